@@ -148,9 +148,17 @@ char const* get_help_msg() {
 
     ////////// f //////////////////////////////////////////////////////////////
 
+    HELP_OPT( "--flwor-threads <n>" )
+      "Evaluate eligible FLWOR \"for\" clauses in parallel on <n> threads.\n\n"
+
     HELP_OPT( "--force-gflwor" )
       "Force the compiler to generate GFLWOR iterators.\n\n"
 
+    ////////// g //////////////////////////////////////////////////////////////
+
+    HELP_OPT( "--groupby-memory-limit <bytes>" )
+      "Spill group-by tuples to temporary files once the groups use more than <bytes> of memory.\n\n"
+
     ////////// h //////////////////////////////////////////////////////////////
 
     HELP_OPT( "--help" )
@@ -161,6 +169,12 @@ char const* get_help_msg() {
     HELP_OPT( "--indent, -i" )
       "Indent output.\n\n"
 
+    HELP_OPT( "--index-build-threads <n>" )
+      "Build sorted value indexes in parallel on <n> threads.\n\n"
+
+    HELP_OPT( "--index-snapshot-dir <dir>" )
+      "Save the build output of declared indexes in <dir>, and reuse it when the indexes are created again over unchanged collections.\n\n"
+
     HELP_OPT( "--infer-joins" )
       "Infer joins.\n\n"
 
@@ -183,6 +197,9 @@ char const* get_help_msg() {
     HELP_OPT( "--lib-path <path>" )
       "Library path (list of directories) where Zorba will look for dynamic libraries (e.g., module external function implementations.\n\n"
 
+    HELP_OPT( "--loader-threads <n>" )
+      "Parse the documents of bulk loading functions in parallel on <n> threads.\n\n"
+
     HELP_OPT( "--loop-hosting" )
       "Hoist expressions out of loops.\n\n"
 
@@ -296,6 +313,9 @@ char const* get_help_msg() {
     HELP_OPT( "--serialize-text" )
       "Serialize the result as text.\n\n"
 
+    HELP_OPT( "--sort-memory-limit <bytes>" )
+      "Spill order-by tuples to temporary files once they use more than <bytes> of memory.\n\n"
+
 #ifndef NDEBUG
     HELP_OPT( "--stable-iterator-ids" )
       "Print the iterator plan with stable IDs.\n\n"
@@ -549,9 +569,20 @@ int parse_args( int argc, char const *argv[] ) {
 
     ////////// f //////////////////////////////////////////////////////////////
 
+    else if ( IS_LONG_OPT( "--flwor-threads" ) ) {
+      PARSE_ARG( "--flwor-threads" );
+      SET_ZPROP( FLWORThreads );
+    }
     else if ( IS_LONG_OPT( "--force-gflwor" ) )
       z_props.setForceGFLWOR( true );
 
+    ////////// g //////////////////////////////////////////////////////////////
+
+    else if ( IS_LONG_OPT( "--groupby-memory-limit" ) ) {
+      PARSE_ARG( "--groupby-memory-limit" );
+      SET_ZPROP( GroupByMemoryLimit );
+    }
+
     ////////// h //////////////////////////////////////////////////////////////
 
     else if ( IS_OPT( "--help", "-h" ) ) {
@@ -566,6 +597,14 @@ int parse_args( int argc, char const *argv[] ) {
 
     else if ( IS_OPT( "--indent", "-i" ) )
       zc_props.indent_ = true;
+    else if ( IS_LONG_OPT( "--index-build-threads" ) ) {
+      PARSE_ARG( "--index-build-threads" );
+      SET_ZPROP( IndexBuildThreads );
+    }
+    else if ( IS_LONG_OPT( "--index-snapshot-dir" ) ) {
+      PARSE_ARG( "--index-snapshot-dir" );
+      z_props.setIndexSnapshotDir( ARG_VAL );
+    }
     else if ( IS_LONG_OPT( "--infer-joins" ) ) {
       PARSE_ARG( "--infer-joins" );
       z_props.setInferJoins( bool_of( ARG_VAL ) );
@@ -605,6 +644,10 @@ int parse_args( int argc, char const *argv[] ) {
       PARSE_ARG( "--lib-path" );
       zc_props.lib_path_ = ARG_VAL;
     }
+    else if ( IS_LONG_OPT( "--loader-threads" ) ) {
+      PARSE_ARG( "--loader-threads" );
+      SET_ZPROP( LoaderThreads );
+    }
     else if ( IS_LONG_OPT( "--loop-hoisting" ) ) {
       PARSE_ARG( "--loop-hoisting" );
       z_props.setLoopHoisting( bool_of( ARG_VAL ) );
@@ -760,6 +803,10 @@ int parse_args( int argc, char const *argv[] ) {
       zc_props.serialize_plan_ = true;
     else if ( IS_LONG_OPT( "--serialize-text" ) )
       zc_props.serialize_text_ = true;
+    else if ( IS_LONG_OPT( "--sort-memory-limit" ) ) {
+      PARSE_ARG( "--sort-memory-limit" );
+      SET_ZPROP( SortMemoryLimit );
+    }
 #ifndef NDEBUG
     else if ( IS_LONG_OPT( "--stable-iterator-ids" ) )
       z_props.setStableIteratorIDs( true );
@@ -68,6 +68,19 @@ class ZORBA_DLL_PUBLIC Collection : public SmartObject
    */
   virtual void
   insertNodesLast(const ItemSequence_t& aNodes) = 0;
+
+  /**
+   * This function loads the documents at the given URIs and inserts them
+   * at the end of the collection, in the order of the URIs. The documents
+   * are parsed in parallel if the number of loader threads has been set
+   * (see Properties::setLoaderThreads()).
+   *
+   * @param aURIs The sequence of xs:string items with the URIs of the
+   *        documents to load.
+   *
+   */
+  virtual void
+  insertDocumentsLast(const ItemSequence_t& aURIs) = 0;
   
   /**
    * This function inserts copies of the given
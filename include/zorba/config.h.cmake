@@ -124,6 +124,7 @@ typedef __int64 int64_t;
 // C++11 language features
 #cmakedefine ZORBA_CXX_NULLPTR
 #cmakedefine ZORBA_CXX_STATIC_ASSERT
+#cmakedefine ZORBA_CXX_THREAD_LOCAL
 
 // C++11 types
 #cmakedefine ZORBA_HAVE_ENABLE_IF
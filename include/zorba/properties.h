@@ -117,6 +117,22 @@ public:
     dump_lib_ = b;
   }
 
+  unsigned getFLWORThreads() const {
+    return flwor_threads_;
+  }
+
+  /**
+   * Sets the number of threads used to evaluate eligible FLWOR "for" clauses
+   * in parallel. Values of 0 or 1 disable parallel FLWOR evaluation (the
+   * default). Parallel evaluation is never used when Zorba is compiled with
+   * ZORBA_FOR_ONE_THREAD_ONLY.
+   *
+   * @param n The number of threads.
+   */
+  void setFLWORThreads( unsigned n ) {
+    flwor_threads_ = n;
+  }
+
   bool getForceGFLWOR() const {
     return force_gflwor_;
   }
@@ -125,6 +141,65 @@ public:
     force_gflwor_ = b;
   }
 
+  size_t getGroupByMemoryLimit() const {
+    return groupby_memory_limit_;
+  }
+
+  /**
+   * Sets the approximate number of bytes a group-by may use to hold its
+   * groups. Once the limit is exceeded, tuples that do not belong to a group
+   * already in memory are partitioned by key into temporary files, and the
+   * partitions are grouped one at a time after the in-memory groups. Tuples
+   * that contain nodes, functions, or JSON items are never written to disk.
+   *
+   * @param limit The limit in bytes; 0 (the default) means no limit.
+   */
+  void setGroupByMemoryLimit( size_t limit ) {
+    groupby_memory_limit_ = limit;
+  }
+
+  unsigned getIndexBuildThreads() const {
+    return index_build_threads_;
+  }
+
+  /**
+   * Sets the number of threads used to build sorted value indexes when they
+   * are created or refreshed. Values of 0 or 1 insert the index entries one
+   * after the other (the default). Parallel builds are never used when Zorba
+   * is compiled with ZORBA_FOR_ONE_THREAD_ONLY.
+   *
+   * @param n The number of threads.
+   */
+  void setIndexBuildThreads( unsigned n ) {
+    index_build_threads_ = n;
+  }
+
+  std::string const& getIndexSnapshotDir() const {
+    return index_snapshot_dir_;
+  }
+
+  /**
+   * Sets the directory of index snapshots. When set, the output of the build
+   * plan of a declared index is saved there whenever the index is created or
+   * refreshed, together with a stamp of the contents of its source
+   * collections. Creating or refreshing the index again, e.g., after a
+   * restart, replays the saved output instead of evaluating the domain and
+   * key expressions, provided that the index declaration, the library modules
+   * of the query, and the contents of the source collections have not
+   * changed. The directory is created if needed.
+   *
+   * @param dir The directory; empty (the default) disables snapshots.
+   */
+  void setIndexSnapshotDir( char const *dir ) {
+    index_snapshot_dir_ = dir;
+  }
+
+  template<class StringType>
+  typename std::enable_if<ZORBA_HAS_C_STR(StringType),void>::type
+  setIndexSnapshotDir( StringType const &dir ) {
+    setIndexSnapshotDir( dir.c_str() );
+  }
+
   bool getInferJoins() const {
     return infer_joins_;
   }
@@ -186,6 +261,23 @@ public:
     setClassPath( jvmClasspath );
   }
 
+  unsigned getLoaderThreads() const {
+    return loader_threads_;
+  }
+
+  /**
+   * Sets the number of threads used to parse the documents given to bulk
+   * loading functions such as
+   * <code>dml:insert-last-documents()</code>. Values of 0 or 1 parse the
+   * documents one after the other (the default). Parallel parsing is never
+   * used when Zorba is compiled with ZORBA_FOR_ONE_THREAD_ONLY.
+   *
+   * @param n The number of threads.
+   */
+  void setLoaderThreads( unsigned n ) {
+    loader_threads_ = n;
+  }
+
   bool getLoopHoisting() const {
     return loop_hoisting_;
   }
@@ -240,6 +332,32 @@ public:
 
   void setOptimizationLevel( unsigned optimization_level );
 
+  std::string const& getPlanCacheDir() const {
+    return plan_cache_dir_;
+  }
+
+  /**
+   * Sets the directory of the persistent plan cache. When set, a query that
+   * is compiled without a user-provided static context is looked up in the
+   * cache first; if a plan for the same query text, file name, compiler
+   * hints, and compiler properties is found, and none of the library modules
+   * the query imports has changed since, the plan is loaded instead of
+   * compiling the query. Otherwise, the query is compiled and its plan is
+   * added to the cache. The directory is created if needed, and may be shared
+   * by several processes.
+   *
+   * @param dir The directory; empty (the default) disables the cache.
+   */
+  void setPlanCacheDir( char const *dir ) {
+    plan_cache_dir_ = dir;
+  }
+
+  template<class StringType>
+  typename std::enable_if<ZORBA_HAS_C_STR(StringType),void>::type
+  setPlanCacheDir( StringType const &dir ) {
+    setPlanCacheDir( dir.c_str() );
+  }
+
   Zorba_plan_format_t getPlanFormat() const {
     return plan_format_;
   }
@@ -322,6 +440,22 @@ public:
     collect_profile_ = format != PROFILE_FORMAT_NONE ? true : collect_profile_;
   }
 
+  size_t getSortMemoryLimit() const {
+    return sort_memory_limit_;
+  }
+
+  /**
+   * Sets the approximate number of bytes an order-by may use to buffer the
+   * tuples it sorts. Once the limit is exceeded, sorted runs of the buffered
+   * tuples are spilled to temporary files and merged at the end. Tuples that
+   * contain nodes, functions, or JSON items are never spilled.
+   *
+   * @param limit The limit in bytes; 0 (the default) means no limit.
+   */
+  void setSortMemoryLimit( size_t limit ) {
+    sort_memory_limit_ = limit;
+  }
+
   bool getStableIteratorIDs() const {
     return stable_iterator_ids_;
   }
@@ -394,15 +528,21 @@ private:
   stream_ptr             debug_stream_;
   bool                   owns_debug_stream_;
   bool                   dump_lib_;
+  unsigned               flwor_threads_;
   bool                   force_gflwor_;
+  size_t                 groupby_memory_limit_;
+  unsigned               index_build_threads_;
+  std::string            index_snapshot_dir_;
   bool                   infer_joins_;
   bool                   inline_udf_;
+  unsigned               loader_threads_;
   bool                   loop_hoisting_;
   uint32_t               max_udf_call_depth_;
   bool                   no_copy_optim_;
   bool                   no_tree_ids_;
   bool                   no_uncalled_iterators_;
   unsigned               optimization_level_;
+  std::string            plan_cache_dir_;
   Zorba_plan_format_t    plan_format_;
   bool                   print_ast_;
   bool                   print_intermediate_opt_;
@@ -412,6 +552,7 @@ private:
   bool                   print_static_types_;
   bool                   print_translated_;
   Zorba_profile_format_t profile_format_;
+  size_t                 sort_memory_limit_;
   bool                   stable_iterator_ids_;
   bool                   trace_codegen_;
 #ifndef ZORBA_NO_FULL_TEXT
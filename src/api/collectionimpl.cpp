@@ -172,6 +172,27 @@ CollectionImpl::insertNodesLast(const ItemSequence_t& aNodes)
 }
 
 
+/*******************************************************************************
+
+********************************************************************************/
+void
+CollectionImpl::insertDocumentsLast(const ItemSequence_t& aURIs)
+{
+  ZORBA_DM_TRY
+  {
+    std::vector<ItemSequence_t> lArgs;
+    lArgs.push_back(new SingletonItemSequence(theQName));
+    lArgs.push_back(aURIs);
+
+    if ( theNS.find( "w3c" ) != std::string::npos )
+      invoke("insert-documents-last", lArgs);
+    else
+      invoke("insert-last-documents", lArgs);
+  }
+  ZORBA_DM_CATCH
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
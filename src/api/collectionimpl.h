@@ -98,6 +98,9 @@ protected:
   
   virtual void
   insertNodesLast(const ItemSequence_t& aNodes);
+
+  virtual void
+  insertDocumentsLast(const ItemSequence_t& aURIs);
   
   virtual void
   insertNodesBefore(const Item& aTarget, const ItemSequence_t& aNodes);
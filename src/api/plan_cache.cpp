@@ -0,0 +1,298 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+#ifdef WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <zorba/config.h>
+#include <zorba/properties.h>
+
+#include "api/plan_cache.h"
+
+#include "context/static_context.h"
+#include "context/uri_resolver.h"
+
+#include "system/globalenv.h"
+
+#include "util/fs_util.h"
+#include "zorbautils/hashfun.h"
+
+
+namespace zorba
+{
+
+static char const PLAN_CACHE_MAGIC[] = "zorba-plan-cache-1";
+
+static uint64_t const MAX_FIELD_SIZE = 1UL << 30;
+
+
+/*******************************************************************************
+  The fields of the key and of the header of an entry are written as
+  "<size>:<bytes>\n", so that no field can run into the next one.
+********************************************************************************/
+static void write_field(std::ostream& os, const std::string& field)
+{
+  os << field.size() << ':' << field << '\n';
+}
+
+
+static bool read_field(std::istream& is, std::string& field)
+{
+  uint64_t size;
+
+  if (!(is >> size) || is.get() != ':' || size > MAX_FIELD_SIZE)
+    return false;
+
+  field.resize(size);
+
+  if (size > 0 && !is.read(&field[0], size))
+    return false;
+
+  return is.get() == '\n';
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+bool PlanCache::isEnabled()
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  Properties const& props = Properties::instance();
+
+  return !props.getPlanCacheDir().empty() &&
+         props.getPlanFormat() == PLAN_FORMAT_NONE &&
+         !props.getPrintAST() &&
+         !props.getPrintTranslated() &&
+         !props.getPrintOptimized() &&
+         !props.getPrintIntermediateOpt() &&
+         !props.getTraceParsing() &&
+         !props.getTraceScanning() &&
+         !props.getTraceTranslator() &&
+         !props.getTraceCodegen();
+#else
+  return false;
+#endif
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+PlanCache::PlanCache(
+    const std::string& query,
+    const zstring& fileName,
+    const Zorba_CompilerHints_t& hints)
+{
+  Properties const& props = Properties::instance();
+
+  std::ostringstream key;
+
+  write_field(key, ZORBA_VERSION);
+#ifdef NDEBUG
+  write_field(key, "release");
+#else
+  write_field(key, "debug");
+#endif
+  write_field(key, query);
+  write_field(key, fileName.str());
+
+  key << hints.opt_level << ' '
+      << hints.lib_module << ' '
+      << hints.for_serialization_only << ' '
+      << props.getFLWORThreads() << ' '
+      << props.getForceGFLWOR() << ' '
+      << props.getInferJoins() << ' '
+      << props.getInlineUDF() << ' '
+      << props.getLoopHoisting() << ' '
+      << props.getNoCopyOptim() << ' '
+      << props.getUseIndexes() << '\n';
+
+  theKey = key.str();
+
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0')
+       << hashfun::h64(theKey, FNV_64_INIT) << ".plan";
+
+  thePath = props.getPlanCacheDir();
+  fs::append(thePath, name.str());
+}
+
+
+/*******************************************************************************
+  Check whether the given module still resolves to the text it had when the
+  plan was cached.
+********************************************************************************/
+bool PlanCache::isCurrent(const CompilerCB::ModuleSource& module)
+{
+  try
+  {
+    zstring errorMsg;
+
+    std::unique_ptr<internal::Resource> resource =
+    GENV.getRootStaticContext().resolve_uri(module.theURI,
+                                            internal::EntityData::MODULE,
+                                            errorMsg);
+
+    internal::StreamResource* streamResource =
+    dynamic_cast<internal::StreamResource*>(resource.get());
+
+    if (streamResource == NULL)
+      return false;
+
+    std::istream& stream = *streamResource->getStream();
+
+    std::string text((std::istreambuf_iterator<char>(stream)),
+                     std::istreambuf_iterator<char>());
+
+    return CompilerCB::ModuleSource::hash(text) == module.theHash;
+  }
+  catch (std::exception const&)
+  {
+    return false;
+  }
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+bool PlanCache::lookup(std::string& plan) const
+{
+  std::ifstream is(thePath.c_str(), std::ios::in | std::ios::binary);
+
+  if (!is.is_open())
+    return false;
+
+  std::string magic;
+  std::string key;
+
+  if (!read_field(is, magic) || magic != PLAN_CACHE_MAGIC ||
+      !read_field(is, key) || key != theKey)
+    return false;
+
+  csize numModules;
+  if (!(is >> numModules) || is.get() != '\n')
+    return false;
+
+  for (csize i = 0; i < numModules; ++i)
+  {
+    std::string uri;
+    CompilerCB::ModuleSource module;
+
+    if (!read_field(is, uri) || !(is >> std::hex >> module.theHash >> std::dec) ||
+        is.get() != '\n')
+      return false;
+
+    module.theURI = uri;
+
+    if (!isCurrent(module))
+      return false;
+  }
+
+  plan.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+
+  return !plan.empty();
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void PlanCache::store(
+    const CompilerCB::ModuleSources& modules,
+    const std::string& plan) const
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  // Write to a file of our own, so that concurrent writers of the same entry
+  // do not interleave, and then move it in place.
+  std::ostringstream tmpPath;
+  tmpPath << thePath << '.'
+#ifdef WIN32
+          << _getpid();
+#else
+          << getpid();
+#endif
+
+  try
+  {
+    std::string const& dir = Properties::instance().getPlanCacheDir();
+
+    if (fs::get_type(dir) != fs::directory)
+      fs::mkdir(dir, true);
+
+    {
+      std::ofstream os(tmpPath.str().c_str(), std::ios::out | std::ios::binary);
+
+      if (!os.is_open())
+        return;
+
+      write_field(os, PLAN_CACHE_MAGIC);
+      write_field(os, theKey);
+
+      os << modules.size() << '\n';
+
+      for (csize i = 0; i < modules.size(); ++i)
+      {
+        write_field(os, modules[i].theURI.str());
+        os << std::hex << modules[i].theHash << std::dec << '\n';
+      }
+
+      os.write(plan.data(), plan.size());
+
+      if (!os.good())
+      {
+        os.close();
+        fs::remove(tmpPath.str(), true);
+        return;
+      }
+    }
+
+    fs::rename(tmpPath.str(), thePath);
+  }
+  catch (std::exception const&)
+  {
+    try
+    {
+      fs::remove(tmpPath.str(), true);
+    }
+    catch (std::exception const&)
+    {
+    }
+  }
+#endif
+}
+
+
+} // namespace zorba
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#ifndef ZORBA_API_PLAN_CACHE_H
+#define ZORBA_API_PLAN_CACHE_H
+
+#include <string>
+
+#include <zorba/options.h>
+
+#include "compiler/api/compilercb.h"
+#include "zorbatypes/zstring.h"
+
+
+namespace zorba
+{
+
+/*******************************************************************************
+  A persistent cache of compiled execution plans, kept in the directory given
+  by Properties::getPlanCacheDir().
+
+  Each entry is a file whose name is a hash of the entry's key. The key is made
+  of the Zorba version, the query text, the file name of the query, the
+  compiler hints, and the properties that change what the compiler produces.
+  The file contains:
+
+  - the full key, so that hash collisions are detected,
+  - the URI and a hash of the text of every library module that the query
+    imports, directly or indirectly (see CompilerCB::theModuleSources), and
+  - the execution plan, in the format of XQuery::saveExecutionPlan().
+
+  An entry is used only if each of its modules still resolves to a text with
+  the same hash, so changing an imported module invalidates the plans of all
+  the queries that import it. Entries are written to a temporary file which is
+  then renamed, so other processes sharing the directory never see a partial
+  entry.
+
+  Only queries that are compiled without a user-provided static context are
+  cached, because such a context may contain things (e.g., external functions,
+  URI resolvers) that are not part of the key and may not be serializable.
+********************************************************************************/
+class PlanCache
+{
+protected:
+  std::string  theKey;
+  std::string  thePath;
+
+public:
+  /**
+   * Whether the cache is in use: a cache directory has been set, and none of
+   * the properties that print or trace the compilation is set (a cached plan
+   * would silently skip these outputs).
+   */
+  static bool isEnabled();
+
+  PlanCache(
+      const std::string& query,
+      const zstring& fileName,
+      const Zorba_CompilerHints_t& hints);
+
+  /**
+   * Puts into plan the cached plan of the query, if there is one and it is up
+   * to date. Returns false otherwise.
+   */
+  bool lookup(std::string& plan) const;
+
+  /**
+   * Caches the given plan of the query, which imports the given modules.
+   * Failures to write the entry are ignored.
+   */
+  void store(
+      const CompilerCB::ModuleSources& modules,
+      const std::string& plan) const;
+
+protected:
+  static bool isCurrent(const CompilerCB::ModuleSource& module);
+};
+
+
+} // namespace zorba
+
+#endif /* ZORBA_API_PLAN_CACHE_H */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
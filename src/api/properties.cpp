@@ -40,9 +40,13 @@ Properties::Properties() {
   collect_profile_ = false;
   debug_stream_.reset( &cout );
   dump_lib_ = false;
+  flwor_threads_ = 0;
   force_gflwor_ = false;
+  groupby_memory_limit_ = 0;
+  index_build_threads_ = 0;
   infer_joins_ = true;
   inline_udf_ = true;
+  loader_threads_ = 0;
   loop_hoisting_ = true;
   max_udf_call_depth_ = 1024;
   no_copy_optim_ = true;
@@ -58,6 +62,7 @@ Properties::Properties() {
   print_static_types_ = true;
   print_translated_ = false;
   profile_format_ = PROFILE_FORMAT_NONE;
+  sort_memory_limit_ = 0;
   stable_iterator_ids_ = false;
   trace_codegen_ = false;
 #ifndef ZORBA_NO_FULL_TEXT
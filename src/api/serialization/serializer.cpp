@@ -88,6 +88,69 @@ static void tokenize(
   }
 }
 
+
+namespace
+{
+
+/*******************************************************************************
+  The output buffer of emitter::emit_expanded_string(). Writing the expanded
+  string character by character through the (possibly transcoding) output
+  stream is expensive, so the characters are collected in the buffer and
+  written to the stream in chunks of BUFFER_SIZE bytes. Runs of characters
+  that are longer than the buffer are written directly.
+********************************************************************************/
+class expansion_buffer
+{
+public:
+  enum { BUFFER_SIZE = 8192 };
+
+protected:
+  std::ostream  & theStream;
+  char            theBuffer[BUFFER_SIZE];
+  size_t          theSize;
+
+public:
+  expansion_buffer(std::ostream& stream) : theStream(stream), theSize(0) { }
+
+  void append(char c)
+  {
+    if (theSize == BUFFER_SIZE)
+      flush();
+
+    theBuffer[theSize++] = c;
+  }
+
+  void append(const char* s, size_t n)
+  {
+    if (n > BUFFER_SIZE - theSize)
+    {
+      flush();
+
+      if (n >= BUFFER_SIZE)
+      {
+        theStream.write(s, n);
+        return;
+      }
+    }
+
+    memcpy(theBuffer + theSize, s, n);
+    theSize += n;
+  }
+
+  void append(const char* s) { append(s, strlen(s)); }
+
+  void flush()
+  {
+    if (theSize > 0)
+    {
+      theStream.write(theBuffer, theSize);
+      theSize = 0;
+    }
+  }
+};
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 //  Default emitter                                                           //
@@ -167,9 +230,24 @@ int serializer::emitter::emit_expanded_string(
 {
   const unsigned char* chars = (const unsigned char*)str;
   const unsigned char* chars_end  = chars + strlen;
+  expansion_buffer out(tr);
 
   for (; chars < chars_end; chars++ )
   {
+    // Copy the run of printable ASCII characters that need no escaping.
+    const unsigned char* run_end = reinterpret_cast<const unsigned char*>(
+      ascii::find_escapable(reinterpret_cast<const char*>(chars),
+                            reinterpret_cast<const char*>(chars_end),
+                            "<>&\""));
+
+    if (run_end != chars)
+    {
+      out.append(reinterpret_cast<const char*>(chars), run_end - chars);
+      chars = run_end;
+
+      if (chars == chars_end)
+        break;
+    }
 
     // the input string is UTF-8
     int char_length;
@@ -183,7 +261,10 @@ int serializer::emitter::emit_expanded_string(
     }
 
     if (char_length > chars_end - chars)
+    {
+      out.flush();
       return chars_end - chars;
+    }
 
     if (char_length > 1)
     {
@@ -203,14 +284,16 @@ int serializer::emitter::emit_expanded_string(
       if (cp >= 0x10000 && cp <= 0x10FFFF)
       {
         ascii::itoa_buf_type cp_buf;
-        tr << "&#" << ascii::itoa(cp, cp_buf) << ';';
+        out.append("&#");
+        out.append(ascii::itoa(cp, cp_buf));
+        out.append(';');
         chars += (char_length-1);
       }
       else
       {
         while (char_length)
         {
-          tr << *chars;
+          out.append(static_cast<char>(*chars));
           if (char_length > 1)
             chars++;
           char_length--;
@@ -248,13 +331,15 @@ int serializer::emitter::emit_expanded_string(
     {
       if ((!emit_attribute_value) && (*chars == 0xA || *chars == 0x9))
       {
-        tr << *chars;
+        out.append(static_cast<char>(*chars));
       }
       else
       {
         char buf[3];
         zorba::xml::toHexString(*chars, buf);
-        tr << "&#x" << buf << ";";
+        out.append("&#x");
+        out.append(buf);
+        out.append(';');
       }
     }
     else switch (*chars)
@@ -265,20 +350,20 @@ int serializer::emitter::emit_expanded_string(
           attribute values.
         */
         if (ser && ser->method == PARAMETER_VALUE_HTML && emit_attribute_value)
-          tr << *chars;
+          out.append(static_cast<char>(*chars));
         else
-          tr << "&lt;";
+          out.append("&lt;");
         break;
 
       case '>':
-        tr << "&gt;";
+        out.append("&gt;");
         break;
 
       case '"':
         if (emit_attribute_value)
-          tr << "&quot;";
+          out.append("&quot;");
         else
-          tr << *chars;
+          out.append(static_cast<char>(*chars));
         break;
 
       case '&':
@@ -292,22 +377,23 @@ int serializer::emitter::emit_expanded_string(
           if (chars_end - chars > 1
             &&
             (*(chars+1) == '{'))
-            tr << *chars;
+            out.append(static_cast<char>(*chars));
           else
-            tr << "&amp;";
+            out.append("&amp;");
         }
         else
         {
-          tr << "&amp;";
+          out.append("&amp;");
         }
         break;
 
       default:
-        tr << *chars;
+        out.append(static_cast<char>(*chars));
         break;
     } // switch
   } // for
 
+  out.flush();
   return 0;
 }
 
@@ -20,6 +20,7 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <iterator>
 #include "zorbatypes/schema_types.h"
 
 #include <zorba/audit_scoped.h>
@@ -50,6 +51,7 @@
 #include "api/auditimpl.h"
 #include "api/staticcollectionmanagerimpl.h"
 #include "api/item_iter_vector.h"
+#include "api/plan_cache.h"
 
 #include "context/static_context.h"
 #include "context/dynamic_context.h"
@@ -412,11 +414,7 @@ void XQueryImpl::compile(const String& aQuery, const Zorba_CompilerHints_t& aHin
 
     std::istringstream lQueryStream(aQuery.c_str());
 
-    // 0 is reserved as an invalid var id, and 1 is taken by the context item
-    // in the main module.
-    ulong nextVarId = dynamic_context::MAX_IDVARS_RESERVED;
-
-    doCompile(lQueryStream, aHints, true, nextVarId);
+    doCompileCached(lQueryStream, aHints);
   }
   QUERY_CATCH
 }
@@ -436,11 +434,7 @@ void XQueryImpl::compile(
     checkNotClosed();
     checkNotCompiled();
 
-    // 0 is reserved as an invalid var id, and 1 is taken by the context item
-    // in the main module.
-    ulong nextVarId = dynamic_context::MAX_IDVARS_RESERVED;
-
-    doCompile(aQuery, aHints, true, nextVarId);
+    doCompileCached(aQuery, aHints);
   }
   QUERY_CATCH
 }
@@ -596,6 +590,83 @@ void XQueryImpl::doCompile(
 }
 
 
+/*******************************************************************************
+  Compile a query that has no user-provided static context, going through the
+  plan cache if it is enabled (see api/plan_cache.h): on a hit, the cached plan
+  is loaded as in loadExecutionPlan(); on a miss, the query is compiled and its
+  plan is saved as in saveExecutionPlan(). A cached plan that cannot be loaded
+  is ignored, and so are failures to save the plan.
+
+  Always called while holding theMutex
+********************************************************************************/
+void XQueryImpl::doCompileCached(
+    std::istream& aQuery,
+    const Zorba_CompilerHints_t& aHints)
+{
+  // 0 is reserved as an invalid var id, and 1 is taken by the context item
+  // in the main module.
+  ulong nextVarId = dynamic_context::MAX_IDVARS_RESERVED;
+
+  bool useCache = PlanCache::isEnabled();
+
+#ifdef ZORBA_WITH_DEBUGGER
+  useCache = useCache && !theIsDebugMode;
+#endif
+
+  if (!useCache)
+  {
+    doCompile(aQuery, aHints, true, nextVarId);
+    return;
+  }
+
+  std::string lQuery((std::istreambuf_iterator<char>(aQuery)),
+                     std::istreambuf_iterator<char>());
+
+  PlanCache lCache(lQuery, theFileName, aHints);
+
+  std::string lPlan;
+
+  if (lCache.lookup(lPlan))
+  {
+    try
+    {
+      std::istringstream lPlanStream(lPlan);
+      zorba::serialization::BinArchiver bin_ar(&lPlanStream);
+      serialize(bin_ar);
+      bin_ar.finalize_input_serialization();
+      return;
+    }
+    catch (ZorbaException const&)
+    {
+      // Start over from an uncompiled query.
+      delete theCompilerCB;
+      theCompilerCB = new CompilerCB(theXQueryDiagnostics);
+      thePlanProxy = NULL;
+      theStaticContext = NULL;
+    }
+  }
+
+  std::istringstream lQueryStream(lQuery);
+
+  doCompile(lQueryStream, aHints, true, nextVarId);
+
+  try
+  {
+    std::ostringstream lPlanStream;
+    zorba::serialization::BinArchiver bin_ar(&lPlanStream);
+    serialize(bin_ar);
+    bin_ar.serialize_out();
+
+    lCache.store(theCompilerCB->theModuleSources, lPlanStream.str());
+  }
+  catch (ZorbaException const&)
+  {
+    // Some plans cannot be serialized (e.g. ones that refer to external
+    // functions); they are just not cached.
+  }
+}
+
+
 /*******************************************************************************
   This method is not part of the XQuery public API. Instead it is invoked from
   the StaticContextImpl::loadProlog() method, which is also the one that creates
@@ -346,6 +346,8 @@ protected:
         bool fork_sctx,
         ulong& nextVarId);
 
+  void doCompileCached(std::istream&, const Zorba_CompilerHints_t& aHints);
+
   PlanWrapper_t generateWrapper();
 
   // special serialize and applyUpdate function that is used by debugger
@@ -79,6 +79,9 @@ typedef rchandle<LetVarIterator> LetVarIter_t;
 class ValueIndexInsertSession;
 typedef rchandle<ValueIndexInsertSession> ValueIndexInsertSession_t;
 
+class HashJoinTable;
+typedef rchandle<HashJoinTable> HashJoinTable_t;
+
 
 // Parsenodes
 class parsenode;
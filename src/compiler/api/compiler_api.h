@@ -26,6 +26,8 @@
 namespace zorba 
 {
 
+class ModuleCache;
+
 
 /********************************************************************************
 
@@ -97,6 +99,8 @@ public:
 
   virtual Rewriter* getDefaultOptimizingRewriter() = 0;
 
+  virtual ModuleCache& getModuleCache() = 0;
+
 private:
   static std::unique_ptr<XQueryCompilerSubsystem> create();
 };
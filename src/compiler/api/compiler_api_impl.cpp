@@ -17,6 +17,7 @@
 
 #include "compiler/api/compiler_api_impl.h"
 #include "compiler/api/compilercb.h"
+#include "compiler/api/module_cache.h"
 #include "compiler/rewriter/framework/default_optimizer.h"
 
 
@@ -24,7 +25,8 @@ namespace zorba {
 
 XQueryCompilerSubsystemImpl::XQueryCompilerSubsystemImpl()
   :
-  m_defaultOptimizer(new DefaultOptimizer())
+  m_defaultOptimizer(new DefaultOptimizer()),
+  m_moduleCache(new ModuleCache())
 {
 }
 
@@ -39,5 +41,11 @@ Rewriter *XQueryCompilerSubsystemImpl::getDefaultOptimizingRewriter()
   return m_defaultOptimizer.get();
 }
 
+
+ModuleCache& XQueryCompilerSubsystemImpl::getModuleCache()
+{
+  return *m_moduleCache;
+}
+
 }
 /* vim:set et sw=2 ts=2: */
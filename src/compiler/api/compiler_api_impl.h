@@ -27,12 +27,15 @@ class XQueryCompilerSubsystemImpl : public XQueryCompilerSubsystem
 
 private:
   std::unique_ptr<Rewriter> m_defaultOptimizer;
+  std::unique_ptr<ModuleCache> m_moduleCache;
 
 public:
   ~XQueryCompilerSubsystemImpl();
 
   Rewriter *getDefaultOptimizingRewriter();
 
+  ModuleCache& getModuleCache();
+
 private:
   XQueryCompilerSubsystemImpl();
 };
@@ -29,6 +29,7 @@
 
 #include "zorbaserialization/serialize_template_types.h"
 #include "zorbaserialization/serialize_zorba_types.h"
+#include "zorbautils/hashfun.h"
 
 
 namespace zorba
@@ -270,6 +271,15 @@ CompilerCB::lookup_pragma(
 }
 
 
+/*******************************************************************************
+
+********************************************************************************/
+uint64_t CompilerCB::ModuleSource::hash(const std::string& text)
+{
+  return hashfun::h64(text, FNV_64_INIT);
+}
+
+
 
 } /* namespace zorba */
 /* vim:set et sw=2 ts=2: */
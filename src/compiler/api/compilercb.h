@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <map>
+#include <string>
 
 #include <zorba/config.h>
 
@@ -138,6 +139,14 @@ class ExprManager;
   flag belongs to the static context, but it is also held here because it needs
   to be available during compilation and translation in order to raise warnings.
 
+  theModuleSources :
+  ------------------
+  The (versioned) URI of each library module that was imported by the query,
+  directly or indirectly, together with a hash of the module's text. It is
+  filled by TranslatorImpl::end_visit(ModuleImport) and used by the plan cache
+  (see api/plan_cache.h) to tell whether a cached plan is out of date. It is
+  not serialized.
+
 ********************************************************************************/
 class CompilerCB : public zorba::serialization::SerializeBaseClass
 {
@@ -191,6 +200,16 @@ public:
 
   typedef PragmaMap::const_iterator PragmaMapIter;
 
+  struct ModuleSource
+  {
+    zstring   theURI;
+    uint64_t  theHash;
+
+    static uint64_t hash(const std::string& text);
+  };
+
+  typedef std::vector<ModuleSource> ModuleSources;
+
 public:
   XQueryDiagnostics       * theXQueryDiagnostics;
 
@@ -228,6 +247,8 @@ public:
   
   bool                      theCommonLanguageEnabled;
 
+  ModuleSources             theModuleSources;
+
 public:
   SERIALIZABLE_CLASS(CompilerCB);
   CompilerCB(::zorba::serialization::Archiver& ar);
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <sstream>
+
+#include <zorba/properties.h>
+
+#include "compiler/api/module_cache.h"
+#include "compiler/api/compiler_api.h"
+#include "compiler/api/compilercb.h"
+
+#include "context/static_context.h"
+
+#include "zorbautils/lock.h"
+
+
+namespace zorba
+{
+
+/*******************************************************************************
+
+********************************************************************************/
+ModuleCache::Handle::~Handle()
+{
+  if (theEntry != NULL)
+    theCache->release(theEntry);
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void ModuleCache::parse(
+    XQueryCompiler& compiler,
+    const zstring& uri,
+    const zstring& url,
+    const std::string& text,
+    Handle& handle)
+{
+  CompilerCB* ccb = compiler.theCompilerCB;
+
+  // The parser reports the AST and the common-language warnings as it goes,
+  // so these cannot be served from the cache.
+  if (Properties::instance().getPrintAST() || ccb->theCommonLanguageEnabled)
+  {
+    std::istringstream stream(text);
+    handle.thePrivateTree = compiler.parse(stream, url);
+    return;
+  }
+
+  // Text without a "jsoniq" or "xquery" version declaration is parsed in the
+  // language of the importing query, and the parser builds different trees
+  // for FLWOR exprs when force_gflwor is set.
+  zstring key = uri;
+  key += '\n';
+  key += url;
+  key += '\n';
+  key += (ccb->theRootSctx != NULL &&
+          ccb->theRootSctx->language_kind() ==
+          StaticContextConsts::language_kind_jsoniq ? "jsoniq" : "xquery");
+  key += (ccb->theConfig.force_gflwor ? "\ngflwor" : "");
+
+  uint64_t hash = CompilerCB::ModuleSource::hash(text);
+
+  {
+    SYNC_CODE(AutoMutex lock(&theMutex);)
+
+    Entries::iterator ite = theEntries.find(key);
+
+    if (ite != theEntries.end() &&
+        ite->second.theHash == hash &&
+        ite->second.theTree != NULL &&
+        !ite->second.theInUse)
+    {
+      ite->second.theInUse = true;
+      handle.theCache = this;
+      handle.theEntry = &ite->second;
+      return;
+    }
+  }
+
+  std::istringstream stream(text);
+  parsenode_t tree = compiler.parse(stream, url);
+
+  SYNC_CODE(AutoMutex lock(&theMutex);)
+
+  Entry& entry = theEntries[key];
+
+  if (entry.theInUse)
+  {
+    // Another compilation is using the cached tree of this module (maybe of
+    // a different version of it); keep the new tree private.
+    handle.thePrivateTree.transfer(tree);
+    return;
+  }
+
+  entry.theHash = hash;
+  entry.theTree.transfer(tree);
+  entry.theInUse = true;
+
+  handle.theCache = this;
+  handle.theEntry = &entry;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void ModuleCache::release(Entry* entry)
+{
+  SYNC_CODE(AutoMutex lock(&theMutex);)
+
+  entry->theInUse = false;
+}
+
+
+} // namespace zorba
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
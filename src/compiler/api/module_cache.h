@@ -0,0 +1,139 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#ifndef ZORBA_COMPILER_API_MODULE_CACHE_H
+#define ZORBA_COMPILER_API_MODULE_CACHE_H
+
+#include <map>
+#include <string>
+
+#include "common/shared_types.h"
+
+#include "compiler/parsetree/parsenode_base.h"
+
+#include "zorbatypes/zstring.h"
+#include "zorbautils/mutex.h"
+
+
+namespace zorba
+{
+
+class XQueryCompiler;
+
+
+/*******************************************************************************
+  A process-wide cache of the parse trees of library modules, shared by all the
+  compilations (including the ones of eval exprs). It is owned by the compiler
+  subsystem (see XQueryCompilerSubsystem::getModuleCache()).
+
+  An entry is identified by the URI of the module, the URL its text was read
+  from, and the parser settings (language, force_gflwor) the text is parsed
+  with. It holds the parse tree of the
+  most recently parsed text for that key, together with the hash of that text
+  (see CompilerCB::ModuleSource::hash()). A cached tree is used only for a text
+  with the same hash, so a module that is changed is parsed again, and the new
+  tree replaces the old one.
+
+  The translator does not modify parse trees, except for some scratch flags
+  that it resets before use, but it does take references to their nodes, and
+  these are not thread-safe. So a cached tree is given to one compilation at a
+  time: the Handle of that compilation has exclusive use of the tree until the
+  Handle is destroyed. A compilation that needs a tree while another one is
+  using it parses the module text itself, without caching the result.
+
+  theEntries: Maps the key of each entry to the entry.
+  theMutex  : Protects theEntries, and the in-use flags and reference counts of
+              the cached trees.
+********************************************************************************/
+class ModuleCache
+{
+protected:
+  struct Entry
+  {
+    uint64_t      theHash;
+    parsenode_t   theTree;
+    bool          theInUse;
+
+    Entry() : theHash(0), theInUse(false) {}
+  };
+
+  typedef std::map<zstring, Entry> Entries;
+
+public:
+  class Handle
+  {
+    friend class ModuleCache;
+
+  protected:
+    ModuleCache  * theCache;
+    Entry        * theEntry;
+    parsenode_t    thePrivateTree;
+
+  public:
+    Handle() : theCache(NULL), theEntry(NULL) {}
+
+    ~Handle();
+
+    const parsenode* get() const
+    {
+      return (theEntry ? theEntry->theTree.getp() : thePrivateTree.getp());
+    }
+
+  private:
+    Handle(const Handle&);
+    void operator=(const Handle&);
+  };
+
+protected:
+  Entries         theEntries;
+  SYNC_CODE(Mutex theMutex;)
+
+public:
+  ModuleCache() {}
+
+  /**
+   * Makes handle refer to the parse tree of the given text of the module with
+   * the given URI, which was read from the given URL. The tree comes from the
+   * cache if possible; otherwise the text is parsed with the given compiler
+   * and, if no other compilation is using the cached tree of the module, the
+   * new tree is cached.
+   */
+  void parse(
+      XQueryCompiler& compiler,
+      const zstring& uri,
+      const zstring& url,
+      const std::string& text,
+      Handle& handle);
+
+protected:
+  void release(Entry* entry);
+
+private:
+  ModuleCache(const ModuleCache&);
+  void operator=(const ModuleCache&);
+};
+
+
+} // namespace zorba
+
+#endif /* ZORBA_COMPILER_API_MODULE_CACHE_H */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
@@ -17,6 +17,7 @@
 
 #include <iostream>
 #include <list>
+#include <set>
 #include <stack>
 #include <vector>
 
@@ -37,6 +38,7 @@
 #include "compiler/api/compilercb.h"
 #include "compiler/codegen/plan_visitor.h"
 #include "compiler/expression/expr.h"
+#include "compiler/expression/expr_iter.h"
 #include "compiler/expression/expr_visitor.h"
 #include "compiler/expression/flwor_expr.h"
 #include "compiler/expression/fo_expr.h"
@@ -200,13 +202,26 @@ struct vector_destroyer
 class VarRebind : public SimpleRCObject
 {
 public:
-  PlanIter_t               theInputVar;
-  std::vector<PlanIter_t>  theOutputVarRefs;
-  bool                     theIsFakeLetVar;
-  bool                     theIsSingleItemLetVar;
+  PlanIter_t                             theInputVar;
+  std::vector<PlanIter_t>                theOutputVarRefs;
+  bool                                   theIsFakeLetVar;
+  bool                                   theIsSingleItemLetVar;
+
+  // For non-grouping vars whose uses are all the argument of an aggregate
+  // function (see has_only_aggregate_uses()): the kinds of the functions
+  // applied to the var, and the var refs that replace the calls of each kind.
+  bool                                   theIsAggregated;
+  std::vector<int>                       theAggregateKinds;
+  std::vector<std::vector<PlanIter_t> >  theAggregateRefs;
 
 public:
-  VarRebind() : theIsFakeLetVar(false), theIsSingleItemLetVar(false) {}
+  VarRebind()
+    :
+    theIsFakeLetVar(false),
+    theIsSingleItemLetVar(false),
+    theIsAggregated(false)
+  {
+  }
 };
 
 
@@ -255,6 +270,82 @@ public:
 typedef rchandle<FlworClauseVarMap> FlworClauseVarMap_t;
 
 
+/*******************************************************************************
+  Check whether the given function call computes an aggregate that a group-by
+  can maintain incrementally for a non-grouping var, and if so, which one.
+********************************************************************************/
+static bool get_group_aggregate(
+    const fo_expr* fo,
+    flwor::GroupAggregate::Kind& kind)
+{
+  if (fo->num_args() != 1)
+    return false;
+
+  switch (fo->get_func()->getKind())
+  {
+  case FunctionConsts::FN_COUNT_1:
+    kind = flwor::GroupAggregate::COUNT;
+    return true;
+  case FunctionConsts::FN_SUM_1:
+  case FunctionConsts::OP_SUM_DOUBLE_1:
+  case FunctionConsts::OP_SUM_FLOAT_1:
+  case FunctionConsts::OP_SUM_DECIMAL_1:
+  case FunctionConsts::OP_SUM_INTEGER_1:
+    kind = flwor::GroupAggregate::SUM;
+    return true;
+  case FunctionConsts::FN_AVG_1:
+    kind = flwor::GroupAggregate::AVG;
+    return true;
+  case FunctionConsts::FN_MIN_1:
+    kind = flwor::GroupAggregate::MIN;
+    return true;
+  case FunctionConsts::FN_MAX_1:
+    kind = flwor::GroupAggregate::MAX;
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+/*******************************************************************************
+  Check whether every use of the given non-grouping var inside e is the sole
+  argument of an aggregate function call (see get_group_aggregate()) in the
+  given static context. If so, the group-by does not need to keep the values
+  of the var, but only the running results of these calls.
+********************************************************************************/
+static bool has_only_aggregate_uses(
+    expr* e,
+    const var_expr* var,
+    const static_context* sctx)
+{
+  if (e == var)
+    return false;
+
+  if (e->get_expr_kind() == fo_expr_kind)
+  {
+    const fo_expr* fo = static_cast<const fo_expr*>(e);
+    flwor::GroupAggregate::Kind kind;
+
+    if (get_group_aggregate(fo, kind) &&
+        fo->get_arg(0) == var &&
+        fo->get_sctx() == sctx)
+      return true;
+  }
+
+  ExprIterator iter(e);
+  while (!iter.done())
+  {
+    if (!has_only_aggregate_uses(**iter, var, sctx))
+      return false;
+
+    iter.next();
+  }
+
+  return true;
+}
+
+
 /******************************************************************************
 
  ******************************************************************************/
@@ -350,6 +441,8 @@ protected:
 
   std::vector<FlworClauseVarMap_t>           theClauseStack;
 
+  std::set<const fo_expr*>                   theGroupAggregates;
+
   CompilerCB                               * theCCB;
 
 #ifdef ZORBA_WITH_DEBUGGER
@@ -1156,6 +1249,9 @@ bool begin_visit(flwor_expr& v)
 
       visit_flwor_clause(c, isGeneral);
 
+      if (!isGeneral && !v.is_sequential())
+        mark_group_aggregates(v, i, theClauseStack.back());
+
       break;
     }
 
@@ -1220,7 +1316,66 @@ void end_visit(flwor_expr& v)
 
     PlanIter_t gflwor = gflwor_codegen(v, v.num_clauses() - 1);
 
-    push_itstack(new flwor::TupleStreamIterator(sctx, qloc, gflwor, ret, false));
+    flwor::TupleStreamIterator* iter =
+    new flwor::TupleStreamIterator(sctx, qloc, gflwor, ret, false);
+
+    if (v.get_return_expr()->get_return_type()->min_card() >= 1)
+      iter->setTopKSort();
+
+    push_itstack(iter);
+  }
+}
+
+
+/*******************************************************************************
+  Mark the non-grouping vars of the groupby clause at position groupPos of a
+  non-general flwor whose values are needed only as the arguments of aggregate
+  functions. The calls are then computed incrementally by the group-by (see
+  begin_visit(fo_expr&)).
+********************************************************************************/
+void mark_group_aggregates(
+    flwor_expr& v,
+    csize groupPos,
+    FlworClauseVarMap* clauseVarMap)
+{
+  csize numClauses = v.num_clauses();
+
+  // A materialize clause would rebind the vars.
+  for (csize i = groupPos + 1; i < numClauses; ++i)
+  {
+    if (v.get_clause(i)->get_kind() != flwor_clause::orderby_clause)
+      return;
+  }
+
+  const groupby_clause* gc = static_cast<const groupby_clause*>(v.get_clause(groupPos));
+  const flwor_clause::rebind_list_t& ngvars = gc->get_nongrouping_vars();
+  csize numGroupVars = gc->get_grouping_vars().size();
+
+  for (csize j = 0; j < ngvars.size(); ++j)
+  {
+    const var_expr* var = ngvars[j].second;
+    bool aggregated = true;
+
+    for (csize i = groupPos + 1; aggregated && i < numClauses; ++i)
+    {
+      const orderby_clause* oc = static_cast<const orderby_clause*>(v.get_clause(i));
+
+      for (csize k = 0; aggregated && k < oc->num_columns(); ++k)
+      {
+        aggregated = has_only_aggregate_uses(oc->get_column_expr(k),
+                                             var,
+                                             v.get_sctx());
+      }
+    }
+
+    if (aggregated)
+    {
+      aggregated = has_only_aggregate_uses(v.get_return_expr(),
+                                           var,
+                                           v.get_sctx());
+    }
+
+    clauseVarMap->theVarRebinds[numGroupVars + j]->theIsAggregated = aggregated;
   }
 }
 
@@ -1803,6 +1958,95 @@ PlanIter_t gflwor_codegen(flwor_expr& flworExpr, int currentClause)
 }
 
 
+/*******************************************************************************
+  Check whether the given expr (the return or where expr of a flwor F that
+  consists of a single FOR clause) can be evaluated independently for each
+  binding of the FOR var, on a thread other than the one evaluating F. This is
+  the case if the expr has no side effects, is deterministic, calls builtin
+  functions only (no user-defined, external, or dynamic ones), and references
+  no variables other than the FOR var (and its positional var) of F and the
+  vars of flwor exprs nested inside the expr itself.
+********************************************************************************/
+bool is_parallel_flwor_expr(const expr* e, const flwor_expr& flworExpr)
+{
+  if (e->is_sequential() || e->is_updating() || e->is_nondeterministic())
+    return false;
+
+  std::vector<expr*> exprs;
+
+  e->get_exprs_of_kind(eval_expr_kind, false, exprs);
+  e->get_exprs_of_kind(dynamic_function_invocation_expr_kind, false, exprs);
+  e->get_exprs_of_kind(function_item_expr_kind, false, exprs);
+
+  if (!exprs.empty())
+    return false;
+
+  e->get_exprs_of_kind(fo_expr_kind, true, exprs);
+
+  std::vector<expr*>::const_iterator ite = exprs.begin();
+  std::vector<expr*>::const_iterator end = exprs.end();
+  for (; ite != end; ++ite)
+  {
+    if (!static_cast<const fo_expr*>(*ite)->get_func()->isBuiltin())
+      return false;
+  }
+
+  std::vector<expr*> nestedFlwors;
+  e->get_exprs_of_kind(flwor_expr_kind, true, nestedFlwors);
+
+  exprs.clear();
+  e->get_exprs_of_kind(var_expr_kind, true, exprs);
+
+  for (ite = exprs.begin(), end = exprs.end(); ite != end; ++ite)
+  {
+    const flwor_clause* c = static_cast<const var_expr*>(*ite)->get_flwor_clause();
+
+    if (c == NULL)
+      return false;
+
+    if (c->get_flwor_expr() != &flworExpr &&
+        std::find(nestedFlwors.begin(), nestedFlwors.end(), c->get_flwor_expr()) ==
+        nestedFlwors.end())
+      return false;
+  }
+
+  return true;
+}
+
+
+/*******************************************************************************
+  Check whether the given (non-general) flwor can be evaluated by a parallel
+  FLWORIterator: it must consist of a single FOR clause, optionally followed
+  by a WHERE clause, and its where and return exprs must be parallelizable.
+********************************************************************************/
+bool is_parallel_flwor(const flwor_expr& flworExpr)
+{
+#ifdef ZORBA_FOR_ONE_THREAD_ONLY
+  return false;
+#else
+  csize numClauses = flworExpr.num_clauses();
+
+  if (numClauses == 0 || numClauses > 2)
+    return false;
+
+  if (flworExpr.get_clause(0)->get_kind() != flwor_clause::for_clause)
+    return false;
+
+  if (numClauses == 2)
+  {
+    const flwor_clause* c = flworExpr.get_clause(1);
+
+    if (c->get_kind() != flwor_clause::where_clause ||
+        !is_parallel_flwor_expr(static_cast<const where_clause*>(c)->get_expr(),
+                                flworExpr))
+      return false;
+  }
+
+  return is_parallel_flwor_expr(flworExpr.get_return_expr(), flworExpr);
+#endif
+}
+
+
 void flwor_codegen(const flwor_expr& flworExpr)
 {
   flwor::FLWORIterator* flworIter;
@@ -2049,6 +2293,18 @@ void flwor_codegen(const flwor_expr& flworExpr)
   groupClause.release();
   orderClause.release();
   materializeClause.release();
+
+  if (Properties::instance().getFLWORThreads() > 1 &&
+      is_parallel_flwor(flworExpr))
+  {
+    flworIter->setNumThreads(Properties::instance().getFLWORThreads());
+  }
+
+  // If every tuple contributes at least one item to the result, a consumer
+  // that needs the first k items only needs the first k tuples in sort order.
+  if (flworExpr.get_return_expr()->get_return_type()->min_card() >= 1)
+    flworIter->setTopKSort();
+
   push_itstack(flworIter);
 }
 
@@ -2075,7 +2331,10 @@ void generate_groupby(
 
     const std::vector<PlanIter_t>& varRefs = varRebind->theOutputVarRefs;
 
-    ngspecs.push_back(flwor::NonGroupingSpec(pop_itstack(), varRefs));
+    ngspecs.push_back(flwor::NonGroupingSpec(pop_itstack(),
+                                             varRefs,
+                                             varRebind->theAggregateKinds,
+                                             varRebind->theAggregateRefs));
   }
 
   for (; i >= 0; --i)
@@ -2469,6 +2728,54 @@ bool begin_visit(fo_expr& v)
   if (is_enclosed_expr(&v))
     theConstructorsStack.push(&v);
 
+  // If the function computes an aggregate over a non-grouping var whose
+  // aggregates are maintained by the group-by, replace the call with a ref
+  // to the result of the aggregate.
+  flwor::GroupAggregate::Kind aggrKind;
+
+  if (get_group_aggregate(&v, aggrKind) &&
+      v.get_arg(0)->get_expr_kind() == var_expr_kind)
+  {
+    const var_expr* var = static_cast<const var_expr*>(v.get_arg(0));
+
+    if (var->get_kind() == var_expr::non_groupby_var)
+    {
+      long i = (long)theClauseStack.size() - 1;
+      long varPos = -1;
+
+      for (; i >= 0; --i)
+      {
+        if ((varPos = theClauseStack[i]->find_var(var)) >= 0)
+          break;
+      }
+
+      VarRebind* varRebind =
+      (i >= 0 ? theClauseStack[i]->theVarRebinds[varPos].getp() : NULL);
+
+      if (varRebind != NULL && varRebind->theIsAggregated)
+      {
+        std::vector<int>& kinds = varRebind->theAggregateKinds;
+        std::vector<int>::iterator ite = std::find(kinds.begin(), kinds.end(), aggrKind);
+        csize pos = ite - kinds.begin();
+
+        if (ite == kinds.end())
+        {
+          kinds.push_back(aggrKind);
+          varRebind->theAggregateRefs.resize(kinds.size());
+        }
+
+        PlanIter_t ref = new LetVarIterator(sctx, qloc, var->get_name());
+
+        varRebind->theAggregateRefs[pos].push_back(ref);
+
+        push_itstack(ref);
+
+        theGroupAggregates.insert(&v);
+        return false;
+      }
+    }
+  }
+
 	return true;
 }
 
@@ -2477,6 +2784,9 @@ void end_visit(fo_expr& v)
 {
   CODEGEN_TRACE_OUT("");
 
+  if (theGroupAggregates.erase(&v) > 0)
+    return;
+
   function* func = v.get_func();
 
   std::vector<PlanIter_t> argv;
@@ -596,6 +596,7 @@ bool EliminateUnusedLetVars::safe_to_fold_var(csize varPos, int& numRefs)
   if (safe && numRefs == 0)
   {
     if (varDomExpr->get_function_kind() == FunctionConsts::OP_CREATE_INTERNAL_INDEX_2 ||
+        varDomExpr->get_function_kind() == FunctionConsts::OP_CREATE_HASH_JOIN_2 ||
         !isSafeVar)
     {
       return false;
@@ -165,6 +165,7 @@ expr* MarkExprs::apply(RewriterContext& rCtx, expr* node, bool& modified)
     if (!f->isUdf())
     {
       if (fkind == FunctionConsts::OP_CREATE_INTERNAL_INDEX_2 ||
+          fkind == FunctionConsts::OP_CREATE_HASH_JOIN_2 ||
           fkind == FunctionConsts::FN_ERROR_0 ||
           fkind == FunctionConsts::FN_ERROR_1 ||
           fkind == FunctionConsts::FN_ERROR_2 ||
@@ -970,6 +970,13 @@ void IndexJoinRule::rewriteJoin(PredicateInfo& predInfo)
 
   for_clause* innerClause = predInfo.theInnerVar->get_forlet_clause();
 
+  //
+  // A value join is evaluated as a hash join, whose hash table maps the keys
+  // of the inner side directly to the inner items. A general join needs the
+  // type promotions implemented by general indexes, so it uses a temp index.
+  //
+  bool hashJoin = !predInfo.theIsGeneral;
+
   //
   // The index domain expr is the expr that defines the inner var, expanded so
   // that it does not reference any LET variables defined after the outer var
@@ -981,7 +988,8 @@ void IndexJoinRule::rewriteJoin(PredicateInfo& predInfo)
   // Create the index declaration
   //
   std::ostringstream os;
-  os << "tempIndex" << GENV_ROOT_STATIC_CONTEXT.create_temporary_index_id();
+  os << (hashJoin ? "tempHashJoin" : "tempIndex")
+     << GENV_ROOT_STATIC_CONTEXT.create_temporary_index_id();
 
   store::Item_t qname;
   GENV_ITEMFACTORY->createQName(qname, "", "", os.str().c_str());
@@ -1022,13 +1030,15 @@ void IndexJoinRule::rewriteJoin(PredicateInfo& predInfo)
   idx->setOrderModifiers(modifiers);
 
   //
-  // Create the "create-index()" expr
+  // Create the "create-index()" or "create-hash-join()" expr
   //
   expr* qnameExpr = em->create_const_expr(sctx, udf, loc, qname);
 
   expr* buildExpr = idx->getBuildExpr(loc);
 
-  function* f = BUILTIN_FUNC(OP_CREATE_INTERNAL_INDEX_2);
+  function* f = (hashJoin ?
+                 BUILTIN_FUNC(OP_CREATE_HASH_JOIN_2) :
+                 BUILTIN_FUNC(OP_CREATE_INTERNAL_INDEX_2));
   fo_expr* createExpr = em->create_fo_expr(sctx, udf, loc, f, qnameExpr, buildExpr);
 
   DynamicBitset indexVars;
@@ -1085,26 +1095,19 @@ void IndexJoinRule::rewriteJoin(PredicateInfo& predInfo)
   }
 
   //
-  // Replace the expr defining the inner var with an index probe.
+  // Replace the expr defining the inner var with an index or hash join probe.
   //
   fo_expr* probeExpr = NULL;
 
-  if (predInfo.theIsGeneral)
+  if (hashJoin)
   {
     probeExpr = em->
     create_fo_expr(sctx,
                    udf,
                    loc,
-                   BUILTIN_FUNC(FN_ZORBA_XQDDF_PROBE_INDEX_POINT_GENERAL_N),
+                   BUILTIN_FUNC(OP_PROBE_HASH_JOIN_2),
                    qnameExpr,
                    const_cast<expr*>(predInfo.theOuterOp));
-    
-    probeExpr = em->
-    create_fo_expr(sctx,
-                   udf,
-                   loc,
-                   BUILTIN_FUNC(OP_SORT_DISTINCT_NODES_ASC_1),
-                   probeExpr);
   }
   else
   {
@@ -1112,9 +1115,16 @@ void IndexJoinRule::rewriteJoin(PredicateInfo& predInfo)
     create_fo_expr(sctx,
                    udf,
                    loc,
-                   BUILTIN_FUNC(FN_ZORBA_XQDDF_PROBE_INDEX_POINT_VALUE_N),
+                   BUILTIN_FUNC(FN_ZORBA_XQDDF_PROBE_INDEX_POINT_GENERAL_N),
                    qnameExpr,
                    const_cast<expr*>(predInfo.theOuterOp));
+    
+    probeExpr = em->
+    create_fo_expr(sctx,
+                   udf,
+                   loc,
+                   BUILTIN_FUNC(OP_SORT_DISTINCT_NODES_ASC_1),
+                   probeExpr);
   }
 
   DynamicBitset probeVars = (*theExprVarsMap)[predInfo.theOuterOp];
@@ -1122,7 +1132,9 @@ void IndexJoinRule::rewriteJoin(PredicateInfo& predInfo)
 
   innerClause->set_expr(probeExpr);
 
-  sctx->bind_index(idx, loc);
+  // The hash join only needs the index declaration for its build expr.
+  if (!hashJoin)
+    sctx->bind_index(idx, loc);
 
   if (Properties::instance().getPrintIntermediateOpt())
   {
@@ -20,6 +20,11 @@
 
 #include "compiler/expression/expr.h"
 #include "compiler/expression/expr_iter.h"
+#ifndef ZORBA_NO_FULL_TEXT
+#include "compiler/expression/ft_expr.h"
+#include "compiler/expression/ftnode.h"
+#include "runtime/full_text/ft_util.h"
+#endif
 
 #include "compiler/xqddf/value_index.h"
 #include "compiler/xqddf/collection_decl.h"
@@ -37,6 +42,8 @@
 
 #include "util/dynamic_bitset.h"
 
+#include "zorbatypes/integer.h"
+
 #include "diagnostics/assert.h"
 
 #include <zorba/properties.h>
@@ -96,7 +103,7 @@ expr* IndexMatchingRule::apply(RewriterContext& rCtx, expr* node, bool& modified
   modified = false;
 
   // TODO remove this
-  if (theIndexDecl->isGeneral())
+  if (theIndexDecl->isGeneral() && !theIndexDecl->isFullText())
     return node;
 
   if (node->get_expr_kind() == flwor_expr_kind)
@@ -106,7 +113,13 @@ expr* IndexMatchingRule::apply(RewriterContext& rCtx, expr* node, bool& modified
 
     theQueryExpr = static_cast<flwor_expr*>(node);
 
+#ifndef ZORBA_NO_FULL_TEXT
+    bool matched = (theIndexDecl->isFullText() ?
+                    matchFullTextIndex() :
+                    matchIndex());
+#else
     bool matched = matchIndex();
+#endif
 
     if (matched)
     {
@@ -686,10 +699,595 @@ bool IndexMatchingRule::matchIndex()
     }
   }
 
+  // If nothing but the value of one of the index keys is needed from the
+  // nodes found, get that value from the index entries instead of the nodes.
+  if (probeExpr->get_func()->getKind() != FunctionConsts::OP_SORT_NODES_ASC_1 &&
+      firstMatchedFOR->get_var() == domVar)
+  {
+    projectKeyColumn(firstMatchedFOR, firstMatchedFORpos, subst);
+  }
+
   return true;
 }
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+/*******************************************************************************
+  Returns the ftwords node whose words must be found in a node for the given
+  full-text selection to match it, if any, and the match options that apply
+  to it, from the outermost to the innermost. Positional filters, the right
+  operand of a "not in", and all but one of the operands of an "ftand" can
+  only reject matches, so they are ignored.
+********************************************************************************/
+static ftwords* find_required_ftwords(
+    const ftnode* node,
+    std::vector<const ftmatch_options*>& options)
+{
+  if (const ftselection* sel = dynamic_cast<const ftselection*>(node))
+  {
+    return find_required_ftwords(sel->get_ftor(), options);
+  }
+  else if (const ftprimary_with_options* pwo =
+           dynamic_cast<const ftprimary_with_options*>(node))
+  {
+    options.push_back(pwo->get_match_options());
+
+    ftwords* words = find_required_ftwords(pwo->get_primary(), options);
+
+    if (words == NULL)
+      options.pop_back();
+
+    return words;
+  }
+  else if (const ftwords_times* wt = dynamic_cast<const ftwords_times*>(node))
+  {
+    // "occurs at most N times" is satisfied by nodes without the words.
+    if (wt->get_times() != NULL)
+      return NULL;
+
+    return const_cast<ftwords*>(wt->get_words());
+  }
+  else if (const ftand* fa = dynamic_cast<const ftand*>(node))
+  {
+    ftnode_list::ftnode_list_t::const_iterator ite = fa->get_node_list().begin();
+    ftnode_list::ftnode_list_t::const_iterator end = fa->get_node_list().end();
+    for (; ite != end; ++ite)
+    {
+      if (ftwords* words = find_required_ftwords(*ite, options))
+        return words;
+    }
+  }
+  else if (const ftmild_not* mn = dynamic_cast<const ftmild_not*>(node))
+  {
+    return find_required_ftwords(mn->get_node_list().front(), options);
+  }
+  else if (const ftor* fo = dynamic_cast<const ftor*>(node))
+  {
+    if (fo->get_node_list().size() == 1)
+      return find_required_ftwords(fo->get_node_list().front(), options);
+  }
+
+  return NULL;
+}
+
+
+/*******************************************************************************
+  Fills in the options missing from "newer" with the ones of "older".
+********************************************************************************/
+static void merge_ft_options(
+    const ftmatch_options* older,
+    ftmatch_options* newer)
+{
+  if (older == NULL)
+    return;
+
+  if (!newer->get_case_option())
+    newer->set_case_option(older->get_case_option());
+  if (!newer->get_diacritics_option())
+    newer->set_diacritics_option(older->get_diacritics_option());
+  if (!newer->get_language_option())
+    newer->set_language_option(older->get_language_option());
+  if (!newer->get_stem_option())
+    newer->set_stem_option(older->get_stem_option());
+  if (!newer->get_stop_word_option())
+    newer->set_stop_word_option(older->get_stop_word_option());
+  if (!newer->get_thesaurus_option())
+    newer->set_thesaurus_option(older->get_thesaurus_option());
+  if (!newer->get_wild_card_option())
+    newer->set_wild_card_option(older->get_wild_card_option());
+}
+
+
+/*******************************************************************************
+  Checks whether, with the given effective match options, a "contains text"
+  expression matches a document token with a query token only if their
+  values, normalized as the key values of the index are, are equal (see
+  FullTextIndexTokenizer).
+********************************************************************************/
+static bool compatible_ft_options(
+    const ftmatch_options& queryOptions,
+    const ftmatch_options& indexOptions)
+{
+  if (queryOptions.get_extension_options() ||
+      indexOptions.get_extension_options())
+    return false;
+
+  if (get_lang_from(&queryOptions) != get_lang_from(&indexOptions))
+    return false;
+
+  bool stemming =
+  (queryOptions.get_stem_option()->get_mode() == ft_stem_mode::stemming);
+
+  if (stemming !=
+      (indexOptions.get_stem_option()->get_mode() == ft_stem_mode::stemming))
+    return false;
+
+  if (!stemming &&
+      queryOptions.get_case_option()->get_mode() == ft_case_mode::upper)
+    return false;
+
+  if (queryOptions.get_wild_card_option()->get_mode() != ft_wild_card_mode::without)
+    return false;
+
+  if (queryOptions.get_stop_word_option()->get_mode() != ft_stop_words_mode::without)
+    return false;
+
+  const ftthesaurus_option* thesaurus = queryOptions.get_thesaurus_option();
+
+  if (thesaurus && !thesaurus->no_thesaurus())
+    return false;
+
+  return true;
+}
+
+
+/*******************************************************************************
+  Matches a flwor expr with a full-text index. The flwor must contain a FOR
+  clause over the domain expr of the index, followed by a WHERE clause with a
+  predicate of the form "K contains text W" (possibly as an operand of an
+  "and"), where K is the key expr of the index applied to the FOR var. The
+  rewrite replaces the domain expr of the FOR clause with a probe of the index
+  for the words of W. The predicate is kept, because the index keeps neither
+  the positions of the tokens nor the words that are not tokens of the index,
+  so the probe may return nodes that do not match it.
+********************************************************************************/
+bool IndexMatchingRule::matchFullTextIndex()
+{
+  CompilerCB* ccb = theQueryExpr->get_ccb();
+  static_context* sctx = theQueryExpr->get_sctx();
+  user_function* udf = theQueryExpr->get_udf();
+
+  csize numVClauses = theViewExpr->num_clauses();
+  csize numQClauses = theQueryExpr->num_clauses();
+
+  for_clause* vfc = NULL;
+
+  for (csize vi = 0; vi < numVClauses; ++vi)
+  {
+    flwor_clause* vc = theViewExpr->get_clause(vi);
+
+    if (vc->get_kind() == flwor_clause::for_clause && vfc == NULL)
+      vfc = static_cast<for_clause*>(vc);
+    else if (vc->get_kind() != flwor_clause::let_clause)
+      return false;
+  }
+
+  if (vfc == NULL || theKeyClauses->size() != 1)
+    return false;
+
+  // Strip the key expr from the tokenization added by the translator.
+  expr* keyExpr = (*theKeyClauses)[0]->get_expr();
+
+  if (keyExpr->get_expr_kind() == fo_expr_kind &&
+      static_cast<fo_expr*>(keyExpr)->get_func()->getKind() ==
+      FunctionConsts::FN_DISTINCT_VALUES_1)
+  {
+    keyExpr = static_cast<fo_expr*>(keyExpr)->get_arg(0);
+  }
+
+  if (keyExpr->get_expr_kind() != fo_expr_kind ||
+      static_cast<fo_expr*>(keyExpr)->get_func()->getKind() !=
+      FunctionConsts::OP_FULL_TEXT_INDEX_TOKENS_1)
+    return false;
+
+  keyExpr = static_cast<fo_expr*>(keyExpr)->get_arg(0);
+
+  ftmatch_options indexOptions(keyExpr->get_loc());
+  merge_ft_options(theIndexDecl->getSctx()->get_match_options(), &indexOptions);
+  indexOptions.set_missing_defaults();
+
+  expr::substitution_t subst;
+  for_clause* qfc = NULL;
+  csize qfcPos = 0;
+
+  for (csize qi = 0; qi < numQClauses; ++qi)
+  {
+    flwor_clause* qc = theQueryExpr->get_clause(qi);
+
+    if (qc->get_kind() != flwor_clause::for_clause)
+      continue;
+
+    for_clause* fc = static_cast<for_clause*>(qc);
+
+    if (!fc->is_allowing_empty() &&
+        fc->get_pos_var() == NULL &&
+        expr_tools::match_exact(fc->get_expr(), vfc->get_expr(), subst))
+    {
+      subst[vfc->get_var()] = fc->get_var();
+      qfc = fc;
+      qfcPos = qi;
+      break;
+    }
+
+    subst.clear();
+  }
+
+  if (qfc == NULL)
+    return false;
+
+  // Look for the "contains text" predicate in the WHERE clauses that follow
+  // the FOR clause. The clauses in between must not change the number of
+  // tuples produced for each node.
+  std::vector<PredInfo> preds;
+
+  for (csize qi = qfcPos + 1; qi < numQClauses; ++qi)
+  {
+    flwor_clause* qc = theQueryExpr->get_clause(qi);
+
+    switch (qc->get_kind())
+    {
+    case flwor_clause::for_clause:
+    case flwor_clause::let_clause:
+    {
+      if (static_cast<forlet_clause*>(qc)->get_expr()->is_sequential())
+        qi = numQClauses;
+      break;
+    }
+    case flwor_clause::where_clause:
+    {
+      getWherePreds(qi, static_cast<where_clause*>(qc), preds);
+      break;
+    }
+    case flwor_clause::orderby_clause:
+    {
+      break;
+    }
+    default:
+    {
+      qi = numQClauses;
+      break;
+    }
+    }
+  }
+
+  ftcontains_expr* ftExpr = NULL;
+  ftwords* words = NULL;
+  std::vector<const ftmatch_options*> optionsChain;
+
+  for (csize i = 0; i < preds.size() && words == NULL; ++i)
+  {
+    if (preds[i].theExpr->get_expr_kind() != ft_expr_kind)
+      continue;
+
+    ftExpr = static_cast<ftcontains_expr*>(preds[i].theExpr);
+
+    if (!expr_tools::match_exact(ftExpr->get_range(), keyExpr, subst))
+      continue;
+
+    optionsChain.clear();
+    words = find_required_ftwords(ftExpr->get_ftselection().getp(), optionsChain);
+
+    if (words == NULL)
+      continue;
+
+    // The documents are tokenized in the language of the "contains text"
+    // expression, the query words in the one of their match options.
+    const ftmatch_options* ftSctxOptions = ftExpr->get_sctx()->get_match_options();
+
+    ftmatch_options queryOptions(ftExpr->get_loc());
+
+    for (csize j = optionsChain.size(); j > 0; --j)
+    {
+      if (optionsChain[j-1] == NULL)
+        continue;
+
+      if (optionsChain[j-1]->get_extension_options())
+      {
+        words = NULL;
+        break;
+      }
+
+      merge_ft_options(optionsChain[j-1], &queryOptions);
+    }
+
+    if (words == NULL)
+      continue;
+
+    merge_ft_options(ftSctxOptions, &queryOptions);
+    queryOptions.set_missing_defaults();
+
+    if ((ftSctxOptions && ftSctxOptions->get_extension_options()) ||
+        get_lang_from(ftSctxOptions) != get_lang_from(&indexOptions) ||
+        !compatible_ft_options(queryOptions, indexOptions))
+    {
+      words = NULL;
+      continue;
+    }
+
+    // The probe is evaluated in the place of the domain expr of the FOR
+    // clause, where the vars of the FOR and the clauses after it are not
+    // in scope.
+    expr* wordsExpr = *words->get_value_expr();
+
+    if (wordsExpr->is_sequential())
+    {
+      words = NULL;
+      continue;
+    }
+
+    const expr::FreeVars& freeVars = wordsExpr->getFreeVars();
+    expr::FreeVars::const_iterator ite = freeVars.begin();
+    expr::FreeVars::const_iterator end = freeVars.end();
+
+    for (; ite != end && words != NULL; ++ite)
+    {
+      const flwor_clause* varClause = (*ite)->get_flwor_clause();
+
+      if (varClause == NULL || varClause->get_flwor_expr() != theQueryExpr)
+        continue;
+
+      for (csize qi = qfcPos; qi < numQClauses; ++qi)
+      {
+        if (theQueryExpr->get_clause(qi) == varClause)
+        {
+          words = NULL;
+          break;
+        }
+      }
+    }
+  }
+
+  if (words == NULL)
+    return false;
+
+  std::vector<expr*> probeArgs(3);
+
+  store::Item_t indexName = theIndexDecl->getName();
+  probeArgs[0] = ccb->theEM->
+  create_const_expr(sctx, udf, qfc->get_loc(), indexName);
+
+  expr::substitution_t cloneSubst;
+  probeArgs[1] = (*words->get_value_expr())->clone(udf, cloneSubst);
+
+  zstring mode(ft_anyall_mode::string_of[words->get_mode()]);
+  probeArgs[2] = ccb->theEM->create_const_expr(sctx, udf, qfc->get_loc(), mode);
+
+  expr* probeExpr = ccb->theEM->
+  create_fo_expr(sctx,
+                 udf,
+                 qfc->get_loc(),
+                 BUILTIN_FUNC(FN_ZORBA_XQDDF_PROBE_INDEX_FULL_TEXT_3),
+                 probeArgs);
+
+  bool hasOrderBy = false;
+
+  for (csize qi = qfcPos + 1; qi < numQClauses; ++qi)
+  {
+    if (theQueryExpr->get_clause(qi)->get_kind() == flwor_clause::orderby_clause)
+      hasOrderBy = true;
+  }
+
+  if (! (theQueryExpr->ignoresSortedNodes() ||
+         hasOrderBy ||
+         (theIndexDecl->numSources() == 1 &&
+          !sctx->lookup_collection(theIndexDecl->getSourceName(0))->isOrdered())))
+  {
+    probeExpr = ccb->theEM->
+    create_fo_expr(sctx,
+                   udf,
+                   qfc->get_loc(),
+                   BUILTIN_FUNC(OP_SORT_NODES_ASC_1),
+                   probeExpr);
+  }
+
+  qfc->set_expr(probeExpr);
+
+  return true;
+}
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
+/*******************************************************************************
+  Rewrites
+
+    for $x in probe-index-*-value(...) ... return E
+
+  as
+
+    for $x in probe-index-*-value-column(..., i, ...) ... return $x
+
+  if every use of $x in the rest of the flwor is an occurrence of an expr E
+  that computes the same value as the i-th key expr of the index. If E may be
+  empty, the flwor must also return E itself, because the probe skips the
+  nodes whose key is empty in column i and then each such node must
+  contribute nothing to the result of the flwor.
+
+  The nodes are returned by the probe in key order, so the rewrite is done
+  only if the flwor does not need them in document order; it is also not
+  done if anything in the flwor depends on the number of nodes found.
+********************************************************************************/
+bool IndexMatchingRule::projectKeyColumn(
+    for_clause* fc,
+    csize fcPos,
+    expr::substitution_t& subst)
+{
+  if (theIndexDecl->isGeneral() ||
+      fc->get_pos_var() != NULL ||
+      fc->get_var()->get_type() != NULL)
+    return false;
+
+  csize numClauses = theQueryExpr->num_clauses();
+
+  for (csize i = fcPos + 1; i < numClauses; ++i)
+  {
+    switch (theQueryExpr->get_clause(i)->get_kind())
+    {
+    case flwor_clause::for_clause:
+    case flwor_clause::let_clause:
+    case flwor_clause::where_clause:
+    case flwor_clause::orderby_clause:
+      break;
+    default:
+      return false;
+    }
+  }
+
+  var_expr* domVar = fc->get_var();
+  var_expr* viewVar =
+  const_cast<var_expr*>(theViewExpr->get_return_expr()->get_var());
+  csize numKeys = theKeyClauses->size();
+
+  for (csize i = 0; i < numKeys; ++i)
+  {
+    expr* keyExpr = (*theKeyClauses)[i]->get_expr();
+    csize numUses = 0;
+
+    if (expr_tools::count_variable_uses(keyExpr, viewVar, 1, NULL) == 0)
+      continue;
+
+    if (!checkKeyColumnUses(theQueryExpr, keyExpr, domVar, subst, numUses) ||
+        numUses == 0)
+      continue;
+
+    if (keyExpr->get_return_type()->get_quantifier() != SequenceType::QUANT_ONE &&
+        !matchKeyColumnExpr(theQueryExpr->get_return_expr(), keyExpr, subst))
+      continue;
+
+    replaceKeyColumnUses(theQueryExpr, keyExpr, domVar, subst);
+
+    CompilerCB* ccb = theQueryExpr->get_ccb();
+    static_context* sctx = theQueryExpr->get_sctx();
+    user_function* udf = theQueryExpr->get_udf();
+
+    fo_expr* probeExpr = static_cast<fo_expr*>(fc->get_expr());
+
+    std::vector<expr*> args;
+    args.reserve(probeExpr->num_args() + 1);
+    args.push_back(probeExpr->get_arg(0));
+    args.push_back(ccb->theEM->
+                   create_const_expr(sctx, udf, fc->get_loc(), xs_integer(i + 1)));
+
+    for (csize j = 1; j < probeExpr->num_args(); ++j)
+      args.push_back(probeExpr->get_arg(j));
+
+    function* func =
+    (probeExpr->get_func()->getKind() ==
+     FunctionConsts::FN_ZORBA_XQDDF_PROBE_INDEX_RANGE_VALUE_N ?
+     BUILTIN_FUNC(OP_PROBE_INDEX_RANGE_VALUE_COLUMN_N) :
+     BUILTIN_FUNC(OP_PROBE_INDEX_POINT_VALUE_COLUMN_N));
+
+    fc->set_expr(ccb->theEM->
+                 create_fo_expr(sctx, udf, fc->get_loc(), func, args));
+
+    return true;
+  }
+
+  return false;
+}
+
+
+/*******************************************************************************
+  Unlike matchKeyExpr(), this matches a query expr with a key expr only if
+  the query expr computes exactly the key value that is stored in the index.
+********************************************************************************/
+bool IndexMatchingRule::matchKeyColumnExpr(
+    expr* qexpr,
+    expr* vexpr,
+    expr::substitution_t& subst)
+{
+  TypeManager* tm = qexpr->get_type_manager();
+
+  if (expr_tools::match_exact(qexpr, vexpr, subst))
+    return true;
+
+  if (vexpr->get_expr_kind() == promote_expr_kind)
+  {
+    // The promotion is a no-op for the values of the query expr.
+    promote_expr* ve = static_cast<promote_expr*>(vexpr);
+
+    return (TypeOps::is_subtype(tm,
+                                *qexpr->get_return_type(),
+                                *ve->get_target_type()) &&
+            expr_tools::match_exact(qexpr, ve->get_input(), subst));
+  }
+  else if (vexpr->get_expr_kind() == treat_expr_kind)
+  {
+    treat_expr* ve = static_cast<treat_expr*>(vexpr);
+
+    return expr_tools::match_exact(qexpr, ve->get_input(), subst);
+  }
+
+  return false;
+}
+
+
+/*******************************************************************************
+  Checks that the given var is used within qexpr only inside exprs that match
+  the key expr vexpr, and counts these exprs.
+********************************************************************************/
+bool IndexMatchingRule::checkKeyColumnUses(
+    expr* qexpr,
+    expr* vexpr,
+    const var_expr* domVar,
+    expr::substitution_t& subst,
+    csize& numUses)
+{
+  if (qexpr == domVar)
+    return false;
+
+  if (qexpr != theQueryExpr && matchKeyColumnExpr(qexpr, vexpr, subst))
+  {
+    ++numUses;
+    return true;
+  }
+
+  ExprIterator iter(qexpr);
+  while (!iter.done())
+  {
+    if (!checkKeyColumnUses(**iter, vexpr, domVar, subst, numUses))
+      return false;
+
+    iter.next();
+  }
+
+  return true;
+}
+
+
+/*******************************************************************************
+  Replaces with the given var the exprs within qexpr that match the key expr
+  vexpr (see checkKeyColumnUses()).
+********************************************************************************/
+expr* IndexMatchingRule::replaceKeyColumnUses(
+    expr* qexpr,
+    expr* vexpr,
+    var_expr* domVar,
+    expr::substitution_t& subst)
+{
+  if (qexpr != theQueryExpr && matchKeyColumnExpr(qexpr, vexpr, subst))
+    return domVar;
+
+  ExprIterator iter(qexpr);
+  while (!iter.done())
+  {
+    **iter = replaceKeyColumnUses(**iter, vexpr, domVar, subst);
+    iter.next();
+  }
+
+  return qexpr;
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
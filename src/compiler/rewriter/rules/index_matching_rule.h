@@ -70,6 +70,10 @@ public:
 protected:
   bool matchIndex();
 
+#ifndef ZORBA_NO_FULL_TEXT
+  bool matchFullTextIndex();
+#endif
+
   void getWherePreds(
       csize clausePos,
       where_clause* wc,
@@ -89,6 +93,29 @@ protected:
       const expr* qexpr,
       const var_expr* domVar,
       const DynamicBitset& matchedFORs);
+
+  bool projectKeyColumn(
+      for_clause* fc,
+      csize fcPos,
+      expr::substitution_t& subst);
+
+  bool matchKeyColumnExpr(
+      expr* qexpr,
+      expr* vexpr,
+      expr::substitution_t& subst);
+
+  bool checkKeyColumnUses(
+      expr* qexpr,
+      expr* vexpr,
+      const var_expr* domVar,
+      expr::substitution_t& subst,
+      csize& numUses);
+
+  expr* replaceKeyColumnUses(
+      expr* qexpr,
+      expr* vexpr,
+      var_expr* domVar,
+      expr::substitution_t& subst);
 };
 
 
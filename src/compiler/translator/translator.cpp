@@ -41,6 +41,7 @@
 #include "compiler/translator/module_version.h"
 #include "compiler/api/compilercb.h"
 #include "compiler/api/compiler_api.h"
+#include "compiler/api/module_cache.h"
 #include "compiler/codegen/plan_visitor.h"
 #include "compiler/parsetree/parsenodes.h"
 #include "compiler/parser/parse_constants.h"
@@ -3676,13 +3677,31 @@ void end_visit(const ModuleImport& v, void* /*visit_state*/)
         fileURL = compURI;
       }
 
-      rchandle<parsenode> ast = xqc.parse(*modfile, fileURL);
+      // Read the text of the module, so that its hash can be recorded for
+      // the plan cache.
+      std::string modText((std::istreambuf_iterator<char>(*modfile)),
+                          std::istreambuf_iterator<char>());
+
+      CompilerCB::ModuleSource modSource;
+      modSource.theURI = compModVer.versioned_uri();
+      modSource.theHash = CompilerCB::ModuleSource::hash(modText);
+      theCCB->theModuleSources.push_back(modSource);
+
+      // The parse tree may come from (and go to) the process-wide module
+      // cache; it is ours until astHandle goes out of scope.
+      ModuleCache::Handle astHandle;
+      GENV_COMPILERSUBSYS.getModuleCache().parse(xqc,
+                                                 modSource.theURI,
+                                                 fileURL,
+                                                 modText,
+                                                 astHandle);
+      const parsenode* ast = astHandle.get();
 
       // Get the target namespace that appears in the module declaration
       // of the imported module and check that this ns is the same as the
       // target ns in the module import statement.
       // Also make sure that the imported module is a library module
-      LibraryModule* mod_ast = dynamic_cast<LibraryModule *>(&*ast);
+      const LibraryModule* mod_ast = dynamic_cast<const LibraryModule *>(ast);
       if (mod_ast == NULL)
       {
         RAISE_ERROR(err::XQST0059, loc,
@@ -5272,6 +5291,16 @@ void* begin_visit(const AST_IndexDecl& v)
     {
       index->setGeneral(true);
     }
+    if (ZANN_CONTAINS(zann_full_text))
+    {
+#ifndef ZORBA_NO_FULL_TEXT
+      index->setGeneral(true);
+      index->setFullText(true);
+#else
+      RAISE_ERROR(zerr::ZXQP0050_FEATURE_NOT_AVAILABLE, loc,
+      ERROR_PARAMS("full-text"));
+#endif
+    }
     if (ZANN_CONTAINS(zann_general_range) ||
         ZANN_CONTAINS(zann_value_range))
     {
@@ -5454,7 +5483,11 @@ void end_visit(const IndexKeyList& v, void* /*visit_state*/)
                      ZED(ZDST0027_NO_KEY_TYPE_DECL)));
       }
 
-      keyExpr = wrap_in_atomization(keyExpr);
+      // The key nodes of a full-text index are tokenized as nodes, so that
+      // element boundaries separate tokens the same way they do for a
+      // "contains text" expression over the same nodes.
+      if (!index->isFullText())
+        keyExpr = wrap_in_atomization(keyExpr);
     }
     else
     {
@@ -5529,6 +5562,24 @@ void end_visit(const IndexKeyList& v, void* /*visit_state*/)
       keyTypes[i] = ptype->getBaseBuiltinType();
     }
 
+#ifndef ZORBA_NO_FULL_TEXT
+    if (index->isFullText())
+    {
+      // The key values of a full-text index are the tokens of the key items,
+      // normalized according to the match options in scope at the index
+      // declaration. theSctx is used as the sctx of the tokens function so
+      // that it sees the ft-option declarations of the module.
+      keyExpr = CREATE(fo)(theSctx,
+                           theUDF,
+                           keyExpr->get_loc(),
+                           BUILTIN_FUNC(OP_FULL_TEXT_INDEX_TOKENS_1),
+                           keyExpr);
+
+      ptype = theRTM.STRING_TYPE_ONE;
+      keyTypes[i] = ptype;
+    }
+#endif
+
     if (index->isGeneral())
     {
       // Eliminate duplicate key values, as they don't play any role in a
@@ -11858,6 +11909,14 @@ expr* generate_fncall(
         
     break;
   }
+  case FunctionConsts::FN_ZORBA_XQDDF_PROBE_INDEX_FULL_TEXT_3:
+  {
+    resultExpr = CREATE(fo)(theRootSctx, theUDF, resultExpr->get_loc(),
+                            BUILTIN_FUNC(OP_SORT_NODES_ASC_1),
+                            resultExpr);
+
+    break;
+  }
   case FunctionConsts::FN_ANALYZE_STRING_2:
   case FunctionConsts::FN_ANALYZE_STRING_3:
   {
@@ -15773,9 +15832,17 @@ void end_visit (const FTExtensionOption& v, void* /*visit_state*/) {
   zstring ns;
   theSctx->lookup_ns( ns, qname->get_prefix(), loc );
 
+  // The parse tree may be shared with other compilations (see ModuleCache),
+  // so the expr gets a copy of the QName rather than the parse node itself.
+  rchandle<QName> const qname_copy(
+    new QName( qname->get_location(), qname->get_qname(), qname->is_eqname() )
+  );
+
   ftmatch_options *const mo = dynamic_cast<ftmatch_options*>( top_ftstack() );
   ZORBA_ASSERT( mo );
-  mo->add_extension_option( new ftextension_option( loc, qname, v.get_val() ) );
+  mo->add_extension_option(
+    new ftextension_option( loc, qname_copy, v.get_val() )
+  );
 #endif /* ZORBA_NO_FULL_TEXT */
 }
 
@@ -15793,7 +15860,25 @@ void end_visit (const FTExtensionSelection& v, void* /*visit_state*/) {
     pop_ftstack();
   else
     RAISE_ERROR_NO_PARAMS(err::XQST0079, loc);
-  push_ftstack( new ftextension_selection( loc, v.get_pragma_list(), s ) );
+
+  // As for FTExtensionOption, copy the pragmas out of the parse tree.
+  rchandle<PragmaList> pragmas;
+  if ( PragmaList const *const pl = v.get_pragma_list().getp() ) {
+    pragmas = new PragmaList( pl->get_location() );
+    PragmaList::list_t::const_iterator p = pl->get_pragmas().begin();
+    PragmaList::list_t::const_iterator const end = pl->get_pragmas().end();
+    for ( ; p != end; ++p ) {
+      QName const *const name = (*p)->get_name().getp();
+      pragmas->push_back(
+        new Pragma(
+          (*p)->get_location(),
+          new QName( name->get_location(), name->get_qname(), name->is_eqname() ),
+          (*p)->get_pragma_lit()
+        )
+      );
+    }
+  }
+  push_ftstack( new ftextension_selection( loc, pragmas, s ) );
 #endif /* ZORBA_NO_FULL_TEXT */
 }
 
@@ -65,6 +65,7 @@ IndexDecl::IndexDecl(
   theName(name),
   theIsGeneral(false),
   theIsUnique(false),
+  theIsFullText(false),
   theIsTemp(false),
   theMaintenanceMode(MANUAL),
   theContainerKind(HASH),
@@ -105,6 +106,7 @@ void IndexDecl::serialize(::zorba::serialization::Archiver& ar)
   ar & theName;
   ar & theIsGeneral;
   ar & theIsUnique;
+  ar & theIsFullText;
   ar & theIsTemp;
   SERIALIZE_ENUM(MaintenanceMode, theMaintenanceMode);
   SERIALIZE_ENUM(ContainerKind, theContainerKind);
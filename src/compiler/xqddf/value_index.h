@@ -115,6 +115,15 @@ typedef rchandle<DocIndexer> DocIndexer_t;
   ------------
   Whether it is a unique index or not.
 
+  theIsFullText:
+  --------------
+  Whether it is a full-text index or not. A full-text index is a general hash
+  index whose key values are the normalized tokens of the key expression (see
+  FullTextIndexTokensIterator). Its entries are posting lists that map each
+  token to the domain nodes containing it; token positions are not kept, so
+  a probe is only a prefilter for the "contains text" expression it replaces
+  (see IndexMatchingRule::matchFullTextIndex).
+
   theIsTemp:
   ----------
   Whether it is a temp index or not. A temp index is an index that is created
@@ -264,6 +273,7 @@ private:
 
   bool                            theIsGeneral;
   bool                            theIsUnique;
+  bool                            theIsFullText;
   bool                            theIsTemp;
   MaintenanceMode                 theMaintenanceMode;
   ContainerKind                   theContainerKind;
@@ -318,6 +328,10 @@ public:
 
   void setUnique(bool unique) { theIsUnique = unique; }
 
+  bool isFullText() const { return theIsFullText; }
+
+  void setFullText(bool ft) { theIsFullText = ft; }
+
   bool isTemp() const { return theIsTemp; }
 
   void setTemp(bool tmp) { theIsTemp = tmp; }
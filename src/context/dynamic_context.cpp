@@ -40,6 +40,7 @@
 
 #include "runtime/api/plan_wrapper.h"
 #include "runtime/base/plan_iterator.h"
+#include "runtime/indexing/hash_join.h"
 
 #include "zorbautils/hashmap_itemp.h"
 #include "util/string_util.h"
@@ -127,6 +128,7 @@ dynamic_context::dynamic_context(dynamic_context* parent)
   keymap(NULL),
   theAvailableIndices(NULL),
   theAvailableMaps(NULL),
+  theHashJoinTables(NULL),
   theEnvironmentVariables(NULL),
   theSnapshotID(0),
   theDocLoadingUserTime(0.0),
@@ -182,6 +184,9 @@ dynamic_context::~dynamic_context()
 
   if (theAvailableMaps)
     delete theAvailableMaps;
+
+  if (theHashJoinTables)
+    delete theHashJoinTables;
 }
 
 
@@ -744,6 +749,36 @@ void dynamic_context::unbindIndex(store::Item* qname)
 }
 
 
+/*******************************************************************************
+
+********************************************************************************/
+HashJoinTable* dynamic_context::getHashJoinTable(store::Item* qname) const
+{
+  HashJoinTable_t table;
+
+  if (theHashJoinTables != NULL && theHashJoinTables->get(qname, table))
+    return table.getp();
+
+  return NULL;
+}
+
+
+/*******************************************************************************
+  Binds the given table to the given name, replacing the table that was bound
+  to it by a previous evaluation of the hash join, if any.
+********************************************************************************/
+void dynamic_context::bindHashJoinTable(
+    store::Item* qname,
+    HashJoinTable_t& table)
+{
+  if (theHashJoinTables == NULL)
+    theHashJoinTables = new HashJoinMap(HashMapItemPointerCmp(0, NULL), 8, false);
+
+  if (!theHashJoinTables->update(qname, table))
+    theHashJoinTables->insert(qname, table);
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
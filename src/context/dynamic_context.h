@@ -50,6 +50,7 @@ template <class V> class ItemPointerHashMap;
     current value, which is either a single item or a temp sequence.
   - A map mapping the uri of each index to the store object representing the
     index (store::Index_t)
+  - A map mapping the name of each hash join to its table (HashJoinTable_t)
 ********************************************************************************/
 class dynamic_context
 {
@@ -119,6 +120,8 @@ protected:
 
   ITEM_PTR_HASH_MAP(store::Index_t, IndexMap);
 
+  ITEM_PTR_HASH_MAP(HashJoinTable_t, HashJoinMap);
+
   typedef std::map<const zstring, const zstring> EnvVarMap;
 
 protected:
@@ -138,6 +141,8 @@ protected:
 
   IndexMap                   * theAvailableMaps;
 
+  HashJoinMap                * theHashJoinTables;
+
   //MODIFY
   EnvVarMap                  * theEnvironmentVariables;
 
@@ -248,6 +253,10 @@ public:
 
   void unbindIndex(store::Item* qname);
 
+  HashJoinTable* getHashJoinTable(store::Item* qname) const;
+
+  void bindHashJoinTable(store::Item* qname, HashJoinTable_t& table);
+
   store::Index* getMap(store::Item* qname, bool lookupParent = true) const;
 
   void bindMap(store::Item* qname, store::Index_t& index);
@@ -321,6 +321,26 @@ PlanIter_t zorba_store_static_collections_dml_insert_last::codegen(
 }
 
 
+/*******************************************************************************
+
+********************************************************************************/
+PlanIter_t zorba_store_static_collections_dml_insert_last_documents::codegen(
+    CompilerCB* cb,
+    static_context* sctx,
+    const QueryLoc& loc,
+    std::vector<PlanIter_t>& argv,
+    expr& ann) const
+{
+  const zstring& ns = getName()->getNamespace();
+
+  bool const dynamic =
+    ns == static_context::ZORBA_STORE_DYNAMIC_COLLECTIONS_DML_FN_NS;
+
+  // the documents are parsed into new trees, so they never need copying
+  return new ZorbaInsertLastDocumentsIterator(sctx, loc, argv, dynamic, false);
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
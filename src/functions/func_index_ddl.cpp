@@ -19,6 +19,11 @@
 
 #include "compiler/expression/fo_expr.h"
 #include "compiler/expression/expr.h"
+#include "compiler/xqddf/value_index.h"
+
+#include "context/static_context.h"
+
+#include "zorbatypes/integer.h"
 
 #include "functions/func_index_ddl.h"
 
@@ -46,6 +51,38 @@ PlanIter_t op_create_internal_index::codegen(
 }
 
 
+PlanIter_t op_create_hash_join::codegen(
+    CompilerCB* cb,
+    static_context* sctx,
+    const QueryLoc& loc,
+    std::vector<PlanIter_t>& argv,
+    expr& ann) const
+{
+  fo_expr* fo = static_cast<fo_expr*>(&ann);
+
+  const const_expr* qnameExpr = static_cast<const const_expr*>(fo->get_arg(0));
+  store::Item_t qname = const_cast<store::Item*>(qnameExpr->get_val());
+
+  return new CreateHashJoinIterator(sctx, loc, argv[1], qname);
+}
+
+
+PlanIter_t op_probe_hash_join::codegen(
+    CompilerCB* cb,
+    static_context* sctx,
+    const QueryLoc& loc,
+    std::vector<PlanIter_t>& argv,
+    expr& ann) const
+{
+  fo_expr* fo = static_cast<fo_expr*>(&ann);
+
+  const const_expr* qnameExpr = static_cast<const const_expr*>(fo->get_arg(0));
+  store::Item_t qname = const_cast<store::Item*>(qnameExpr->get_val());
+
+  return new ProbeHashJoinIterator(sctx, loc, argv[1], qname);
+}
+
+
 PlanIter_t fn_zorba_ddl_create_index::codegen(
   CompilerCB*,
   static_context* sctx,
@@ -157,6 +194,76 @@ PlanIter_t fn_zorba_ddl_probe_index_range_value_skip::codegen(
 }
 
 
+/*******************************************************************************
+  The type of the items in the projected key column, if the index and the
+  column are known statically.
+********************************************************************************/
+static xqtref_t get_key_column_type(const fo_expr* caller, xqtref_t defaultType)
+{
+  const store::Item* qname = caller->get_arg(0)->getQName();
+
+  if (qname == NULL || caller->get_arg(1)->get_expr_kind() != const_expr_kind)
+    return defaultType;
+
+  const IndexDecl* decl = caller->get_sctx()->lookup_index(qname);
+
+  if (decl == NULL)
+    return defaultType;
+
+  const store::Item* column =
+  static_cast<const const_expr*>(caller->get_arg(1))->get_val();
+
+  xs_integer pos = column->getIntegerValue();
+
+  if (pos.sign() <= 0 || pos > xs_integer(decl->getNumKeyExprs()))
+    return defaultType;
+
+  xqtref_t keyType = decl->getKeyTypes()[to_xs_unsignedInt(pos) - 1];
+
+  if (keyType == NULL)
+    return defaultType;
+
+  return caller->get_type_manager()->
+         create_type(*keyType, SequenceType::QUANT_STAR);
+}
+
+
+xqtref_t op_probe_index_point_value_column::getReturnType(
+    const fo_expr* caller) const
+{
+  return get_key_column_type(caller, theSignature.returnType());
+}
+
+
+PlanIter_t op_probe_index_point_value_column::codegen(
+  CompilerCB*,
+  static_context* sctx,
+  const QueryLoc& loc,
+  std::vector<PlanIter_t>& argv,
+  expr& ann) const
+{
+  return new ProbeIndexPointValueIterator(sctx, loc, argv, false, true);
+}
+
+
+xqtref_t op_probe_index_range_value_column::getReturnType(
+    const fo_expr* caller) const
+{
+  return get_key_column_type(caller, theSignature.returnType());
+}
+
+
+PlanIter_t op_probe_index_range_value_column::codegen(
+  CompilerCB*,
+  static_context* sctx,
+  const QueryLoc& loc,
+  std::vector<PlanIter_t>& argv,
+  expr& ann) const
+{
+  return new ProbeIndexRangeValueIterator(sctx, loc, argv, false, true);
+}
+
+
 PlanIter_t fn_zorba_ddl_probe_index_range_general::codegen(
   CompilerCB*,
   static_context* sctx,
@@ -168,6 +275,30 @@ PlanIter_t fn_zorba_ddl_probe_index_range_general::codegen(
 }
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+PlanIter_t fn_zorba_ddl_probe_index_full_text::codegen(
+  CompilerCB*,
+  static_context* sctx,
+  const QueryLoc& loc,
+  std::vector<PlanIter_t>& argv,
+  expr& ann) const
+{
+  return new ProbeIndexFullTextIterator(sctx, loc, argv);
+}
+
+
+PlanIter_t op_full_text_index_tokens::codegen(
+  CompilerCB*,
+  static_context* sctx,
+  const QueryLoc& loc,
+  std::vector<PlanIter_t>& argv,
+  expr& ann) const
+{
+  return new FullTextIndexTokensIterator(sctx, loc, argv[0]);
+}
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
 void populate_context_index_ddl(static_context* sctx)
 {
   const char* zorba_op_ns = static_context::ZORBA_OP_NS;
@@ -184,12 +315,31 @@ void populate_context_index_ddl(static_context* sctx)
         GENV_TYPESYSTEM.ANY_ATOMIC_TYPE_STAR,
         GENV_TYPESYSTEM.ITEM_TYPE_STAR));
 
+#ifndef ZORBA_NO_FULL_TEXT
+  DECL(sctx, op_full_text_index_tokens,
+       (createQName(zorba_op_ns, "", "full-text-index-tokens"),
+        GENV_TYPESYSTEM.ITEM_TYPE_STAR,
+        GENV_TYPESYSTEM.STRING_TYPE_STAR));
+#endif
+
   DECL(sctx, op_create_internal_index,
        (createQName(zorba_op_ns, "", "create-internal-index"),
         GENV_TYPESYSTEM.QNAME_TYPE_ONE,
         GENV_TYPESYSTEM.ITEM_TYPE_STAR,
         GENV_TYPESYSTEM.EMPTY_TYPE));
 
+  DECL(sctx, op_create_hash_join,
+       (createQName(zorba_op_ns, "", "create-hash-join"),
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE,
+        GENV_TYPESYSTEM.ITEM_TYPE_STAR,
+        GENV_TYPESYSTEM.EMPTY_TYPE));
+
+  DECL(sctx, op_probe_hash_join,
+       (createQName(zorba_op_ns, "", "probe-hash-join"),
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE,
+        GENV_TYPESYSTEM.ANY_ATOMIC_TYPE_QUESTION,
+        GENV_TYPESYSTEM.ITEM_TYPE_STAR));
+
   DECL(sctx, fn_zorba_ddl_create_index,
        (createQName("http://zorba.io/modules/store/static/indexes/ddl",
                     "",
@@ -254,6 +404,20 @@ void populate_context_index_ddl(static_context* sctx)
         true,
         GENV_TYPESYSTEM.ANY_NODE_TYPE_STAR));
 
+  DECL(sctx, op_probe_index_point_value_column,
+       (createQName(zorba_op_ns, "", "probe-index-point-value-column"),
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE,
+        GENV_TYPESYSTEM.INTEGER_TYPE_ONE,
+        true,
+        GENV_TYPESYSTEM.ANY_ATOMIC_TYPE_STAR));
+
+  DECL(sctx, op_probe_index_range_value_column,
+       (createQName(zorba_op_ns, "", "probe-index-range-value-column"),
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE,
+        GENV_TYPESYSTEM.INTEGER_TYPE_ONE,
+        true,
+        GENV_TYPESYSTEM.ANY_ATOMIC_TYPE_STAR));
+
   DECL(sctx, fn_zorba_ddl_probe_index_range_general,
        (createQName("http://zorba.io/modules/store/static/indexes/dml",
                     "",
@@ -266,6 +430,17 @@ void populate_context_index_ddl(static_context* sctx)
         GENV_TYPESYSTEM.BOOLEAN_TYPE_ONE,
         GENV_TYPESYSTEM.BOOLEAN_TYPE_ONE,
         GENV_TYPESYSTEM.ANY_NODE_TYPE_STAR));
+
+#ifndef ZORBA_NO_FULL_TEXT
+  DECL(sctx, fn_zorba_ddl_probe_index_full_text,
+       (createQName("http://zorba.io/modules/store/static/indexes/dml",
+                    "",
+                    "probe-index-full-text"),
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE,
+        GENV_TYPESYSTEM.ANY_ATOMIC_TYPE_STAR,
+        GENV_TYPESYSTEM.STRING_TYPE_ONE,
+        GENV_TYPESYSTEM.ANY_NODE_TYPE_STAR));
+#endif
 }
 
 
@@ -65,6 +65,61 @@ public:
 };
 
 
+/*******************************************************************************
+  op:create-hash-join($joinName as xs:QName, $items as item*)
+
+  The second param is bound to an expression of the form :
+
+  for $dot at $pos in domain_expr
+  return value-index-entry-builder($$dot, key_expr)
+********************************************************************************/
+class op_create_hash_join : public function
+{
+public:
+  op_create_hash_join(const signature& sig)
+    :
+    function(sig, FunctionConsts::OP_CREATE_HASH_JOIN_2)
+  {
+  }
+
+  bool accessesDynCtx() const { return true; }
+
+  unsigned short getScriptingKind() const 
+  {
+    // Like create-internal-index, this is NOT a sequential function, although
+    // it binds the hash table in the dynamic context immediately.
+    return SIMPLE_EXPR;
+  }
+
+  bool mustCopyInputNodes(expr* fo, csize input) const { return false; }
+
+  BoolAnnotationValue ignoresSortedNodes(expr* fo, csize input) const 
+  {
+    return ANNOTATION_TRUE;
+  }
+
+  CODEGEN_DECL();
+};
+
+
+/*******************************************************************************
+  op:probe-hash-join($joinName as xs:QName, $key as xs:anyAtomicType?)
+********************************************************************************/
+class op_probe_hash_join : public function
+{
+public:
+  op_probe_hash_join(const signature& sig)
+    :
+    function(sig, FunctionConsts::OP_PROBE_HASH_JOIN_2)
+  {
+  }
+
+  bool accessesDynCtx() const { return true; }
+
+  CODEGEN_DECL();
+};
+
+
 /*******************************************************************************
   fn-zorba-ddl:create($indexName as xs:QName)
 ********************************************************************************/
@@ -168,6 +223,29 @@ public:
 };
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+/*******************************************************************************
+  op:full-text-index-tokens($input as item()*) as xs:string*
+
+  Computes the key values of a full-text index from the items returned by its
+  key expression (see FullTextIndexTokensIterator).
+********************************************************************************/
+class op_full_text_index_tokens : public function
+{
+public:
+  op_full_text_index_tokens(const signature& sig)
+    :
+    function(sig, FunctionConsts::OP_FULL_TEXT_INDEX_TOKENS_1)
+  {
+  }
+
+  bool mustCopyInputNodes(expr* fo, csize input) const { return false; }
+
+  CODEGEN_DECL();
+};
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
 /*******************************************************************************
   fn-zorba-ddl:probe-index-point-value(
       $indexName as xs:QName, 
@@ -315,6 +393,62 @@ public:
 };
 
 
+/*******************************************************************************
+  op-zorba:probe-index-point-value-column(
+      $indexName as xs:QName,
+      $column    as xs:integer,
+      $key1      as xs:anyAtomicItem?,
+      ....
+      $keyN      as xs:anyAtomicItem?) as xs:anyAtomicType*
+
+  Like probe-index-point-value, but returns, instead of the nodes found, the
+  items in the given (1-based) key column of their index entries, skipping
+  empty ones. Calls to this function are introduced by the IndexMatchingRule
+  only, for queries that need nothing but that key from the nodes.
+********************************************************************************/
+class op_probe_index_point_value_column : public function
+{
+public:
+  op_probe_index_point_value_column(const signature& sig)
+    :
+    function(sig, FunctionConsts::OP_PROBE_INDEX_POINT_VALUE_COLUMN_N)
+  {
+  }
+
+  bool accessesDynCtx() const { return true; }
+
+  xqtref_t getReturnType(const fo_expr* caller) const;
+
+  CODEGEN_DECL();
+};
+
+
+/*******************************************************************************
+  op-zorba:probe-index-range-value-column(
+      $indexName as xs:QName,
+      $column    as xs:integer,
+      ....) as xs:anyAtomicType*
+
+  The key-column counterpart of probe-index-range-value (see
+  op_probe_index_point_value_column).
+********************************************************************************/
+class op_probe_index_range_value_column : public function
+{
+public:
+  op_probe_index_range_value_column(const signature& sig)
+    :
+    function(sig, FunctionConsts::OP_PROBE_INDEX_RANGE_VALUE_COLUMN_N)
+  {
+  }
+
+  bool accessesDynCtx() const { return true; }
+
+  xqtref_t getReturnType(const fo_expr* caller) const;
+
+  CODEGEN_DECL();
+};
+
+
 /*******************************************************************************
   fn-zorba-ddl:probe-index-range-general(
       $indexName           as xs:QName, 
@@ -343,6 +477,37 @@ public:
 };
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+/*******************************************************************************
+  fn-zorba-ddl:probe-index-full-text(
+      $indexName as xs:QName,
+      $words     as xs:anyAtomicType*,
+      $mode      as xs:string) as node()*
+
+  Note: the translator wraps calls to this function with an OP_SORT_NODES_ASC
+  function.
+********************************************************************************/
+class fn_zorba_ddl_probe_index_full_text : public function
+{
+public:
+  fn_zorba_ddl_probe_index_full_text(const signature& sig)
+    :
+    function(sig, FunctionConsts::FN_ZORBA_XQDDF_PROBE_INDEX_FULL_TEXT_3)
+  {
+  }
+
+  bool accessesDynCtx() const { return true; }
+
+  FunctionConsts::AnnotationValue producesDistinctNodes() const 
+  {
+    return FunctionConsts::YES;
+  }
+
+  CODEGEN_DECL();
+};
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
 } //namespace zorba
 
 
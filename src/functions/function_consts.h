@@ -59,12 +59,18 @@ typedef enum
   FN_ZORBA_XQDDF_PROBE_INDEX_RANGE_VALUE_N,
   FN_ZORBA_XQDDF_PROBE_INDEX_RANGE_VALUE_SKIP_N,
   FN_ZORBA_XQDDF_PROBE_INDEX_RANGE_GENERAL_N,
+  FN_ZORBA_XQDDF_PROBE_INDEX_FULL_TEXT_3,
+  OP_PROBE_INDEX_POINT_VALUE_COLUMN_N,
+  OP_PROBE_INDEX_RANGE_VALUE_COLUMN_N,
   OP_CREATE_INTERNAL_INDEX_2,
+  OP_CREATE_HASH_JOIN_2,
+  OP_PROBE_HASH_JOIN_2,
   FN_ZORBA_XQDDF_CREATE_INDEX_1,
   FN_ZORBA_XQDDF_DELETE_INDEX_1,
   FN_ZORBA_XQDDF_REFRESH_INDEX_1,
   OP_VALUE_INDEX_ENTRY_BUILDER_N,
   OP_GENERAL_INDEX_ENTRY_BUILDER_N,
+  OP_FULL_TEXT_INDEX_TOKENS_1,
 
   FN_EXACTLY_ONE_1,
   FN_MAX_1,
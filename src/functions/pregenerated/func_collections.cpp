@@ -577,6 +577,32 @@ void populate_context_collections(static_context* sctx)
 
 
 
+      {
+    DECL_WITH_KIND(sctx, zorba_store_static_collections_dml_insert_last_documents,
+        (createQName("http://zorba.io/modules/store/static/collections/dml","","insert-last-documents"), 
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE, 
+        GENV_TYPESYSTEM.STRING_TYPE_STAR, 
+        GENV_TYPESYSTEM.EMPTY_TYPE),
+        FunctionConsts::ZORBA_STORE_STATIC_COLLECTIONS_DML_INSERT_LAST_DOCUMENTS_2);
+
+  }
+
+
+
+
+      {
+    DECL_WITH_KIND(sctx, zorba_store_static_collections_dml_insert_last_documents,
+        (createQName("http://zorba.io/modules/store/dynamic/collections/dml","","insert-last-documents"), 
+        GENV_TYPESYSTEM.QNAME_TYPE_ONE, 
+        GENV_TYPESYSTEM.STRING_TYPE_STAR, 
+        GENV_TYPESYSTEM.EMPTY_TYPE),
+        FunctionConsts::ZORBA_STORE_DYNAMIC_COLLECTIONS_DML_INSERT_LAST_DOCUMENTS_2);
+
+  }
+
+
+
+
       {
     DECL_WITH_KIND(sctx, zorba_store_static_collections_dml_apply_insert_first,
         (createQName("http://zorba.io/modules/store/static/collections/dml","","apply-insert-first"), 
@@ -320,6 +320,25 @@ public:
 };
 
 
+//zorba-store-static-collections-dml:insert-last-documents
+class zorba_store_static_collections_dml_insert_last_documents : public function
+{
+public:
+  zorba_store_static_collections_dml_insert_last_documents(const signature& sig, FunctionConsts::FunctionKind kind)
+    : 
+    function(sig, kind)
+  {
+
+  }
+
+  unsigned short getScriptingKind() const { return UPDATING_EXPR; }
+
+  bool accessesDynCtx() const { return true; }
+
+  CODEGEN_DECL();
+};
+
+
 //zorba-store-static-collections-dml:apply-insert-first
 class zorba_store_static_collections_dml_apply_insert_first : public function
 {
@@ -73,6 +73,8 @@
   ZORBA_STORE_DYNAMIC_COLLECTIONS_DML_INSERT_FIRST_2,
   ZORBA_STORE_STATIC_COLLECTIONS_DML_INSERT_LAST_2,
   ZORBA_STORE_DYNAMIC_COLLECTIONS_DML_INSERT_LAST_2,
+  ZORBA_STORE_STATIC_COLLECTIONS_DML_INSERT_LAST_DOCUMENTS_2,
+  ZORBA_STORE_DYNAMIC_COLLECTIONS_DML_INSERT_LAST_DOCUMENTS_2,
   ZORBA_STORE_STATIC_COLLECTIONS_DML_APPLY_INSERT_FIRST_2,
   ZORBA_STORE_DYNAMIC_COLLECTIONS_DML_APPLY_INSERT_FIRST_2,
   ZORBA_STORE_STATIC_COLLECTIONS_DML_APPLY_INSERT_LAST_2,
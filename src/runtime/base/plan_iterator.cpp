@@ -73,7 +73,8 @@ PlanState::PlanState(
   theLocalDynCtx(localDctx),
   theHasToQuit(false),
   theProfile( Properties::instance().getCollectProfile() ),
-  theBlockOwned(true)
+  theBlockOwned(true),
+  theArena(NULL)
 {
   assert(globalDctx != NULL && localDctx != NULL);
   theBlock = new int8_t[theBlockSize];
@@ -92,7 +93,8 @@ PlanState::PlanState(PlanState& aPlanState):
       theDebuggerCommons(aPlanState.theDebuggerCommons),
       theHasToQuit(aPlanState.theHasToQuit),
       theProfile(aPlanState.theProfile),
-      theBlockOwned(false)
+      theBlockOwned(false),
+      theArena(&aPlanState.getArena())
 {
 }
 
@@ -106,8 +108,12 @@ void PlanState::checkDepth(const QueryLoc& loc)
 PlanState::~PlanState()
 {
   if (theBlockOwned)
+  {
     delete[] theBlock;
+    delete theArena;
+  }
   theBlock = 0;
+  theArena = 0;
 }
 
 
@@ -201,15 +207,18 @@ TypeManager* PlanIterator::getTypeManager() const
 
 bool PlanIterator::countImpl(store::Item_t& result, PlanState& planState) const
 {
-  store::Item_t item;
-  xs_integer count(0);
+  std::vector<store::Item_t> items;
+  bool haveMoreItems = true;
+  csize count = 0;
 
   PlanIteratorState* state;
   DEFAULT_STACK_INIT(PlanIteratorState, state, planState);
 
-  while (consumeNext(item, this, planState))
+  while (haveMoreItems)
   {
-    ++count;
+    items.clear();
+    haveMoreItems = consumeNextBatch(items, this, planState);
+    count += items.size();
   }
 
   STACK_PUSH(GENV_ITEMFACTORY->createInteger(result, xs_integer(count)), state);
@@ -229,6 +238,36 @@ bool PlanIterator::skipImpl(int64_t count, PlanState& planState) const
 }
 
 
+void PlanIterator::setMaxItemsImpl(csize, PlanState&) const
+{
+}
+
+
+/*******************************************************************************
+  Default batch adapter: pulls the items one by one through nextImpl(), so that
+  every iterator supports batched consumption. The per-item profiling and
+  interrupt checks of consumeNext() are done once for the whole batch by the
+  caller.
+********************************************************************************/
+bool PlanIterator::nextBatchImpl(
+    std::vector<store::Item_t>& result,
+    csize maxItems,
+    PlanState& planState) const
+{
+  store::Item_t item;
+
+  for (csize i = 0; i < maxItems; ++i)
+  {
+    if (!nextImpl(item, planState))
+      return false;
+
+    result.push_back(item);
+  }
+
+  return true;
+}
+
+
 #ifndef NDEBUG
 bool PlanIterator::consumeNext(
     store::Item_t& result,
@@ -18,6 +18,7 @@
 #define ZORBA_RUNTIME_PLAN_ITERATOR
 
 #include <stack>
+#include <vector>
 
 #include "common/shared_types.h"
 
@@ -27,6 +28,8 @@
 
 #include "compiler/parser/query_loc.h"
 
+#include "runtime/base/query_arena.h"
+
 #include "zorba/util/timer.h"
 #include "zorbaserialization/class_serializer.h"
 #include "zorbaserialization/serialize_template_types.h"
@@ -113,6 +116,11 @@ class XQueryImpl;
                     i.e. between every two iterator next calls. This value is
                     set by the StateWrapper class (see runtime/util/timeout.h)
                     after a user-defined timeout value is exceeded.
+
+  theArena        : The arena from which the iterators allocate the structures
+                    that do not outlive the execution of the plan (see class
+                    QueryArena). It is created on first use. A copy of a plan
+                    state shares the arena of the original, like its block.
 ********************************************************************************/
 class PlanState
 {
@@ -143,6 +151,9 @@ public:
 
   bool                      theBlockOwned;
 
+protected:
+  QueryArena              * theArena;
+
 public:
   PlanState(
       dynamic_context* globalDctx,
@@ -156,6 +167,16 @@ public:
   ~PlanState();
 
   void checkDepth(const QueryLoc& loc);
+
+  QueryArena& getArena()
+  {
+    if (theArena == NULL)
+      theArena = new QueryArena();
+
+    return *theArena;
+  }
+
+  const QueryArena* getArenaIfAny() const { return theArena; }
 };
 
 
@@ -398,6 +419,9 @@ class PlanIterator : public SimpleRCObject
 {
   friend class PlanIterWrapper;
 
+public:
+  static const csize DEFAULT_BATCH_SIZE = 256;
+
 protected:
   uint32_t           theStateOffset;
 
@@ -574,6 +598,63 @@ public:
 
   virtual bool skipImpl(int64_t count, PlanState &planState) const;
 
+  /**
+   * Tell the iterator that its consumer will ask for at most maxItems items
+   * before the iterator is reset or closed. The hint must be given after the
+   * iterator has been opened or reset, and before any of its items has been
+   * requested; it is forgotten on reset. Classes can overwrite
+   * setMaxItemsImpl() to compute less of their result when only a prefix of
+   * it is needed (e.g. an order-by can keep just the top maxItems tuples).
+   * The base implementation ignores the hint.
+   *
+   * @param maxItems the max number of items that will be requested (> 0)
+   * @param planState the state plan
+   */
+  void setMaxItems(csize maxItems, PlanState& planState) const
+  {
+    setMaxItemsImpl(maxItems, planState);
+  }
+
+  virtual void setMaxItemsImpl(csize maxItems, PlanState& planState) const;
+
+  /**
+   * Produce up to maxItems next items of the Plan's sequence and append them
+   * to the given vector. The profiling and interrupt checks are done once per
+   * batch rather than once per item. Classes can overwrite nextBatchImpl() to
+   * produce a whole batch without going through nextImpl() for every item.
+   *
+   * Returns false if the end of the sequence has been reached (fewer than
+   * maxItems items may have been appended in that case), true otherwise.
+   * After false has been returned, the iterator must be reset before it is
+   * asked for more items. Once produceNextBatch() has been called, the
+   * iterator must not be asked for single items via produceNext() until it
+   * is reset.
+   *
+   * @param result the vector to append the produced items to
+   * @param maxItems the maximum number of items to produce
+   * @param planState the state plan
+   */
+  bool produceNextBatch(
+      std::vector<store::Item_t>& result,
+      csize maxItems,
+      PlanState& planState) const
+  {
+    PlanIteratorState *const state =
+      StateTraitsImpl<PlanIteratorState>::getState(planState, theStateOffset);
+
+#ifndef NDEBUG
+    ZORBA_ASSERT(state->theIsOpened);
+#endif
+    TimerWrapper t(state, planState.theProfile, &mbr_fn::addNext);
+
+    return nextBatchImpl(result, maxItems, planState);
+  }
+
+  virtual bool nextBatchImpl(
+      std::vector<store::Item_t>& result,
+      csize maxItems,
+      PlanState& planState) const;
+
   /**
    * Produce the next item and return it to the caller. Implicitly, the first
    * call of 'producNext' initializes the iterator and allocates resources
@@ -620,6 +701,25 @@ public:
     return iter->produceNext(result, planState);
   }
 #endif
+
+  /**
+   * Static Method: Makes the given iterator produce up to maxItems next
+   * results and appends them to the given vector. See produceNextBatch().
+   */
+  static bool consumeNextBatch(
+        std::vector<store::Item_t>& result,
+        const PlanIterator* iter,
+        PlanState& planState,
+        csize maxItems = DEFAULT_BATCH_SIZE)
+  {
+    if (planState.theHasToQuit)
+    {
+      // Quit the execution
+      throw FlowCtlException(FlowCtlException::INTERRUPT);
+    }
+
+    return iter->produceNextBatch(result, maxItems, planState);
+  }
 };
 
 #ifndef NDEBUG
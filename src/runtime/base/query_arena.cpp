@@ -0,0 +1,119 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include "runtime/base/query_arena.h"
+
+namespace zorba
+{
+
+/*******************************************************************************
+
+********************************************************************************/
+QueryArena::QueryArena()
+  :
+  thePageCur(NULL),
+  thePageEnd(NULL),
+  theNumAllocations(0),
+  theBytesInUse(0),
+  thePeakBytesInUse(0)
+{
+  for (size_t c = 0; c < NUM_CLASSES; ++c)
+    theFreeLists[c] = NULL;
+}
+
+
+QueryArena::~QueryArena()
+{
+  for (size_t i = 0; i < thePages.size(); ++i)
+    delete [] thePages[i];
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void* QueryArena::allocate(size_t size)
+{
+  size_t c = (size - 1) / GRANULE;
+
+  if (c >= NUM_CLASSES)
+    return ::operator new(size);
+
+  size_t blockSize = (c + 1) * GRANULE;
+
+  ++theNumAllocations;
+  theBytesInUse += blockSize;
+
+  if (theBytesInUse > thePeakBytesInUse)
+    thePeakBytesInUse = theBytesInUse;
+
+  FreeBlock* block = theFreeLists[c];
+
+  if (block != NULL)
+  {
+    theFreeLists[c] = block->theNext;
+    return block;
+  }
+
+  if (static_cast<size_t>(thePageEnd - thePageCur) < blockSize)
+  {
+    // The rest of the current page is too small for the block, so it is put
+    // in the free list of the largest size class that fits in it.
+    size_t rest = thePageEnd - thePageCur;
+
+    if (rest >= GRANULE)
+    {
+      FreeBlock* restBlock = reinterpret_cast<FreeBlock*>(thePageCur);
+      size_t restClass = rest / GRANULE - 1;
+      restBlock->theNext = theFreeLists[restClass];
+      theFreeLists[restClass] = restBlock;
+    }
+
+    thePageCur = new char[PAGE_SIZE];
+    thePageEnd = thePageCur + PAGE_SIZE;
+    thePages.push_back(thePageCur);
+  }
+
+  void* result = thePageCur;
+  thePageCur += blockSize;
+  return result;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void QueryArena::deallocate(void* block, size_t size)
+{
+  size_t c = (size - 1) / GRANULE;
+
+  if (c >= NUM_CLASSES)
+  {
+    ::operator delete(block);
+    return;
+  }
+
+  theBytesInUse -= (c + 1) * GRANULE;
+
+  FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+  freeBlock->theNext = theFreeLists[c];
+  theFreeLists[c] = freeBlock;
+}
+
+
+} // namespace zorba
+/* vim:set et sw=2 ts=2: */
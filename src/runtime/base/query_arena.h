@@ -0,0 +1,177 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#ifndef ZORBA_RUNTIME_QUERY_ARENA_H
+#define ZORBA_RUNTIME_QUERY_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace zorba
+{
+
+/*******************************************************************************
+  A memory arena owned by a PlanState (see PlanState::getArena()), from which
+  the iterators of a plan allocate the transient structures that never outlive
+  the plan's execution, such as the sort keys of an order-by clause.
+
+  Like the MemoryManager of the compiler, the arena carves its blocks out of
+  large pages that are all freed together when the arena is destroyed, so the
+  blocks need no per-block bookkeeping. Unlike it, the blocks can be given back
+  with deallocate(), since iterators that are reset in a loop allocate and drop
+  their structures over and over: the blocks are kept in free lists, one per
+  size class of GRANULE bytes, and reused by later allocations of the same size
+  class. Blocks larger than the largest size class come from the heap.
+
+  An arena is used by the single thread that executes its plan, so it takes no
+  locks; the worker threads of a parallel FLWOR have plan states, and arenas,
+  of their own.
+
+  The counters are reported in the profile of the query (see PrinterVisitor).
+********************************************************************************/
+class QueryArena
+{
+public:
+  enum
+  {
+    PAGE_SIZE = 16384,
+    GRANULE = 16,
+    NUM_CLASSES = 32
+  };
+
+protected:
+  struct FreeBlock
+  {
+    FreeBlock  * theNext;
+  };
+
+protected:
+  std::vector<char*>   thePages;
+  char               * thePageCur;
+  char               * thePageEnd;
+
+  FreeBlock          * theFreeLists[NUM_CLASSES];
+
+  size_t               theNumAllocations;
+  size_t               theBytesInUse;
+  size_t               thePeakBytesInUse;
+
+public:
+  QueryArena();
+
+  ~QueryArena();
+
+  void* allocate(size_t size);
+
+  void deallocate(void* block, size_t size);
+
+  size_t getNumAllocations() const { return theNumAllocations; }
+
+  size_t getBytesInUse() const { return theBytesInUse; }
+
+  size_t getPeakBytesInUse() const { return thePeakBytesInUse; }
+
+  size_t getPageBytes() const { return thePages.size() * PAGE_SIZE; }
+
+private:
+  QueryArena(const QueryArena&);
+  QueryArena& operator=(const QueryArena&);
+};
+
+
+/*******************************************************************************
+  An STL allocator over a QueryArena. A default-constructed allocator has no
+  arena and allocates from the heap, so that containers that are not given an
+  arena keep working as before. The allocator travels with the contents of a
+  container when the container is swapped or moved.
+********************************************************************************/
+template <class T>
+class ArenaAllocator
+{
+  template <class U> friend class ArenaAllocator;
+
+public:
+  typedef T              value_type;
+  typedef T            * pointer;
+  typedef const T      * const_pointer;
+  typedef T            & reference;
+  typedef const T      & const_reference;
+  typedef size_t         size_type;
+  typedef ptrdiff_t      difference_type;
+
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+protected:
+  QueryArena  * theArena;
+
+public:
+  ArenaAllocator(QueryArena* arena = NULL) : theArena(arena) { }
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : theArena(other.theArena) { }
+
+  QueryArena* getArena() const { return theArena; }
+
+  pointer address(reference x) const { return &x; }
+
+  const_pointer address(const_reference x) const { return &x; }
+
+  size_type max_size() const { return size_type(-1) / sizeof(T); }
+
+  void construct(pointer p, const T& value) { new (p) T(value); }
+
+  void destroy(pointer p) { p->~T(); }
+
+  pointer allocate(size_type n, const void* = 0)
+  {
+    if (theArena == NULL)
+      return static_cast<pointer>(::operator new(n * sizeof(T)));
+
+    return static_cast<pointer>(theArena->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type n)
+  {
+    if (theArena == NULL)
+      ::operator delete(p);
+    else
+      theArena->deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U>& other) const
+  {
+    return theArena == other.theArena;
+  }
+
+  template <class U>
+  bool operator!=(const ArenaAllocator<U>& other) const
+  {
+    return theArena != other.theArena;
+  }
+};
+
+
+} // namespace zorba
+
+#endif /* ZORBA_RUNTIME_QUERY_ARENA_H */
+/* vim:set et sw=2 ts=2: */
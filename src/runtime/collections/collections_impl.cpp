@@ -21,6 +21,7 @@
 #include "diagnostics/util_macros.h"
 #include "diagnostics/xquery_diagnostics.h"
 #include <zorba/internal/unique_ptr.h>
+#include <zorba/properties.h>
 
 #include "zorbatypes/URI.h"
 #include "zorbatypes/numconversions.h"
@@ -37,6 +38,7 @@
 
 #include "runtime/collections/collections.h"
 #include "runtime/core/apply_updates.h"
+#include "runtime/util/doc_uri_heuristics.h"
 #include "runtime/base/plan_iterator.h"
 #include "runtime/visitors/planiter_visitor.h"
 
@@ -382,6 +384,43 @@ bool ZorbaCollectionIterator::nextImpl(
 }
 
 
+bool ZorbaCollectionIterator::nextBatchImpl(
+    std::vector<store::Item_t>& result,
+    csize maxItems,
+    PlanState& planState) const
+{
+  store::Item_t item;
+
+  ZorbaCollectionIteratorState* state = StateTraitsImpl<ZorbaCollectionIteratorState>::getState(planState, theStateOffset);
+
+  if (state->theIterator.getp() != NULL && state->theIteratorOpened == false)
+  {
+    ZORBA_ASSERT (false && "nextBatchImpl() called past iterator end");
+    return false;
+  }
+  else if ( ! state->theIteratorOpened)
+  {
+    initCollection(planState, 0);
+  }
+
+  // pull straight from the store iterator, bypassing the duff's device
+  for (csize i = 0; i < maxItems; ++i)
+  {
+    if (!state->theIterator->next(item))
+    {
+      // close as early as possible
+      state->theIterator->close();
+      state->theIteratorOpened = false;
+      return false;
+    }
+
+    result.push_back(item);
+  }
+
+  return true;
+}
+
+
 bool ZorbaCollectionIterator::skipImpl(int64_t count, PlanState& planState) const
 {  
   ZorbaCollectionIteratorState* state = StateTraitsImpl<ZorbaCollectionIteratorState>::getState(planState, theStateOffset);
@@ -854,6 +893,133 @@ ZorbaInsertLastIterator::getCollection(
 }
 
 
+/*******************************************************************************
+  declare updating function
+  insert-last-documents($name as xs:QName, $uris as xs:string*)
+
+  Loads the documents at the given uris and inserts them at the end of the
+  collection. The uris are resolved to streams on the calling thread, and the
+  store then parses the streams, on Properties::getLoaderThreads() threads,
+  each into a tree of its own. The new trees are inserted as they are, without
+  being copied, since nothing else can reference them.
+********************************************************************************/
+bool ZorbaInsertLastDocumentsIterator::nextImpl(
+    store::Item_t& result,
+    PlanState& planState) const
+{
+  store::Collection_t                           collection;
+  const StaticallyKnownCollection*              collectionDecl;
+  store::Item_t                                 name;
+  store::Item_t                                 uriItem;
+  std::vector<std::unique_ptr<internal::Resource> > resources;
+  std::vector<zstring>                          uris;
+  std::vector<std::istream*>                    streams;
+  std::vector<store::Item_t>                    docs;
+  store::LoadProperties                         loadProperties;
+  std::unique_ptr<store::PUL>                   pul;
+
+  PlanIteratorState* state;
+  DEFAULT_STACK_INIT(PlanIteratorState, state, planState);
+
+  consumeNext(name, theChildren[0].getp(), planState);
+
+  collectionDecl = getCollection(name, collection);
+
+  while (consumeNext(uriItem, theChildren[1].getp(), planState))
+  {
+    zstring uri;
+    zstring normUri;
+    zstring errorMessage;
+
+    uriItem->getStringValue2(uri);
+    normalizeInputUri(uri, theSctx, loc, &normUri);
+
+    std::unique_ptr<internal::Resource> resource =
+    theSctx->resolve_uri(normUri, internal::EntityData::DOCUMENT, errorMessage);
+
+    internal::StreamResource* streamResource =
+    dynamic_cast<internal::StreamResource*>(resource.get());
+
+    if (streamResource == NULL || streamResource->getStream() == NULL)
+    {
+      RAISE_ERROR(err::FODC0002, loc, ERROR_PARAMS(uri, errorMessage));
+    }
+
+    uris.push_back(normUri);
+    streams.push_back(streamResource->getStream());
+    resources.push_back(std::move(resource));
+  }
+
+  loadProperties.setStoreDocument(false);
+  loadProperties.setDTDValidate(theSctx->is_feature_set(feature::dtd));
+
+  try
+  {
+    GENV_STORE.loadDocuments(uris,
+                             streams,
+                             loadProperties,
+                             Properties::instance().getLoaderThreads(),
+                             docs);
+  }
+  catch (ZorbaException& e)
+  {
+    e.set_diagnostic(err::FODC0002);
+    set_source(e, loc);
+    throw;
+  }
+
+  for (csize i = 0; i < docs.size(); ++i)
+  {
+    checkNodeType(theSctx, docs[i], collectionDecl, loc, theIsDynamic);
+  }
+
+  pul.reset(GENV_ITEMFACTORY->createPendingUpdateList());
+
+  pul->addInsertLastIntoCollection(&loc, name, docs, theIsDynamic);
+
+  result = pul.release();
+  STACK_PUSH(result != NULL, state);
+
+  STACK_END (state);
+}
+
+
+const StaticallyKnownCollection*
+ZorbaInsertLastDocumentsIterator::getCollection(
+    const store::Item_t& name,
+    store::Collection_t& coll) const
+{
+  const StaticallyKnownCollection* collectionDecl =
+  zorba::getCollection(theSctx, name, loc, theIsDynamic, coll);
+
+  if (!theIsDynamic) 
+  {
+    switch(collectionDecl->getUpdateProperty())
+    {
+      case StaticContextConsts::decl_const:
+        RAISE_ERROR(zerr::ZDDY0004_COLLECTION_CONST_UPDATE, loc,
+        ERROR_PARAMS(name->getStringValue()));
+
+      case StaticContextConsts::decl_append_only:
+      case StaticContextConsts::decl_queue:
+      case StaticContextConsts::decl_mutable:
+        // good to go
+        break;
+
+      default:
+        ZORBA_ASSERT(false);
+    }
+
+    if (collectionDecl && !collectionDecl->isOrdered())
+    {
+      RAISE_ERROR(zerr::ZDDY0012_COLLECTION_UNORDERED_BAD_OPERATION, loc,
+      ERROR_PARAMS(name->getStringValue(), "insert"));
+    }
+  }
+  return collectionDecl;
+}
+
+
 /*******************************************************************************
   declare updating function
   insert-before($name as xs:QName,
@@ -511,6 +511,41 @@ zstring ZorbaInsertLastIterator::getNameAsString() const {
 // </ZorbaInsertLastIterator>
 
 
+// <ZorbaInsertLastDocumentsIterator>
+SERIALIZABLE_CLASS_VERSIONS(ZorbaInsertLastDocumentsIterator)
+
+void ZorbaInsertLastDocumentsIterator::serialize(::zorba::serialization::Archiver& ar)
+{
+  serialize_baseclass(ar,
+  (ZorbaCollectionIteratorHelper<ZorbaInsertLastDocumentsIterator, PlanIteratorState>*)this);
+}
+
+
+void ZorbaInsertLastDocumentsIterator::accept(PlanIterVisitor& v) const
+{
+  if (!v.hasToVisit(this))
+    return;
+
+  v.beginVisit(*this);
+
+  std::vector<PlanIter_t>::const_iterator lIter = theChildren.begin();
+  std::vector<PlanIter_t>::const_iterator lEnd = theChildren.end();
+  for ( ; lIter != lEnd; ++lIter ){
+    (*lIter)->accept(v);
+  }
+
+  v.endVisit(*this);
+}
+
+ZorbaInsertLastDocumentsIterator::~ZorbaInsertLastDocumentsIterator() {}
+
+
+zstring ZorbaInsertLastDocumentsIterator::getNameAsString() const {
+  return "zorba-store-static-collections-dml:insert-last-documents";
+}
+// </ZorbaInsertLastDocumentsIterator>
+
+
 // <ZorbaApplyInsertFirstIterator>
 SERIALIZABLE_CLASS_VERSIONS(ZorbaApplyInsertFirstIterator)
 
@@ -293,6 +293,7 @@ public:
   bool isCountOptimizable() const;
   bool countImpl(store::Item_t& result, PlanState& planState) const;
   bool skipImpl(int64_t count, PlanState& planState) const;
+  bool nextBatchImpl(std::vector<store::Item_t>& result, csize maxItems, PlanState& planState) const;
   void initCollection(PlanState& planState, int64_t skipCount) const;
   void accept(PlanIterVisitor& v) const;
 
@@ -565,6 +566,42 @@ public:
 };
 
 
+/**
+ * 
+ * Author: 
+ */
+class ZorbaInsertLastDocumentsIterator : public ZorbaCollectionIteratorHelper<ZorbaInsertLastDocumentsIterator, PlanIteratorState>
+{ 
+public:
+  SERIALIZABLE_CLASS(ZorbaInsertLastDocumentsIterator);
+
+  SERIALIZABLE_CLASS_CONSTRUCTOR2T(ZorbaInsertLastDocumentsIterator,
+    ZorbaCollectionIteratorHelper<ZorbaInsertLastDocumentsIterator, PlanIteratorState>);
+
+  void serialize( ::zorba::serialization::Archiver& ar);
+
+  ZorbaInsertLastDocumentsIterator(
+    static_context* sctx,
+    const QueryLoc& loc,
+    std::vector<PlanIter_t>& children,
+    bool isDynamic,
+    bool needToCopy)
+    : 
+    ZorbaCollectionIteratorHelper<ZorbaInsertLastDocumentsIterator, PlanIteratorState>(sctx, loc, children, isDynamic, needToCopy)
+  {}
+
+  virtual ~ZorbaInsertLastDocumentsIterator();
+
+  zstring getNameAsString() const;
+
+public:
+  const StaticallyKnownCollection* getCollection(const store::Item_t& name, store::Collection_t& coll) const;
+  void accept(PlanIterVisitor& v) const;
+
+  bool nextImpl(store::Item_t& result, PlanState& aPlanState) const;
+};
+
+
 /**
  * 
  * Author: 
@@ -26,8 +26,12 @@
 
 #include "runtime/core/flwor_iterator.h"
 #include "runtime/core/gflwor/comp_function.h"
+#include "runtime/core/gflwor/external_sort.h"
+#include "runtime/core/gflwor/groupby_spill.h"
 #include "runtime/api/plan_iterator_wrapper.h"
 #include "runtime/visitors/planiter_visitor.h"
+#include "runtime/util/flowctl_exception.h"
+#include "runtime/util/work_stealing_pool.h"
 
 #include "system/globalenv.h"
 
@@ -36,6 +40,7 @@
 #include "store/api/pul.h"
 #include "store/api/item_factory.h"
 #include <zorba/internal/unique_ptr.h>
+#include <zorba/properties.h>
 
 
 #ifndef WIN32
@@ -702,8 +707,16 @@ FlworState::FlworState()
   :
   theNumTuples(0),
   theCurTuplePos(0),
+  theSorter(NULL),
+  theTopK(0),
+  theTopKNextSeqNo(0),
   theGroupMap(0),
-  theFirstResult(true)
+  theGroupSpiller(NULL),
+  theFirstResult(true),
+  theReturnOffset(0),
+  theParallelInputPos(0),
+  theParallelItemPos(0),
+  theParallelInputDone(false)
 {
 }
 
@@ -715,11 +728,15 @@ FlworState::~FlworState()
 {
   clearSortTable();
 
+  delete theSorter;
+
   if (theGroupMap != NULL)
   {
     clearGroupMap();
     delete theGroupMap;
   }
+
+  delete theGroupSpiller;
 }
 
 
@@ -760,6 +777,10 @@ void FlworState::init(
   theNumTuples = 0;
   theCurTuplePos = 0;
   theFirstResult = true;
+
+  theParallelInputPos = 0;
+  theParallelItemPos = 0;
+  theParallelInputDone = false;
 }
 
 
@@ -815,10 +836,33 @@ void FlworState::reset(PlanState& planState)
   if (!theSortTable.empty())
     clearSortTable();
 
+  if (theSorter != NULL)
+  {
+    delete theSorter;
+    theSorter = NULL;
+    theOrderResultIter = 0;
+  }
+
+  theTopK = 0;
+  theTopKSeqNos.clear();
+  theTopKNextSeqNo = 0;
+
   theTuplesTable.clear();
 
   if (theGroupMap != NULL)
     clearGroupMap();
+
+  if (theGroupSpiller != NULL)
+  {
+    delete theGroupSpiller;
+    theGroupSpiller = NULL;
+  }
+
+  theParallelInput.clear();
+  theParallelResults.clear();
+  theParallelInputPos = 0;
+  theParallelItemPos = 0;
+  theParallelInputDone = false;
 }
 
 
@@ -889,7 +933,9 @@ FLWORIterator::FLWORIterator(
   theGroupByClause(aGroupByClauses),
   theOrderByClause(orderByClause),
   theMaterializeClause(materializeClause),
-  theReturnClause(aReturnClause)
+  theReturnClause(aReturnClause),
+  theNumThreads(0),
+  theTopKSort(false)
 {
   if (theOrderByClause != 0 && theOrderByClause->theOrderSpecs.size() == 0)
   {
@@ -943,6 +989,8 @@ void FLWORIterator::serialize(::zorba::serialization::Archiver& ar)
   ar & theOrderByClause;  //can be null
   ar & theMaterializeClause;  //can be null
   ar & theReturnClause; 
+  ar & theNumThreads;
+  ar & theTopKSort;
 }
 
 
@@ -959,6 +1007,29 @@ bool FLWORIterator::nextImpl(store::Item_t& result, PlanState& planState) const
 
   assert(state->theVarBindingState.size() > 0);
 
+  if (theNumThreads > 1)
+  {
+    while (computeParallelRound(state, planState))
+    {
+      for (state->theCurTuplePos = 0;
+           state->theCurTuplePos < state->theParallelResults.size();
+           ++state->theCurTuplePos)
+      {
+        for (state->theParallelItemPos = 0;
+             state->theParallelItemPos <
+             state->theParallelResults[state->theCurTuplePos].size();
+             ++state->theParallelItemPos)
+        {
+          result.transfer(state->theParallelResults[state->theCurTuplePos]
+                                                   [state->theParallelItemPos]);
+          STACK_PUSH(true, state);
+        }
+      }
+    }
+
+    goto stop;
+  }
+
   while (true)
   {
     // Here we do the variable bindings from the outer most to the inner most
@@ -1064,67 +1135,98 @@ bool FLWORIterator::nextImpl(store::Item_t& result, PlanState& planState) const
               rebindGroupTuplesForSort(state, planState);
             }
 
+            if (state->theSorter != NULL)
             {
-              SortTupleCmp cmp(theOrderByClause->theLocation,
-                               planState.theLocalDynCtx,
-                               theSctx->get_typemanager(),
-                               &theOrderByClause->theOrderSpecs);
+              state->theSorter->sort();
 
-              if (theOrderByClause->theStable)
-              {
-                std::stable_sort(state->theSortTable.begin(),
-                                 state->theSortTable.end(),
-                                 cmp);
-              }
-              else
+              while (nextExternalSortResult(state, planState))
               {
-                std::sort(state->theSortTable.begin(),
-                          state->theSortTable.end(),
-                          cmp);
+                state->theOrderResultIter->open();
+
+                while (state->theOrderResultIter->next(result))
+                {
+                  STACK_PUSH(true, state);
+                }
+
+                state->theOrderResultIter->close();
               }
             }
+            else
+            {
+              {
+                SortTupleCmp cmp(theOrderByClause->theLocation,
+                                 planState.theLocalDynCtx,
+                                 theSctx->get_typemanager(),
+                                 &theOrderByClause->theOrderSpecs);
 
-            state->theCurTuplePos = 0;
-            state->theNumTuples = (ulong)state->theSortTable.size();
+                if (state->theTopK > 0)
+                {
+                  TopKSortTupleCmp topKCmp(cmp, state->theTopKSeqNos);
 
-            while (state->theCurTuplePos < state->theNumTuples)
-            {
-              state->theOrderResultIter.transfer(state->theResultTable[state->theSortTable[state->theCurTuplePos].theDataPos]);
+                  std::sort_heap(state->theSortTable.begin(),
+                                 state->theSortTable.end(),
+                                 topKCmp);
+                }
+                else if (theOrderByClause->theStable)
+                {
+                  std::stable_sort(state->theSortTable.begin(),
+                                   state->theSortTable.end(),
+                                   cmp);
+                }
+                else
+                {
+                  std::sort(state->theSortTable.begin(),
+                            state->theSortTable.end(),
+                            cmp);
+                }
+              }
 
-              state->theOrderResultIter->open();
+              state->theCurTuplePos = 0;
+              state->theNumTuples = (ulong)state->theSortTable.size();
 
-              while (state->theOrderResultIter->next(result))
+              while (state->theCurTuplePos < state->theNumTuples)
               {
-                STACK_PUSH(true, state);
-              }
+                state->theOrderResultIter.transfer(state->theResultTable[state->theSortTable[state->theCurTuplePos].theDataPos]);
+
+                state->theOrderResultIter->open();
 
-             state->theOrderResultIter->close();
+                while (state->theOrderResultIter->next(result))
+                {
+                  STACK_PUSH(true, state);
+                }
 
-              ++(state->theCurTuplePos);
+                state->theOrderResultIter->close();
+
+                ++(state->theCurTuplePos);
+              }
             }
           }
 
           // GroupBy Materialize? (no 0rderBy)
           else if (theGroupByClause)
           {
-            state->theGroupMapIter = state->theGroupMap->begin();
-
-            while (state->theGroupMapIter != state->theGroupMap->end())
+            do
             {
-              if (!state->theFirstResult)
-                theReturnClause->reset(planState);
+              state->theGroupMapIter = state->theGroupMap->begin();
+
+              while (state->theGroupMapIter != state->theGroupMap->end())
+              {
+                if (!state->theFirstResult)
+                  theReturnClause->reset(planState);
 
-              state->theFirstResult = false;
+                state->theFirstResult = false;
 
-              rebindGroupTuple(state->theGroupMapIter, state, planState);
+                rebindGroupTuple(state->theGroupMapIter, state, planState);
 
-              while(consumeNext(result, theReturnClause, planState)) 
-              {
-                STACK_PUSH(true, state);
-              }
+                while(consumeNext(result, theReturnClause, planState)) 
+                {
+                  STACK_PUSH(true, state);
+                }
 
-              ++state->theGroupMapIter;
+                ++state->theGroupMapIter;
+              }
             }
+            while (nextGroupPartition(state, planState));
           }
 
           goto stop;
@@ -1380,8 +1482,8 @@ void FLWORIterator::materializeStreamTuple(
   FlworState::SortTable& sortTable = iterState->theSortTable;
   sortTable.resize(numTuples + 1);
 
-  std::vector<store::Item*>& sortTuple = sortTable[numTuples].theKeyValues;
-  sortTuple.resize(numSpecs);
+  SortTuple::KeyValues& sortTuple = sortTable[numTuples].theKeyValues;
+  SortTuple::initKeyValues(sortTuple, numSpecs, planState);
 
   for (csize i = 0; i < numSpecs; ++i)
   {
@@ -1410,32 +1512,16 @@ void FLWORIterator::materializeStreamTuple(
 
 
 /***************************************************************************//**
-  All FOR and LET vars are bound when this method is called. The method computes
-  the sort tuple ST and the return-clause sequence R for the current var 
-  bindings. Then, it inserts I(R) into theReultTable, where I is an iterator over
-  the temp seq storing R, and the pair (ST, P) into theSortTable, where P is the
-  position of I(R) within theReultTable.
+  Compute the values of the orderby keys for the current var bindings.
 ********************************************************************************/
-void FLWORIterator::materializeSortTupleAndResult(
-    FlworState* iterState,
+void FLWORIterator::computeSortKey(
+    SortTuple::KeyValues& sortKey,
     PlanState& planState) const
 {
-  ZORBA_ASSERT(theOrderByClause);
-
-  FlworState::SortTable& sortTable = iterState->theSortTable;
-  FlworState::ResultTable& resultTable = iterState->theResultTable;
-
-  csize numTuples = sortTable.size();
-  sortTable.resize(numTuples + 1);
-  resultTable.resize(numTuples + 1);
-
-  // Create the sort tuple
-
   std::vector<OrderSpec>& orderSpecs = theOrderByClause->theOrderSpecs;
   csize numSpecs = orderSpecs.size();
 
-  std::vector<store::Item*>& sortKey = sortTable[numTuples].theKeyValues;
-  sortKey.resize(numSpecs);
+  SortTuple::initKeyValues(sortKey, numSpecs, planState);
 
   for (csize i = 0; i < numSpecs; ++i)
   {
@@ -1458,14 +1544,160 @@ void FLWORIterator::materializeSortTupleAndResult(
 
     orderSpecs[i].theDomainIter->reset(planState);
   }
+}
 
-  sortTable[numTuples].theDataPos = numTuples;
+
+/***************************************************************************//**
+  All FOR and LET vars are bound when this method is called. The method computes
+  the sort tuple ST and the return-clause sequence R for the current var 
+  bindings. Then, it inserts I(R) into theReultTable, where I is an iterator over
+  the temp seq storing R, and the pair (ST, P) into theSortTable, where P is the
+  position of I(R) within theReultTable.
+
+  If a sort memory limit is set, ST and R are instead added to theSorter as a
+  tuple whose only column is R.
+********************************************************************************/
+void FLWORIterator::materializeSortTupleAndResult(
+    FlworState* iterState,
+    PlanState& planState) const
+{
+  ZORBA_ASSERT(theOrderByClause);
+
+  if (iterState->theTopK > 0)
+  {
+    materializeTopKSortTupleAndResult(iterState, planState);
+    return;
+  }
+
+  if (iterState->theSorter == NULL &&
+      Properties::instance().getSortMemoryLimit() > 0)
+  {
+    SortTupleCmp cmp(theOrderByClause->theLocation,
+                     planState.theLocalDynCtx,
+                     theSctx->get_typemanager(),
+                     &theOrderByClause->theOrderSpecs);
+
+    iterState->theSorter = new ExternalSorter(cmp,
+                                              theOrderByClause->theStable,
+                                              Properties::instance().getSortMemoryLimit());
+  }
+
+  if (iterState->theSorter != NULL)
+  {
+    std::unique_ptr<ExternalSorter::Tuple> tuple(new ExternalSorter::Tuple);
+
+    computeSortKey(tuple->theSortTuple.theKeyValues, planState);
+
+    tuple->theColumns.resize(1);
+
+    store::Item_t resultItem;
+    while (consumeNext(resultItem, theReturnClause, planState))
+    {
+      tuple->theColumns[0].push_back(resultItem);
+    }
+
+    iterState->theSorter->add(tuple.release());
+    return;
+  }
+
+  csize numTuples = iterState->theSortTable.size();
+  iterState->theSortTable.resize(numTuples + 1);
+  iterState->theResultTable.resize(numTuples + 1);
+
+  computeSortKey(iterState->theSortTable[numTuples].theKeyValues, planState);
+
+  iterState->theSortTable[numTuples].theDataPos = numTuples;
+
+  store::Iterator_t iterWrapper = new PlanIteratorWrapper(theReturnClause, planState);
+  store::TempSeq_t resultSeq = GENV_STORE.createTempSeq(iterWrapper, false);
+  store::Iterator_t resultIter = resultSeq->getIterator();
+
+  iterState->theResultTable[numTuples].transfer(resultIter);
+}
+
+
+/***************************************************************************//**
+  The top-k version of materializeSortTupleAndResult(). theSortTable is a heap
+  of at most theTopK sort tuples, with the tuple that sorts last at the front.
+  When the heap is full, a new tuple is dropped, before its return clause is
+  evaluated, unless it sorts before the front tuple. Otherwise, it replaces the
+  front tuple and takes over the slot of that tuple in theResultTable.
+********************************************************************************/
+void FLWORIterator::materializeTopKSortTupleAndResult(
+    FlworState* iterState,
+    PlanState& planState) const
+{
+  FlworState::SortTable& sortTable = iterState->theSortTable;
+
+  SortTupleCmp cmp(theOrderByClause->theLocation,
+                   planState.theLocalDynCtx,
+                   theSctx->get_typemanager(),
+                   &theOrderByClause->theOrderSpecs);
+
+  TopKSortTupleCmp topKCmp(cmp, iterState->theTopKSeqNos);
+
+  SortTuple sortTuple;
+  computeSortKey(sortTuple.theKeyValues, planState);
+
+  csize slot;
+
+  if (sortTable.size() == iterState->theTopK)
+  {
+    // The new tuple comes after all the tuples in the heap in input order, so
+    // it must sort strictly before the front tuple in order to be kept.
+    if (!cmp(sortTuple, sortTable.front()))
+    {
+      sortTuple.clear();
+      return;
+    }
+
+    std::pop_heap(sortTable.begin(), sortTable.end(), topKCmp);
+
+    slot = sortTable.back().theDataPos;
+    sortTable.back().clear();
+  }
+  else
+  {
+    slot = sortTable.size();
+    sortTable.resize(slot + 1);
+    iterState->theResultTable.resize(slot + 1);
+    iterState->theTopKSeqNos.resize(slot + 1);
+  }
+
+  sortTable.back().theKeyValues.swap(sortTuple.theKeyValues);
+  sortTable.back().theDataPos = slot;
+  iterState->theTopKSeqNos[slot] = iterState->theTopKNextSeqNo++;
+
+  std::push_heap(sortTable.begin(), sortTable.end(), topKCmp);
 
   store::Iterator_t iterWrapper = new PlanIteratorWrapper(theReturnClause, planState);
   store::TempSeq_t resultSeq = GENV_STORE.createTempSeq(iterWrapper, false);
   store::Iterator_t resultIter = resultSeq->getIterator();
 
-  resultTable[numTuples].transfer(resultIter);
+  iterState->theResultTable[slot].transfer(resultIter);
+}
+
+
+/***************************************************************************//**
+  Get the next tuple from the external sorter, if any, and make
+  theOrderResultIter an iterator over its return-clause result.
+********************************************************************************/
+bool FLWORIterator::nextExternalSortResult(
+    FlworState* iterState,
+    PlanState& planState) const
+{
+  ExternalSorter::Tuple* tuple = iterState->theSorter->next();
+
+  if (tuple == NULL)
+  {
+    iterState->theOrderResultIter = 0;
+    return false;
+  }
+
+  store::TempSeq_t resultSeq = GENV_STORE.createTempSeq(tuple->theColumns[0]);
+  iterState->theOrderResultIter = resultSeq->getIterator();
+
+  return true;
 }
 
 
@@ -1486,7 +1718,7 @@ void FLWORIterator::materializeGroupTuple(
   std::unique_ptr<GroupTuple> groupTuple(new GroupTuple());
   std::vector<store::Item_t>& groupTupleItems = groupTuple->theItems;
 
-  std::vector<GroupingSpec> groupSpecs = theGroupByClause->theGroupingSpecs;
+  std::vector<GroupingSpec>& groupSpecs = theGroupByClause->theGroupingSpecs;
   std::vector<GroupingSpec>::iterator specIter = groupSpecs.begin();
   std::vector<GroupingSpec>::iterator specEnd = groupSpecs.end();
 
@@ -1501,43 +1733,119 @@ void FLWORIterator::materializeGroupTuple(
     ++specIter;
   }
 
-  GroupHashMap* groupMap = iterState->theGroupMap;
-
-  std::vector<NonGroupingSpec> nongroupingSpecs = theGroupByClause->theNonGroupingSpecs;
-  std::vector<store::TempSeq_t>* nongroupVarSequences = 0;
+  std::vector<NonGroupingSpec>& nongroupingSpecs = theGroupByClause->theNonGroupingSpecs;
   csize numNonGroupingSpecs = nongroupingSpecs.size();
 
-  if (groupMap->get(groupTuple.get(), nongroupVarSequences))
+  std::vector<std::vector<store::Item_t> > values(numNonGroupingSpecs);
+
+  for (csize i = 0; i < numNonGroupingSpecs; ++i)
   {
-    for (csize i = 0; i < numNonGroupingSpecs; ++i)
+    store::Item_t item;
+
+    while (consumeNext(item, nongroupingSpecs[i].theInput, planState))
     {
-      store::Iterator_t iterWrapper = 
-      new PlanIteratorWrapper(nongroupingSpecs[i].theInput, planState);
+      values[i].push_back(item);
+    }
 
-      (*nongroupVarSequences)[i]->append(iterWrapper);
+    nongroupingSpecs[i].reset(planState);
+  }
 
-      nongroupingSpecs[i].reset(planState);
-    }
+  if (iterState->theGroupSpiller == NULL &&
+      Properties::instance().getGroupByMemoryLimit() > 0)
+  {
+    iterState->theGroupSpiller =
+    new GroupSpiller(Properties::instance().getGroupByMemoryLimit());
+  }
+
+  addGroupTuple(iterState, groupTuple, values, planState);
+}
+
+
+/*******************************************************************************
+  Adds the values of the non-grouping vars in an input tuple to the group with
+  the given key. If the group is not in the group map and the group-by is
+  spilling, the tuple is given to the spiller instead.
+********************************************************************************/
+void FLWORIterator::addGroupTuple(
+    FlworState* iterState,
+    std::unique_ptr<GroupTuple>& groupTuple,
+    std::vector<std::vector<store::Item_t> >& values,
+    PlanState& planState) const
+{
+  GroupHashMap* groupMap = iterState->theGroupMap;
+  GroupSpiller* spiller = iterState->theGroupSpiller;
+
+  const std::vector<NonGroupingSpec>& nongroupingSpecs =
+  theGroupByClause->theNonGroupingSpecs;
+
+  GroupAggregate::Context aggrCtx(theGroupByClause->theLocation,
+                                  planState.theLocalDynCtx,
+                                  theSctx);
+  GroupValue* groupValue = NULL;
+  size_t size;
+
+  if (groupMap->get(groupTuple.get(), groupValue))
+  {
+    size = groupValue->add(nongroupingSpecs, values, aggrCtx);
+  }
+  else if (spiller != NULL && spiller->isSpilling())
+  {
+    uint32_t hash = groupMap->get_compare_function().hash(groupTuple.get());
+
+    std::unique_ptr<GroupSpiller::Tuple> tuple(new GroupSpiller::Tuple);
+    tuple->theKey.swap(groupTuple->theItems);
+    tuple->theColumns.swap(values);
+
+    spiller->add(hash, tuple.release());
+    return;
   }
   else
   {
-    nongroupVarSequences = new std::vector<store::TempSeq_t>();
+    std::unique_ptr<GroupValue> newValue(new GroupValue(nongroupingSpecs));
 
-    for (csize i = 0; i < numNonGroupingSpecs; ++i)
-    {
-      store::Iterator_t iterWrapper = 
-      new PlanIteratorWrapper(nongroupingSpecs[i].theInput, planState);
+    size = newValue->add(nongroupingSpecs, values, aggrCtx);
+    size += sizeof(GroupTuple) + sizeof(GroupValue) +
+            GroupSpiller::size_of(groupTuple->theItems);
 
-      store::TempSeq_t result = GENV_STORE.createTempSeq(iterWrapper, false);
+    groupValue = newValue.release();
+    groupMap->insert(groupTuple.get(), groupValue);
+    groupTuple.release();
+  }
 
-      nongroupVarSequences->push_back(result);
+  if (spiller != NULL)
+    spiller->addMemory(size);
+}
 
-      nongroupingSpecs[i].reset(planState);
-    }
 
-    groupMap->insert(groupTuple.get(), nongroupVarSequences);
-    groupTuple.release();
+/*******************************************************************************
+  Replaces the groups in the group map with the groups of the next partition
+  of tuples spilled by the group-by, if any. Returns false if there are no more
+  partitions.
+********************************************************************************/
+bool FLWORIterator::nextGroupPartition(
+    FlworState* iterState,
+    PlanState& planState) const
+{
+  GroupSpiller* spiller = iterState->theGroupSpiller;
+
+  if (spiller == NULL || !spiller->nextPartition())
+    return false;
+
+  iterState->clearGroupMap();
+
+  GroupSpiller::Tuple* spilledTuple;
+
+  while ((spilledTuple = spiller->next()) != NULL)
+  {
+    std::unique_ptr<GroupSpiller::Tuple> tuple(spilledTuple);
+    std::unique_ptr<GroupTuple> groupTuple(new GroupTuple());
+
+    groupTuple->theItems.swap(tuple->theKey);
+
+    addGroupTuple(iterState, groupTuple, tuple->theColumns, planState);
   }
+
+  return true;
 }
 
 
@@ -1582,19 +1890,23 @@ void FLWORIterator::rebindGroupTuplesForSort(
 {
   GroupHashMap* groupMap = iterState->theGroupMap;
 
-  GroupHashMap::iterator groupMapIter = groupMap->begin();
-  GroupHashMap::iterator groupMapEnd = groupMap->end();
-
-  while (groupMapIter != groupMapEnd)
+  do
   {
-    rebindGroupTuple(groupMapIter, iterState, planState);
+    GroupHashMap::iterator groupMapIter = groupMap->begin();
+    GroupHashMap::iterator groupMapEnd = groupMap->end();
+
+    while (groupMapIter != groupMapEnd)
+    {
+      rebindGroupTuple(groupMapIter, iterState, planState);
   
-    materializeSortTupleAndResult(iterState, planState);
+      materializeSortTupleAndResult(iterState, planState);
 
-    theReturnClause->reset(planState);
+      theReturnClause->reset(planState);
 
-    ++groupMapIter;
+      ++groupMapIter;
+    }
   }
+  while (nextGroupPartition(iterState, planState));
 }
 
 
@@ -1607,17 +1919,21 @@ void FLWORIterator::rebindGroupTuplesForMaterialize(
 {
   GroupHashMap* groupMap = iterState->theGroupMap;
 
-  GroupHashMap::iterator groupMapIter = groupMap->begin();
-  GroupHashMap::iterator groupMapEnd = groupMap->end();
-
-  while (groupMapIter != groupMapEnd)
+  do
   {
-    rebindGroupTuple(groupMapIter, iterState, planState);
+    GroupHashMap::iterator groupMapIter = groupMap->begin();
+    GroupHashMap::iterator groupMapEnd = groupMap->end();
+
+    while (groupMapIter != groupMapEnd)
+    {
+      rebindGroupTuple(groupMapIter, iterState, planState);
   
-    materializeStreamTuple(iterState, planState);
+      materializeStreamTuple(iterState, planState);
 
-    ++groupMapIter;
+      ++groupMapIter;
+    }
   }
+  while (nextGroupPartition(iterState, planState));
 }
 
 
@@ -1654,24 +1970,206 @@ void FLWORIterator::rebindGroupTuple(
   }
 
   // Bind non-grouping vars
-  std::vector<store::TempSeq_t>* lVector = (*groupMapIter).second;
-  std::vector<store::TempSeq_t>::const_iterator lOuterSeqIter = lVector->begin();
-  std::vector<NonGroupingSpec> lNonGroupingSpecs = theGroupByClause->theNonGroupingSpecs;
-  std::vector<NonGroupingSpec>::const_iterator lNonGroupingSpecsIter = lNonGroupingSpecs.begin();
+  GroupAggregate::Context aggrCtx(theGroupByClause->theLocation,
+                                  planState.theLocalDynCtx,
+                                  theSctx);
+
+  (*groupMapIter).second->bind(theGroupByClause->theNonGroupingSpecs,
+                               planState,
+                               aggrCtx);
+}
+
+
+/*******************************************************************************
+  Task executed by the worker threads of a parallel flwor. Each worker gets its
+  own copy of the plan state, in which the return and where clauses are opened
+  lazily (at the same offset as in the main state block) the first time the
+  worker picks up a chunk. The copies are closed and destroyed by the thread
+  that drives the flwor, after all the workers have terminated.
+********************************************************************************/
+class ParallelForTask : public WorkStealingPool::Task
+{
+private:
+  const FLWORIterator      * theFlwor;
+  FlworState               * theFlworState;
+  PlanState                & thePlanState;
+  std::vector<PlanState*>    theWorkerStates;
+
+public:
+  ParallelForTask(
+      const FLWORIterator* flwor,
+      FlworState* flworState,
+      PlanState& planState,
+      csize numWorkers)
+    :
+    theFlwor(flwor),
+    theFlworState(flworState),
+    thePlanState(planState),
+    theWorkerStates(numWorkers, NULL)
+  {
+  }
+
+  ~ParallelForTask()
+  {
+    for (csize i = 0; i < theWorkerStates.size(); ++i)
+    {
+      PlanState* workerState = theWorkerStates[i];
 
-  while (lNonGroupingSpecsIter != lNonGroupingSpecs.end())
+      if (workerState == NULL)
+        continue;
+
+      theFlwor->theReturnClause->close(*workerState);
+
+      if (theFlwor->theWhereClause != NULL)
+        theFlwor->theWhereClause->close(*workerState);
+
+      delete workerState;
+    }
+  }
+
+  void execute(csize chunkNo, csize workerId)
+  {
+    PlanState* workerState = theWorkerStates[workerId];
+
+    if (workerState == NULL)
+    {
+      workerState = new PlanState(thePlanState.theGlobalDynCtx,
+                                  thePlanState.theLocalDynCtx,
+                                  thePlanState.theBlockSize,
+                                  thePlanState.theStackDepth,
+                                  thePlanState.theMaxStackDepth);
+
+      workerState->theCompilerCB = thePlanState.theCompilerCB;
+      workerState->theQuery = thePlanState.theQuery;
+      workerState->theDebuggerCommons = thePlanState.theDebuggerCommons;
+
+      uint32_t offset = theFlworState->theReturnOffset;
+
+      try
+      {
+        theFlwor->theReturnClause->open(*workerState, offset);
+
+        if (theFlwor->theWhereClause != NULL)
+          theFlwor->theWhereClause->open(*workerState, offset);
+      }
+      catch (...)
+      {
+        delete workerState;
+        throw;
+      }
+
+      theWorkerStates[workerId] = workerState;
+    }
+
+    theFlwor->evalParallelChunk(chunkNo,
+                                theFlworState,
+                                thePlanState,
+                                *workerState);
+  }
+};
+
+
+/*******************************************************************************
+  Parallel mode: consume the next round of domain items of the FOR var, and
+  evaluate the where and return clauses for them on the worker threads. The
+  results are left in flworState->theParallelResults, one vector per chunk of
+  PARALLEL_CHUNK_SIZE bindings. Returns false if the domain is exhausted.
+********************************************************************************/
+bool FLWORIterator::computeParallelRound(
+    FlworState* flworState,
+    PlanState& planState) const
+{
+  const ForLetClause& flc = theForLetClauses[0];
+
+  flworState->theParallelInputPos += flworState->theParallelInput.size();
+  flworState->theParallelInput.clear();
+  flworState->theParallelResults.clear();
+
+  if (flworState->theParallelInputDone)
+    return false;
+
+  csize maxItems = theNumThreads * PARALLEL_CHUNKS_PER_THREAD * PARALLEL_CHUNK_SIZE;
+
+  flworState->theParallelInputDone = !consumeNextBatch(flworState->theParallelInput,
+                                                       flc.theInput,
+                                                       planState,
+                                                       maxItems);
+
+  csize numItems = flworState->theParallelInput.size();
+
+  if (numItems == 0)
+    return false;
+
+  csize numChunks = (numItems + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+
+  flworState->theParallelResults.resize(numChunks);
+
+  WorkStealingPool pool(theNumThreads);
+  ParallelForTask task(this, flworState, planState, pool.getNumWorkers());
+
+  pool.run(task, numChunks);
+
+  return true;
+}
+
+
+/*******************************************************************************
+  Parallel mode: executed by a worker thread. Binds the FOR var (and its
+  positional var) to each domain item of the given chunk in the worker's own
+  state block, and collects the results of the return clause.
+********************************************************************************/
+void FLWORIterator::evalParallelChunk(
+    csize chunkNo,
+    FlworState* flworState,
+    PlanState& mainState,
+    PlanState& workerState) const
+{
+  const ForLetClause& flc = theForLetClauses[0];
+
+  std::vector<store::Item_t>& input = flworState->theParallelInput;
+  std::vector<store::Item_t>& results = flworState->theParallelResults[chunkNo];
+
+  csize chunkBegin = chunkNo * PARALLEL_CHUNK_SIZE;
+  csize chunkEnd = std::min(chunkBegin + PARALLEL_CHUNK_SIZE, input.size());
+
+  store::Item_t item;
+
+  for (csize i = chunkBegin; i < chunkEnd; ++i)
   {
-    std::vector<LetVarIter_t>::const_iterator lOuterVarBindingIter =
-    lNonGroupingSpecsIter->theVarRefs.begin();
+    // the timeout is signaled on the main plan state only
+    if (mainState.theHasToQuit)
+      throw FlowCtlException(FlowCtlException::INTERRUPT);
+
+    std::vector<PlanIter_t>::const_iterator ite = flc.theVarRefs.begin();
+    std::vector<PlanIter_t>::const_iterator end = flc.theVarRefs.end();
+    for (; ite != end; ++ite)
+    {
+      static_cast<ForVarIterator*>((*ite).getp())->bind(input[i].getp(), workerState);
+    }
+
+    if (!flc.thePosVarRefs.empty())
+    {
+      store::Item_t posItem;
+      GENV_ITEMFACTORY->createInteger(posItem,
+                                      xs_integer(flworState->theParallelInputPos + i + 1));
 
-    while (lOuterVarBindingIter != lNonGroupingSpecsIter->theVarRefs.end())
+      std::vector<PlanIter_t>::const_iterator ite = flc.thePosVarRefs.begin();
+      std::vector<PlanIter_t>::const_iterator end = flc.thePosVarRefs.end();
+      for (; ite != end; ++ite)
+      {
+        static_cast<ForVarIterator*>((*ite).getp())->bind(posItem.getp(), workerState);
+      }
+    }
+
+    if (theWhereClause == NULL || evalToBool(theWhereClause, workerState))
     {
-      store::TempSeq_t lTmpSeq = *lOuterSeqIter;
-      ( *lOuterVarBindingIter )->bind(lTmpSeq , planState);
-      ++lOuterVarBindingIter;
+      while (consumeNext(item, theReturnClause, workerState))
+      {
+        results.push_back(item);
+      }
+
+      theReturnClause->reset(workerState);
     }
-    ++lNonGroupingSpecsIter;
-    ++lOuterSeqIter;
   }
 }
 
@@ -1693,6 +2191,8 @@ void FLWORIterator::openImpl(PlanState& planState, uint32_t& offset)
     iter->theInput->open(planState, offset);
   }
 
+  iterState->theReturnOffset = offset;
+
   theReturnClause->open(planState, offset);
 
   if (theWhereClause != NULL)
@@ -1768,6 +2268,22 @@ void FLWORIterator::resetImpl(PlanState& planState) const
 }
 
 
+/*******************************************************************************
+  Switch to top-k sorting if only the first maxItems items of the result are
+  needed (see theTopKSort).
+********************************************************************************/
+void FLWORIterator::setMaxItemsImpl(csize maxItems, PlanState& planState) const
+{
+  if (!theTopKSort || maxItems == 0)
+    return;
+
+  FlworState* state =
+  StateTraitsImpl<FlworState>::getState(planState, theStateOffset);
+
+  state->theTopK = maxItems;
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
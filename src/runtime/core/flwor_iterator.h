@@ -32,6 +32,8 @@ namespace store { class PUL; }
 namespace flwor
 {
 
+class GroupSpiller;
+
 
 /***************************************************************************//**
   Wraps a FOR or LET clause. There is one ForLetClause for each for/let variable.
@@ -347,22 +349,83 @@ public:
   The iterator I over a temp sequence that stores the result of return clause
   for the tuple pointed to by theCurTuplePos.
 
+  - theSorter :
+  -------------
+  If a sort memory limit is set (see Properties::setSortMemoryLimit()), the
+  sort tuples and the results of the return clause are stored in theSorter
+  instead of theSortTable and theResultTable, so that they can be spilled to
+  disk. The sorter is created when the first tuple is materialized.
+
+  - theTopK :
+  -----------
+  If > 0, the consumer of the flwor will ask for at most theTopK items (see
+  FLWORIterator::setMaxItemsImpl()). Then, theSortTable is kept as a heap of
+  the best theTopK sort tuples seen so far, and the return clause is evaluated
+  only for the tuples that enter the heap.
+
+  - theTopKSeqNos :
+  -----------------
+  In top-k mode, the input position of the sort tuple that currently occupies
+  each slot of theResultTable. Used to break ties between equal sort keys.
+
+  - theTopKNextSeqNo :
+  --------------------
+  In top-k mode, the input position of the next sort tuple.
+
   - theGroupMap :
   ---------------
 
   - theGroupMapIter :
   -------------------
 
+  - theGroupSpiller :
+  -------------------
+  If a memory limit is set for group-by (see
+  Properties::getGroupByMemoryLimit()), the spiller that receives the input
+  tuples of the groups that do not fit in theGroupMap. After the groups in
+  theGroupMap have been consumed, theGroupMap is refilled with the groups of
+  each spilled partition in turn (see FLWORIterator::nextGroupPartition()).
+
   - thePUL :
   ----------
 
   - theFirstResult :
   ------------------
 
+  - theReturnOffset :
+  -------------------
+  The offset in the state block at which the return clause (followed by the
+  where clause, if any) was opened. Used to open the same subtree in the state
+  blocks of the worker threads in parallel mode.
+
+  - theParallelInput :
+  --------------------
+  In parallel mode, the domain items of the FOR var that are evaluated in the
+  current round.
+
+  - theParallelResults :
+  ----------------------
+  In parallel mode, the results of the return clause for the current round,
+  one vector per chunk of theParallelInput.
+
+  - theParallelInputPos :
+  -----------------------
+  In parallel mode, the number of domain items consumed before the current
+  round (used to compute the value of the positional var).
+
+  - theParallelItemPos :
+  ----------------------
+  In parallel mode, the position of the next item to return within the chunk
+  of theParallelResults pointed to by theCurTuplePos.
+
+  - theParallelInputDone :
+  ------------------------
+  In parallel mode, whether the domain of the FOR var has been exhausted.
 ********************************************************************************/
 class FlworState : public PlanIteratorState
 {
   friend class FLWORIterator;
+  friend class ParallelForTask;
 
 public:
   typedef std::vector<SortTuple> SortTable;
@@ -390,14 +453,36 @@ protected:
 
   store::Iterator_t              theOrderResultIter;
 
+  ExternalSorter               * theSorter;
+
+  csize                          theTopK;
+
+  std::vector<csize>             theTopKSeqNos;
+
+  csize                          theTopKNextSeqNo;
+
   GroupHashMap                 * theGroupMap;
 
   GroupHashMap::iterator         theGroupMapIter;
 
+  GroupSpiller                 * theGroupSpiller;
+
   store::PUL_t                   thePUL;
 
   bool                           theFirstResult;
 
+  uint32_t                       theReturnOffset;
+
+  std::vector<store::Item_t>     theParallelInput;
+
+  std::vector<std::vector<store::Item_t> > theParallelResults;
+
+  csize                          theParallelInputPos;
+
+  csize                          theParallelItemPos;
+
+  bool                           theParallelInputDone;
+
 public:
   FlworState();
 
@@ -436,9 +521,26 @@ private:
 
   - Data Members:
 
+  theNumThreads : If greater than 1, the flwor consists of a single FOR clause
+                  whose return (and where) clause can be evaluated independently
+                  for each binding of the FOR var (see the codegen). The bindings
+                  are then evaluated in chunks by theNumThreads worker threads,
+                  each with its own state block, and the results are returned
+                  in the order of the bindings.
+
+  theTopKSort   : True if the flwor has an orderby (and no materialize clause)
+                  and its return clause returns at least one item for every
+                  tuple. Then, if the consumer needs at most k items, only the
+                  first k tuples in sort order are needed (see setMaxItemsImpl()).
 ********************************************************************************/
 class FLWORIterator : public PlanIterator
 {
+  friend class ParallelForTask;
+
+public:
+  static const csize PARALLEL_CHUNK_SIZE = 64;
+  static const csize PARALLEL_CHUNKS_PER_THREAD = 16;
+
 private:
   std::vector<ForLetClause> theForLetClauses;
   csize                     theNumBindings;
@@ -447,6 +549,8 @@ private:
   OrderByClause           * theOrderByClause;
   MaterializeClause       * theMaterializeClause;
   PlanIter_t                theReturnClause;
+  csize                     theNumThreads;
+  bool                      theTopKSort;
 
 public:
   SERIALIZABLE_CLASS(FLWORIterator);
@@ -466,11 +570,21 @@ public:
 
   ~FLWORIterator();
 
+  void setNumThreads(csize numThreads) { theNumThreads = numThreads; }
+
+  csize getNumThreads() const { return theNumThreads; }
+
+  void setTopKSort() { theTopKSort = (theOrderByClause != NULL); }
+
+  bool isTopKSort() const { return theTopKSort; }
+
   void openImpl(PlanState& planState, uint32_t& offset);
   bool nextImpl(store::Item_t& result, PlanState& planState) const;
   void resetImpl(PlanState& planState) const;
   void closeImpl(PlanState& planState);
 
+  void setMaxItemsImpl(csize maxItems, PlanState& planState) const;
+
   zstring getNameAsString() const;
 
   uint32_t getStateSize() const;
@@ -493,14 +607,36 @@ private:
       FlworState* flworState,
       PlanState& planState) const;
 
+  void computeSortKey(
+      SortTuple::KeyValues& sortKey,
+      PlanState& planState) const;
+
   void materializeSortTupleAndResult(
       FlworState* flworState,
       PlanState& planState) const;
 
+  void materializeTopKSortTupleAndResult(
+      FlworState* flworState,
+      PlanState& planState) const;
+
+  bool nextExternalSortResult(
+      FlworState* flworState,
+      PlanState& planState) const;
+
   void materializeGroupTuple(
       FlworState* flworState,
       PlanState& planState) const;
 
+  void addGroupTuple(
+      FlworState* flworState,
+      std::unique_ptr<GroupTuple>& groupTuple,
+      std::vector<std::vector<store::Item_t> >& values,
+      PlanState& planState) const;
+
+  bool nextGroupPartition(
+      FlworState* flworState,
+      PlanState& planState) const;
+
   void rebindStreamTuple(
       ulong tuplePos,
       FlworState* iterState,
@@ -518,6 +654,16 @@ private:
   void rebindGroupTuplesForSort(
       FlworState* iterState,
       PlanState& planState) const;
+
+  bool computeParallelRound(
+      FlworState* flworState,
+      PlanState& planState) const;
+
+  void evalParallelChunk(
+      csize chunkNo,
+      FlworState* flworState,
+      PlanState& mainState,
+      PlanState& workerState) const;
 };
 
 
@@ -20,6 +20,8 @@
 #include "runtime/visitors/planiter_visitor.h"
 #include "runtime/booleans/BooleanImpl.h"
 #include "runtime/core/gflwor/common.h"
+#include "runtime/core/gflwor/groupby_spill.h"
+#include "runtime/util/item_iterator.h"
 
 namespace zorba
 {
@@ -116,10 +118,30 @@ NonGroupingSpec::NonGroupingSpec(
 }
 
 
+NonGroupingSpec::NonGroupingSpec(
+    PlanIter_t inputVar,
+    const std::vector<PlanIter_t>& varRefs,
+    const std::vector<int>& aggregateKinds,
+    const std::vector<std::vector<PlanIter_t> >& aggregateRefs)
+  :
+  theInput(inputVar),
+  theAggregateKinds(aggregateKinds)
+{
+  castIterVector<LetVarIterator>(theVarRefs, varRefs);
+
+  theAggregateRefs.resize(aggregateRefs.size());
+
+  for (csize i = 0; i < aggregateRefs.size(); ++i)
+    castIterVector<LetVarIterator>(theAggregateRefs[i], aggregateRefs[i]);
+}
+
+
 void NonGroupingSpec::serialize(::zorba::serialization::Archiver& ar)
 {
   ar & theInput;
   ar & theVarRefs;
+  ar & theAggregateKinds;
+  ar & theAggregateRefs;
 }
 
 
@@ -160,6 +182,118 @@ void NonGroupingSpec::close(PlanState& planState)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////
+//                                                                             //
+//  GroupValue                                                                 //
+//                                                                             //
+/////////////////////////////////////////////////////////////////////////////////
+
+GroupValue::GroupValue(const std::vector<NonGroupingSpec>& specs)
+  :
+  theSequences(specs.size()),
+  theAggregates(specs.size())
+{
+  for (csize i = 0; i < specs.size(); ++i)
+  {
+    const std::vector<int>& kinds = specs[i].theAggregateKinds;
+
+    for (csize j = 0; j < kinds.size(); ++j)
+    {
+      theAggregates[i].push_back(
+        new GroupAggregate(static_cast<GroupAggregate::Kind>(kinds[j])));
+    }
+  }
+}
+
+
+GroupValue::~GroupValue()
+{
+  for (csize i = 0; i < theAggregates.size(); ++i)
+  {
+    for (csize j = 0; j < theAggregates[i].size(); ++j)
+      delete theAggregates[i][j];
+  }
+}
+
+
+size_t GroupValue::add(
+    const std::vector<NonGroupingSpec>& specs,
+    std::vector<std::vector<store::Item_t> >& values,
+    const GroupAggregate::Context& ctx)
+{
+  size_t size = 0;
+  csize numSpecs = specs.size();
+
+  for (csize i = 0; i < numSpecs; ++i)
+  {
+    std::vector<store::Item_t>& items = values[i];
+    std::vector<GroupAggregate*>& aggregates = theAggregates[i];
+
+    for (csize j = 0; j < aggregates.size(); ++j)
+    {
+      for (csize k = 0; k < items.size(); ++k)
+      {
+        store::Item_t item(items[k]);
+        aggregates[j]->add(item, ctx);
+      }
+    }
+
+    if (!specs[i].needsSequence())
+      continue;
+
+    size += GroupSpiller::size_of(items);
+
+    if (theSequences[i] == NULL)
+    {
+      theSequences[i] = GENV_STORE.createTempSeq(items);
+    }
+    else
+    {
+      store::Iterator_t itemIter = new ItemIterator(items);
+      itemIter->open();
+      theSequences[i]->append(itemIter);
+    }
+  }
+
+  return size;
+}
+
+
+void GroupValue::bind(
+    const std::vector<NonGroupingSpec>& specs,
+    PlanState& planState,
+    const GroupAggregate::Context& ctx)
+{
+  csize numSpecs = specs.size();
+
+  for (csize i = 0; i < numSpecs; ++i)
+  {
+    const NonGroupingSpec& spec = specs[i];
+
+    std::vector<LetVarIter_t>::const_iterator refIter = spec.theVarRefs.begin();
+    std::vector<LetVarIter_t>::const_iterator refEnd = spec.theVarRefs.end();
+
+    for (; refIter != refEnd; ++refIter)
+    {
+      store::TempSeq_t seq = theSequences[i];
+      (*refIter)->bind(seq, planState);
+    }
+
+    for (csize j = 0; j < theAggregates[i].size(); ++j)
+    {
+      refIter = spec.theAggregateRefs[j].begin();
+      refEnd = spec.theAggregateRefs[j].end();
+
+      for (; refIter != refEnd; ++refIter)
+      {
+        store::Iterator_t result = theAggregates[i][j]->getResult(ctx);
+        (*refIter)->bind(result, planState);
+      }
+    }
+  }
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////
 //                                                                             //
 //  GroupTupleCmp                                                              //
@@ -24,6 +24,7 @@
 #include "system/globalenv.h"
 
 #include "runtime/core/var_iterators.h"
+#include "runtime/core/gflwor/groupby_aggregate.h"
 #include "runtime/api/plan_iterator_wrapper.h"
 
 #include "store/api/store.h"
@@ -152,18 +153,34 @@ public:
 
   theVarRefs:
   -----------
-  All references to this non-group-by var in the output tuple stream.
+  All references to this non-group-by var in the output tuple stream, except
+  the ones in theAggregateRefs.
+
+  theAggregateKinds:
+  ------------------
+  The aggregate functions (see GroupAggregate::Kind) that are applied to this
+  non-group-by var in the output tuple stream, and whose result can be computed
+  incrementally while the input tuples are assigned to their groups.
+
+  theAggregateRefs:
+  -----------------
+  For each entry in theAggregateKinds, the var refs that stand for the result
+  of the function calls of that kind whose argument is this var. The codegen
+  replaces each such call with one of these refs.
 ********************************************************************************/
 class NonGroupingSpec : public ::zorba::serialization::SerializeBaseClass
 {
   friend class FLWORIterator;
   friend class GroupByIterator;
+  friend class GroupValue;
   friend class PrinterVisitor;
   friend class GroupByClause; //Just for older gcc's
   
 protected:
-  PlanIter_t                theInput;
-  std::vector<LetVarIter_t> theVarRefs;
+  PlanIter_t                              theInput;
+  std::vector<LetVarIter_t>               theVarRefs;
+  std::vector<int>                        theAggregateKinds;
+  std::vector<std::vector<LetVarIter_t> > theAggregateRefs;
   
 public:
   SERIALIZABLE_CLASS(NonGroupingSpec)
@@ -177,8 +194,23 @@ public:
         PlanIter_t inputVar,
         const std::vector<PlanIter_t>& varRefs);
 
+  NonGroupingSpec(
+        PlanIter_t inputVar,
+        const std::vector<PlanIter_t>& varRefs,
+        const std::vector<int>& aggregateKinds,
+        const std::vector<std::vector<PlanIter_t> >& aggregateRefs);
+
   virtual ~NonGroupingSpec() {}
 
+  /**
+   * Whether the full value of this var must be kept for each group, i.e.,
+   * whether it has any references besides the aggregate ones.
+   */
+  bool needsSequence() const
+  {
+    return !theVarRefs.empty() || theAggregateKinds.empty();
+  }
+
   void accept(PlanIterVisitor& v) const;
 
   uint32_t getStateSizeOfSubtree() const; 
@@ -210,6 +242,52 @@ public:
 };
 
 
+/***************************************************************************//**
+  The value stored in the GroupHashMap for a GroupTuple T. For each non-grouping
+  var v, it stores a temp sequence with the concatenation of all the values that
+  v was bound to in each input tuple it that matched with T, and one aggregate
+  for each entry in the theAggregateKinds of v's NonGroupingSpec. The temp seq
+  is not kept if v is referenced only via aggregates (it is NULL then).
+
+  theSequences  : The temp seqs, one per non-grouping var.
+  theAggregates : The aggregates, one vector per non-grouping var.
+********************************************************************************/
+class GroupValue
+{
+public:
+  std::vector<store::TempSeq_t>              theSequences;
+  std::vector<std::vector<GroupAggregate*> > theAggregates;
+
+public:
+  GroupValue(const std::vector<NonGroupingSpec>& specs);
+
+  ~GroupValue();
+
+  /**
+   * Adds the values of the non-grouping vars in an input tuple that belongs
+   * to this group. The values may be consumed. Returns an estimate of the
+   * memory used for them.
+   */
+  size_t add(
+      const std::vector<NonGroupingSpec>& specs,
+      std::vector<std::vector<store::Item_t> >& values,
+      const GroupAggregate::Context& ctx);
+
+  /**
+   * Binds the non-grouping var refs in the output tuple stream to the values
+   * of this group.
+   */
+  void bind(
+      const std::vector<NonGroupingSpec>& specs,
+      PlanState& planState,
+      const GroupAggregate::Context& ctx);
+
+private:
+  GroupValue(const GroupValue&);
+  void operator=(const GroupValue&);
+};
+
+
 /***************************************************************************//**
   Class acting as a comparison function between to groupby tuples. An instance
   of this class is passed to the GroupHashMap that we use to do the grouping.
@@ -239,14 +317,10 @@ public:
 
 /***************************************************************************//**
   The hash map used to do the grouping. For each GroupTuple T, it stores
-  the tuple itself and one temp sequence for each non-grouping variable. The
-  temp seq for a non-grouping var v stores the concatenation of all the values
-  that v was bound to in each input tuple it that matched with T. These sequences
-  are the values to which the non-grouping vars will be bound in tuple otg.
+  the tuple itself and the GroupValue of T, which holds the values to which the
+  non-grouping vars will be bound in tuple otg.
 ********************************************************************************/
-typedef zorba::HashMap<GroupTuple*,
-                       std::vector<store::TempSeq_t>*,
-                       GroupTupleCmp> GroupHashMap;
+typedef zorba::HashMap<GroupTuple*, GroupValue*, GroupTupleCmp> GroupHashMap;
 
 
 /***************************************************************************//**
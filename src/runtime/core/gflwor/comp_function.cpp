@@ -28,9 +28,9 @@ bool SortTupleCmp::operator()(const SortTuple& t1, const SortTuple& t2) const
   ZORBA_ASSERT(t1.theKeyValues.size() == t2.theKeyValues.size());
   ZORBA_ASSERT(t1.theKeyValues.size() == theOrderSpecs->size());
 
-  std::vector<store::Item*>::const_iterator t1iter = t1.theKeyValues.begin();
-  std::vector<store::Item*>::const_iterator t1end = t1.theKeyValues.end();
-  std::vector<store::Item*>::const_iterator t2iter = t2.theKeyValues.begin();
+  SortTuple::KeyValues::const_iterator t1iter = t1.theKeyValues.begin();
+  SortTuple::KeyValues::const_iterator t1end = t1.theKeyValues.end();
+  SortTuple::KeyValues::const_iterator t2iter = t2.theKeyValues.begin();
 
   std::vector<OrderSpec>::const_iterator orderSpecIter = theOrderSpecs->begin();
 
@@ -86,6 +86,40 @@ public:
 };
 
 
+/***************************************************************************//**
+  Comparison function used by the top-k mode of the orderby iterators, which
+  keep the best k sort tuples seen so far in a heap. Sort tuples with equal
+  keys are ordered by their input position, which is stored in theSeqNos at
+  the theDataPos of each tuple. This makes the order a total one, so that the
+  heap returns the same tuples, in the same order, as a stable sort would.
+********************************************************************************/
+class TopKSortTupleCmp
+{
+private:
+  const SortTupleCmp       & theCmp;
+  const std::vector<csize> & theSeqNos;
+
+public:
+  TopKSortTupleCmp(const SortTupleCmp& cmp, const std::vector<csize>& seqNos)
+    :
+    theCmp(cmp),
+    theSeqNos(seqNos)
+  {
+  }
+
+  bool operator()(const SortTuple& t1, const SortTuple& t2) const
+  {
+    if (theCmp(t1, t2))
+      return true;
+
+    if (theCmp(t2, t1))
+      return false;
+
+    return theSeqNos[t1.theDataPos] < theSeqNos[t2.theDataPos];
+  }
+};
+
+
 } // namespace flwor
 } // namespace zorba
 #endif /* ZORBA_RUNTIME_GFLWOR_COMP_FUNCTION */
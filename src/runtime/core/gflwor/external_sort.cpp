@@ -0,0 +1,516 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "runtime/core/gflwor/external_sort.h"
+
+#include "zorbaserialization/bin_archiver.h"
+#include "zorbaserialization/serialize_basic_types.h"
+#include "zorbaserialization/serialize_template_types.h"
+#include "zorbaserialization/serialize_zorba_types.h"
+
+#include "diagnostics/assert.h"
+#include "diagnostics/xquery_diagnostics.h"
+
+#include "util/fs_util.h"
+#include "util/mem_sizeof.h"
+
+
+namespace zorba
+{
+
+namespace flwor
+{
+
+/*******************************************************************************
+  A sorted sequence of tuples. theHead is the current tuple of the run; it is
+  owned by the run and is deleted when the run advances.
+********************************************************************************/
+class ExternalSorter::Run
+{
+protected:
+  Tuple  * theHead;
+
+public:
+  Run() : theHead(NULL) {}
+
+  virtual ~Run() { delete theHead; }
+
+  Tuple* head() const { return theHead; }
+
+  /**
+   * Deletes the current head and moves to the next tuple of the run. Returns
+   * false if the run is exhausted.
+   */
+  virtual bool advance() = 0;
+};
+
+
+/*******************************************************************************
+  A run that lives in memory: the last (partial) buffer of a spilling sort.
+********************************************************************************/
+class ExternalSorter::MemoryRun : public ExternalSorter::Run
+{
+protected:
+  std::vector<Tuple*>   theTuples;
+  csize                 thePos;
+
+public:
+  MemoryRun(std::vector<Tuple*>& tuples) : thePos(0)
+  {
+    theTuples.swap(tuples);
+  }
+
+  ~MemoryRun()
+  {
+    for (; thePos < theTuples.size(); ++thePos)
+      delete theTuples[thePos];
+  }
+
+  bool advance()
+  {
+    delete theHead;
+    theHead = NULL;
+
+    if (thePos < theTuples.size())
+      theHead = theTuples[thePos++];
+
+    return theHead != NULL;
+  }
+};
+
+
+/*******************************************************************************
+  A run that has been spilled to a temp file. The file consists of blocks,
+  each of them starting with its byte length, followed by a BinArchiver
+  archive that stores the number of tuples in the block and, for each tuple,
+  its key values and its payload columns.
+********************************************************************************/
+class ExternalSorter::FileRun : public ExternalSorter::Run
+{
+protected:
+  zstring               thePath;
+  std::ifstream         theStream;
+  std::vector<Tuple*>   theBlock;
+  csize                 theBlockPos;
+
+public:
+  FileRun(const zstring& path) : thePath(path), theBlockPos(0) {}
+
+  ~FileRun()
+  {
+    for (; theBlockPos < theBlock.size(); ++theBlockPos)
+      delete theBlock[theBlockPos];
+
+    if (theStream.is_open())
+      theStream.close();
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+    fs::remove(thePath, true);
+#endif
+  }
+
+  void write(std::vector<Tuple*>::const_iterator begin,
+             std::vector<Tuple*>::const_iterator end);
+
+  void open();
+
+  bool advance();
+
+protected:
+  bool readBlock();
+};
+
+
+void ExternalSorter::FileRun::write(
+    std::vector<Tuple*>::const_iterator begin,
+    std::vector<Tuple*>::const_iterator end)
+{
+  std::ofstream os(thePath.c_str(), std::ios::out | std::ios::binary);
+
+  while (begin != end)
+  {
+    csize numTuples = std::min<csize>(end - begin, BLOCK_SIZE);
+
+    std::ostringstream block;
+    {
+      serialization::BinArchiver ar(&block);
+
+      ar & numTuples;
+
+      for (csize i = 0; i < numTuples; ++i, ++begin)
+      {
+        Tuple* tuple = *begin;
+
+        std::vector<store::Item_t> keyValues(tuple->theSortTuple.theKeyValues.begin(),
+                                             tuple->theSortTuple.theKeyValues.end());
+        ar & keyValues;
+        ar & tuple->theColumns;
+      }
+
+      ar.serialize_out();
+    }
+
+    std::string data = block.str();
+    uint64_t size = data.size();
+
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(data.data(), data.size());
+  }
+
+  os.close();
+
+  if (os.fail())
+  {
+    throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+    ERROR_PARAMS("could not write sort run " + thePath));
+  }
+}
+
+
+void ExternalSorter::FileRun::open()
+{
+  theStream.open(thePath.c_str(), std::ios::in | std::ios::binary);
+
+  if (!theStream.is_open())
+  {
+    throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+    ERROR_PARAMS("could not open sort run " + thePath));
+  }
+}
+
+
+bool ExternalSorter::FileRun::readBlock()
+{
+  theBlock.clear();
+  theBlockPos = 0;
+
+  uint64_t size;
+  theStream.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+  if (theStream.gcount() == 0)
+    return false;
+
+  std::string data(size, '\0');
+  theStream.read(&data[0], size);
+
+  if ((uint64_t)theStream.gcount() != size)
+  {
+    throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+    ERROR_PARAMS("truncated sort run " + thePath));
+  }
+
+  std::istringstream block(data);
+  serialization::BinArchiver ar(&block);
+
+  csize numTuples;
+  ar & numTuples;
+
+  theBlock.reserve(numTuples);
+
+  for (csize i = 0; i < numTuples; ++i)
+  {
+    std::unique_ptr<Tuple> tuple(new Tuple);
+
+    std::vector<store::Item_t> keyValues;
+    ar & keyValues;
+    ar & tuple->theColumns;
+
+    SortTuple::KeyValues& keys = tuple->theSortTuple.theKeyValues;
+    keys.resize(keyValues.size());
+
+    for (csize j = 0; j < keyValues.size(); ++j)
+      keys[j] = keyValues[j].release();
+
+    theBlock.push_back(tuple.release());
+  }
+
+  ar.finalize_input_serialization();
+
+  return !theBlock.empty();
+}
+
+
+bool ExternalSorter::FileRun::advance()
+{
+  delete theHead;
+  theHead = NULL;
+
+  if (theBlockPos == theBlock.size() && !readBlock())
+    return false;
+
+  theHead = theBlock[theBlockPos++];
+  return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                                                             //
+//  ExternalSorter                                                             //
+//                                                                             //
+/////////////////////////////////////////////////////////////////////////////////
+
+
+/*******************************************************************************
+  Estimate the memory used by a tuple. Items shared among several tuples are
+  counted once per tuple, so the estimate errs on the side of spilling early.
+********************************************************************************/
+static size_t tuple_size(const ExternalSorter::Tuple* tuple)
+{
+  size_t size = sizeof(ExternalSorter::Tuple);
+
+  const SortTuple::KeyValues& keys = tuple->theSortTuple.theKeyValues;
+
+  for (csize i = 0; i < keys.size(); ++i)
+  {
+    size += sizeof(store::Item*);
+    if (keys[i] != NULL)
+      size += ztd::mem_sizeof(*keys[i]);
+  }
+
+  return size + ztd::mem_sizeof(tuple->theColumns);
+}
+
+
+/*******************************************************************************
+  Check whether all the items of a tuple are atomic, so that the tuple can be
+  written to a run file without losing anything.
+********************************************************************************/
+static bool is_spillable(const ExternalSorter::Tuple* tuple)
+{
+  const SortTuple::KeyValues& keys = tuple->theSortTuple.theKeyValues;
+
+  for (csize i = 0; i < keys.size(); ++i)
+  {
+    if (keys[i] != NULL && !keys[i]->isAtomic())
+      return false;
+  }
+
+  const std::vector<ExternalSorter::Column>& columns = tuple->theColumns;
+
+  for (csize i = 0; i < columns.size(); ++i)
+  {
+    for (csize j = 0; j < columns[i].size(); ++j)
+    {
+      if (columns[i][j] != NULL && !columns[i][j]->isAtomic())
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+ExternalSorter::ExternalSorter(
+    const SortTupleCmp& cmp,
+    bool stable,
+    size_t memoryLimit)
+  :
+  theCmp(cmp),
+  theStable(stable),
+  theMemoryLimit(memoryLimit),
+  theBufferSize(0),
+#ifdef ZORBA_WITH_FILE_ACCESS
+  theCanSpill(memoryLimit > 0),
+#else
+  theCanSpill(false),
+#endif
+  theCurrent(NULL),
+  theBufferPos(0)
+{
+}
+
+
+ExternalSorter::~ExternalSorter()
+{
+  for (csize i = theBufferPos; i < theBuffer.size(); ++i)
+    delete theBuffer[i];
+
+  if (theRuns.empty())
+    delete theCurrent;
+
+  for (csize i = 0; i < theRuns.size(); ++i)
+    delete theRuns[i];
+}
+
+
+void ExternalSorter::add(Tuple* tuple)
+{
+  theBuffer.push_back(tuple);
+
+  if (!theCanSpill)
+    return;
+
+  if (!is_spillable(tuple))
+  {
+    theCanSpill = false;
+    return;
+  }
+
+  theBufferSize += tuple_size(tuple);
+
+  if (theBufferSize > theMemoryLimit)
+    spill();
+}
+
+
+void ExternalSorter::sortBuffer()
+{
+  TupleCmp cmp(theCmp);
+
+  if (theStable)
+    std::stable_sort(theBuffer.begin(), theBuffer.end(), cmp);
+  else
+    std::sort(theBuffer.begin(), theBuffer.end(), cmp);
+}
+
+
+/*******************************************************************************
+  Sort the buffered tuples, write them to a new run file, and empty the buffer.
+********************************************************************************/
+void ExternalSorter::spill()
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  sortBuffer();
+
+  std::unique_ptr<FileRun> run(new FileRun(fs::get_temp_file()));
+
+  run->write(theBuffer.begin(), theBuffer.end());
+
+  theRuns.push_back(run.release());
+
+  for (csize i = 0; i < theBuffer.size(); ++i)
+    delete theBuffer[i];
+
+  theBuffer.clear();
+  theBufferSize = 0;
+#endif
+}
+
+
+void ExternalSorter::sort()
+{
+  sortBuffer();
+
+  if (theRuns.empty())
+    return;
+
+  theRuns.push_back(new MemoryRun(theBuffer));
+
+  csize numRuns = theRuns.size();
+
+  for (csize i = 0; i < numRuns; ++i)
+  {
+    if (i < numRuns - 1)
+      static_cast<FileRun*>(theRuns[i])->open();
+
+    if (theRuns[i]->advance())
+      theHeap.push_back(i);
+  }
+
+  for (csize i = theHeap.size() / 2; i > 0; --i)
+    siftDown(i - 1);
+}
+
+
+ExternalSorter::Tuple* ExternalSorter::next()
+{
+  if (theRuns.empty())
+  {
+    delete theCurrent;
+    theCurrent = NULL;
+
+    if (theBufferPos < theBuffer.size())
+      theCurrent = theBuffer[theBufferPos++];
+
+    return theCurrent;
+  }
+
+  // The previous tuple is the head of the top run. Advance that run now that
+  // the caller is done with the tuple.
+  if (theCurrent != NULL)
+  {
+    theCurrent = NULL;
+
+    if (!theRuns[theHeap[0]]->advance())
+    {
+      theHeap[0] = theHeap.back();
+      theHeap.pop_back();
+    }
+
+    if (!theHeap.empty())
+      siftDown(0);
+  }
+
+  if (theHeap.empty())
+    return NULL;
+
+  theCurrent = theRuns[theHeap[0]]->head();
+  return theCurrent;
+}
+
+
+/*******************************************************************************
+  Compare the head tuples of two runs. Ties go to the run that was created
+  first, which keeps the merge stable.
+********************************************************************************/
+bool ExternalSorter::lessThan(csize run1, csize run2) const
+{
+  const SortTuple& t1 = theRuns[run1]->head()->theSortTuple;
+  const SortTuple& t2 = theRuns[run2]->head()->theSortTuple;
+
+  if (theCmp(t1, t2))
+    return true;
+
+  if (theCmp(t2, t1))
+    return false;
+
+  return run1 < run2;
+}
+
+
+void ExternalSorter::siftDown(csize pos)
+{
+  csize size = theHeap.size();
+
+  while (true)
+  {
+    csize smallest = pos;
+    csize left = 2 * pos + 1;
+    csize right = left + 1;
+
+    if (left < size && lessThan(theHeap[left], theHeap[smallest]))
+      smallest = left;
+
+    if (right < size && lessThan(theHeap[right], theHeap[smallest]))
+      smallest = right;
+
+    if (smallest == pos)
+      break;
+
+    std::swap(theHeap[pos], theHeap[smallest]);
+    pos = smallest;
+  }
+}
+
+
+} // namespace flwor
+} // namespace zorba
+/* vim:set et sw=2 ts=2: */
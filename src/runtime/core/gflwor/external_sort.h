@@ -0,0 +1,175 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_RUNTIME_GFLWOR_EXTERNAL_SORT
+#define ZORBA_RUNTIME_GFLWOR_EXTERNAL_SORT
+
+#include <vector>
+
+#include "store/api/item.h"
+
+#include "runtime/core/gflwor/orderby_iterator.h"
+#include "runtime/core/gflwor/comp_function.h"
+
+
+namespace zorba
+{
+
+namespace flwor
+{
+
+/***************************************************************************//**
+  A memory-budgeted sorter for the tuples of an orderby clause.
+
+  Each tuple consists of a sort tuple (the values of the orderby keys) and a
+  number of payload columns, each storing a sequence of items. The meaning of
+  the columns is up to the user of the sorter (e.g. the result of the return
+  clause, or the values of the FOR and LET vars of a tuple stream).
+
+  The tuples are buffered in memory until their (estimated) size exceeds
+  theMemoryLimit. At that point, the buffered tuples are sorted and written
+  to a temp file as a sorted "run", and the buffer is emptied. When all the
+  tuples have been added, sort() turns the buffered tuples into one more,
+  in-memory run, and next() k-way merges all the runs. If no run was spilled,
+  next() simply returns the buffered tuples in sorted order.
+
+  A run file is a sequence of blocks, each holding up to BLOCK_SIZE tuples in
+  a self-contained BinArchiver archive, so that merging keeps at most one
+  block per run in memory.
+
+  Only tuples whose key and payload items are all atomic can be spilled,
+  because nodes, functions, and JSON items would lose their identity. As soon
+  as the buffer contains a tuple with such an item, spilling is switched off
+  for the rest of the sort (runs spilled before that point are still merged).
+
+  The merge is stable: runs are created in input order, and ties between the
+  heads of two runs are resolved in favor of the earlier run.
+
+  theCmp         : The comparison function for sort tuples.
+  theStable      : Whether the in-memory sorting of each run must be stable.
+  theMemoryLimit : Approximate max number of bytes used by theBuffer.
+  theBuffer      : The tuples added since the last run was spilled.
+  theBufferSize  : The estimated memory size of the tuples in theBuffer.
+  theCanSpill    : False if spilling has been switched off (see above).
+  theRuns        : The runs created so far. After sort(), the last run is the
+                   in-memory one.
+  theHeap        : A binary min-heap of positions in theRuns, ordered by the
+                   current head tuple of each run.
+  theCurrent     : The tuple returned by the last call to next().
+  theBufferPos   : The position in theBuffer of the next tuple to return, if
+                   no run was spilled.
+********************************************************************************/
+class ExternalSorter
+{
+public:
+  static const csize BLOCK_SIZE = 1024;
+
+  typedef std::vector<store::Item_t> Column;
+
+  class Tuple
+  {
+  public:
+    SortTuple             theSortTuple;
+    std::vector<Column>   theColumns;
+
+  public:
+    Tuple() { }
+
+    ~Tuple() { theSortTuple.clear(); }
+  };
+
+  class Run;
+  class FileRun;
+  class MemoryRun;
+
+protected:
+  class TupleCmp
+  {
+  private:
+    const SortTupleCmp & theCmp;
+
+  public:
+    TupleCmp(const SortTupleCmp& cmp) : theCmp(cmp) {}
+
+    bool operator()(const Tuple* t1, const Tuple* t2) const
+    {
+      return theCmp(t1->theSortTuple, t2->theSortTuple);
+    }
+  };
+
+protected:
+  SortTupleCmp                theCmp;
+  bool                        theStable;
+  size_t                      theMemoryLimit;
+
+  std::vector<Tuple*>         theBuffer;
+  size_t                      theBufferSize;
+  bool                        theCanSpill;
+
+  std::vector<Run*>           theRuns;
+  std::vector<csize>          theHeap;
+  Tuple                     * theCurrent;
+  csize                       theBufferPos;
+
+public:
+  ExternalSorter(const SortTupleCmp& cmp, bool stable, size_t memoryLimit);
+
+  ~ExternalSorter();
+
+  /**
+   * Adds the given tuple to the sorter, which takes over its ownership. May
+   * spill a sorted run to disk.
+   */
+  void add(Tuple* tuple);
+
+  /**
+   * Must be called once, after the last tuple has been added and before the
+   * first call to next().
+   */
+  void sort();
+
+  /**
+   * Returns the next tuple in sort order, or NULL if there are no more
+   * tuples. The returned tuple is owned by the sorter, and it remains valid
+   * until the next call to next().
+   */
+  Tuple* next();
+
+protected:
+  void sortBuffer();
+
+  void spill();
+
+  bool lessThan(csize run1, csize run2) const;
+
+  void siftDown(csize pos);
+
+private:
+  ExternalSorter(const ExternalSorter&);
+  void operator=(const ExternalSorter&);
+};
+
+
+} // namespace flwor
+} // namespace zorba
+
+#endif /* ZORBA_RUNTIME_GFLWOR_EXTERNAL_SORT */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,481 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include "runtime/core/gflwor/groupby_aggregate.h"
+
+#include "runtime/core/arithmetic_impl.h"
+#include "runtime/booleans/BooleanImpl.h"
+#include "runtime/util/item_iterator.h"
+
+#include "context/static_context.h"
+#include "context/dynamic_context.h"
+
+#include "system/globalenv.h"
+
+#include "store/api/item_factory.h"
+
+#include "types/casting.h"
+#include "types/typeops.h"
+#include "types/typemanager.h"
+
+#include "zorbatypes/integer.h"
+#include "zorbatypes/numeric_types.h"
+
+#include "diagnostics/xquery_diagnostics.h"
+#include "diagnostics/util_macros.h"
+#include "diagnostics/zorba_exception.h"
+
+
+namespace zorba
+{
+
+namespace flwor
+{
+
+/*******************************************************************************
+  An iterator that raises a given error when its next() method is called. It
+  is bound to the references of an aggregate whose computation has failed.
+********************************************************************************/
+class AggregateErrorIterator : public store::Iterator
+{
+private:
+  std::unique_ptr<ZorbaException> theError;
+
+public:
+  AggregateErrorIterator(const ZorbaException& error) : theError(clone(error)) {}
+
+  void open() {}
+
+  bool next(store::Item_t&)
+  {
+    theError->polymorphic_throw();
+    return false;
+  }
+
+  void reset() {}
+
+  void close() {}
+};
+
+
+/*******************************************************************************
+
+********************************************************************************/
+GroupAggregate::Context::Context(
+    const QueryLoc& loc,
+    dynamic_context* dctx,
+    static_context* sctx)
+  :
+  theLoc(loc),
+  theDctx(dctx),
+  theTypeManager(sctx->get_typemanager()),
+  theTimezone(dctx->get_implicit_timezone()),
+  theCollator(sctx->get_default_collator(loc))
+{
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+GroupAggregate::GroupAggregate(Kind kind)
+  :
+  theKind(kind),
+  theCount(0),
+  theType(store::XS_LAST),
+  theIsDone(false),
+  theHitNumeric(false),
+  theHitYearMonth(false),
+  theHitDayTime(false),
+  theHasResult(false)
+{
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void GroupAggregate::add(store::Item_t& item, const Context& ctx)
+{
+  assert(!theHasResult);
+
+  if (theError.get() != NULL || theIsDone)
+    return;
+
+  try
+  {
+    switch (theKind)
+    {
+    case COUNT:
+      ++theCount;
+      break;
+    case SUM:
+      addSum(item, ctx);
+      break;
+    case AVG:
+      addAvg(item, ctx);
+      break;
+    case MIN:
+    case MAX:
+      addMinMax(item, ctx);
+      break;
+    }
+  }
+  catch (ZorbaException& e)
+  {
+    if ((theKind == MIN || theKind == MAX) && e.diagnostic() == err::XPTY0004)
+      e.set_diagnostic(err::FORG0006);
+
+    theError = clone(e);
+  }
+}
+
+
+/*******************************************************************************
+  See FnSumIterator::nextImpl()
+********************************************************************************/
+void GroupAggregate::addSum(store::Item_t& item, const Context& ctx)
+{
+  store::SchemaTypeCode itemType = item->getTypeCode();
+
+  if (itemType == store::XS_UNTYPED_ATOMIC)
+  {
+    GenericCast::castToBuiltinAtomic(item, item, store::XS_DOUBLE, NULL, ctx.theLoc);
+    itemType = store::XS_DOUBLE;
+  }
+
+  if (theValue == NULL)
+  {
+    if (!TypeOps::is_numeric(itemType) &&
+        (!TypeOps::is_subtype(itemType, store::XS_DURATION) ||
+         itemType == store::XS_DURATION))
+    {
+      xqtref_t type = ctx.theTypeManager->create_value_type(item);
+      RAISE_ERROR(err::FORG0006, ctx.theLoc,
+      ERROR_PARAMS(ZED(BadArgTypeForFn_2o34o), *type, "fn:sum"));
+    }
+
+    theValue.transfer(item);
+    theType = itemType;
+    return;
+  }
+
+  if (item->isNaN())
+  {
+    theValue.transfer(item);
+    theIsDone = true;
+    return;
+  }
+
+  if ((TypeOps::is_numeric(theType) &&
+       TypeOps::is_numeric(itemType)) ||
+      (TypeOps::is_subtype(theType, store::XS_YM_DURATION) &&
+       TypeOps::is_subtype(itemType, store::XS_YM_DURATION)) ||
+      (TypeOps::is_subtype(theType, store::XS_DT_DURATION) &&
+       TypeOps::is_subtype(itemType, store::XS_DT_DURATION)))
+  {
+    GenericArithIterator<AddOperation>::compute(theValue,
+                                                ctx.theDctx,
+                                                ctx.theTypeManager,
+                                                ctx.theLoc,
+                                                theValue,
+                                                item);
+  }
+  else
+  {
+    xqtref_t type1 = ctx.theTypeManager->create_value_type(theValue);
+    xqtref_t type2 = ctx.theTypeManager->create_value_type(item);
+    RAISE_ERROR(err::FORG0006, ctx.theLoc,
+    ERROR_PARAMS(ZED(SumImpossibleWithTypes_23), *type1, *type2));
+  }
+}
+
+
+/*******************************************************************************
+  See FnAvgIterator::nextImpl()
+********************************************************************************/
+void GroupAggregate::addAvg(store::Item_t& item, const Context& ctx)
+{
+  const RootTypeManager& rtm = GENV_TYPESYSTEM;
+
+  store::SchemaTypeCode itemType = item->getTypeCode();
+
+  if (TypeOps::is_numeric(itemType) || itemType == store::XS_UNTYPED_ATOMIC)
+  {
+    theHitNumeric = true;
+
+    if (theHitYearMonth || theHitDayTime)
+    {
+      xqtref_t type = ctx.theTypeManager->create_value_type(item);
+      RAISE_ERROR(err::FORG0006, ctx.theLoc,
+      ERROR_PARAMS(ZED(BadArgTypeForFn_2o34o),
+                   *type,
+                   "fn:avg",
+                   ZED(ExpectedType_5),
+                   (theHitYearMonth ?
+                    *rtm.YM_DURATION_TYPE_ONE :
+                    *rtm.DT_DURATION_TYPE_ONE)));
+    }
+  }
+  else if (itemType == store::XS_YM_DURATION || itemType == store::XS_DT_DURATION)
+  {
+    bool yearMonth = (itemType == store::XS_YM_DURATION);
+
+    if (theHitNumeric)
+    {
+      xqtref_t type = ctx.theTypeManager->create_value_type(item);
+      RAISE_ERROR(err::FORG0006, ctx.theLoc,
+      ERROR_PARAMS(ZED(BadArgTypeForFn_2o34o),
+                   *type,
+                   "fn:avg",
+                   ZED(ExpectedNumericType)));
+    }
+
+    if ((yearMonth && theHitDayTime) || (!yearMonth && theHitYearMonth))
+    {
+      xqtref_t type = ctx.theTypeManager->create_value_type(item);
+      RAISE_ERROR(err::FORG0006, ctx.theLoc,
+      ERROR_PARAMS(ZED(BadArgTypeForFn_2o34o),
+                   *type,
+                   "fn:avg",
+                   ZED(ExpectedType_5),
+                   (yearMonth ?
+                    *rtm.DT_DURATION_TYPE_ONE :
+                    *rtm.YM_DURATION_TYPE_ONE)));
+    }
+
+    if (yearMonth)
+      theHitYearMonth = true;
+    else
+      theHitDayTime = true;
+  }
+  else
+  {
+    xqtref_t type = ctx.theTypeManager->create_value_type(item);
+    RAISE_ERROR(err::FORG0006, ctx.theLoc,
+    ERROR_PARAMS(ZED(BadArgTypeForFn_2o34o),
+                 *type,
+                 "fn:avg",
+                 ZED(ExpectedNumericOrDurationType)));
+  }
+
+  if (theCount++ == 0)
+  {
+    theValue.transfer(item);
+  }
+  else
+  {
+    GenericArithIterator<AddOperation>::compute(theValue,
+                                                ctx.theDctx,
+                                                ctx.theTypeManager,
+                                                ctx.theLoc,
+                                                theValue,
+                                                item);
+  }
+}
+
+
+/*******************************************************************************
+  See FnMinMaxIterator::nextImpl()
+********************************************************************************/
+void GroupAggregate::addMinMax(store::Item_t& item, const Context& ctx)
+{
+  store::SchemaTypeCode itemType = item->getTypeCode();
+
+  if (itemType == store::XS_UNTYPED_ATOMIC)
+  {
+    GenericCast::castToBuiltinAtomic(item, item, store::XS_DOUBLE, NULL, ctx.theLoc);
+    itemType = store::XS_DOUBLE;
+  }
+
+  if (item->isNaN())
+  {
+    theValue = item;
+
+    if (TypeOps::is_subtype(itemType, store::XS_DOUBLE))
+    {
+      theIsDone = true;
+      return;
+    }
+
+    theType = itemType;
+  }
+
+  if (theValue != NULL)
+  {
+    store::Item_t promoted;
+
+    if (!GenericCast::promote(promoted, item, theType, NULL,
+                              ctx.theTypeManager, ctx.theLoc))
+    {
+      if (GenericCast::promote(promoted, theValue, itemType, NULL,
+                               ctx.theTypeManager, ctx.theLoc))
+      {
+        theValue.transfer(promoted);
+        theType = theValue->getTypeCode();
+      }
+      else
+      {
+        RAISE_ERROR(err::FORG0006, ctx.theLoc,
+        ERROR_PARAMS(ZED(PromotionImpossible)));
+      }
+    }
+    else
+    {
+      item.transfer(promoted);
+      itemType = item->getTypeCode();
+    }
+
+    store::Item_t itemCopy(item);
+    store::Item_t valueCopy(theValue);
+
+    if (CompareIterator::valueComparison(ctx.theLoc,
+                                         itemCopy,
+                                         valueCopy,
+                                         (theKind == MIN ?
+                                          CompareConsts::VALUE_LESS :
+                                          CompareConsts::VALUE_GREATER),
+                                         ctx.theTypeManager,
+                                         ctx.theTimezone,
+                                         ctx.theCollator))
+    {
+      theType = itemType;
+      theValue.transfer(item);
+    }
+  }
+  else
+  {
+    theType = itemType;
+    theValue.transfer(item);
+  }
+
+  ++theCount;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void GroupAggregate::computeResult(const Context& ctx)
+{
+  theHasResult = true;
+
+  if (theError.get() != NULL)
+    return;
+
+  try
+  {
+    switch (theKind)
+    {
+    case COUNT:
+    {
+      GENV_ITEMFACTORY->createInteger(theResult, xs_integer(theCount));
+      break;
+    }
+    case SUM:
+    {
+      if (theValue != NULL)
+        theResult.transfer(theValue);
+      else
+        GENV_ITEMFACTORY->createInteger(theResult,
+                                        numeric_consts<xs_integer>::zero());
+      break;
+    }
+    case AVG:
+    {
+      if (theCount > 0)
+      {
+        store::Item_t countItem;
+        GENV_ITEMFACTORY->createInteger(countItem, xs_integer(theCount));
+
+        GenericArithIterator<DivideOperation>::compute(theResult,
+                                                       ctx.theDctx,
+                                                       ctx.theTypeManager,
+                                                       ctx.theLoc,
+                                                       theValue,
+                                                       countItem);
+      }
+      break;
+    }
+    case MIN:
+    case MAX:
+    {
+      if (theCount == 1)
+      {
+        // check type compatibility
+        store::Item_t dummy1(theValue);
+        store::Item_t dummy2(theValue);
+        CompareIterator::valueComparison(ctx.theLoc,
+                                         dummy1,
+                                         dummy2,
+                                         (theKind == MIN ?
+                                          CompareConsts::VALUE_LESS :
+                                          CompareConsts::VALUE_GREATER),
+                                         ctx.theTypeManager,
+                                         ctx.theTimezone,
+                                         ctx.theCollator);
+      }
+
+      theResult.transfer(theValue);
+      break;
+    }
+    }
+  }
+  catch (ZorbaException& e)
+  {
+    if ((theKind == MIN || theKind == MAX) && e.diagnostic() == err::XPTY0004)
+      e.set_diagnostic(err::FORG0006);
+
+    theError = clone(e);
+    theResult = NULL;
+  }
+
+  theValue = NULL;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+store::Iterator_t GroupAggregate::getResult(const Context& ctx)
+{
+  if (!theHasResult)
+    computeResult(ctx);
+
+  store::Iterator_t result;
+
+  if (theError.get() != NULL)
+    result = new AggregateErrorIterator(*theError);
+  else if (theResult != NULL)
+    result = new ItemIterator(theResult);
+  else
+    result = new ItemIterator();
+
+  result->open();
+  return result;
+}
+
+
+} // namespace flwor
+} // namespace zorba
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_RUNTIME_GFLWOR_GROUPBY_AGGREGATE
+#define ZORBA_RUNTIME_GFLWOR_GROUPBY_AGGREGATE
+
+#include <memory>
+
+#include <zorba/zorba_exception.h>
+
+#include "common/shared_types.h"
+#include "compiler/parser/query_loc.h"
+
+#include "store/api/item.h"
+#include "store/api/iterator.h"
+
+
+namespace zorba
+{
+
+class XQPCollator;
+
+namespace flwor
+{
+
+/***************************************************************************//**
+  Computes one of fn:count, fn:sum, fn:avg, fn:min, or fn:max incrementally
+  over the value of a non-grouping var, as the tuples of a group are added to
+  it. This lets a group-by keep a running result per group instead of the whole
+  value of the var (see NonGroupingSpec::theAggregateKinds).
+
+  add() follows the item-at-a-time logic of FnCountIterator, FnSumIterator,
+  FnAvgIterator, and FnMinMaxIterator, so the result is the same as when the
+  function is applied to the full sequence. Dynamic errors are not raised by
+  add(); the first one is kept and raised when the result is consumed, so that
+  no error is raised for a group whose aggregate is never used.
+
+  theKind    : The aggregate function.
+  theCount   : COUNT, AVG: the number of items added so far.
+  theValue   : SUM, AVG: the running sum. MIN, MAX: the running min or max.
+  theType    : SUM: the type of the first item. MIN, MAX: the type of theValue.
+  theIsDone  : SUM, MIN, MAX: a NaN has been found, which decides the result.
+  theHitNumeric, theHitYearMonth, theHitDayTime : AVG: the kinds of items that
+               have been added so far (they may not be mixed).
+  theHasResult : Whether theResult has been computed. No more items may be
+               added after that.
+  theResult  : The result of the function (NULL for the empty sequence).
+  theError   : The first error raised while adding an item or computing the
+               result, if any.
+********************************************************************************/
+class GroupAggregate
+{
+public:
+  enum Kind
+  {
+    COUNT = 0,
+    SUM,
+    AVG,
+    MIN,
+    MAX
+  };
+
+  /**
+   * The context that the aggregate functions are evaluated in.
+   */
+  class Context
+  {
+  public:
+    const QueryLoc      & theLoc;
+    dynamic_context     * theDctx;
+    const TypeManager   * theTypeManager;
+    long                  theTimezone;
+    XQPCollator         * theCollator;
+
+  public:
+    Context(const QueryLoc& loc, dynamic_context* dctx, static_context* sctx);
+  };
+
+protected:
+  Kind                             theKind;
+  csize                            theCount;
+  store::Item_t                    theValue;
+  store::SchemaTypeCode            theType;
+  bool                             theIsDone;
+  bool                             theHitNumeric;
+  bool                             theHitYearMonth;
+  bool                             theHitDayTime;
+  bool                             theHasResult;
+  store::Item_t                    theResult;
+  std::unique_ptr<ZorbaException>  theError;
+
+public:
+  GroupAggregate(Kind kind);
+
+  Kind getKind() const { return theKind; }
+
+  void add(store::Item_t& item, const Context& ctx);
+
+  /**
+   * Returns a new, open iterator over the result of the aggregate function,
+   * which raises the pending error, if any, when its next() is called.
+   */
+  store::Iterator_t getResult(const Context& ctx);
+
+protected:
+  void addSum(store::Item_t& item, const Context& ctx);
+
+  void addAvg(store::Item_t& item, const Context& ctx);
+
+  void addMinMax(store::Item_t& item, const Context& ctx);
+
+  void computeResult(const Context& ctx);
+
+private:
+  GroupAggregate(const GroupAggregate&);
+  void operator=(const GroupAggregate&);
+};
+
+
+} // namespace flwor
+} // namespace zorba
+
+#endif /* ZORBA_RUNTIME_GFLWOR_GROUPBY_AGGREGATE */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
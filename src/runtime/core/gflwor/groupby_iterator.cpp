@@ -27,10 +27,12 @@
 #include "runtime/visitors/planiter_visitor.h"
 #include "runtime/core/gflwor/groupby_iterator.h"
 #include "runtime/core/gflwor/common.h"
+#include "runtime/core/gflwor/groupby_spill.h"
 
 #include "system/globalenv.h"
 
 #include <zorba/internal/unique_ptr.h>
+#include <zorba/properties.h>
 
 using namespace zorba;
 
@@ -55,7 +57,8 @@ SERIALIZABLE_CLASS_VERSIONS(GroupByIterator)
 ********************************************************************************/
 GroupByState::GroupByState() 
   :
-  theGroupMap(0)
+  theGroupMap(0),
+  theGroupSpiller(NULL)
 {
 }
 
@@ -75,6 +78,8 @@ GroupByState::~GroupByState()
 
   delete theGroupMap;
   theGroupMap = 0;
+
+  delete theGroupSpiller;
 }
   
 
@@ -110,6 +115,9 @@ void GroupByState::reset(PlanState& aPlanState)
   }
 
   theGroupMap->clear();
+
+  delete theGroupSpiller;
+  theGroupSpiller = NULL;
 }
   
 
@@ -339,7 +347,7 @@ bool GroupByIterator::nextImpl(store::Item_t& aResult, PlanState& planState) con
     }
   }
 
-  if (!state->theGroupMap->empty()) 
+  do
   {
     state->theGroupMapIter = state->theGroupMap->begin();
 
@@ -352,6 +360,7 @@ bool GroupByIterator::nextImpl(store::Item_t& aResult, PlanState& planState) con
       STACK_PUSH(true, state);
     }
   }
+  while (nextGroupPartition(state, planState));
 
   STACK_END(state);
 }
@@ -387,46 +396,121 @@ void GroupByIterator::matVarsAndGroupBy(
     theGroupingSpecs[i].theInput->reset(aPlanState);
   }
 
+  numVars = theNonGroupingSpecs.size();
+
+  std::vector<std::vector<store::Item_t> > values(numVars);
+
+  for (csize i = 0; i < numVars; ++i)
+  {
+    while (consumeNext(temp, theNonGroupingSpecs[i].theInput.getp(), aPlanState))
+    {
+      values[i].push_back(temp);
+    }
+
+    theNonGroupingSpecs[i].theInput->reset(aPlanState);
+  }
+
+  if (aGroupByState->theGroupSpiller == NULL &&
+      Properties::instance().getGroupByMemoryLimit() > 0)
+  {
+    aGroupByState->theGroupSpiller =
+    new GroupSpiller(Properties::instance().getGroupByMemoryLimit());
+  }
+
+  addGroupTuple(aGroupByState, groupTuple, values, aPlanState);
+}
+
+
+/***************************************************************************//**
+  Adds the values of the non-grouping vars in an input tuple to the group with
+  the given key, or to the spiller (see FLWORIterator::addGroupTuple()).
+********************************************************************************/
+void GroupByIterator::addGroupTuple(
+    GroupByState* aGroupByState,
+    std::unique_ptr<GroupTuple>& aGroupTuple,
+    std::vector<std::vector<store::Item_t> >& aValues,
+    PlanState& aPlanState) const
+{
   GroupHashMap* groupMap = aGroupByState->theGroupMap;
+  GroupSpiller* spiller = aGroupByState->theGroupSpiller;
 
-  numVars = theNonGroupingSpecs.size();
+  GroupAggregate::Context aggrCtx(loc, aPlanState.theLocalDynCtx, theSctx);
 
-  std::vector<store::TempSeq_t>* nonGroupTuple = NULL;
+  GroupValue* groupValue = NULL;
+  size_t size;
 
-  if (groupMap->get(groupTuple.get(), nonGroupTuple))
+  if (groupMap->get(aGroupTuple.get(), groupValue))
   {
-    assert(nonGroupTuple != NULL);
+    assert(groupValue != NULL);
 
-    for (csize i = 0; i < numVars; ++i)
-    {
-      store::Iterator_t iterWrapper = 
-      new PlanIteratorWrapper(theNonGroupingSpecs[i].theInput, aPlanState);
+    size = groupValue->add(theNonGroupingSpecs, aValues, aggrCtx);
+  }
+  else if (spiller != NULL && spiller->isSpilling())
+  {
+    uint32_t hash = groupMap->get_compare_function().hash(aGroupTuple.get());
 
-      (*nonGroupTuple)[i]->append(iterWrapper);
+    std::unique_ptr<GroupSpiller::Tuple> tuple(new GroupSpiller::Tuple);
+    tuple->theKey.swap(aGroupTuple->theItems);
+    tuple->theColumns.swap(aValues);
 
-      theNonGroupingSpecs[i].theInput->reset(aPlanState);
-    }
+    spiller->add(hash, tuple.release());
+    return;
   }
   else
   {
-    nonGroupTuple = new std::vector<store::TempSeq_t>();
+    std::unique_ptr<GroupValue> newValue(new GroupValue(theNonGroupingSpecs));
 
-    for (csize i = 0; i < numVars; ++i)
-    {
-      store::Iterator_t iterWrapper = 
-      new PlanIteratorWrapper(theNonGroupingSpecs[i].theInput, aPlanState);
+    size = newValue->add(theNonGroupingSpecs, aValues, aggrCtx);
+    size += sizeof(GroupTuple) + sizeof(GroupValue) +
+            GroupSpiller::size_of(aGroupTuple->theItems);
 
-      // FIXME are those settings (no-copy and no-lazy) right? 
-      store::TempSeq_t tempSeq = GENV_STORE.createTempSeq(iterWrapper, false); 
+    groupValue = newValue.release();
+    groupMap->insert(aGroupTuple.get(), groupValue);
+    aGroupTuple.release();
+  }
 
-      nonGroupTuple->push_back(tempSeq);
+  if (spiller != NULL)
+    spiller->addMemory(size);
+}
 
-      theNonGroupingSpecs[i].theInput->reset(aPlanState);
-    }
 
-    groupMap->insert(groupTuple.get(), nonGroupTuple);
-    groupTuple.release();
+/***************************************************************************//**
+  Replaces the groups in the group map with the groups of the next spilled
+  partition, if any (see FLWORIterator::nextGroupPartition()).
+********************************************************************************/
+bool GroupByIterator::nextGroupPartition(
+    GroupByState* aGroupByState,
+    PlanState& aPlanState) const
+{
+  GroupSpiller* spiller = aGroupByState->theGroupSpiller;
+
+  if (spiller == NULL || !spiller->nextPartition())
+    return false;
+
+  GroupHashMap* groupMap = aGroupByState->theGroupMap;
+  GroupHashMap::iterator iter = groupMap->begin();
+  GroupHashMap::iterator end = groupMap->end();
+  for (; iter != end; ++iter)
+  {
+    delete (*iter).first;
+    delete (*iter).second;
+  }
+
+  groupMap->clear();
+
+  GroupSpiller::Tuple* spilledTuple;
+
+  while ((spilledTuple = spiller->next()) != NULL)
+  {
+    std::unique_ptr<GroupSpiller::Tuple> tuple(spilledTuple);
+    std::unique_ptr<GroupTuple> groupTuple(new GroupTuple());
+
+    groupTuple->theItems.swap(tuple->theKey);
+
+    addGroupTuple(aGroupByState, groupTuple, tuple->theColumns, aPlanState);
   }
+
+  return true;
 }
 
 
@@ -454,21 +538,9 @@ void GroupByIterator::bindGroupBy(
   }
 
   // Bind non-grouping vars
-  numVars = theNonGroupingSpecs.size();
+  GroupAggregate::Context aggrCtx(loc, aPlanState.theLocalDynCtx, theSctx);
 
-  std::vector<store::TempSeq_t>* nonGroupTuple = (*aGroupMapIter).second;
-
-  for (csize i = 0; i < numVars; ++i)
-  {
-    store::TempSeq_t nonGroupVar = (*nonGroupTuple)[i].getp();
-
-    csize numVarRefs = theNonGroupingSpecs[i].theVarRefs.size();
-
-    for (csize j = 0; j < numVarRefs; ++j)
-    {
-      theNonGroupingSpecs[i].theVarRefs[j]->bind(nonGroupVar, aPlanState);
-    }
-  }
+  (*aGroupMapIter).second->bind(theNonGroupingSpecs, aPlanState, aggrCtx);
 }
   
 
@@ -30,10 +30,14 @@ namespace flwor
 {
 
 class GroupByIterator;
+
+class GroupSpiller;
   
 
 /***************************************************************************//**
-
+  theGroupSpiller : The spiller for the tuples whose groups do not fit in
+                    theGroupMap, if a memory limit is set for group-by (see
+                    FlworState::theGroupSpiller).
 ********************************************************************************/
 class GroupByState : public PlanIteratorState 
 {
@@ -42,6 +46,7 @@ class GroupByState : public PlanIteratorState
 protected:
   GroupHashMap           * theGroupMap;
   GroupHashMap::iterator   theGroupMapIter;
+  GroupSpiller           * theGroupSpiller;
        
 public:
   GroupByState();
@@ -104,6 +109,16 @@ private:
         GroupByState* aGroupByState,
         PlanState& aPlanState) const;
 
+  void addGroupTuple(
+        GroupByState* aGroupByState,
+        std::unique_ptr<GroupTuple>& aGroupTuple,
+        std::vector<std::vector<store::Item_t> >& aValues,
+        PlanState& aPlanState) const;
+
+  bool nextGroupPartition(
+        GroupByState* aGroupByState,
+        PlanState& aPlanState) const;
+
   void bindGroupBy(
         GroupHashMap::iterator aGroupMapIter,
         GroupByState* aGroupByState,
@@ -0,0 +1,406 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include "runtime/core/gflwor/groupby_spill.h"
+
+#include "zorbaserialization/bin_archiver.h"
+#include "zorbaserialization/serialize_basic_types.h"
+#include "zorbaserialization/serialize_template_types.h"
+#include "zorbaserialization/serialize_zorba_types.h"
+
+#include "diagnostics/assert.h"
+#include "diagnostics/xquery_diagnostics.h"
+
+#include "util/fs_util.h"
+#include "util/mem_sizeof.h"
+
+
+namespace zorba
+{
+
+namespace flwor
+{
+
+/*******************************************************************************
+  Check whether all the items of a tuple are atomic, so that the tuple can be
+  written to a partition file without losing anything.
+********************************************************************************/
+static bool is_spillable(const GroupSpiller::Tuple* tuple)
+{
+  for (csize i = 0; i < tuple->theKey.size(); ++i)
+  {
+    if (tuple->theKey[i] != NULL && !tuple->theKey[i]->isAtomic())
+      return false;
+  }
+
+  for (csize i = 0; i < tuple->theColumns.size(); ++i)
+  {
+    const GroupSpiller::Column& column = tuple->theColumns[i];
+
+    for (csize j = 0; j < column.size(); ++j)
+    {
+      if (column[j] != NULL && !column[j]->isAtomic())
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+/*******************************************************************************
+  The tuples of one hash partition. The tuples in theFile come before the ones
+  in theBuffer. While writing, theBuffer holds the tuples added since the last
+  block was written; while reading, the tuples of the block being read, or, at
+  the end, the in-memory tail.
+
+  theCanSpill : False if a tuple with a non-atomic item has been added.
+  theNumBlocks: The number of blocks in theFile that have not been read yet.
+********************************************************************************/
+class GroupSpiller::Partition
+{
+protected:
+  zstring               thePath;
+  std::ofstream         theOutStream;
+  std::ifstream         theInStream;
+  std::vector<Tuple*>   theBuffer;
+  csize                 theBufferPos;
+  std::vector<Tuple*>   theTail;
+  csize                 theNumBlocks;
+  bool                  theCanSpill;
+
+public:
+  Partition()
+    :
+    theBufferPos(0),
+    theNumBlocks(0),
+#ifdef ZORBA_WITH_FILE_ACCESS
+    theCanSpill(true)
+#else
+    theCanSpill(false)
+#endif
+  {
+  }
+
+  ~Partition()
+  {
+    for (; theBufferPos < theBuffer.size(); ++theBufferPos)
+      delete theBuffer[theBufferPos];
+
+    for (csize i = 0; i < theTail.size(); ++i)
+      delete theTail[i];
+
+    if (theOutStream.is_open())
+      theOutStream.close();
+
+    if (theInStream.is_open())
+      theInStream.close();
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+    if (!thePath.empty())
+      fs::remove(thePath, true);
+#endif
+  }
+
+  void add(Tuple* tuple);
+
+  void finish();
+
+  Tuple* next();
+
+protected:
+  void writeBlock();
+
+  bool readBlock();
+};
+
+
+void GroupSpiller::Partition::add(Tuple* tuple)
+{
+  if (theCanSpill && !is_spillable(tuple))
+    theCanSpill = false;
+
+  if (!theCanSpill)
+  {
+    theTail.push_back(tuple);
+    return;
+  }
+
+  theBuffer.push_back(tuple);
+
+  if (theBuffer.size() >= BLOCK_SIZE)
+    writeBlock();
+}
+
+
+/*******************************************************************************
+  Append the buffered tuples to the partition file, as one block, and empty
+  the buffer. See ExternalSorter::FileRun for the block layout.
+********************************************************************************/
+void GroupSpiller::Partition::writeBlock()
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  if (thePath.empty())
+  {
+    thePath = fs::get_temp_file();
+    theOutStream.open(thePath.c_str(), std::ios::out | std::ios::binary);
+  }
+
+  csize numTuples = theBuffer.size();
+
+  std::ostringstream block;
+  {
+    serialization::BinArchiver ar(&block);
+
+    ar & numTuples;
+
+    for (csize i = 0; i < numTuples; ++i)
+    {
+      ar & theBuffer[i]->theKey;
+      ar & theBuffer[i]->theColumns;
+    }
+
+    ar.serialize_out();
+  }
+
+  std::string data = block.str();
+  uint64_t size = data.size();
+
+  theOutStream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  theOutStream.write(data.data(), data.size());
+
+  if (theOutStream.fail())
+  {
+    throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+    ERROR_PARAMS("could not write group-by partition " + thePath));
+  }
+
+  for (csize i = 0; i < numTuples; ++i)
+    delete theBuffer[i];
+
+  theBuffer.clear();
+  ++theNumBlocks;
+#endif
+}
+
+
+/*******************************************************************************
+  Switch the partition from writing to reading.
+********************************************************************************/
+void GroupSpiller::Partition::finish()
+{
+  // The buffered tuples precede the tail, so they go to the tail's front
+  // instead of being written to the file.
+  theTail.insert(theTail.begin(), theBuffer.begin(), theBuffer.end());
+  theBuffer.clear();
+
+  if (theOutStream.is_open())
+  {
+    theOutStream.close();
+
+    theInStream.open(thePath.c_str(), std::ios::in | std::ios::binary);
+
+    if (!theInStream.is_open())
+    {
+      throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+      ERROR_PARAMS("could not open group-by partition " + thePath));
+    }
+  }
+}
+
+
+bool GroupSpiller::Partition::readBlock()
+{
+  theBuffer.clear();
+  theBufferPos = 0;
+
+  if (theNumBlocks == 0)
+    return false;
+
+  --theNumBlocks;
+
+  uint64_t size;
+  theInStream.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+  std::string data(size, '\0');
+  theInStream.read(&data[0], size);
+
+  if ((uint64_t)theInStream.gcount() != size)
+  {
+    throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+    ERROR_PARAMS("truncated group-by partition " + thePath));
+  }
+
+  std::istringstream block(data);
+  serialization::BinArchiver ar(&block);
+
+  csize numTuples;
+  ar & numTuples;
+
+  theBuffer.reserve(numTuples);
+
+  for (csize i = 0; i < numTuples; ++i)
+  {
+    std::unique_ptr<Tuple> tuple(new Tuple);
+
+    ar & tuple->theKey;
+    ar & tuple->theColumns;
+
+    theBuffer.push_back(tuple.release());
+  }
+
+  ar.finalize_input_serialization();
+
+  return !theBuffer.empty();
+}
+
+
+GroupSpiller::Tuple* GroupSpiller::Partition::next()
+{
+  if (theBufferPos == theBuffer.size())
+  {
+    if (!readBlock())
+    {
+      // The file is exhausted: continue with the in-memory tail.
+      theBuffer.swap(theTail);
+      theBufferPos = 0;
+
+      if (theBuffer.empty())
+        return NULL;
+    }
+  }
+
+  return theBuffer[theBufferPos++];
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                                                             //
+//  GroupSpiller                                                               //
+//                                                                             //
+/////////////////////////////////////////////////////////////////////////////////
+
+
+size_t GroupSpiller::size_of(const std::vector<store::Item_t>& items)
+{
+  size_t size = sizeof(store::Item_t) * items.size();
+
+  for (csize i = 0; i < items.size(); ++i)
+  {
+    if (items[i] != NULL)
+      size += ztd::mem_sizeof(*items[i]);
+  }
+
+  return size;
+}
+
+
+GroupSpiller::GroupSpiller(size_t memoryLimit)
+  :
+  theMemoryLimit(memoryLimit),
+  theMemorySize(0),
+  theIsSpilling(false),
+  thePartitions(NUM_PARTITIONS, NULL),
+  theIsReading(false),
+  theCurPartition(0)
+{
+}
+
+
+GroupSpiller::~GroupSpiller()
+{
+  for (csize i = 0; i < thePartitions.size(); ++i)
+    delete thePartitions[i];
+}
+
+
+void GroupSpiller::addMemory(size_t size)
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  theMemorySize += size;
+
+  if (theMemoryLimit > 0 && theMemorySize > theMemoryLimit)
+    theIsSpilling = true;
+#endif
+}
+
+
+void GroupSpiller::add(uint32_t hash, Tuple* tuple)
+{
+  ZORBA_ASSERT(isSpilling());
+
+  // The low bits of the hash code also select the bucket of the group map,
+  // so mix the high bits in before picking a partition.
+  hash ^= (hash >> 16);
+  hash *= 0x45d9f3b;
+  hash ^= (hash >> 16);
+
+  Partition*& partition = thePartitions[hash % NUM_PARTITIONS];
+
+  if (partition == NULL)
+    partition = new Partition;
+
+  partition->add(tuple);
+}
+
+
+bool GroupSpiller::nextPartition()
+{
+  if (!theIsReading)
+  {
+    theIsReading = true;
+    theCurPartition = 0;
+  }
+  else if (theCurPartition < NUM_PARTITIONS)
+  {
+    delete thePartitions[theCurPartition];
+    thePartitions[theCurPartition] = NULL;
+    ++theCurPartition;
+  }
+
+  while (theCurPartition < NUM_PARTITIONS && thePartitions[theCurPartition] == NULL)
+    ++theCurPartition;
+
+  if (theCurPartition == NUM_PARTITIONS)
+    return false;
+
+  thePartitions[theCurPartition]->finish();
+  return true;
+}
+
+
+GroupSpiller::Tuple* GroupSpiller::next()
+{
+  ZORBA_ASSERT(theIsReading && theCurPartition < NUM_PARTITIONS);
+
+  return thePartitions[theCurPartition]->next();
+}
+
+
+} // namespace flwor
+} // namespace zorba
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_RUNTIME_GFLWOR_GROUPBY_SPILL
+#define ZORBA_RUNTIME_GFLWOR_GROUPBY_SPILL
+
+#include <vector>
+
+#include "common/shared_types.h"
+
+#include "store/api/item.h"
+
+
+namespace zorba
+{
+
+namespace flwor
+{
+
+/***************************************************************************//**
+  Spills the input tuples of a group-by clause to disk, once the groups kept
+  in memory exceed a given memory budget.
+
+  The user of the spiller reports the memory used by its in-memory groups via
+  addMemory(). While the total is within theMemoryLimit, the spiller is idle
+  and all groups are built in memory. After that, isSpilling() returns true,
+  and every input tuple that does not belong to a group that is already in
+  memory must be given to add() instead of starting a new group. Such a tuple
+  consists of the values of the grouping vars (its key) and the values of the
+  non-grouping vars (its columns). add() assigns the tuple to one of
+  NUM_PARTITIONS partitions, based on the hash of its key, so all the tuples of
+  a group end up in the same partition, in input order.
+
+  When the input is exhausted and the in-memory groups have been consumed,
+  nextPartition() and next() return the tuples of each non-empty partition in
+  turn, so that the groups of one partition at a time can be rebuilt in memory.
+  The tuples of a partition are not spilled again, even if its groups exceed
+  the memory budget.
+
+  Each partition buffers up to BLOCK_SIZE tuples in memory and then appends
+  them to its temp file, as a block with the same layout as the run files of
+  ExternalSorter. As in ExternalSorter, only tuples whose items are all atomic
+  can be written to disk. After a tuple with a non-atomic item has been added
+  to a partition, all the remaining tuples of that partition are kept in
+  memory, after the ones already written to its file.
+
+  theMemoryLimit : Approximate max number of bytes used by the in-memory groups.
+  theMemorySize  : The estimated memory size of the in-memory groups.
+  theIsSpilling  : Whether the memory budget has been exceeded.
+  thePartitions  : The partitions (NULL for partitions that got no tuple).
+  theIsReading   : Whether nextPartition() has been called.
+  theCurPartition: The position in thePartitions of the partition being read.
+********************************************************************************/
+class GroupSpiller
+{
+public:
+  static const csize NUM_PARTITIONS = 16;
+  static const csize BLOCK_SIZE = 1024;
+
+  typedef std::vector<store::Item_t> Column;
+
+  class Tuple
+  {
+  public:
+    std::vector<store::Item_t>  theKey;
+    std::vector<Column>         theColumns;
+  };
+
+  class Partition;
+
+protected:
+  size_t                   theMemoryLimit;
+  size_t                   theMemorySize;
+  bool                     theIsSpilling;
+  std::vector<Partition*>  thePartitions;
+  bool                     theIsReading;
+  csize                    theCurPartition;
+
+public:
+  GroupSpiller(size_t memoryLimit);
+
+  ~GroupSpiller();
+
+  /**
+   * Accounts for size more bytes used by the in-memory groups. Starts spilling
+   * if the memory budget is exceeded.
+   */
+  void addMemory(size_t size);
+
+  /**
+   * Whether new groups must be spilled via add(). Always false once the
+   * partitions are being read.
+   */
+  bool isSpilling() const
+  {
+    return theIsSpilling && !theIsReading;
+  }
+
+  /**
+   * Adds the given tuple, whose key has the given hash code, to the spiller,
+   * which takes over its ownership.
+   */
+  void add(uint32_t hash, Tuple* tuple);
+
+  /**
+   * Moves to the next non-empty partition. Returns false if there are no
+   * more partitions.
+   */
+  bool nextPartition();
+
+  /**
+   * Returns the next tuple of the current partition, or NULL if there are no
+   * more tuples in it. The caller takes over the ownership of the tuple.
+   */
+  Tuple* next();
+
+  /**
+   * Returns an estimate of the memory used by the given items.
+   */
+  static size_t size_of(const std::vector<store::Item_t>& items);
+
+private:
+  GroupSpiller(const GroupSpiller&);
+  void operator=(const GroupSpiller&);
+};
+
+
+} // namespace flwor
+} // namespace zorba
+
+#endif /* ZORBA_RUNTIME_GFLWOR_GROUPBY_SPILL */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
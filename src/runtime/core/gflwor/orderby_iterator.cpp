@@ -33,6 +33,9 @@
 #include "runtime/core/gflwor/orderby_iterator.h"
 #include "runtime/core/gflwor/common.h"
 #include "runtime/core/gflwor/comp_function.h"
+#include "runtime/core/gflwor/external_sort.h"
+
+#include <zorba/properties.h>
 
 #include <vector>
 #include <algorithm>
@@ -126,7 +129,10 @@ void OrderSpec::close(PlanState& aPlanState) const
 OrderByState::OrderByState() 
   :
   theNumTuples(0),
-  theCurTuplePos(0)
+  theCurTuplePos(0),
+  theSorter(NULL),
+  theTopK(0),
+  theTopKNextSeqNo(0)
 {
 }
 
@@ -134,6 +140,7 @@ OrderByState::OrderByState()
 OrderByState::~OrderByState() 
 {
   clearSortTable();
+  delete theSorter;
 }
 
 
@@ -143,6 +150,9 @@ void OrderByState::init(PlanState& planState, std::vector<OrderSpec>* orderSpecs
 
   theNumTuples = 0;
   theCurTuplePos = 0;
+  theSorter = NULL;
+  theTopK = 0;
+  theTopKNextSeqNo = 0;
 }
 
 
@@ -154,6 +164,13 @@ void OrderByState::reset(PlanState& planState)
   theDataTable.clear();
   theNumTuples = 0;
   theCurTuplePos = 0;
+
+  delete theSorter;
+  theSorter = NULL;
+
+  theTopK = 0;
+  theTopKSeqNos.clear();
+  theTopKNextSeqNo = 0;
 }
 
 
@@ -321,6 +338,21 @@ void OrderByIterator::closeImpl(PlanState& planState)
 
   StateTraitsImpl<OrderByState>::destroyState(planState, theStateOffset);
 }
+
+
+/*******************************************************************************
+  The consumer needs at most maxItems tuples, so keep only the first maxItems
+  tuples in sort order.
+********************************************************************************/
+void OrderByIterator::setMaxItemsImpl(csize maxItems, PlanState& planState) const
+{
+  if (maxItems == 0)
+    return;
+
+  OrderByState* iterState = StateTraitsImpl<OrderByState>::getState(planState,
+                                                                    theStateOffset);
+  iterState->theTopK = maxItems;
+}
   
   
 
@@ -329,41 +361,76 @@ bool OrderByIterator::nextImpl(store::Item_t& result, PlanState& planState) cons
   OrderByState* iterState;
   DEFAULT_STACK_INIT(OrderByState, iterState, planState);
 
-  while (consumeNext(result, theTupleIter, planState)) 
+  if (Properties::instance().getSortMemoryLimit() > 0 && iterState->theTopK == 0)
   {
-    materializeResultForSort(iterState, planState);
-  }
+    {
+      SortTupleCmp cmp(loc,
+                       planState.theLocalDynCtx,
+                       theSctx->get_typemanager(),
+                       &theOrderSpecs);
 
-  {
-    SortTupleCmp cmp(loc,
-                     planState.theLocalDynCtx,
-                     theSctx->get_typemanager(),
-                     &theOrderSpecs);
+      iterState->theSorter =
+      new ExternalSorter(cmp, theStable, Properties::instance().getSortMemoryLimit());
+    }
 
-    if (theStable)
+    while (consumeNext(result, theTupleIter, planState)) 
     {
-      std::stable_sort(iterState->theSortTable.begin(),
-                       iterState->theSortTable.end(),
-                       cmp);
+      materializeResultForExternalSort(iterState, planState);
     }
-    else
+
+    iterState->theSorter->sort();
+
+    while (bindNextExternalSortTuple(iterState, planState))
     {
-      std::sort(iterState->theSortTable.begin(),
-                iterState->theSortTable.end(),
-                cmp);
+      STACK_PUSH(true, iterState);
     }
   }
+  else
+  {
+    while (consumeNext(result, theTupleIter, planState)) 
+    {
+      materializeResultForSort(iterState, planState);
+    }
 
-  iterState->theCurTuplePos = 0;
-  iterState->theNumTuples = (ulong)iterState->theSortTable.size();
+    {
+      SortTupleCmp cmp(loc,
+                       planState.theLocalDynCtx,
+                       theSctx->get_typemanager(),
+                       &theOrderSpecs);
 
-  while(iterState->theCurTuplePos < iterState->theNumTuples)
-  {
-    bindOrderBy(iterState, planState);
+      if (iterState->theTopK > 0)
+      {
+        TopKSortTupleCmp topKCmp(cmp, iterState->theTopKSeqNos);
+
+        std::sort_heap(iterState->theSortTable.begin(),
+                       iterState->theSortTable.end(),
+                       topKCmp);
+      }
+      else if (theStable)
+      {
+        std::stable_sort(iterState->theSortTable.begin(),
+                         iterState->theSortTable.end(),
+                         cmp);
+      }
+      else
+      {
+        std::sort(iterState->theSortTable.begin(),
+                  iterState->theSortTable.end(),
+                  cmp);
+      }
+    }
+
+    iterState->theCurTuplePos = 0;
+    iterState->theNumTuples = (ulong)iterState->theSortTable.size();
+
+    while(iterState->theCurTuplePos < iterState->theNumTuples)
+    {
+      bindOrderBy(iterState, planState);
 
-    STACK_PUSH(true, iterState);
+      STACK_PUSH(true, iterState);
 
-    ++(iterState->theCurTuplePos);
+      ++(iterState->theCurTuplePos);
+    }
   }
 
   STACK_PUSH(false, iterState);
@@ -372,28 +439,15 @@ bool OrderByIterator::nextImpl(store::Item_t& result, PlanState& planState) cons
 
 
 /***************************************************************************//**
-  All FOR and LET vars are bound when this method is called. The method computes
-  the order-by tuple T and the return-clause sequence R for the current var
-  bindings. Then, it inserts the pair (T, I(R)) into theOrderMap (where I is
-  an iterator over the temp seq storing R).
+  Compute the values of the orderby keys for the current var bindings.
 ********************************************************************************/
-void OrderByIterator::materializeResultForSort( 
-    OrderByState* iterState,
-    PlanState& planState) const 
+void OrderByIterator::computeSortKey(
+    SortTuple::KeyValues& sortKey,
+    PlanState& planState) const
 {
-  OrderByState::SortTable& sortTable = iterState->theSortTable;
-  OrderByState::DataTable& dataTable = iterState->theDataTable;
-
-  csize numTuples = sortTable.size();
-  sortTable.resize(numTuples + 1);
-  dataTable.resize(numTuples + 1);
-
-  // Create the sort tuple
-
   csize numSpecs = theOrderSpecs.size();
 
-  std::vector<store::Item*>& sortKey = sortTable[numTuples].theKeyValues;
-  sortKey.resize(numSpecs);
+  SortTuple::initKeyValues(sortKey, numSpecs, planState);
 
   for (csize i = 0; i < numSpecs; ++i)
   {
@@ -416,15 +470,50 @@ void OrderByIterator::materializeResultForSort(
 
     theOrderSpecs[i].theDomainIter->reset(planState);
   }
+}
+
+
+/***************************************************************************//**
+  All FOR and LET vars are bound when this method is called. The method computes
+  the order-by tuple T and the return-clause sequence R for the current var
+  bindings. Then, it inserts the pair (T, I(R)) into theOrderMap (where I is
+  an iterator over the temp seq storing R).
+
+  In top-k mode, the tuple may be dropped instead (see materializeTopKSortTuple).
+********************************************************************************/
+void OrderByIterator::materializeResultForSort( 
+    OrderByState* iterState,
+    PlanState& planState) const 
+{
+  OrderByState::SortTable& sortTable = iterState->theSortTable;
+  OrderByState::DataTable& dataTable = iterState->theDataTable;
+
+  csize dataPos;
+
+  if (iterState->theTopK > 0)
+  {
+    if (!materializeTopKSortTuple(iterState, planState, dataPos))
+      return;
+  }
+  else
+  {
+    dataPos = sortTable.size();
+    sortTable.resize(dataPos + 1);
+    dataTable.resize(dataPos + 1);
+
+    // Create the sort tuple
+
+    computeSortKey(sortTable[dataPos].theKeyValues, planState);
   
-  sortTable[numTuples].theDataPos = numTuples;
+    sortTable[dataPos].theDataPos = dataPos;
+  }
 
   // create the data tuple
 
   csize numForVars = theInputForVars.size();
   csize numLetVars = theInputLetVars.size();
 
-  StreamTuple& streamTuple = dataTable[numTuples];
+  StreamTuple& streamTuple = dataTable[dataPos];
   streamTuple.theItems.resize(numForVars);
   streamTuple.theSequences.resize(numLetVars);
 
@@ -450,6 +539,109 @@ void OrderByIterator::materializeResultForSort(
 }
   
 
+/***************************************************************************//**
+  Compute the sort tuple for the current var bindings and insert it into
+  theSortTable, which is kept as a heap of at most theTopK sort tuples, with
+  the tuple that sorts last at the front. When the heap is full, the new tuple
+  is dropped (and false is returned) unless it sorts before the front tuple;
+  otherwise, it replaces the front tuple and takes over the slot of that tuple
+  in theDataTable. The slot of the new tuple is returned in dataPos.
+********************************************************************************/
+bool OrderByIterator::materializeTopKSortTuple(
+    OrderByState* iterState,
+    PlanState& planState,
+    csize& dataPos) const
+{
+  OrderByState::SortTable& sortTable = iterState->theSortTable;
+
+  SortTupleCmp cmp(loc,
+                   planState.theLocalDynCtx,
+                   theSctx->get_typemanager(),
+                   &theOrderSpecs);
+
+  TopKSortTupleCmp topKCmp(cmp, iterState->theTopKSeqNos);
+
+  SortTuple sortTuple;
+  computeSortKey(sortTuple.theKeyValues, planState);
+
+  if (sortTable.size() == iterState->theTopK)
+  {
+    // The new tuple comes after all the tuples in the heap in input order, so
+    // it must sort strictly before the front tuple in order to be kept.
+    if (!cmp(sortTuple, sortTable.front()))
+    {
+      sortTuple.clear();
+      return false;
+    }
+
+    std::pop_heap(sortTable.begin(), sortTable.end(), topKCmp);
+
+    dataPos = sortTable.back().theDataPos;
+    sortTable.back().clear();
+  }
+  else
+  {
+    dataPos = sortTable.size();
+    sortTable.resize(dataPos + 1);
+    iterState->theDataTable.resize(dataPos + 1);
+    iterState->theTopKSeqNos.resize(dataPos + 1);
+  }
+
+  sortTable.back().theKeyValues.swap(sortTuple.theKeyValues);
+  sortTable.back().theDataPos = dataPos;
+  iterState->theTopKSeqNos[dataPos] = iterState->theTopKNextSeqNo++;
+
+  std::push_heap(sortTable.begin(), sortTable.end(), topKCmp);
+
+  return true;
+}
+
+
+/***************************************************************************//**
+  Same as materializeResultForSort(), but the sort tuple and the values of the
+  FOR and LET vars are stored in a tuple of theSorter. The value of each var
+  becomes one column of the tuple.
+********************************************************************************/
+void OrderByIterator::materializeResultForExternalSort(
+    OrderByState* iterState,
+    PlanState& planState) const
+{
+  std::unique_ptr<ExternalSorter::Tuple> tuple(new ExternalSorter::Tuple);
+
+  computeSortKey(tuple->theSortTuple.theKeyValues, planState);
+
+  csize numForVars = theInputForVars.size();
+  csize numLetVars = theInputLetVars.size();
+
+  tuple->theColumns.resize(numForVars + numLetVars);
+
+  for (csize i = 0;  i < numForVars; ++i)
+  {
+    store::Item_t forItem;
+    consumeNext(forItem, theInputForVars[i], planState);
+
+    tuple->theColumns[i].push_back(forItem);
+
+    theInputForVars[i]->reset(planState);
+  }
+
+  for (csize i = 0; i < numLetVars; ++i)
+  {
+    ExternalSorter::Column& column = tuple->theColumns[numForVars + i];
+
+    store::Item_t letItem;
+    while (consumeNext(letItem, theInputLetVars[i], planState))
+    {
+      column.push_back(letItem);
+    }
+
+    theInputLetVars[i]->reset(planState);
+  }
+
+  iterState->theSorter->add(tuple.release());
+}
+  
+
 void OrderByIterator::bindOrderBy( 
     OrderByState* iterState,
     PlanState& planState) const 
@@ -469,6 +661,38 @@ void OrderByIterator::bindOrderBy(
     bindVariables(streamTuple.theSequences[i], theOutputLetVarsRefs[i], planState);
   }
 }
+
+
+/***************************************************************************//**
+  Get the next tuple from theSorter, if any, and bind its columns to the
+  references of the FOR and LET vars.
+********************************************************************************/
+bool OrderByIterator::bindNextExternalSortTuple(
+    OrderByState* iterState,
+    PlanState& planState) const
+{
+  ExternalSorter::Tuple* tuple = iterState->theSorter->next();
+
+  if (tuple == NULL)
+    return false;
+
+  csize numForVarsRefs = theOutputForVarsRefs.size();
+  for (csize i = 0; i < numForVarsRefs; ++i)
+  {
+    bindVariables(tuple->theColumns[i][0], theOutputForVarsRefs[i], planState);
+  }
+
+  csize numLetVarsRefs = theOutputLetVarsRefs.size();
+  for (csize i = 0; i < numLetVarsRefs; ++i)
+  {
+    store::TempSeq_t letTempSeq =
+    GENV_STORE.createTempSeq(tuple->theColumns[numForVarsRefs + i]);
+
+    bindVariables(letTempSeq, theOutputLetVarsRefs[i], planState);
+  }
+
+  return true;
+}
   
   
 } //Namespace flwor
@@ -33,6 +33,8 @@ class OrderByIterator;
 
 class OrderValue;
 
+class ExternalSorter;
+
 
 /***************************************************************************//**
   Wrapper for a OrderSpec.
@@ -111,11 +113,18 @@ public:
   For a simple flwor, the T data is an iterator I over a temp sequence that
   stores the result of the return clause computed for the current input-
   stream tuple.
+
+  The key values are allocated from the arena of the plan state (see
+  OrderByIterator::computeSortKey()), since an orderby clause creates one
+  SortTuple per input tuple and the SortTuples never outlive the plan.
 ********************************************************************************/
 class SortTuple
 {
 public:
-  std::vector<store::Item*>   theKeyValues;
+  typedef std::vector<store::Item*, ArenaAllocator<store::Item*> > KeyValues;
+
+public:
+  KeyValues                   theKeyValues;
   ulong                       theDataPos;
 
 public:
@@ -123,6 +132,24 @@ public:
 
   ~SortTuple() { }
 
+  /**
+   * Resizes the given key values to the given number of keys, moving them to
+   * the arena of the given plan state first if they are not there yet.
+   */
+  static void initKeyValues(
+      KeyValues& keyValues,
+      csize numKeys,
+      PlanState& planState)
+  {
+    if (keyValues.get_allocator().getArena() == NULL)
+    {
+      KeyValues(ArenaAllocator<store::Item*>(&planState.getArena())).
+      swap(keyValues);
+    }
+
+    keyValues.resize(numKeys);
+  }
+
   void clear()
   {
     csize numColumns = theKeyValues.size();
@@ -147,6 +174,15 @@ public:
   theCurTuplePos : A position inside theOrderMap. Used to return individual flwor
                    results after the full result set has been materialized and
                    sorted. 
+  theSorter      : Used instead of theSortTable and theDataTable if a sort
+                   memory limit is set (see Properties::setSortMemoryLimit()).
+                   The tuples are then spilled to disk as needed.
+  theTopK        : If > 0, the consumer needs at most theTopK tuples (see
+                   OrderByIterator::setMaxItemsImpl()). Then, theSortTable is
+                   a heap of the best theTopK sort tuples seen so far.
+  theTopKSeqNos  : In top-k mode, the input position of the tuple that currently
+                   occupies each slot of theDataTable.
+  theTopKNextSeqNo : In top-k mode, the input position of the next tuple.
 ********************************************************************************/
 class OrderByState : public PlanIteratorState 
 {
@@ -162,6 +198,12 @@ protected:
   ulong        theNumTuples;
   ulong        theCurTuplePos;
 
+  ExternalSorter * theSorter;
+
+  csize              theTopK;
+  std::vector<csize> theTopKSeqNos;
+  csize              theTopKNextSeqNo;
+
 public:
   OrderByState();
 
@@ -215,6 +257,8 @@ public:
   bool nextImpl(store::Item_t& result, PlanState& planState) const;
   void resetImpl(PlanState& planState) const;
   void closeImpl(PlanState& planState);
+
+  void setMaxItemsImpl(csize maxItems, PlanState& planState) const;
   
   zstring getNameAsString() const;
 
@@ -224,13 +268,30 @@ public:
   virtual void accept(PlanIterVisitor&) const;
 
 private:
+  void computeSortKey(
+        SortTuple::KeyValues& sortKey,
+        PlanState& planState) const;
+
   void materializeResultForSort(
         OrderByState* iterState,
         PlanState& planState) const;
 
+  bool materializeTopKSortTuple(
+        OrderByState* iterState,
+        PlanState& planState,
+        csize& dataPos) const;
+
+  void materializeResultForExternalSort(
+        OrderByState* iterState,
+        PlanState& planState) const;
+
   void bindOrderBy(
         OrderByState* iterState,
         PlanState& planState) const;
+
+  bool bindNextExternalSortTuple(
+        OrderByState* iterState,
+        PlanState& planState) const;
 };
 
 
@@ -49,7 +49,8 @@ TupleStreamIterator::TupleStreamIterator(
                                                              aLoc,
                                                              aTupleIter,
                                                              aReturnIter),
-  theIsUpdating(aIsUpdating) 
+  theIsUpdating(aIsUpdating),
+  theTopKSort(false)
 {
 }
 
@@ -102,6 +103,15 @@ bool TupleStreamIterator::nextImpl(store::Item_t& aResult, PlanState& aPlanState
 }
 
 
+void TupleStreamIterator::setMaxItemsImpl(
+    csize maxItems,
+    PlanState& aPlanState) const
+{
+  if (theTopKSort)
+    theChild0->setMaxItems(maxItems, aPlanState);
+}
+
+
 BINARY_ACCEPT(TupleStreamIterator);
 
   
@@ -36,7 +36,11 @@ class TupleStreamIterator : public BinaryBaseIterator<TupleStreamIterator,
 private:
   //theChild0 == TupleClause
   //theChild1 == ReturnClause
+  //theTopKSort == true if the return clause returns at least one item for
+  //every tuple. Then, a bound on the number of items needed by the consumer
+  //is also a bound on the number of tuples needed from the TupleClause.
   bool        theIsUpdating;
+  bool        theTopKSort;
         
 public:
   SERIALIZABLE_CLASS(TupleStreamIterator);
@@ -51,6 +55,7 @@ public:
     (BinaryBaseIterator<TupleStreamIterator, PlanIteratorState>*)this);
 
     ar & theIsUpdating;
+    ar & theTopKSort;
   }
 
 public:
@@ -65,6 +70,10 @@ public:
   
   virtual bool isUpdating() const { return theIsUpdating; }
 
+  void setTopKSort() { theTopKSort = !theIsUpdating; }
+
+  void setMaxItemsImpl(csize maxItems, PlanState& planState) const;
+
   void accept(PlanIterVisitor& v) const;
 
   zstring getNameAsString() const;
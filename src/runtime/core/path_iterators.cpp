@@ -1124,6 +1124,7 @@ void ChildAxisState::init(PlanState& planState)
   AxisState::init(planState);
 
   theChildren = GENV_ITERATOR_FACTORY->createChildrenIterator();
+  theChildrenOpened = false;
 }
 
 
@@ -1133,6 +1134,8 @@ void ChildAxisState::reset(PlanState& planState)
 
   if (theChildren != NULL)
     theChildren->reset();
+
+  theChildrenOpened = false;
 }
 
 
@@ -1200,6 +1203,82 @@ bool ChildAxisIterator::nextImpl(store::Item_t& result, PlanState& planState) co
 }
 
 
+/*******************************************************************************
+  Batched version of nextImpl(). Instead of suspending the duff's device after
+  every child, it keeps the children iterator of the current context node open
+  across calls (theChildrenOpened) and fills the batch in a tight loop. If the
+  item-at-a-time protocol has already been started, it falls back to the
+  default adapter.
+********************************************************************************/
+bool ChildAxisIterator::nextBatchImpl(
+    std::vector<store::Item_t>& result,
+    csize maxItems,
+    PlanState& planState) const
+{
+  const store::Item* child = NULL;
+
+  ChildAxisState* state =
+  StateTraitsImpl<ChildAxisState>::getState(planState, theStateOffset);
+
+  if (state->getDuffsLine() != PlanIteratorState::DUFFS_ALLOCATE_RESOURCES)
+    return PlanIterator::nextBatchImpl(result, maxItems, planState);
+
+  csize numItems = 0;
+
+  while (numItems < maxItems)
+  {
+    if (!state->theChildrenOpened)
+    {
+      do
+      {
+        if (!consumeNext(state->theContextNode, theChild.getp(), planState))
+          return false;
+
+        if (!state->theContextNode->isNode())
+        {
+          throw XQUERY_EXCEPTION(err::XPTY0020, ERROR_LOC(loc));
+        }
+      }
+      while (!isElementOrDocumentNode(state->theContextNode.getp()));
+
+      state->theCurrentPos = 0;
+      state->theChildren->init(state->theContextNode);
+      state->theChildren->open();
+      state->theChildrenOpened = true;
+    }
+
+    while (numItems < maxItems && (child = state->theChildren->next()) != NULL)
+    {
+      if (nameOrKindTest(theSctx, child, loc))
+      {
+        if (theTargetPos >= 0)
+        {
+          if (state->theCurrentPos++ == theTargetPos)
+          {
+            result.push_back(const_cast<store::Item*>(child));
+            ++numItems;
+            break;
+          }
+        }
+        else
+        {
+          result.push_back(const_cast<store::Item*>(child));
+          ++numItems;
+        }
+      }
+    }
+
+    if (child == NULL || (theTargetPos >= 0 && state->theCurrentPos > theTargetPos))
+    {
+      state->theChildren->close();
+      state->theChildrenOpened = false;
+    }
+  }
+
+  return true;
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
@@ -1224,6 +1303,8 @@ void DescendantAxisState::reset(PlanState& planState)
   AxisState::reset(planState);
 
   clear();
+
+  theIndexedDescendants = NULL;
 }
 
 
@@ -1282,6 +1363,41 @@ bool DescendantAxisIterator::nextImpl(store::Item_t& result, PlanState& planStat
 
     state->theCurrentPos = 0;
 
+    // If the store can list the elements with the wanted name directly, there
+    // is no need to walk the subtree of the context node.
+    if (theTestKind == match_name_test &&
+        theWildKind == match_no_wild &&
+        theNodeKind == store::StoreConsts::elementNode)
+    {
+      state->theIndexedDescendants =
+      state->theContextNode->getDescendantElements(theQName.getp());
+    }
+
+    if (state->theIndexedDescendants != NULL)
+    {
+      state->theIndexedDescendants->open();
+
+      while (state->theIndexedDescendants->next(result))
+      {
+        if (theTargetPos >= 0)
+        {
+          if (state->theCurrentPos++ == theTargetPos)
+          {
+            STACK_PUSH(true, state);
+            break;
+          }
+        }
+        else
+        {
+          STACK_PUSH(true, state);
+        }
+      }
+
+      state->theIndexedDescendants->close();
+      state->theIndexedDescendants = NULL;
+      continue;
+    }
+
     state->push(state->theContextNode);
 
     desc = state->top()->next();
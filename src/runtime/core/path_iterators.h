@@ -578,8 +578,9 @@ class ChildAxisState : public AxisState
 {
 public:
   rchandle<store::ChildrenIterator>  theChildren;
+  bool                               theChildrenOpened;
 
-  ChildAxisState() {}
+  ChildAxisState() : theChildrenOpened(false) {}
 
   ~ChildAxisState() {}
 
@@ -613,6 +614,11 @@ public:
   zstring getNameAsString() const;
 
   bool nextImpl(store::Item_t& result, PlanState& planState) const;
+
+  bool nextBatchImpl(
+      std::vector<store::Item_t>& result,
+      csize maxItems,
+      PlanState& planState) const;
 };
 
 
@@ -628,6 +634,8 @@ public:
   ulong                 theTop;
   std::vector<PathPair> theCurrentPath;
 
+  store::Iterator_t     theIndexedDescendants;
+
 public:
   DescendantAxisState() : theTop(0) {}
 
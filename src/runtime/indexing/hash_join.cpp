@@ -0,0 +1,165 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include "runtime/indexing/hash_join.h"
+
+#include "store/api/item.h"
+
+#include "diagnostics/assert.h"
+
+namespace zorba
+{
+
+const csize HashJoinTable::PARTITION_SIZE = 16384;
+
+
+/*******************************************************************************
+
+********************************************************************************/
+HashJoinTable::HashJoinTable(long timezone, XQPCollator* collator)
+  :
+  theCompareFunction(timezone, collator),
+  thePartitionBits(0)
+{
+}
+
+
+HashJoinTable::~HashJoinTable()
+{
+  for (csize i = 0; i < thePartitions.size(); ++i)
+    delete thePartitions[i];
+}
+
+
+/*******************************************************************************
+  Adds an entry to the table. Must be called before build(). Takes over the
+  given key and item.
+********************************************************************************/
+void HashJoinTable::insert(store::Item_t& key, store::Item_t& item)
+{
+  ZORBA_ASSERT(thePartitions.empty());
+
+  theEntries.push_back(Entry());
+
+  Entry& entry = theEntries.back();
+  entry.theHash = theCompareFunction.hash(key.getp());
+  entry.theKey.transfer(key);
+  entry.theItem.transfer(item);
+}
+
+
+/*******************************************************************************
+  Builds the hash maps of the table, once all its entries have been inserted.
+********************************************************************************/
+void HashJoinTable::build()
+{
+  csize numEntries = theEntries.size();
+  csize numPartitions = 1;
+
+  while (numEntries / numPartitions > PARTITION_SIZE && thePartitionBits < 16)
+  {
+    numPartitions <<= 1;
+    ++thePartitionBits;
+  }
+
+  // Compute the position of the first entry of each partition.
+  std::vector<csize> starts(numPartitions + 1, 0);
+
+  for (csize i = 0; i < numEntries; ++i)
+    ++starts[partition(theEntries[i].theHash) + 1];
+
+  for (csize p = 0; p < numPartitions; ++p)
+    starts[p + 1] += starts[p];
+
+  // Cluster the entries by partition, keeping their order within each one.
+  if (numPartitions > 1)
+  {
+    std::vector<csize> positions(starts.begin(), starts.end() - 1);
+    std::vector<Entry> clustered(numEntries);
+
+    for (csize i = 0; i < numEntries; ++i)
+    {
+      Entry& entry = theEntries[i];
+      Entry& target = clustered[positions[partition(entry.theHash)]++];
+
+      target.theKey.transfer(entry.theKey);
+      target.theItem.transfer(entry.theItem);
+      target.theHash = entry.theHash;
+    }
+
+    theEntries.swap(clustered);
+  }
+
+  theFilter.init(numEntries);
+
+  if (theFilter.isEnabled())
+  {
+    for (csize i = 0; i < numEntries; ++i)
+      theFilter.insert(theEntries[i].theHash);
+  }
+
+  thePartitions.resize(numPartitions);
+
+  for (csize p = 0; p < numPartitions; ++p)
+  {
+    csize start = starts[p];
+    csize stop = starts[p + 1];
+
+    PartitionMap* map = new PartitionMap(theCompareFunction, stop - start, false);
+    thePartitions[p] = map;
+
+    for (csize i = start; i < stop; ++i)
+    {
+      Entry& entry = theEntries[i];
+      entry.theNext = numEntries;
+
+      Chain chain;
+      chain.theFirst = chain.theLast = i;
+
+      if (!map->insert(entry.theKey.getp(), chain))
+      {
+        theEntries[chain.theLast].theNext = i;
+        chain.theLast = i;
+        map->update(entry.theKey.getp(), chain);
+      }
+    }
+  }
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+csize HashJoinTable::find(const store::Item* key) const
+{
+  uint32_t hash = theCompareFunction.hash(key);
+
+  if (!theFilter.mayContain(hash))
+    return end();
+
+  Chain chain;
+  store::Item* k = const_cast<store::Item*>(key);
+
+  if (thePartitions[partition(hash)]->get(k, chain))
+    return chain.theFirst;
+
+  return end();
+}
+
+
+}
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_RUNTIME_INDEXING_HASH_JOIN_H
+#define ZORBA_RUNTIME_INDEXING_HASH_JOIN_H
+
+#include <vector>
+
+#include "common/shared_types.h"
+
+#include "zorbautils/bloom_filter.h"
+#include "zorbautils/hashmap_itemh.h"
+
+#include "zorbatypes/rchandle.h"
+
+namespace zorba
+{
+
+/*******************************************************************************
+  The table built by a hash join (see CreateHashJoinIterator) over the inner
+  side of a value equi-join, and probed with the keys of the outer side (see
+  ProbeHashJoinIterator). It maps each key to the items of the inner side that
+  have that key, in the order in which they were inserted. Items without a key
+  are not inserted, since they cannot be equal to anything.
+
+  theEntries:
+  -----------
+  The (key, item) pairs of the table. The entries with the same key are linked
+  into a chain through their theNext field, so the table allocates no memory
+  per entry and no memory per key besides the hash maps.
+
+  thePartitions:
+  --------------
+  The hash maps mapping each key to the first and the last entry of its chain.
+  A table with up to PARTITION_SIZE entries has a single map. Larger tables
+  are partitioned, as in a grace hash join, on the high-order bits of the key
+  hashes: their entries are clustered by partition and each partition gets its
+  own map, so a probe only touches a small map and a chain of entries that are
+  close to each other in memory. Since the whole table is in memory, the
+  partitions are never spilled to disk.
+
+  theFilter:
+  ----------
+  A Bloom filter over the key hashes of a large table, which rejects most of
+  the probes with keys that are not in the table before they reach its maps.
+********************************************************************************/
+class HashJoinTable : public SimpleRCObject
+{
+public:
+  static const csize PARTITION_SIZE;
+
+protected:
+  struct Entry
+  {
+    store::Item_t  theKey;
+    store::Item_t  theItem;
+    uint32_t       theHash;
+    csize          theNext;
+  };
+
+  struct Chain
+  {
+    csize          theFirst;
+    csize          theLast;
+  };
+
+  typedef HashMap<store::Item*, Chain, ItemHandleHashMapCmp> PartitionMap;
+
+protected:
+  ItemHandleHashMapCmp        theCompareFunction;
+
+  std::vector<Entry>          theEntries;
+
+  std::vector<PartitionMap*>  thePartitions;
+  unsigned int                thePartitionBits;
+
+  BloomFilter                 theFilter;
+
+public:
+  HashJoinTable(long timezone, XQPCollator* collator);
+
+  ~HashJoinTable();
+
+  void insert(store::Item_t& key, store::Item_t& item);
+
+  void build();
+
+  csize size() const { return theEntries.size(); }
+
+  csize numPartitions() const { return thePartitions.size(); }
+
+  /**
+   * Returns the position of the first entry with the given key, or end() if
+   * there is none.
+   */
+  csize find(const store::Item* key) const;
+
+  csize next(csize pos) const { return theEntries[pos].theNext; }
+
+  csize end() const { return theEntries.size(); }
+
+  const store::Item_t& getItem(csize pos) const { return theEntries[pos].theItem; }
+
+protected:
+  csize partition(uint32_t hash) const
+  {
+    return (thePartitionBits == 0 ? 0 : hash >> (32 - thePartitionBits));
+  }
+};
+
+
+}
+
+#endif
+/* vim:set et sw=2 ts=2: */
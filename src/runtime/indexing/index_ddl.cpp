@@ -15,8 +15,11 @@
  */
 #include "stdafx.h"
 
+#include <algorithm>
+
 #include "runtime/visitors/planiter_visitor.h"
 #include "runtime/indexing/index_ddl.h"
+#include "runtime/indexing/index_snapshot.h"
 #include "runtime/api/plan_wrapper.h"
 #include "runtime/api/plan_iterator_wrapper.h"
 
@@ -45,12 +48,27 @@
 #include "diagnostics/xquery_exception.h"
 #include "diagnostics/util_macros.h"
 
+#ifndef ZORBA_NO_FULL_TEXT
+#include "compiler/expression/ftnode.h"
+#include "runtime/full_text/ft_stop_words_set.h"
+#include "runtime/full_text/ft_util.h"
+#include "runtime/full_text/stemmer.h"
+#include "store/api/ft_token_iterator.h"
+#include <zorba/tokenizer.h>
+#endif
+
 namespace zorba {
 
 
 SERIALIZABLE_CLASS_VERSIONS(CreateInternalIndexIterator)
 DEF_GET_NAME_AS_STRING(CreateInternalIndexIterator)
 
+SERIALIZABLE_CLASS_VERSIONS(CreateHashJoinIterator)
+DEF_GET_NAME_AS_STRING(CreateHashJoinIterator)
+
+SERIALIZABLE_CLASS_VERSIONS(ProbeHashJoinIterator)
+DEF_GET_NAME_AS_STRING(ProbeHashJoinIterator)
+
 SERIALIZABLE_CLASS_VERSIONS(CreateIndexIterator)
 DEF_GET_NAME_AS_STRING(CreateIndexIterator)
 
@@ -78,6 +96,14 @@ DEF_GET_NAME_AS_STRING(ProbeIndexRangeValueIterator)
 SERIALIZABLE_CLASS_VERSIONS(ProbeIndexRangeGeneralIterator)
 DEF_GET_NAME_AS_STRING(ProbeIndexRangeGeneralIterator)
 
+#ifndef ZORBA_NO_FULL_TEXT
+SERIALIZABLE_CLASS_VERSIONS(FullTextIndexTokensIterator)
+DEF_GET_NAME_AS_STRING(FullTextIndexTokensIterator)
+
+SERIALIZABLE_CLASS_VERSIONS(ProbeIndexFullTextIterator)
+DEF_GET_NAME_AS_STRING(ProbeIndexFullTextIterator)
+#endif
+
 
 /*******************************************************************************
   This function is called from the probe function to chaeck that the type of
@@ -162,6 +188,29 @@ static void checkKeyType(
 }
 
 
+/*******************************************************************************
+  Counts the non-empty items in the given key column of the entries that
+  satisfy the condition the probe iterator has been initialized with.
+********************************************************************************/
+static void countKeyColumn(
+    const store::IndexProbeIterator_t& ite,
+    csize column,
+    store::Item_t& result)
+{
+  xs_integer count(0);
+  store::Item_t item;
+
+  ite->open();
+
+  while (ite->nextKeyColumn(item, column))
+    ++count;
+
+  ite->close();
+
+  GENV_ITEMFACTORY->createInteger(result, count);
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
@@ -266,6 +315,99 @@ void CreateInternalIndexIterator::accept(PlanIterVisitor& v) const
 }
 
 
+/*******************************************************************************
+  CreateHashJoinIterator
+********************************************************************************/
+
+CreateHashJoinIterator::~CreateHashJoinIterator() 
+{
+}
+
+
+bool CreateHashJoinIterator::nextImpl(
+    store::Item_t& result,
+    PlanState& planState) const
+{
+  store::Item_t item;
+  store::Item_t key;
+  HashJoinTable_t table;
+
+  PlanIteratorState* state;
+  DEFAULT_STACK_INIT(PlanIteratorState, state, planState);
+
+  table = new HashJoinTable(planState.theLocalDynCtx->get_implicit_timezone(),
+                            theSctx->get_default_collator(loc));
+
+  while (consumeNext(item, theChild, planState))
+  {
+    // The child returns each item followed by its key, which is NULL if the
+    // key expr returned the empty sequence (see ValueIndexEntryBuilderIterator).
+    if (!consumeNext(key, theChild, planState))
+      ZORBA_ASSERT(false);
+
+    if (key != NULL)
+      table->insert(key, item);
+  }
+
+  table->build();
+
+  planState.theLocalDynCtx->bindHashJoinTable(theQName.getp(), table);
+
+  STACK_END(state);
+}
+
+
+UNARY_ACCEPT(CreateHashJoinIterator)
+
+
+/*******************************************************************************
+  ProbeHashJoinIterator
+********************************************************************************/
+
+void ProbeHashJoinIteratorState::reset(PlanState& planState)
+{
+  PlanIteratorState::reset(planState);
+  theTable = NULL;
+}
+
+
+ProbeHashJoinIterator::~ProbeHashJoinIterator() 
+{
+}
+
+
+bool ProbeHashJoinIterator::nextImpl(
+    store::Item_t& result,
+    PlanState& planState) const
+{
+  store::Item_t key;
+
+  ProbeHashJoinIteratorState* state;
+  DEFAULT_STACK_INIT(ProbeHashJoinIteratorState, state, planState);
+
+  if (consumeNext(key, theChild, planState))
+  {
+    state->theTable = planState.theLocalDynCtx->getHashJoinTable(theQName.getp());
+    ZORBA_ASSERT(state->theTable != NULL);
+
+    for (state->thePos = state->theTable->find(key.getp());
+         state->thePos != state->theTable->end();
+         state->thePos = state->theTable->next(state->thePos))
+    {
+      result = state->theTable->getItem(state->thePos);
+      STACK_PUSH(true, state);
+    }
+
+    state->theTable = NULL;
+  }
+
+  STACK_END(state);
+}
+
+
+UNARY_ACCEPT(ProbeHashJoinIterator)
+
+
 /*******************************************************************************
   CreateIndexIterator
 ********************************************************************************/
@@ -307,6 +449,9 @@ bool CreateIndexIterator::nextImpl(store::Item_t& result, PlanState& planState)
   
   planWrapper = new PlanWrapper(buildPlan, ccb, NULL, NULL, 0, false, 0); 
 
+  if (IndexSnapshotIterator::isEnabled())
+    planWrapper = new IndexSnapshotIterator(indexDecl, buildPlan, planWrapper, ccb);
+
   createIndexSpec(indexDecl, planState.theLocalDynCtx->get_implicit_timezone(), spec);
 
   result = GENV_ITEMFACTORY->createPendingUpdateList();
@@ -443,6 +588,9 @@ bool RefreshIndexIterator::nextImpl(
   
   planWrapper = new PlanWrapper(buildPlan, ccb, dctx, NULL, 0, false, 0); 
 
+  if (IndexSnapshotIterator::isEnabled())
+    planWrapper = new IndexSnapshotIterator(indexDecl, buildPlan, planWrapper, ccb);
+
   result = GENV_ITEMFACTORY->createPendingUpdateList();
 
   reinterpret_cast<store::PUL*>(result.getp())->addRefreshIndex(&loc, qname, planWrapper);
@@ -575,6 +723,218 @@ bool GeneralIndexEntryBuilderIterator::nextImpl(
 BINARY_ACCEPT(GeneralIndexEntryBuilderIterator)
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+/*******************************************************************************
+  Computes the key values of a full-text index: the tokens of an item,
+  normalized according to the match options in scope at the declaration of
+  the index. With stemming, a token is normalized to its stem; otherwise, to
+  its lower-case value stripped of diacritics. A token that is a stop word
+  of the index is normalized to the empty string, which is a key of every
+  domain node.
+
+  If the match options of a "contains text" expression are compatible with
+  the ones of the index (see IndexMatchingRule::matchFullTextIndex), a query
+  token matches a document token only if their normalized values are equal,
+  or if the query token is a stop word of the index.
+********************************************************************************/
+class FullTextIndexTokenizer
+{
+  class IndexStemmer : public FTToken::Stemmer
+  {
+    internal::StemmerProvider const * theProvider;
+
+  public:
+    IndexStemmer() : theProvider(GENV_STORE.getStemmerProvider())
+    {
+      ZORBA_ASSERT(theProvider);
+    }
+
+    void operator()(
+        string_t const& word,
+        locale::iso639_1::type lang,
+        string_t* result) const
+    {
+      internal::Stemmer::ptr stemmer;
+      if (theProvider->getStemmer(lang, &stemmer))
+        stemmer->stem(word, lang, result);
+      else
+        *result = word;
+    }
+  };
+
+  ftmatch_options             * theOptions;
+  locale::iso639_1::type        theLang;
+  bool                          theStemming;
+  ft_stop_words_set const     * theStopWords;
+  IndexStemmer                  theStemmer;
+
+public:
+  FullTextIndexTokenizer(const static_context* sctx);
+
+  ~FullTextIndexTokenizer();
+
+  void tokenize(const store::Item* item, std::vector<zstring>& tokens) const;
+};
+
+
+FullTextIndexTokenizer::FullTextIndexTokenizer(const static_context* sctx)
+  :
+  theStopWords(NULL)
+{
+  const ftmatch_options* options = sctx->get_match_options();
+
+  theOptions = (options ?
+                new ftmatch_options(*options) :
+                new ftmatch_options(QueryLoc::null));
+
+  theOptions->set_missing_defaults();
+
+  theLang = get_lang_from(theOptions);
+
+  theStemming = (theOptions->get_stem_option()->get_mode() ==
+                 ft_stem_mode::stemming);
+
+  theStopWords = ft_stop_words_set::construct(*theOptions->get_stop_word_option(),
+                                              theLang,
+                                              *sctx).release();
+}
+
+
+FullTextIndexTokenizer::~FullTextIndexTokenizer()
+{
+  delete theStopWords;
+  delete theOptions;
+}
+
+
+void FullTextIndexTokenizer::tokenize(
+    const store::Item* item,
+    std::vector<zstring>& tokens) const
+{
+  store::Item_t stringItem;
+
+  // Only nodes and strings can be tokenized by the store.
+  if (!item->isNode())
+  {
+    zstring value;
+    item->getStringValue2(value);
+    GENV_ITEMFACTORY->createString(stringItem, value);
+    item = stringItem.getp();
+  }
+
+  TokenizerProvider const* provider = GENV_STORE.getTokenizerProvider();
+  ZORBA_ASSERT(provider);
+
+  Tokenizer::State tokenizerState;
+  FTTokenIterator_t ite = item->getTokens(*provider, tokenizerState, theLang);
+
+  while (ite->hasNext())
+  {
+    const FTToken* token = ite->next();
+
+    if (theStopWords && theStopWords->contains(token->value(FTToken::lower)))
+      tokens.push_back(zstring());
+    else if (theStemming)
+      tokens.push_back(token->value(theStemmer, theLang));
+    else
+      tokens.push_back(token->value(FTToken::lower | FTToken::ascii, theLang));
+  }
+}
+
+
+/*******************************************************************************
+  op-zorba:full-text-index-tokens($input as item()*) as xs:string*
+********************************************************************************/
+FullTextIndexTokensIteratorState::FullTextIndexTokensIteratorState()
+  :
+  theTokenizer(NULL)
+{
+}
+
+
+FullTextIndexTokensIteratorState::~FullTextIndexTokensIteratorState()
+{
+  delete theTokenizer;
+}
+
+
+void FullTextIndexTokensIteratorState::init(PlanState& planState)
+{
+  PlanIteratorState::init(planState);
+  theTokens.clear();
+  theNextToken = 0;
+}
+
+
+void FullTextIndexTokensIteratorState::reset(PlanState& planState)
+{
+  PlanIteratorState::reset(planState);
+  theTokens.clear();
+  theNextToken = 0;
+}
+
+
+FullTextIndexTokensIterator::FullTextIndexTokensIterator(
+    static_context* sctx,
+    const QueryLoc& loc,
+    PlanIter_t& child)
+  :
+  UnaryBaseIterator<FullTextIndexTokensIterator,
+                    FullTextIndexTokensIteratorState>(sctx, loc, child)
+{
+}
+
+
+FullTextIndexTokensIterator::~FullTextIndexTokensIterator()
+{
+}
+
+
+void FullTextIndexTokensIterator::serialize(::zorba::serialization::Archiver& ar)
+{
+  serialize_baseclass(ar,
+  (UnaryBaseIterator<FullTextIndexTokensIterator,
+                     FullTextIndexTokensIteratorState>*)this);
+}
+
+
+bool FullTextIndexTokensIterator::nextImpl(
+    store::Item_t& result,
+    PlanState& planState) const
+{
+  store::Item_t item;
+  zstring token;
+
+  FullTextIndexTokensIteratorState* state;
+  DEFAULT_STACK_INIT(FullTextIndexTokensIteratorState, state, planState);
+
+  if (state->theTokenizer == NULL)
+    state->theTokenizer = new FullTextIndexTokenizer(theSctx);
+
+  STACK_PUSH(GENV_ITEMFACTORY->createString(result, token), state);
+
+  while (consumeNext(item, theChild.getp(), planState))
+  {
+    state->theTokens.clear();
+    state->theTokenizer->tokenize(item.getp(), state->theTokens);
+
+    for (state->theNextToken = 0;
+         state->theNextToken < state->theTokens.size();
+         ++state->theNextToken)
+    {
+      token = state->theTokens[state->theNextToken];
+      STACK_PUSH(GENV_ITEMFACTORY->createString(result, token), state);
+    }
+  }
+
+  STACK_END(state);
+}
+
+
+UNARY_ACCEPT(FullTextIndexTokensIterator)
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
 /*******************************************************************************
   probe-index-point-value($indexName as xs:QName,
                           $key1      as anyAtomic?,
@@ -599,6 +959,7 @@ void ProbeIndexPointValueIteratorState::init(PlanState& planState)
   theIndexDecl = 0;
   theIndex = 0;
   theIterator = NULL;
+  theKeyColumn = 0;
 }
 
 
@@ -621,12 +982,14 @@ ProbeIndexPointValueIterator::ProbeIndexPointValueIterator(
     static_context* sctx,
     const QueryLoc& loc,
     std::vector<PlanIter_t>& children,
-    bool skip)
+    bool skip,
+    bool projectColumn)
   : 
   NaryBaseIterator<ProbeIndexPointValueIterator,
                    ProbeIndexPointValueIteratorState>(sctx, loc, children),
   theCheckKeyType(true),
-  theSkip(skip)
+  theSkip(skip),
+  theProjectColumn(projectColumn)
 {
 }
 
@@ -643,6 +1006,7 @@ void ProbeIndexPointValueIterator::serialize(::zorba::serialization::Archiver& a
 
   ar & theCheckKeyType;
   ar & theSkip;
+  ar & theProjectColumn;
 }
 
 
@@ -672,11 +1036,19 @@ bool ProbeIndexPointValueIterator::nextImpl(
         if (skip.sign() < 0)
           skip = numeric_consts<xs_integer>::zero();
       }
+      else if (theProjectColumn)
+      {
+        store::Item_t columnItem;
+        ZORBA_ASSERT(consumeNext(columnItem, theChildren[1], planState));
+        state->theKeyColumn = to_xs_unsignedInt(columnItem->getIntegerValue()) - 1;
+      }
 
       state->theIterator->init(cond, skip);
       state->theIterator->open();
         
-      while(state->theIterator->next(result)) 
+      while (theProjectColumn ?
+             state->theIterator->nextKeyColumn(result, state->theKeyColumn) :
+             state->theIterator->next(result))
       {
         STACK_PUSH(true, state);
       }
@@ -718,9 +1090,20 @@ bool ProbeIndexPointValueIterator::countImpl(
         if (skip.sign() < 0)
           skip = numeric_consts<xs_integer>::zero();
       }
+      else if (theProjectColumn)
+      {
+        store::Item_t columnItem;
+        ZORBA_ASSERT(consumeNext(columnItem, theChildren[1], planState));
+        state->theKeyColumn = to_xs_unsignedInt(columnItem->getIntegerValue()) - 1;
+      }
 
       state->theIterator->init(cond, skip);
-      state->theIterator->count(result);
+
+      if (theProjectColumn)
+        countKeyColumn(state->theIterator, state->theKeyColumn, result);
+      else
+        state->theIterator->count(result);
+
       STACK_PUSH(true, state);
     }
 
@@ -740,7 +1123,7 @@ void ProbeIndexPointValueIterator::getIndex(
 {
   store::Item_t qnameItem;
   csize numChildren = theChildren.size();
-  csize numNonKeyParams = (theSkip ? 2 : 1);
+  csize numNonKeyParams = (theSkip || theProjectColumn ? 2 : 1);
 
   ZORBA_ASSERT(consumeNext(qnameItem, theChildren[0], planState));
 
@@ -787,7 +1170,7 @@ store::IndexCondition_t ProbeIndexPointValueIterator::createCondition(
   store::Item_t keyItem;
   store::IndexCondition_t cond;
   csize numChildren = theChildren.size();
-  csize numNonKeyParams = (theSkip ? 2 : 1);
+  csize numNonKeyParams = (theSkip || theProjectColumn ? 2 : 1);
 
   cond = state->theIndex->createCondition(store::IndexCondition::POINT_VALUE);
 
@@ -1053,6 +1436,7 @@ void ProbeIndexRangeValueIteratorState::init(PlanState& planState)
   theQname = 0;
   theIndex = 0;
   theIterator = NULL;
+  theKeyColumn = 0;
 }
 
 
@@ -1074,12 +1458,14 @@ ProbeIndexRangeValueIterator::ProbeIndexRangeValueIterator(
     static_context* sctx,
     const QueryLoc& loc,
     std::vector<PlanIter_t>& children,
-    bool skip)
+    bool skip,
+    bool projectColumn)
   : 
   NaryBaseIterator<ProbeIndexRangeValueIterator,
                    ProbeIndexRangeValueIteratorState>(sctx, loc, children),
   theCheckKeyType(true),
-  theSkip(skip)
+  theSkip(skip),
+  theProjectColumn(projectColumn)
 {
 }
 
@@ -1097,6 +1483,7 @@ void ProbeIndexRangeValueIterator::serialize(::zorba::serialization::Archiver& a
 
   ar & theCheckKeyType;
   ar & theSkip;
+  ar & theProjectColumn;
 }
 
 
@@ -1124,11 +1511,19 @@ bool ProbeIndexRangeValueIterator::nextImpl(
       if (skip.sign() < 0)
         skip = numeric_consts<xs_integer>::zero();
     }
+    else if (theProjectColumn)
+    {
+      store::Item_t columnItem;
+      ZORBA_ASSERT(consumeNext(columnItem, theChildren[1], planState));
+      state->theKeyColumn = to_xs_unsignedInt(columnItem->getIntegerValue()) - 1;
+    }
 
     state->theIterator->init(cond, skip);
     state->theIterator->open();
       
-    while (state->theIterator->next(result)) 
+    while (theProjectColumn ?
+           state->theIterator->nextKeyColumn(result, state->theKeyColumn) :
+           state->theIterator->next(result))
     {
       STACK_PUSH(true, state);
     }
@@ -1167,9 +1562,20 @@ bool ProbeIndexRangeValueIterator::countImpl(
       if (skip.sign() < 0)
         skip = numeric_consts<xs_integer>::zero();
     }
+    else if (theProjectColumn)
+    {
+      store::Item_t columnItem;
+      ZORBA_ASSERT(consumeNext(columnItem, theChildren[1], planState));
+      state->theKeyColumn = to_xs_unsignedInt(columnItem->getIntegerValue()) - 1;
+    }
 
     state->theIterator->init(cond, skip);
-    state->theIterator->count(result);
+
+    if (theProjectColumn)
+      countKeyColumn(state->theIterator, state->theKeyColumn, result);
+    else
+      state->theIterator->count(result);
+
     STACK_PUSH(true, state);
 
     STACK_END(state);
@@ -1188,7 +1594,7 @@ void ProbeIndexRangeValueIterator::getIndex(
 {
   store::Item_t qnameItem;
   csize numChildren = theChildren.size();
-  csize numNonKeyParams = (theSkip ? 2 : 1);
+  csize numNonKeyParams = (theSkip || theProjectColumn ? 2 : 1);
   IndexDecl_t indexDecl;
 
   ZORBA_ASSERT(consumeNext(qnameItem, theChildren[0], planState));
@@ -1251,7 +1657,7 @@ store::IndexCondition_t ProbeIndexRangeValueIterator::createCondition(
   TypeManager* tm = theSctx->get_typemanager();
   store::IndexCondition_t cond;
   csize numChildren = theChildren.size();
-  csize numNonKeyParams = (theSkip ? 2 : 1);
+  csize numNonKeyParams = (theSkip || theProjectColumn ? 2 : 1);
 
   cond = state->theIndex->createCondition(store::IndexCondition::BOX_VALUE);
 
@@ -1760,5 +2166,289 @@ void ProbeIndexRangeGeneralIterator::accept(PlanIterVisitor& v) const
   v.endVisit(*this);
 }
 
+
+#ifndef ZORBA_NO_FULL_TEXT
+/*******************************************************************************
+  probe-index-full-text
+********************************************************************************/
+ProbeIndexFullTextIteratorState::ProbeIndexFullTextIteratorState()
+  :
+  theTokenizer(NULL)
+{
+}
+
+
+ProbeIndexFullTextIteratorState::~ProbeIndexFullTextIteratorState()
+{
+  delete theTokenizer;
+}
+
+
+void ProbeIndexFullTextIteratorState::init(PlanState& planState)
+{
+  ProbeIndexPointGeneralIteratorState::init(planState);
+  theNodes.clear();
+  theNextNode = 0;
+}
+
+
+void ProbeIndexFullTextIteratorState::reset(PlanState& planState)
+{
+  ProbeIndexPointGeneralIteratorState::reset(planState);
+  theCondition = NULL;
+  theNodes.clear();
+  theNextNode = 0;
+}
+
+
+ProbeIndexFullTextIterator::ProbeIndexFullTextIterator(
+    static_context* sctx,
+    const QueryLoc& loc,
+    std::vector<PlanIter_t>& children)
+  : 
+  NaryBaseIterator<ProbeIndexFullTextIterator,
+                   ProbeIndexFullTextIteratorState>(sctx, loc, children)
+{
+}
+
+
+ProbeIndexFullTextIterator::~ProbeIndexFullTextIterator() 
+{
+}
+
+
+void ProbeIndexFullTextIterator::serialize(::zorba::serialization::Archiver& ar)
+{
+  serialize_baseclass(ar,
+  (NaryBaseIterator<ProbeIndexFullTextIterator,
+                    ProbeIndexFullTextIteratorState>*)this);
+}
+
+
+bool ProbeIndexFullTextIterator::nextImpl(
+    store::Item_t& result,
+    PlanState& planState) const
+{
+  try
+  {
+    ProbeIndexFullTextIteratorState* state;
+    DEFAULT_STACK_INIT(ProbeIndexFullTextIteratorState, state, planState);
+
+    getIndex(state, planState);
+    findNodes(state, planState);
+
+    for (state->theNextNode = 0;
+         state->theNextNode < state->theNodes.size();
+         ++state->theNextNode)
+    {
+      result = state->theNodes[state->theNextNode];
+      STACK_PUSH(true, state);
+    }
+
+    state->theNodes.clear();
+
+    STACK_END(state);
+  }
+  catch (ZorbaException& e)
+  {
+    set_source(e, loc, false);
+    throw;
+  }
+}
+
+
+void ProbeIndexFullTextIterator::getIndex(
+    ProbeIndexFullTextIteratorState* state,
+    PlanState& planState) const
+{
+  store::Item_t qnameItem;
+
+  ZORBA_ASSERT(consumeNext(qnameItem, theChildren[0], planState));
+
+  if (state->theQname == NULL || !state->theQname->equals(qnameItem)) 
+  {
+    state->theQname = qnameItem;
+      
+    if ((state->theIndexDecl = theSctx->lookup_index(qnameItem)) == NULL)
+    {
+      RAISE_ERROR(zerr::ZDDY0021_INDEX_NOT_DECLARED, loc,
+      ERROR_PARAMS(qnameItem->getStringValue()));
+    }
+
+    if (!state->theIndexDecl->isFullText())
+    {
+      RAISE_ERROR(zerr::ZDDY0029_INDEX_POINT_GENERAL_PROBE_NOT_ALLOWED, loc,
+      ERROR_PARAMS(qnameItem->getStringValue()));
+    }
+
+    state->theIndex = GENV_STORE.getIndex(state->theQname);
+
+    if (state->theIndex == NULL)
+    {
+      RAISE_ERROR(zerr::ZDDY0023_INDEX_DOES_NOT_EXIST, loc,
+      ERROR_PARAMS(qnameItem->getStringValue()));
+    }
+    
+    state->theIterator = GENV_STORE.getIteratorFactory()->
+                         createIndexProbeIterator(state->theIndex);
+
+    state->theCondition = 
+    state->theIndex->createCondition(store::IndexCondition::POINT_GENERAL);
+
+    delete state->theTokenizer;
+    state->theTokenizer =
+    new FullTextIndexTokenizer(state->theIndexDecl->getSctx());
+  }
+}
+
+
+/*******************************************************************************
+  Collects in state->theNodes the nodes returned by the probe. The tokens of
+  the search words are grouped so that a node is returned if it has all the
+  tokens of one of the groups. The empty-string token of a stop word is a key
+  of every node, so a group made of stop words only finds all the nodes.
+********************************************************************************/
+void ProbeIndexFullTextIterator::findNodes(
+    ProbeIndexFullTextIteratorState* state,
+    PlanState& planState) const
+{
+  store::Item_t wordItem;
+  store::Item_t modeItem;
+  std::vector<zstring> tokens;
+  std::vector<std::vector<zstring> > groups;
+
+  ZORBA_ASSERT(consumeNext(modeItem, theChildren[2], planState));
+
+  zstring modeStr = modeItem->getStringValue();
+  csize mode = 0;
+
+  while (ft_anyall_mode::string_of[mode] != NULL &&
+         modeStr != ft_anyall_mode::string_of[mode])
+    ++mode;
+
+  if (ft_anyall_mode::string_of[mode] == NULL)
+  {
+    RAISE_ERROR(zerr::ZXQD0004_INVALID_PARAMETER, loc,
+    ERROR_PARAMS(modeStr));
+  }
+
+  while (consumeNext(wordItem, theChildren[1], planState))
+  {
+    tokens.clear();
+    state->theTokenizer->tokenize(wordItem.getp(), tokens);
+
+    switch (mode)
+    {
+    case ft_anyall_mode::any:
+    {
+      groups.push_back(tokens);
+      break;
+    }
+    case ft_anyall_mode::any_word:
+    {
+      for (csize i = 0; i < tokens.size(); ++i)
+        groups.push_back(std::vector<zstring>(1, tokens[i]));
+      break;
+    }
+    default:
+    {
+      if (groups.empty())
+        groups.resize(1);
+
+      groups[0].insert(groups[0].end(), tokens.begin(), tokens.end());
+      break;
+    }
+    }
+  }
+
+  if (groups.empty() &&
+      mode != ft_anyall_mode::any &&
+      mode != ft_anyall_mode::any_word)
+  {
+    groups.resize(1);
+  }
+
+  StructuredItemHandleHashSet found(1024, false);
+  std::vector<store::Item_t> nodes;
+  std::vector<store::Item_t> tokenNodes;
+
+  for (csize i = 0; i < groups.size(); ++i)
+  {
+    std::vector<zstring>& group = groups[i];
+
+    // The empty token constrains nothing if the group has other tokens.
+    std::sort(group.begin(), group.end());
+    group.erase(std::unique(group.begin(), group.end()), group.end());
+
+    if (group.size() > 1 && group[0].empty())
+      group.erase(group.begin());
+
+    if (group.empty())
+      group.push_back(zstring());
+
+    nodes.clear();
+    probeToken(state, group[0], nodes);
+
+    for (csize j = 1; j < group.size() && !nodes.empty(); ++j)
+    {
+      tokenNodes.clear();
+      probeToken(state, group[j], tokenNodes);
+
+      StructuredItemHandleHashSet tokenSet(tokenNodes.size() + 1, false);
+
+      for (csize k = 0; k < tokenNodes.size(); ++k)
+        tokenSet.insert(tokenNodes[k]);
+
+      csize numNodes = 0;
+      for (csize k = 0; k < nodes.size(); ++k)
+      {
+        if (tokenSet.exists(nodes[k]))
+        {
+          if (numNodes != k)
+            nodes[numNodes].transfer(nodes[k]);
+
+          ++numNodes;
+        }
+      }
+
+      nodes.resize(numNodes);
+    }
+
+    for (csize k = 0; k < nodes.size(); ++k)
+    {
+      if (found.insert(nodes[k]))
+        state->theNodes.push_back(nodes[k]);
+    }
+  }
+}
+
+
+void ProbeIndexFullTextIterator::probeToken(
+    ProbeIndexFullTextIteratorState* state,
+    const zstring& token,
+    std::vector<store::Item_t>& nodes) const
+{
+  store::Item_t keyItem;
+  store::Item_t node;
+  zstring value(token);
+
+  GENV_ITEMFACTORY->createString(keyItem, value);
+
+  state->theCondition->clear();
+  state->theCondition->pushItem(keyItem);
+
+  state->theIterator->init(state->theCondition.getp());
+  state->theIterator->open();
+
+  while (state->theIterator->next(node))
+    nodes.push_back(node);
+
+  state->theIterator->close();
+}
+
+
+NARY_ACCEPT(ProbeIndexFullTextIterator)
+#endif /* ZORBA_NO_FULL_TEXT */
+
 } // namespace zorba
 /* vim:set et sw=2 ts=2: */
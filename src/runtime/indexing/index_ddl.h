@@ -24,12 +24,17 @@
 #include "runtime/base/binarybase.h"
 #include "runtime/base/narybase.h"
 
+#include "runtime/indexing/hash_join.h"
+
 
 namespace zorba 
 {
 
 class IndexDecl;
 class StructuredItemHandleHashSet;
+#ifndef ZORBA_NO_FULL_TEXT
+class FullTextIndexTokenizer;
+#endif
 
 
 /*******************************************************************************
@@ -91,6 +96,121 @@ public:
 };
 
 
+/*******************************************************************************
+  create-hash-join($joinName as xs:QName, $items as item()*) as ()
+
+  This is an internal function that is used by the hashjoins rule to build the
+  hash table of a value equi-join over its inner side (see HashJoinTable) and
+  to bind it in the dynamic context. The second param is bound to the build
+  expr of a temp value index declaration, i.e., an expr of the form :
+
+  for $dot at $pos in domain_expr
+  return value-index-entry-builder($$dot, key_expr)
+
+  Unlike a temp index, the table is not a store object and is not maintained.
+********************************************************************************/
+class CreateHashJoinIterator : public UnaryBaseIterator<CreateHashJoinIterator,
+                                                        PlanIteratorState>
+{ 
+protected:
+  store::Item_t theQName;
+
+public:
+  SERIALIZABLE_CLASS(CreateHashJoinIterator);
+
+  SERIALIZABLE_CLASS_CONSTRUCTOR2T(CreateHashJoinIterator,
+  UnaryBaseIterator<CreateHashJoinIterator, PlanIteratorState>);
+
+  void serialize( ::zorba::serialization::Archiver& ar)
+  {
+    serialize_baseclass(ar,
+    (UnaryBaseIterator<CreateHashJoinIterator, PlanIteratorState>*)this);
+
+    ar & theQName;
+  }
+
+  CreateHashJoinIterator(
+        static_context* sctx,
+        const QueryLoc& loc,
+        PlanIter_t& child,
+        const store::Item_t& name)
+    :
+    UnaryBaseIterator<CreateHashJoinIterator, PlanIteratorState>(sctx, loc, child),
+    theQName(name)
+  {
+  }
+
+  ~CreateHashJoinIterator();
+
+  store::Item_t getName() const { return theQName; }
+
+  void accept(PlanIterVisitor& v) const;
+
+  zstring getNameAsString() const;
+
+  bool nextImpl(store::Item_t& result, PlanState& aPlanState) const;
+};
+
+
+/*******************************************************************************
+  probe-hash-join($joinName as xs:QName, $key as xs:anyAtomicType?) as item()*
+
+  Returns the items of the inner side of a hash join whose key is equal to the
+  given key, in the order in which the hash join inserted them.
+********************************************************************************/
+class ProbeHashJoinIteratorState : public PlanIteratorState
+{
+public:
+  HashJoinTable_t  theTable;
+  csize            thePos;
+
+  void reset(PlanState&);
+};
+
+
+class ProbeHashJoinIterator : public UnaryBaseIterator<ProbeHashJoinIterator,
+                                                       ProbeHashJoinIteratorState>
+{ 
+protected:
+  store::Item_t theQName;
+
+public:
+  SERIALIZABLE_CLASS(ProbeHashJoinIterator);
+
+  SERIALIZABLE_CLASS_CONSTRUCTOR2T(ProbeHashJoinIterator,
+  UnaryBaseIterator<ProbeHashJoinIterator, ProbeHashJoinIteratorState>);
+
+  void serialize( ::zorba::serialization::Archiver& ar)
+  {
+    serialize_baseclass(ar,
+    (UnaryBaseIterator<ProbeHashJoinIterator, ProbeHashJoinIteratorState>*)this);
+
+    ar & theQName;
+  }
+
+  ProbeHashJoinIterator(
+        static_context* sctx,
+        const QueryLoc& loc,
+        PlanIter_t& child,
+        const store::Item_t& name)
+    :
+    UnaryBaseIterator<ProbeHashJoinIterator, ProbeHashJoinIteratorState>(sctx, loc, child),
+    theQName(name)
+  {
+  }
+
+  ~ProbeHashJoinIterator();
+
+  store::Item_t getName() const { return theQName; }
+
+  void accept(PlanIterVisitor& v) const;
+
+  zstring getNameAsString() const;
+
+  bool nextImpl(store::Item_t& result, PlanState& aPlanState) const;
+};
+
+
 /*******************************************************************************
   create($indexName as xs:QName) as pul()
  
@@ -323,6 +443,62 @@ public:
 };
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+/******************************************************************************
+  op-zorba:full-text-index-tokens($input as item()*) as xs:string*
+
+  Returns the key values of a full-text index for the items returned by its
+  key expression: the empty string, followed by the tokens of each item,
+  normalized by a FullTextIndexTokenizer. The empty string is thus a key of
+  every domain node, so that a probe whose search words contribute no token
+  finds all the nodes.
+*******************************************************************************/
+class FullTextIndexTokensIteratorState : public PlanIteratorState
+{
+public:
+  FullTextIndexTokenizer * theTokenizer;
+  std::vector<zstring>     theTokens;
+  csize                    theNextToken;
+
+public:
+  FullTextIndexTokensIteratorState();
+
+  ~FullTextIndexTokensIteratorState();
+
+  void init(PlanState&);
+
+  void reset(PlanState&);
+};
+
+
+class FullTextIndexTokensIterator :
+public UnaryBaseIterator<FullTextIndexTokensIterator,
+                         FullTextIndexTokensIteratorState>
+{
+public:
+  SERIALIZABLE_CLASS(FullTextIndexTokensIterator);
+  SERIALIZABLE_CLASS_CONSTRUCTOR2T(FullTextIndexTokensIterator,
+  UnaryBaseIterator<FullTextIndexTokensIterator,
+                    FullTextIndexTokensIteratorState>);
+  void serialize(::zorba::serialization::Archiver& ar);
+
+public:
+  FullTextIndexTokensIterator(
+      static_context* sctx,
+      const QueryLoc& loc,
+      PlanIter_t& child);
+
+  ~FullTextIndexTokensIterator();
+
+  void accept(PlanIterVisitor& v) const;
+
+  zstring getNameAsString() const;
+
+  bool nextImpl(store::Item_t& result, PlanState& aPlanState) const;
+};
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
 /******************************************************************************
    probe-index-point-value($indexName as xs:QName,
                            $key1      as anyAtomic?,
@@ -339,6 +515,7 @@ public:
   const IndexDecl              * theIndexDecl;
   store::Index                 * theIndex; 
   store::IndexProbeIterator_t    theIterator;
+  csize                          theKeyColumn;
 
 public:
   ProbeIndexPointValueIteratorState();
@@ -359,6 +536,7 @@ class ProbeIndexPointValueIterator
 protected:
   bool theCheckKeyType;
   bool theSkip;
+  bool theProjectColumn;
 
 public:
   SERIALIZABLE_CLASS(ProbeIndexPointValueIterator);
@@ -371,12 +549,15 @@ public:
       static_context* sctx,
       const QueryLoc& loc,
       std::vector<PlanIter_t>& children,
-      bool skip);
+      bool skip,
+      bool projectColumn = false);
 
   ~ProbeIndexPointValueIterator();
 
   bool hasSkip() const { return theSkip; }
 
+  bool projectsColumn() const { return theProjectColumn; }
+
   void accept(PlanIterVisitor& v) const;
 
   bool nextImpl(store::Item_t& result, PlanState& planState) const;
@@ -484,6 +665,7 @@ public:
   const IndexDecl             * theIndexDecl;
   store::Index                * theIndex;
   store::IndexProbeIterator_t   theIterator;
+  csize                         theKeyColumn;
 
 public:
   ProbeIndexRangeValueIteratorState();
@@ -503,6 +685,7 @@ public NaryBaseIterator<ProbeIndexRangeValueIterator,
 protected:
   bool theCheckKeyType;
   bool theSkip;
+  bool theProjectColumn;
 
 public:
   SERIALIZABLE_CLASS(ProbeIndexRangeValueIterator);
@@ -515,12 +698,15 @@ public:
       static_context* sctx,
       const QueryLoc& loc,
       std::vector<PlanIter_t>& children,
-      bool skip);
+      bool skip,
+      bool projectColumn = false);
 
   ~ProbeIndexRangeValueIterator();
 
   bool hasSkip() const { return theSkip; }
 
+  bool projectsColumn() const { return theProjectColumn; }
+
   void accept(PlanIterVisitor& v) const;
 
   bool nextImpl(store::Item_t& result, PlanState& planState) const;
@@ -625,6 +811,90 @@ private:
 
 
 
+#ifndef ZORBA_NO_FULL_TEXT
+/******************************************************************************
+  probe-index-full-text(
+      $indexName as xs:QName,
+      $words     as xs:anyAtomicType*,
+      $mode      as xs:string) as node()*
+
+  Returns the domain nodes of a full-text index that may contain the given
+  search words, where $mode is the "any", "any word", "all", "all words", or
+  "phrase" option of a "contains text" expression. The words are tokenized
+  and normalized the same way as the key values of the index, and a node is
+  returned if, for "all", "all words", and "phrase", it has all the tokens,
+  for "any", it has all the tokens of one of the words, and for "any word",
+  it has one of the tokens. The index keeps neither the positions nor the
+  original values of the tokens, so the result is a superset of the nodes
+  that match the words: the caller must still evaluate the "contains text"
+  expression on the nodes returned.
+
+  Note: the translator wraps calls to this function with an OP_SORT_NODES_ASC
+  function.
+
+  theTokenizer : the tokenizer of the index probed
+  theNodes     : the nodes found
+  theNextNode  : the position in theNodes of the next node to return
+********************************************************************************/
+class ProbeIndexFullTextIteratorState : public ProbeIndexPointGeneralIteratorState
+{
+public:
+  FullTextIndexTokenizer     * theTokenizer;
+  std::vector<store::Item_t>   theNodes;
+  csize                        theNextNode;
+
+public:
+  ProbeIndexFullTextIteratorState();
+
+  ~ProbeIndexFullTextIteratorState();
+
+  void init(PlanState&);
+
+  void reset(PlanState&);
+};
+
+
+class ProbeIndexFullTextIterator : 
+public NaryBaseIterator<ProbeIndexFullTextIterator, 
+                        ProbeIndexFullTextIteratorState>
+{
+public:
+  SERIALIZABLE_CLASS(ProbeIndexFullTextIterator);
+  SERIALIZABLE_CLASS_CONSTRUCTOR2T(ProbeIndexFullTextIterator,
+  NaryBaseIterator<ProbeIndexFullTextIterator, ProbeIndexFullTextIteratorState>);
+  void serialize(::zorba::serialization::Archiver& ar);
+
+public:
+  ProbeIndexFullTextIterator(
+      static_context* sctx,
+      const QueryLoc& loc,
+      std::vector<PlanIter_t>& children);
+  
+  ~ProbeIndexFullTextIterator();
+
+  void accept(PlanIterVisitor& v) const;
+
+  zstring getNameAsString() const;
+
+  bool nextImpl(store::Item_t& result, PlanState& aPlanState) const;
+
+private:
+  void getIndex(
+      ProbeIndexFullTextIteratorState* state,
+      PlanState& planState) const;
+
+  void findNodes(
+      ProbeIndexFullTextIteratorState* state,
+      PlanState& planState) const;
+
+  void probeToken(
+      ProbeIndexFullTextIteratorState* state,
+      const zstring& token,
+      std::vector<store::Item_t>& nodes) const;
+};
+#endif /* ZORBA_NO_FULL_TEXT */
+
+
 }
 #endif
 /*
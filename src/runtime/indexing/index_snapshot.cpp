@@ -0,0 +1,776 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+
+#ifdef WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <zorba/config.h>
+#include <zorba/properties.h>
+
+#include "runtime/indexing/index_snapshot.h"
+
+#include "runtime/base/plan_iterator.h"
+#include "runtime/visitors/iterprinter.h"
+#include "runtime/visitors/printer_visitor_api.h"
+
+#include "compiler/api/compilercb.h"
+
+#include "context/static_context.h"
+
+#include "system/globalenv.h"
+
+#include "store/api/collection.h"
+#include "store/api/item.h"
+#include "store/api/item_factory.h"
+#include "store/api/store.h"
+
+#include "types/casting.h"
+
+#include "util/fs_util.h"
+#include "zorbatypes/float.h"
+#include "zorbautils/hashfun.h"
+
+#include "diagnostics/assert.h"
+#include "diagnostics/xquery_diagnostics.h"
+
+
+namespace zorba
+{
+
+static char const INDEX_SNAPSHOT_MAGIC[] = "zorba-index-snapshot-1";
+
+static uint64_t const MAX_FIELD_SIZE = 1UL << 30;
+
+
+/*******************************************************************************
+  The header of a snapshot is written as "<size>:<bytes>\n" (see plan_cache.cpp).
+  The items are written in binary: sizes, ids, and type codes as varints, and
+  doubles and floats as their raw bits.
+********************************************************************************/
+static void write_field(std::ostream& os, const std::string& field)
+{
+  os << field.size() << ':' << field << '\n';
+}
+
+
+static bool read_field(std::istream& is, std::string& field)
+{
+  uint64_t size;
+
+  if (!(is >> size) || is.get() != ':' || size > MAX_FIELD_SIZE)
+    return false;
+
+  field.resize(size);
+
+  if (size > 0 && !is.read(&field[0], size))
+    return false;
+
+  return is.get() == '\n';
+}
+
+
+static void write_varint(std::ostream& os, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    os.put(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+
+  os.put(static_cast<char>(value));
+}
+
+
+static bool read_varint(std::istream& is, uint64_t& value)
+{
+  value = 0;
+
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    int byte = is.get();
+
+    if (byte == EOF)
+      return false;
+
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+    if (!(byte & 0x80))
+      return true;
+  }
+
+  return false;
+}
+
+
+static void write_fixed(std::ostream& os, uint64_t value)
+{
+  for (int i = 0; i < 8; ++i)
+    os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+
+static bool read_fixed(std::istream& is, uint64_t& value)
+{
+  unsigned char bytes[8];
+
+  if (!is.read(reinterpret_cast<char*>(bytes), 8))
+    return false;
+
+  value = 0;
+
+  for (int i = 7; i >= 0; --i)
+    value = (value << 8) | bytes[i];
+
+  return true;
+}
+
+
+static void hash_string(const zstring& s, uint64_t& hash)
+{
+  hash = hashfun::h64(s.c_str(), s.size(), hash);
+
+  // Separate the strings, so that ("ab", "c") and ("a", "bc") differ.
+  char separator = '\0';
+  hash = hashfun::h64(&separator, 1, hash);
+}
+
+
+/*******************************************************************************
+  Prints a plan like XMLIterPrinter does, but without the iterator ids (which
+  are addresses), so that the same plan always prints the same way.
+********************************************************************************/
+class FingerprintIterPrinter : public XMLIterPrinter
+{
+public:
+  FingerprintIterPrinter(std::ostream& os) : XMLIterPrinter(os) {}
+
+  using XMLIterPrinter::addAttribute;
+
+  void addAttribute(char const* name, char const* value)
+  {
+    if (strcmp(name, "id") == 0 ||
+        strcmp(name, "referenced-by") == 0 ||
+        strcmp(name, "pos-referenced-by") == 0)
+      return;
+
+    XMLIterPrinter::addAttribute(name, value);
+  }
+};
+
+
+/*******************************************************************************
+
+********************************************************************************/
+bool IndexSnapshotIterator::isEnabled()
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  return !Properties::instance().getIndexSnapshotDir().empty();
+#else
+  return false;
+#endif
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+IndexSnapshotIterator::IndexSnapshotIterator(
+    IndexDecl* indexDecl,
+    PlanIterator* buildPlan,
+    const store::Iterator_t& source,
+    CompilerCB* ccb)
+  :
+  theIndexDecl(indexDecl),
+  theBuildPlan(buildPlan),
+  theSource(source),
+  theMode(PASS_THROUGH),
+  theSourceIsOpen(false),
+  theNumItems(0)
+{
+  std::ostringstream modules;
+
+  for (csize i = 0; i < ccb->theModuleSources.size(); ++i)
+  {
+    modules << ccb->theModuleSources[i].theURI << ' '
+            << std::hex << ccb->theModuleSources[i].theHash << std::dec << '\n';
+  }
+
+  theModules = modules.str();
+
+  const store::Item* name = indexDecl->getName();
+
+  std::ostringstream fileName;
+  fileName << std::hex << std::setw(16) << std::setfill('0')
+           << hashfun::h64(name->getNamespace().str() + '\n' +
+                           name->getLocalName().str(),
+                           FNV_64_INIT)
+           << ".idx";
+
+  thePath = Properties::instance().getIndexSnapshotDir();
+  fs::append(thePath, fileName.str());
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+IndexSnapshotIterator::~IndexSnapshotIterator()
+{
+  close();
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void IndexSnapshotIterator::open()
+{
+  std::string header;
+  bool snapshotable;
+
+  computeHeader(header, snapshotable);
+
+  if (snapshotable)
+  {
+    if (openSnapshot(header))
+    {
+      theMode = REPLAY;
+      return;
+    }
+
+    startRecording(header);
+  }
+
+  theNodes.clear();
+
+  theSource->open();
+  theSourceIsOpen = true;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+bool IndexSnapshotIterator::next(store::Item_t& result)
+{
+  switch (theMode)
+  {
+  case REPLAY:
+  {
+    if (theNumItems == 0)
+      return false;
+
+    --theNumItems;
+    readItem(result);
+    return true;
+  }
+  case RECORD:
+  {
+    if (!theSource->next(result))
+    {
+      stopRecording(true);
+      return false;
+    }
+
+    if (writeItem(result.getp()))
+      ++theNumItems;
+    else
+      stopRecording(false);
+
+    return true;
+  }
+  default:
+  {
+    return theSource->next(result);
+  }
+  }
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void IndexSnapshotIterator::reset()
+{
+  close();
+  open();
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void IndexSnapshotIterator::close()
+{
+  stopRecording(false);
+
+  if (theSourceIsOpen)
+  {
+    theSource->close();
+    theSourceIsOpen = false;
+  }
+
+  if (theInput.is_open())
+    theInput.close();
+
+  theNodes.clear();
+  theMode = PASS_THROUGH;
+}
+
+
+/*******************************************************************************
+  Computes the header that the snapshot must have to be replayed: the
+  fingerprint of the build plan and the stamps of the source collections. On
+  the way, the nodes of the source collections are put in theNodes, in the
+  order that gives them their ids.
+********************************************************************************/
+void IndexSnapshotIterator::computeHeader(
+    std::string& header,
+    bool& snapshotable)
+{
+  std::ostringstream os;
+
+  write_field(os, INDEX_SNAPSHOT_MAGIC);
+  write_field(os, ZORBA_VERSION);
+
+  std::ostringstream plan;
+  FingerprintIterPrinter printer(plan);
+  print_iter_plan(printer, theBuildPlan.getp());
+
+  write_field(os, plan.str());
+  write_field(os, theModules);
+
+  theNodes.clear();
+  snapshotable = true;
+
+  for (csize i = 0; i < theIndexDecl->numSources(); ++i)
+  {
+    const store::Item* name = theIndexDecl->getSourceName(i);
+
+    write_field(os, name->getNamespace().str() + '\n' + name->getLocalName().str());
+
+    store::Collection_t collection = GENV_STORE.getCollection(name, false);
+
+    if (collection == NULL)
+    {
+      os << "-\n";
+      continue;
+    }
+
+    csize firstNode = theNodes.size();
+    uint64_t hash = FNV_64_INIT;
+
+    store::Iterator_t trees = collection->getIterator();
+    store::Item_t tree;
+
+    trees->open();
+
+    while (trees->next(tree))
+    {
+      if (!tree->isNode())
+      {
+        snapshotable = false;
+        break;
+      }
+
+      walkTree(tree.getp(), hash);
+    }
+
+    trees->close();
+
+    if (!snapshotable)
+      break;
+
+    os << (theNodes.size() - firstNode) << ' '
+       << std::hex << hash << std::dec << '\n';
+  }
+
+  header = os.str();
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void IndexSnapshotIterator::walkTree(store::Item* node, uint64_t& hash)
+{
+  theNodes.push_back(node);
+
+  store::NodeKind kind = node->getNodeKind();
+
+  char kindByte = static_cast<char>(kind);
+  hash = hashfun::h64(&kindByte, 1, hash);
+
+  if (kind == store::StoreConsts::elementNode ||
+      kind == store::StoreConsts::attributeNode ||
+      kind == store::StoreConsts::piNode)
+  {
+    store::Item* name = node->getNodeName();
+    hash_string(name->getNamespace(), hash);
+    hash_string(name->getLocalName(), hash);
+  }
+
+  if (kind != store::StoreConsts::elementNode &&
+      kind != store::StoreConsts::documentNode)
+  {
+    hash_string(node->getStringValue(), hash);
+    return;
+  }
+
+  store::Item_t child;
+
+  if (kind == store::StoreConsts::elementNode)
+  {
+    store::Iterator_t attributes = node->getAttributes();
+    attributes->open();
+
+    while (attributes->next(child))
+      walkTree(child.getp(), hash);
+
+    attributes->close();
+  }
+
+  store::Iterator_t children = node->getChildren();
+  children->open();
+
+  while (children->next(child))
+    walkTree(child.getp(), hash);
+
+  children->close();
+}
+
+
+/*******************************************************************************
+  Opens the snapshot for replay, if it exists, has the given header, and is
+  complete.
+********************************************************************************/
+bool IndexSnapshotIterator::openSnapshot(const std::string& header)
+{
+  theInput.open(thePath.c_str(), std::ios::in | std::ios::binary);
+
+  if (!theInput.is_open())
+    return false;
+
+  std::string fileHeader;
+  uint64_t numItems;
+  uint64_t itemsSize;
+
+  if (read_field(theInput, fileHeader) && fileHeader == header)
+  {
+    std::streampos itemsStart = theInput.tellg();
+
+    if (theInput.seekg(-16, std::ios::end) &&
+        read_fixed(theInput, numItems) &&
+        read_fixed(theInput, itemsSize) &&
+        static_cast<uint64_t>(theInput.tellg() - itemsStart) == itemsSize + 16 &&
+        theInput.seekg(itemsStart))
+    {
+      theNumItems = numItems;
+      return true;
+    }
+  }
+
+  theInput.close();
+  return false;
+}
+
+
+/*******************************************************************************
+  Starts writing a new snapshot into a temporary file of our own, so that
+  concurrent writers of the same snapshot do not interleave. Failures leave
+  the iterator in PASS_THROUGH mode.
+********************************************************************************/
+void IndexSnapshotIterator::startRecording(const std::string& header)
+{
+#ifdef ZORBA_WITH_FILE_ACCESS
+  std::ostringstream tmpPath;
+  tmpPath << thePath << '.'
+#ifdef WIN32
+          << _getpid();
+#else
+          << getpid();
+#endif
+
+  theTmpPath = tmpPath.str();
+
+  try
+  {
+    std::string const& dir = Properties::instance().getIndexSnapshotDir();
+
+    if (fs::get_type(dir) != fs::directory)
+      fs::mkdir(dir, true);
+  }
+  catch (std::exception const&)
+  {
+    return;
+  }
+
+  theOutput.open(theTmpPath.c_str(),
+                 std::ios::out | std::ios::binary | std::ios::trunc);
+
+  if (!theOutput.is_open())
+    return;
+
+  write_field(theOutput, header);
+  theItemsStart = theOutput.tellp();
+  theNumItems = 0;
+
+  theNodeIds.clear();
+
+  for (csize i = 0; i < theNodes.size(); ++i)
+    theNodeIds[theNodes[i]] = i;
+
+  theNodes.clear();
+
+  theMode = RECORD;
+#endif
+}
+
+
+/*******************************************************************************
+  Stops recording. If the build plan has been exhausted, the snapshot is
+  completed and moved in place; otherwise it is discarded.
+********************************************************************************/
+void IndexSnapshotIterator::stopRecording(bool complete)
+{
+  if (theMode != RECORD)
+    return;
+
+  theMode = PASS_THROUGH;
+  theNodeIds.clear();
+
+  if (complete)
+  {
+    uint64_t itemsSize = static_cast<uint64_t>(theOutput.tellp() - theItemsStart);
+
+    write_fixed(theOutput, theNumItems);
+    write_fixed(theOutput, itemsSize);
+  }
+
+  theOutput.close();
+
+  bool ok = (complete && !theOutput.fail());
+
+  try
+  {
+    if (ok)
+      fs::rename(theTmpPath, thePath);
+    else
+      fs::remove(theTmpPath, true);
+  }
+  catch (std::exception const&)
+  {
+    try
+    {
+      fs::remove(theTmpPath, true);
+    }
+    catch (std::exception const&)
+    {
+    }
+  }
+}
+
+
+/*******************************************************************************
+  Appends the given item of the build plan to the snapshot. Returns false if
+  the item cannot be put in a snapshot.
+********************************************************************************/
+bool IndexSnapshotIterator::writeItem(const store::Item* item)
+{
+  if (item == NULL)
+  {
+    theOutput.put('N');
+    return true;
+  }
+
+  if (item->isNode())
+  {
+    NodeIds::const_iterator ite = theNodeIds.find(item);
+
+    if (ite == theNodeIds.end())
+      return false;
+
+    theOutput.put('D');
+    write_varint(theOutput, ite->second);
+    return true;
+  }
+
+  if (!item->isAtomic() || item->isStreamable())
+    return false;
+
+  store::SchemaTypeCode typeCode = item->getTypeCode();
+
+  if (typeCode == store::XS_ANY_ATOMIC ||
+      typeCode == store::XS_QNAME ||
+      typeCode == store::XS_NOTATION ||
+      typeCode >= store::JS_NULL ||
+      item->getType()->getNamespace() != static_context::W3C_XML_SCHEMA_NS)
+    return false;
+
+  theOutput.put('A');
+  write_varint(theOutput, typeCode);
+
+  if (typeCode == store::XS_DOUBLE)
+  {
+    double value = item->getDoubleValue().getNumber();
+    uint64_t bits;
+    memcpy(&bits, &value, 8);
+    write_fixed(theOutput, bits);
+  }
+  else if (typeCode == store::XS_FLOAT)
+  {
+    float value = item->getFloatValue().getNumber();
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    write_fixed(theOutput, bits);
+  }
+  else
+  {
+    zstring value = item->getStringValue();
+    write_varint(theOutput, value.size());
+    theOutput.write(value.data(), value.size());
+  }
+
+  return true;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void IndexSnapshotIterator::readItem(store::Item_t& result)
+{
+  bool ok = true;
+  uint64_t value;
+
+  switch (theInput.get())
+  {
+  case 'N':
+  {
+    result = NULL;
+    break;
+  }
+  case 'D':
+  {
+    ok = read_varint(theInput, value) && value < theNodes.size();
+
+    if (ok)
+      result = theNodes[value];
+
+    break;
+  }
+  case 'A':
+  {
+    if (!read_varint(theInput, value) || value >= store::JS_NULL)
+    {
+      ok = false;
+      break;
+    }
+
+    store::SchemaTypeCode typeCode = static_cast<store::SchemaTypeCode>(value);
+
+    if (typeCode == store::XS_DOUBLE)
+    {
+      double number;
+      ok = read_fixed(theInput, value);
+      memcpy(&number, &value, 8);
+
+      if (ok)
+        GENV_ITEMFACTORY->createDouble(result, xs_double(number));
+    }
+    else if (typeCode == store::XS_FLOAT)
+    {
+      float number;
+      ok = read_fixed(theInput, value);
+      uint32_t bits = static_cast<uint32_t>(value);
+      memcpy(&number, &bits, 4);
+
+      if (ok)
+        GENV_ITEMFACTORY->createFloat(result, xs_float(number));
+    }
+    else
+    {
+      ok = read_varint(theInput, value) && value <= MAX_FIELD_SIZE;
+
+      if (!ok)
+        break;
+
+      std::string bytes(value, '\0');
+
+      if (value > 0 && !theInput.read(&bytes[0], value))
+      {
+        ok = false;
+        break;
+      }
+
+      zstring lexical(bytes);
+
+      if (typeCode == store::XS_STRING)
+      {
+        GENV_ITEMFACTORY->createString(result, lexical);
+      }
+      else if (typeCode == store::XS_UNTYPED_ATOMIC)
+      {
+        GENV_ITEMFACTORY->createUntypedAtomic(result, lexical);
+      }
+      else
+      {
+        store::Item_t untyped;
+        GENV_ITEMFACTORY->createUntypedAtomic(untyped, lexical);
+
+        ok = GenericCast::castToBuiltinAtomic(result,
+                                              untyped,
+                                              typeCode,
+                                              NULL,
+                                              QueryLoc::null,
+                                              false);
+      }
+    }
+
+    break;
+  }
+  default:
+  {
+    ok = false;
+    break;
+  }
+  }
+
+  if (!ok || !theInput)
+  {
+    throw ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+    ERROR_PARAMS("corrupt index snapshot " + thePath));
+  }
+}
+
+
+} // namespace zorba
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_RUNTIME_INDEXING_INDEX_SNAPSHOT_H
+#define ZORBA_RUNTIME_INDEXING_INDEX_SNAPSHOT_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/shared_types.h"
+
+#include "compiler/xqddf/value_index.h"
+
+#include "store/api/iterator.h"
+
+#include "util/unordered_map.h"
+
+
+namespace zorba
+{
+
+/*******************************************************************************
+  A wrapper around the build plan of a declared index that keeps a snapshot of
+  the output of the plan in the directory given by
+  Properties::getIndexSnapshotDir(). Recreating or refreshing the index over
+  unchanged collections, typically after a restart, then replays the snapshot
+  instead of evaluating the domain and key expressions again. The store builds
+  the index out of the replayed items as usual.
+
+  The snapshot of an index is a file whose name is a hash of the index name.
+  It contains:
+
+  - a header made of a fingerprint of the build plan (its printed form without
+    the iterator ids, plus the URI and text hash of every library module of
+    the query, see CompilerCB::theModuleSources) and a stamp of each source
+    collection of the index: its number of nodes and a hash of their kinds,
+    names, and string values,
+  - the items returned by the build plan: domain nodes as their position in
+    a preorder walk of the source collections, key items as their type code
+    and value, and
+  - a trailer with the number of items and the size of the items section.
+
+  open() walks the source collections to compute their stamps. If the snapshot
+  exists and its header is the expected one, next() replays it. Otherwise,
+  next() returns the items of the build plan and records them into a new
+  snapshot, which replaces the old one once the build plan is exhausted.
+  Recording is abandoned if the plan returns an item that has no place in a
+  snapshot: a node outside the source collections, a JSON item, a streamable
+  string, or an atomic item of a QName, NOTATION, or non-builtin type. No
+  snapshot is used at all for collections that contain JSON items.
+********************************************************************************/
+class IndexSnapshotIterator : public store::Iterator
+{
+protected:
+  enum Mode
+  {
+    PASS_THROUGH,
+    RECORD,
+    REPLAY
+  };
+
+  typedef std::unordered_map<const store::Item*, uint64_t> NodeIds;
+
+protected:
+  IndexDecl_t                  theIndexDecl;
+  PlanIter_t                   theBuildPlan;
+  store::Iterator_t            theSource;
+  std::string                  theModules;
+  std::string                  thePath;
+
+  Mode                         theMode;
+  bool                         theSourceIsOpen;
+
+  std::vector<store::Item*>    theNodes;
+  NodeIds                      theNodeIds;
+
+  std::ifstream                theInput;
+  uint64_t                     theNumItems;
+
+  std::string                  theTmpPath;
+  std::ofstream                theOutput;
+  std::streampos               theItemsStart;
+
+public:
+  /**
+   * Whether index snapshots are in use: a snapshot directory has been set and
+   * Zorba has file access.
+   */
+  static bool isEnabled();
+
+  IndexSnapshotIterator(
+      IndexDecl* indexDecl,
+      PlanIterator* buildPlan,
+      const store::Iterator_t& source,
+      CompilerCB* ccb);
+
+  ~IndexSnapshotIterator();
+
+  void open();
+
+  bool next(store::Item_t& result);
+
+  void reset();
+
+  void close();
+
+protected:
+  void computeHeader(std::string& header, bool& snapshotable);
+
+  void walkTree(store::Item* node, uint64_t& hash);
+
+  bool openSnapshot(const std::string& header);
+
+  void startRecording(const std::string& header);
+
+  void stopRecording(bool complete);
+
+  bool writeItem(const store::Item* item);
+
+  void readItem(store::Item_t& result);
+};
+
+
+} // namespace zorba
+
+#endif /* ZORBA_RUNTIME_INDEXING_INDEX_SNAPSHOT_H */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
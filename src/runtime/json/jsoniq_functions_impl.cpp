@@ -1124,8 +1124,8 @@ bool SingleObjectLookupIterator::nextImpl(
   store::Item_t input;
   store::Item_t name;
 
-  PlanIteratorState* state;
-  DEFAULT_STACK_INIT(PlanIteratorState, state, planState);
+  SingleObjectLookupIteratorState* state;
+  DEFAULT_STACK_INIT(SingleObjectLookupIteratorState, state, planState);
 
   if (consumeNext(input, theChild0.getp(), planState))
   {
@@ -1133,7 +1133,7 @@ bool SingleObjectLookupIterator::nextImpl(
     {
       if (consumeNext(name, theChild1.getp(), planState))
       {
-        result = input->getObjectValue(name);
+        result = input->getObjectValue(name, state->theHint);
         
         STACK_PUSH(result != NULL, state);
       }
@@ -294,7 +294,7 @@ SERIALIZABLE_CLASS_VERSIONS(SingleObjectLookupIterator)
 void SingleObjectLookupIterator::serialize(::zorba::serialization::Archiver& ar)
 {
   serialize_baseclass(ar,
-  (BinaryBaseIterator<SingleObjectLookupIterator, PlanIteratorState>*)this);
+  (BinaryBaseIterator<SingleObjectLookupIterator, SingleObjectLookupIteratorState>*)this);
 }
 
 
@@ -313,6 +313,19 @@ theChild1->accept(v);
 
 SingleObjectLookupIterator::~SingleObjectLookupIterator() {}
 
+SingleObjectLookupIteratorState::SingleObjectLookupIteratorState() {}
+
+SingleObjectLookupIteratorState::~SingleObjectLookupIteratorState() {}
+
+
+void SingleObjectLookupIteratorState::init(PlanState& planState) {
+  PlanIteratorState::init(planState);
+}
+
+void SingleObjectLookupIteratorState::reset(PlanState& planState) {
+  PlanIteratorState::reset(planState);
+}
+
 
 zstring SingleObjectLookupIterator::getNameAsString() const {
   return "op-zorba:single-object-lookup";
@@ -341,13 +341,26 @@ public:
  * 
  * Author: 
  */
-class SingleObjectLookupIterator : public BinaryBaseIterator<SingleObjectLookupIterator, PlanIteratorState>
+class SingleObjectLookupIteratorState : public PlanIteratorState
+{
+public:
+  store::ObjectLookupHint theHint; //where the key was found in the last object
+
+  SingleObjectLookupIteratorState();
+
+  ~SingleObjectLookupIteratorState();
+
+  void init(PlanState&);
+  void reset(PlanState&);
+};
+
+class SingleObjectLookupIterator : public BinaryBaseIterator<SingleObjectLookupIterator, SingleObjectLookupIteratorState>
 { 
 public:
   SERIALIZABLE_CLASS(SingleObjectLookupIterator);
 
   SERIALIZABLE_CLASS_CONSTRUCTOR2T(SingleObjectLookupIterator,
-    BinaryBaseIterator<SingleObjectLookupIterator, PlanIteratorState>);
+    BinaryBaseIterator<SingleObjectLookupIterator, SingleObjectLookupIteratorState>);
 
   void serialize( ::zorba::serialization::Archiver& ar);
 
@@ -356,7 +369,7 @@ public:
     const QueryLoc& loc,
     PlanIter_t& child1, PlanIter_t& child2)
     : 
-    BinaryBaseIterator<SingleObjectLookupIterator, PlanIteratorState>(sctx, loc, child1, child2)
+    BinaryBaseIterator<SingleObjectLookupIterator, SingleObjectLookupIteratorState>(sctx, loc, child1, child2)
   {}
 
   virtual ~SingleObjectLookupIterator();
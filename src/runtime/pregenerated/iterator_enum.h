@@ -47,6 +47,7 @@
   TYPE_ZorbaInsertBeforeIterator,
   TYPE_ZorbaInsertFirstIterator,
   TYPE_ZorbaInsertLastIterator,
+  TYPE_ZorbaInsertLastDocumentsIterator,
   TYPE_ZorbaApplyInsertFirstIterator,
   TYPE_ZorbaApplyInsertLastIterator,
   TYPE_ZorbaApplyInsertBeforeIterator,
@@ -424,12 +424,14 @@ void FnSubsequenceIteratorState::init(PlanState& planState) {
   PlanIteratorState::init(planState);
   theRemaining = 0;
   theIsChildReset = false;
+  theIsBounded = false;
 }
 
 void FnSubsequenceIteratorState::reset(PlanState& planState) {
   PlanIteratorState::reset(planState);
   theRemaining = 0;
   theIsChildReset = false;
+  theIsBounded = false;
 }
 
 zstring FnSubsequenceIterator::getNameAsString() const {
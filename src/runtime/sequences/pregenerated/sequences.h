@@ -39,6 +39,7 @@
 namespace zorba {
 class StructuredItemHandleHashSet;
 class AtomicItemHandleHashSet;
+class BloomFilter;
 /**
  * 
  *    op:concatenate
@@ -442,6 +443,7 @@ class FnSubsequenceIteratorState : public PlanIteratorState
 public:
   xs_long theRemaining; //
   bool theIsChildReset; //
+  bool theIsBounded; //
 
   FnSubsequenceIteratorState();
 
@@ -473,6 +475,8 @@ public:
 
   zstring getNameAsString() const;
 
+public:
+  bool nextBatchImpl(std::vector<store::Item_t>& result, csize maxItems, PlanState& planState) const;
   void accept(PlanIterVisitor& v) const;
 
   bool nextImpl(store::Item_t& result, PlanState& aPlanState) const;
@@ -744,6 +748,7 @@ class HashSemiJoinIteratorState : public PlanIteratorState
 {
 public:
   StructuredItemHandleHashSet* theRightInput; //
+  BloomFilter* theRightFilter; //
 
   HashSemiJoinIteratorState();
 
@@ -61,6 +61,7 @@
 
 #include "zorbautils/hashset_structured_itemh.h"
 #include "zorbautils/hashset_atomic_itemh.h"
+#include "zorbautils/bloom_filter.h"
 
 namespace zorbatm = zorba::time;
 
@@ -538,7 +539,9 @@ bool FnSubsequenceIterator::nextImpl(store::Item_t& result, PlanState& planState
   if (!theChildren[0]->skip(startPos-1, planState))
     goto done;
 
-  if (theChildren.size() < 3 || lengthDouble.isPosInf())
+  state->theIsBounded = !(theChildren.size() < 3 || lengthDouble.isPosInf());
+
+  if (!state->theIsBounded)
   {
     while (CONSUME(result, 0))
     {
@@ -562,6 +565,66 @@ done:
   STACK_END(state);
 }
 
+
+/*******************************************************************************
+  The first item is produced by nextImpl(), which evaluates the position
+  arguments and skips the input up to the starting position. After that, the
+  input is forwarded in batches, bounded by the number of remaining items.
+********************************************************************************/
+bool FnSubsequenceIterator::nextBatchImpl(
+    std::vector<store::Item_t>& result,
+    csize maxItems,
+    PlanState& planState) const
+{
+  FnSubsequenceIteratorState* state =
+  StateTraitsImpl<FnSubsequenceIteratorState>::getState(planState, theStateOffset);
+
+  if (maxItems == 0)
+    return true;
+
+  if (state->getDuffsLine() == PlanIteratorState::DUFFS_ALLOCATE_RESOURCES)
+  {
+    store::Item_t item;
+
+    if (!nextImpl(item, planState))
+      return false;
+
+    result.push_back(item);
+    --maxItems;
+  }
+
+  bool haveMoreItems = true;
+
+  if (state->theIsBounded &&
+      static_cast<xs_long>(maxItems) > state->theRemaining)
+  {
+    maxItems = static_cast<csize>(state->theRemaining);
+  }
+
+  if (maxItems > 0)
+  {
+    csize const oldSize = result.size();
+
+    haveMoreItems = consumeNextBatch(result,
+                                     theChildren[0].getp(),
+                                     planState,
+                                     maxItems);
+
+    if (state->theIsBounded)
+      state->theRemaining -= static_cast<xs_long>(result.size() - oldSize);
+  }
+
+  if (!haveMoreItems || (state->theIsBounded && state->theRemaining <= 0))
+  {
+    theChildren[0]->reset(planState);
+    state->theIsChildReset = true;
+    return false;
+  }
+
+  return true;
+}
+
+
 /*******************************************************************************
   15.1.10 fn:subsequence
 ********************************************************************************/
@@ -617,6 +680,17 @@ bool SubsequenceIntIterator::nextImpl(store::Item_t& result, PlanState& planStat
   if (theChildren.size() == 3 && state->theRemaining <= 0)
     goto done;
 
+  // At most startPos + length input items are needed; let the input know,
+  // so that it may avoid computing the rest (e.g. a top-k order-by).
+  if (theChildren.size() == 3 &&
+      state->theRemaining <= std::numeric_limits<xs_long>::max() - startPos &&
+      static_cast<uint64_t>(startPos + state->theRemaining) <=
+      static_cast<uint64_t>(std::numeric_limits<csize>::max()))
+  {
+    theChildren[0]->setMaxItems(static_cast<csize>(startPos + state->theRemaining),
+                                planState);
+  }
+
   // Consume and skip all input items that are before the startPos
   if (!theChildren[0]->skip(startPos, planState))
     goto done;
@@ -689,6 +763,12 @@ bool SequencePointAccessIterator::nextImpl(
 
   --startPos;
 
+  if (static_cast<uint64_t>(startPos) <
+      static_cast<uint64_t>(std::numeric_limits<csize>::max()))
+  {
+    theChildren[0]->setMaxItems(static_cast<csize>(startPos + 1), planState);
+  }
+
   // Consume and skip all input items that are before the startPos
   if (!theChildren[0]->skip(startPos, planState))
     goto done;
@@ -889,6 +969,7 @@ bool FnDeepEqualIterator::nextImpl(
 HashSemiJoinIteratorState::HashSemiJoinIteratorState()
 {
   theRightInput = new StructuredItemHandleHashSet(1024, false);
+  theRightFilter = new BloomFilter();
 }
 
 
@@ -896,6 +977,8 @@ HashSemiJoinIteratorState::~HashSemiJoinIteratorState()
 {
   delete theRightInput;
   theRightInput = 0;
+  delete theRightFilter;
+  theRightFilter = 0;
 }
 
 
@@ -909,12 +992,16 @@ void HashSemiJoinIteratorState::reset(PlanState& planState)
 {
   PlanIteratorState::reset(planState);
   theRightInput->clear();
+  theRightFilter->clear();
 }
 
 
 bool HashSemiJoinIterator::nextImpl(store::Item_t& result, PlanState& planState) const
 {
+  typedef StructuredItemHandleHashSet::CompareFunction CompareFunction;
+
   store::Item_t lItem;
+  std::vector<uint32_t> hashes;
   bool not_found;
 
   HashSemiJoinIteratorState* state;
@@ -923,12 +1010,26 @@ bool HashSemiJoinIterator::nextImpl(store::Item_t& result, PlanState& planState)
   // eat the complete right-hand side and hash it
   while ( consumeNext(lItem, theChildren[1].getp(), planState))
   {
+    hashes.push_back(CompareFunction::hash(lItem.getp()));
     state->theRightInput->insert(lItem);
   }
 
+  // A large right-hand side also gets a Bloom filter, so that most of the
+  // left items that are not in it are rejected without a hash set lookup.
+  state->theRightFilter->init(hashes.size());
+
+  if (state->theRightFilter->isEnabled())
+  {
+    for (csize i = 0; i < hashes.size(); ++i)
+      state->theRightFilter->insert(hashes[i]);
+  }
+
   while (consumeNext(result, theChildren[0].getp(), planState))
   {
-    not_found = ! state->theRightInput->exists(result);
+    not_found =
+      (!state->theRightFilter->mayContain(CompareFunction::hash(result.getp())) ||
+       !state->theRightInput->exists(result));
+
     if (not_found == theAntijoin)
       STACK_PUSH(true, state);
   }
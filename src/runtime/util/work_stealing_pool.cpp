@@ -0,0 +1,241 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <exception>
+
+#include "runtime/util/work_stealing_pool.h"
+#include "runtime/util/flowctl_exception.h"
+
+#include "zorbautils/runnable.h"
+
+#include "diagnostics/assert.h"
+#include "diagnostics/xquery_diagnostics.h"
+#include "diagnostics/zorba_exception.h"
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace zorba
+{
+
+/*******************************************************************************
+
+********************************************************************************/
+class WorkStealingPool::Worker : public Runnable
+{
+private:
+  WorkStealingPool  * thePool;
+  csize               theId;
+
+public:
+  Worker(WorkStealingPool* pool, csize id) : thePool(pool), theId(id) {}
+
+  virtual void run()
+  {
+    thePool->executeTasks(theId);
+  }
+
+  // Note: this method is not allowed to throw an exception!
+  virtual void finish()
+  {
+  }
+};
+
+
+/*******************************************************************************
+
+********************************************************************************/
+WorkStealingPool::WorkStealingPool(csize numWorkers)
+  :
+  theNumWorkers(numWorkers > 0 ? numWorkers : 1),
+  theQueues(theNumWorkers),
+  theQueueMutexes(theNumWorkers),
+  theTask(NULL),
+  theHasError(false)
+{
+  for (csize i = 0; i < theNumWorkers; ++i)
+    theQueueMutexes[i] = new Mutex();
+}
+
+
+WorkStealingPool::~WorkStealingPool()
+{
+  for (csize i = 0; i < theNumWorkers; ++i)
+    delete theQueueMutexes[i];
+}
+
+
+/*******************************************************************************
+  Deal out the tasks, start one thread per worker, and wait until all of them
+  have terminated.
+********************************************************************************/
+void WorkStealingPool::run(Task& task, csize numTasks)
+{
+  if (numTasks == 0)
+    return;
+
+  theTask = &task;
+  theHasError = false;
+  theError.reset();
+  theFlowCtlError.reset();
+
+  csize numWorkers = (numTasks < theNumWorkers ? numTasks : theNumWorkers);
+  csize chunkSize = numTasks / numWorkers;
+  csize extra = numTasks % numWorkers;
+  csize pos = 0;
+
+  for (csize i = 0; i < numWorkers; ++i)
+  {
+    csize end = pos + chunkSize + (i < extra ? 1 : 0);
+
+    // the owner pops from the back, so push in reverse order to let each
+    // worker execute its range front to back
+    for (csize j = end; j > pos; --j)
+      theQueues[i].push_back(j - 1);
+
+    pos = end;
+  }
+
+  std::vector<Worker*> workers(numWorkers);
+
+  for (csize i = 0; i < numWorkers; ++i)
+  {
+    workers[i] = new Worker(this, i);
+    workers[i]->start();
+  }
+
+  for (csize i = 0; i < numWorkers; ++i)
+  {
+    // Runnable::join() may miss the finish signal of a thread that is about
+    // to terminate, so wait for the termination first (see Runnable::terminate)
+    while (workers[i]->status() != Runnable::TERMINATED)
+    {
+#ifdef WIN32
+      Sleep(1);
+#else
+      usleep(100);
+#endif
+    }
+
+    workers[i]->join();
+    delete workers[i];
+  }
+
+  for (csize i = 0; i < numWorkers; ++i)
+    theQueues[i].clear();
+
+  theTask = NULL;
+
+  if (theError.get() != NULL)
+    theError->polymorphic_throw();
+
+  if (theFlowCtlError.get() != NULL)
+    throw FlowCtlException(*theFlowCtlError);
+}
+
+
+/*******************************************************************************
+  Pop the next task of the given worker from the back of its own queue. If the
+  queue is empty, steal a task from the front of the queue of another worker.
+********************************************************************************/
+bool WorkStealingPool::popTask(csize workerId, csize& taskPos)
+{
+  if (theHasError)
+    return false;
+
+  {
+    AutoMutex lock(theQueueMutexes[workerId]);
+
+    if (!theQueues[workerId].empty())
+    {
+      taskPos = theQueues[workerId].back();
+      theQueues[workerId].pop_back();
+      return true;
+    }
+  }
+
+  for (csize i = 1; i < theNumWorkers; ++i)
+  {
+    csize victim = (workerId + i) % theNumWorkers;
+
+    AutoMutex lock(theQueueMutexes[victim]);
+
+    if (!theQueues[victim].empty())
+    {
+      taskPos = theQueues[victim].front();
+      theQueues[victim].pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+/*******************************************************************************
+  Main loop of a worker thread. Errors are recorded (the first one wins) and
+  make all the workers stop picking up new tasks.
+********************************************************************************/
+void WorkStealingPool::executeTasks(csize workerId)
+{
+  csize taskPos;
+
+  try
+  {
+    while (popTask(workerId, taskPos))
+    {
+      theTask->execute(taskPos, workerId);
+    }
+  }
+  catch (ZorbaException const& e)
+  {
+    AutoMutex lock(&theErrorMutex);
+    if (!theHasError)
+      theError = clone(e);
+    theHasError = true;
+  }
+  catch (FlowCtlException const& e)
+  {
+    AutoMutex lock(&theErrorMutex);
+    if (!theHasError)
+      theFlowCtlError.reset(new FlowCtlException(e));
+    theHasError = true;
+  }
+  catch (std::exception const& e)
+  {
+    AutoMutex lock(&theErrorMutex);
+    if (!theHasError)
+      theError.reset(NEW_ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR,
+                                         ERROR_PARAMS(e.what())));
+    theHasError = true;
+  }
+  catch (...)
+  {
+    AutoMutex lock(&theErrorMutex);
+    if (!theHasError)
+      theError.reset(NEW_ZORBA_EXCEPTION(zerr::ZXQP0003_INTERNAL_ERROR));
+    theHasError = true;
+  }
+}
+
+
+} // namespace zorba
+/* vim:set et sw=2 ts=2: */
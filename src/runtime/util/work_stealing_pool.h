@@ -0,0 +1,107 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#ifndef ZORBA_RUNTIME_UTIL_WORK_STEALING_POOL_H
+#define ZORBA_RUNTIME_UTIL_WORK_STEALING_POOL_H
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <zorba/zorba_exception.h>
+
+#include "zorbautils/mutex.h"
+
+#include "store/api/shared_types.h"
+
+namespace zorba
+{
+
+class FlowCtlException;
+
+
+/*******************************************************************************
+  A set of worker threads that execute a number of independent tasks. The
+  tasks are identified by their position (0 to numTasks-1) and are dealt out
+  to the workers in contiguous ranges. Each worker pops tasks from the back of
+  its own deque and, once that is empty, steals tasks from the front of the
+  deques of the other workers.
+
+  run() blocks until all the tasks have been executed. If a task raises an
+  error, the remaining tasks are abandoned and the first error is rethrown by
+  run() in the calling thread, after all the workers have stopped.
+
+  The workers are plain Runnables that live for the duration of one run()
+  call, so a pool holds no threads between runs.
+********************************************************************************/
+class WorkStealingPool
+{
+public:
+  class Task
+  {
+  public:
+    virtual ~Task() {}
+
+    /**
+     * Executes the task at the given position. Called concurrently by the
+     * worker threads; workerId is in [0, getNumWorkers()) and can be used to
+     * index per-worker resources.
+     */
+    virtual void execute(csize taskPos, csize workerId) = 0;
+  };
+
+protected:
+  class Worker;
+
+  typedef std::deque<csize> TaskQueue;
+
+protected:
+  csize                               theNumWorkers;
+
+  std::vector<TaskQueue>              theQueues;
+  std::vector<Mutex*>                 theQueueMutexes;
+
+  Task                              * theTask;
+
+  Mutex                               theErrorMutex;
+  volatile bool                       theHasError;
+  std::unique_ptr<ZorbaException>     theError;
+  std::unique_ptr<FlowCtlException>   theFlowCtlError;
+
+public:
+  WorkStealingPool(csize numWorkers);
+
+  ~WorkStealingPool();
+
+  csize getNumWorkers() const { return theNumWorkers; }
+
+  void run(Task& task, csize numTasks);
+
+protected:
+  bool popTask(csize workerId, csize& taskPos);
+
+  void executeTasks(csize workerId);
+
+private:
+  WorkStealingPool(const WorkStealingPool&);
+  void operator=(const WorkStealingPool&);
+};
+
+
+} // namespace zorba
+
+#endif
+/* vim:set et sw=2 ts=2: */
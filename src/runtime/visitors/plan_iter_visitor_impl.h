@@ -42,6 +42,8 @@ PIV_VISIT_DECL( CommentIterator );
 PIV_VISIT_DECL( CompareIterator );
 PIV_VISIT_DECL( CreateIndexIterator );
 PIV_VISIT_DECL( CreateInternalIndexIterator );
+PIV_VISIT_DECL( CreateHashJoinIterator );
+PIV_VISIT_DECL( ProbeHashJoinIterator );
 PIV_VISIT_DECL( CtxVarAssignIterator );
 PIV_VISIT_DECL( CtxVarDeclareIterator );
 PIV_VISIT_DECL( CtxVarIsSetIterator );
@@ -83,6 +85,9 @@ PIV_VISIT_DECL( FnMinMaxIterator );
 PIV_VISIT_DECL( FollowingAxisIterator );
 PIV_VISIT_DECL( ForVarIterator );
 PIV_VISIT_DECL( FTContainsIterator );
+#ifndef ZORBA_NO_FULL_TEXT
+PIV_VISIT_DECL( FullTextIndexTokensIterator );
+#endif
 PIV_VISIT_DECL( FunctionItemIterator );
 PIV_VISIT_DECL( GeneralIndexEntryBuilderIterator );
 PIV_VISIT_DECL( GenericArithIterator<AddOperation> );
@@ -122,6 +127,9 @@ PIV_VISIT_DECL( PiIterator );
 PIV_VISIT_DECL( PlanIterator );
 PIV_VISIT_DECL( PrecedingAxisIterator );
 PIV_VISIT_DECL( PrecedingReverseAxisIterator );
+#ifndef ZORBA_NO_FULL_TEXT
+PIV_VISIT_DECL( ProbeIndexFullTextIterator );
+#endif
 PIV_VISIT_DECL( ProbeIndexPointGeneralIterator );
 PIV_VISIT_DECL( ProbeIndexPointValueIterator );
 PIV_VISIT_DECL( ProbeIndexRangeGeneralIterator );
@@ -34,6 +34,8 @@ class CommentIterator;
 class CompareIterator;
 class CreateIndexIterator;
 class CreateInternalIndexIterator;
+class CreateHashJoinIterator;
+class ProbeHashJoinIterator;
 class CtxVarAssignIterator;
 class CtxVarDeclareIterator;
 class CtxVarIsSetIterator;
@@ -70,6 +72,7 @@ class FnMinMaxIterator;
 class FollowingAxisIterator;
 class ForVarIterator;
 class FTContainsIterator;
+class FullTextIndexTokensIterator;
 class FunctionItemIterator;
 class GeneralIndexEntryBuilderIterator;
 class HoistIterator;
@@ -102,6 +105,7 @@ class PiIterator;
 class PlanIterator;
 class PrecedingAxisIterator;
 class PrecedingReverseAxisIterator;
+class ProbeIndexFullTextIterator;
 class ProbeIndexPointGeneralIterator;
 class ProbeIndexPointValueIterator;
 class ProbeIndexRangeGeneralIterator;
@@ -83,6 +83,8 @@ namespace zorba{
 
     class ZorbaInsertLastIterator;
 
+    class ZorbaInsertLastDocumentsIterator;
+
     class ZorbaApplyInsertFirstIterator;
 
     class ZorbaApplyInsertLastIterator;
@@ -858,6 +860,9 @@ public:
     virtual void beginVisit ( const ZorbaInsertLastIterator& ) = 0;
     virtual void endVisit   ( const ZorbaInsertLastIterator& ) = 0;
 
+    virtual void beginVisit ( const ZorbaInsertLastDocumentsIterator& ) = 0;
+    virtual void endVisit   ( const ZorbaInsertLastDocumentsIterator& ) = 0;
+
     virtual void beginVisit ( const ZorbaApplyInsertFirstIterator& ) = 0;
     virtual void endVisit   ( const ZorbaApplyInsertFirstIterator& ) = 0;
 
@@ -139,6 +139,9 @@ namespace zorba {
     void beginVisit( const ZorbaInsertLastIterator& );
     void endVisit  ( const ZorbaInsertLastIterator& );
 
+    void beginVisit( const ZorbaInsertLastDocumentsIterator& );
+    void endVisit  ( const ZorbaInsertLastDocumentsIterator& );
+
     void beginVisit( const ZorbaApplyInsertFirstIterator& );
     void endVisit  ( const ZorbaApplyInsertFirstIterator& );
 
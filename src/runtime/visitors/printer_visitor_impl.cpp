@@ -110,6 +110,21 @@ void PrinterVisitor::printCommons( PlanIterator const *pi, int id ) {
     thePrinter.addDecAttribute( "prof-cpu", pd.data_.cpu_time_);
     thePrinter.addDecAttribute( "prof-wall", pd.data_.wall_time_);
     thePrinter.addAttribute( "prof-name", pi->getNameAsString().str() );
+
+    // The arena is shared by all the iterators of the plan, so its usage is
+    // reported once, with the root iterator.
+    QueryArena const *const arena = thePlanState->getArenaIfAny();
+    if ( pi == theIterator && arena ) {
+      thePrinter.addIntAttribute(
+        "prof-arena-allocs", static_cast<xs_long>( arena->getNumAllocations() )
+      );
+      thePrinter.addIntAttribute(
+        "prof-arena-peak", static_cast<xs_long>( arena->getPeakBytesInUse() )
+      );
+      thePrinter.addIntAttribute(
+        "prof-arena-pages", static_cast<xs_long>( arena->getPageBytes() )
+      );
+    }
   }
 }
 
@@ -230,6 +245,10 @@ DEF_VISIT( OrIterator )
 DEF_VISIT( PiIterator )
 DEF_VISIT( ProbeIndexPointGeneralIterator )
 DEF_VISIT( ProbeIndexRangeGeneralIterator )
+#ifndef ZORBA_NO_FULL_TEXT
+DEF_VISIT( FullTextIndexTokensIterator )
+DEF_VISIT( ProbeIndexFullTextIterator )
+#endif
 DEF_VISIT( RefreshIndexIterator )
 DEF_VISIT( RenameIterator )
 DEF_VISIT( ReplaceIterator )
@@ -336,6 +355,8 @@ DEF_OP_T_VISIT( SpecificNumArithIterator, SubtractOperation, INTEGER )
     thePrinter.startBeginVisit( #CLASS, ++theId );    \
     if ( i.hasSkip() )                                \
       thePrinter.addBoolAttribute( "skip", true );    \
+    if ( i.projectsColumn() )                         \
+      thePrinter.addBoolAttribute( "project-column", true ); \
     printCommons( &i, theId );                        \
     thePrinter.endBeginVisit( theId );                \
   }                                                   \
@@ -366,6 +387,7 @@ DEF_INSERT_NODES_VISIT( ZorbaInsertBeforeIterator )
 DEF_INSERT_NODES_VISIT( ZorbaInsertFirstIterator )
 DEF_INSERT_NODES_VISIT( ZorbaInsertIterator )
 DEF_INSERT_NODES_VISIT( ZorbaInsertLastIterator )
+DEF_INSERT_NODES_VISIT( ZorbaInsertLastDocumentsIterator )
 
 ////////// special cases //////////////////////////////////////////////////////
 
@@ -406,6 +428,22 @@ void PrinterVisitor::beginVisit( CreateInternalIndexIterator const &i ) {
 }
 DEF_END_VISIT( CreateInternalIndexIterator )
 
+void PrinterVisitor::beginVisit( CreateHashJoinIterator const &i ) {
+  thePrinter.startBeginVisit( "CreateHashJoinIterator", ++theId );
+  thePrinter.addAttribute( "name", i.getName()->show().str() );
+  printCommons( &i, theId );
+  thePrinter.endBeginVisit( theId );
+}
+DEF_END_VISIT( CreateHashJoinIterator )
+
+void PrinterVisitor::beginVisit( ProbeHashJoinIterator const &i ) {
+  thePrinter.startBeginVisit( "ProbeHashJoinIterator", ++theId );
+  thePrinter.addAttribute( "name", i.getName()->show().str() );
+  printCommons( &i, theId );
+  thePrinter.endBeginVisit( theId );
+}
+DEF_END_VISIT( ProbeHashJoinIterator )
+
 void PrinterVisitor::beginVisit( CtxVarAssignIterator const &i ) {
   thePrinter.startBeginVisit( "CtxVarAssignIterator", ++theId );
   thePrinter.addIntAttribute( "varid", i.getVarId() );
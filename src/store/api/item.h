@@ -47,6 +47,8 @@ namespace store
 
 typedef StoreConsts::NodeKind NodeKind;
 
+class ObjectLookupHint;
+
 /*******************************************************************************
    Class Item represents an "item" as defined by the XQuery Data Model (XDM)
    [http://www.w3.org/TR/xquery-semantics/doc-fs-Item]
@@ -619,6 +621,18 @@ public:
   virtual bool
   isRecursive() const;
 
+  /**
+   *  @return An iterator over the element descendants of this node that have
+   *          the given name, in document order, or NULL.
+   *
+   * Note: This function is used purely for enabling certain optimizations in
+   * the query processor, which walks the subtree of the node if it returns
+   * NULL. A store may return NULL for any node, e.g. if it keeps no summary
+   * of the element names of the node's tree.
+   */
+  virtual Iterator_t
+  getDescendantElements(const Item* qname) const;
+
   /** Accessor for document node
    *  @return  uri?
    */
@@ -944,6 +958,17 @@ public:
   virtual store::Item_t
   getObjectValue(const store::Item_t& key) const;
 
+  /**
+   * defined on JSONObject
+   * Like getObjectValue(key), but for callers that look up the same key in
+   * many objects: the store may remember in the hint where it found the key,
+   * and use that to find it faster in the next objects. The default
+   * implementation ignores the hint.
+   * @return the value associated with a given key
+   */
+  virtual store::Item_t
+  getObjectValue(const store::Item_t& key, ObjectLookupHint& hint) const;
+
   /**
    * defined on JSONObject
    * 
@@ -1038,6 +1063,39 @@ private:
 ZORBA_DLL_PUBLIC
 std::ostream& operator<<( std::ostream&, Item::ItemKind );
 
+
+/*******************************************************************************
+  The memo of the lookups of a key in a series of objects (see
+  Item::getObjectValue(key, hint)). Its meaning is private to the store; the
+  caller only keeps it between lookups.
+
+  theKey:
+  -------
+  The key item of the last lookup that the store memoized. It is held so that
+  it cannot be freed and its address reused by another key.
+
+  theLayout:
+  ----------
+  The layout of the objects in which the key is at position thePosition.
+********************************************************************************/
+class ObjectLookupHint
+{
+public:
+  Item_t        theKey;
+  const void  * theLayout;
+  size_t        thePosition;
+
+public:
+  ObjectLookupHint() : theLayout(NULL), thePosition(0) {}
+
+  void clear()
+  {
+    theKey = NULL;
+    theLayout = NULL;
+    thePosition = 0;
+  }
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 } // namespace store
@@ -188,6 +188,14 @@ public:
   virtual void close() = 0;
 
   virtual void count(Item_t& result) = 0;
+
+  /**
+   * Like next(), but instead of the next node that satisfies the probe
+   * condition, returns the item stored in the given column of the key of
+   * that node's index entry. Nodes whose key is the empty sequence in that
+   * column are skipped. Only value indexes support this method.
+   */
+  virtual bool nextKeyColumn(Item_t& result, csize column) = 0;
 };
 
 
@@ -240,6 +240,28 @@ public:
         std::istream* stream,
         const LoadProperties& loadProperties) = 0;
 
+  /**
+   * Load several documents to the store. The documents are parsed in
+   * parallel, each into its own tree, on up to numThreads threads. They are
+   * returned in docs, in the order of the given streams, once all of them
+   * have been loaded. If a document cannot be loaded, the error of the first
+   * such document (in stream order) is raised.
+   *
+   * @param docUris The uris of the documents to load; they also serve as the
+   *        base uris of the documents.
+   * @param streams User heap allocated streams, one per uri. They will NOT be
+   *        freed by Zorba.
+   * @param loadProperties Properties on how to do the document loading
+   * @param numThreads The max number of threads to use for parsing.
+   * @param docs On return, the newly created documents.
+   */
+  virtual void loadDocuments(
+        const std::vector<zstring>& docUris,
+        const std::vector<std::istream*>& streams,
+        const LoadProperties& loadProperties,
+        csize numThreads,
+        std::vector<Item_t>& docs) = 0;
+
 
   /**
    * Get an rchandle to the root node of the document with the given uri.
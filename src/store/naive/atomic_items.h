@@ -33,6 +33,7 @@
 #include <zorba/store_consts.h>
 #include "store_defs.h"
 #include "shared_types.h"
+#include "item_pool.h"
 #include "tree_id.h"
 
 #ifndef ZORBA_NO_FULL_TEXT
@@ -69,7 +70,8 @@ typedef store::ItemHandle<QNameItem> QNameItem_t;
 
 
 /******************************************************************************
-
+  Base class of the atomic items. Atomic items are allocated from the ItemPool,
+  since queries create and drop them at a high rate.
 *******************************************************************************/
 
 class AtomicItem : public store::Item
@@ -85,6 +87,13 @@ public:
 
   virtual ~AtomicItem() {}
 
+  static void* operator new(size_t size) { return ItemPool::allocate(size); }
+
+  static void operator delete(void* p, size_t size)
+  {
+    ItemPool::deallocate(p, size);
+  }
+
   SYNC_CODE(RCLock* getRCLock() const { return &theRCLock; })
 
   void getTypedValue(store::Item_t& val, store::Iterator_t& iter) const;
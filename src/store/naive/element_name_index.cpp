@@ -0,0 +1,171 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include "element_name_index.h"
+#include "node_items.h"
+#include "atomic_items.h"
+
+
+namespace zorba { namespace simplestore {
+
+const csize ElementNameIndex::MIN_ELEMENTS = 256;
+
+
+/*******************************************************************************
+
+********************************************************************************/
+ElementNameIndex::ElementNameIndex()
+  :
+  theNames(64, false),
+  theNumElements(0)
+{
+}
+
+
+ElementNameIndex::~ElementNameIndex()
+{
+  NameMap::iterator ite = theNames.begin();
+  NameMap::iterator end = theNames.end();
+
+  for (; ite != end; ++ite)
+    delete (*ite).second;
+}
+
+
+/*******************************************************************************
+  Build the index of the tree rooted at the given node. Return NULL if the tree
+  has fewer than MIN_ELEMENTS elements, since walking it is cheap enough, or if
+  it contains connector nodes, since the nodes reached through them belong to
+  other trees and cannot be located by the ordpaths of this tree.
+********************************************************************************/
+ElementNameIndex* ElementNameIndex::build(const XmlNode* root)
+{
+  store::StoreConsts::NodeKind kind = root->getNodeKind();
+
+  if (kind != store::StoreConsts::documentNode &&
+      kind != store::StoreConsts::elementNode)
+    return NULL;
+
+  ElementNameIndex* index = new ElementNameIndex();
+
+  if (!index->addElements(static_cast<const InternalNode*>(root)) ||
+      index->theNumElements < MIN_ELEMENTS)
+  {
+    delete index;
+    return NULL;
+  }
+
+  return index;
+}
+
+
+/*******************************************************************************
+  Add the given node, if it is an element, and its element descendants to the
+  index, in document order. The subtree is walked with an explicit stack, since
+  the trees that need an index are typically deep ones.
+********************************************************************************/
+bool ElementNameIndex::addElements(const InternalNode* root)
+{
+  typedef std::pair<const InternalNode*, csize> PathEntry;
+
+  std::vector<PathEntry> path;
+  path.push_back(PathEntry(root, 0));
+
+  const InternalNode* node = root;
+
+  while (true)
+  {
+    if (node->getNodeKind() == store::StoreConsts::elementNode)
+    {
+      ElementNode* elem = const_cast<ElementNode*>(
+                          static_cast<const ElementNode*>(node));
+
+      const store::Item* qname =
+      static_cast<const QNameItem*>(elem->getNodeName())->getNormalized();
+
+      NodeList* nodes;
+      if (!theNames.get(qname, nodes))
+      {
+        nodes = new NodeList;
+        theNames.insert(qname, nodes);
+      }
+
+      nodes->push_back(elem);
+      ++theNumElements;
+    }
+
+    // Move to the next element in document order.
+    node = NULL;
+
+    while (node == NULL && !path.empty())
+    {
+      PathEntry& top = path.back();
+
+      if (top.second == top.first->numChildren())
+      {
+        path.pop_back();
+        continue;
+      }
+
+      XmlNode* child = *(top.first->childrenBegin() + top.second++);
+
+      if (child->isConnectorNode())
+        return false;
+
+      if (child->getNodeKind() == store::StoreConsts::elementNode)
+        node = static_cast<const InternalNode*>(child);
+    }
+
+    if (node == NULL)
+      return true;
+
+    path.push_back(PathEntry(node, 0));
+  }
+}
+
+
+/*******************************************************************************
+  Return the elements with the given name, or NULL if there are none.
+********************************************************************************/
+const ElementNameIndex::NodeList* ElementNameIndex::getElements(
+    const store::Item* qname) const
+{
+  NodeList* nodes;
+
+  if (theNames.get(static_cast<const QNameItem*>(qname)->getNormalized(), nodes))
+    return nodes;
+
+  return NULL;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+bool ElementNameIterator::next(store::Item_t& result)
+{
+  if (thePos == theEnd)
+    return false;
+
+  result = (*theNodes)[thePos++];
+  return true;
+}
+
+
+} // namespace simplestore
+} // namespace zorba
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_SIMPLE_STORE_ELEMENT_NAME_INDEX
+#define ZORBA_SIMPLE_STORE_ELEMENT_NAME_INDEX
+
+#include <vector>
+
+#include "store/api/iterator.h"
+
+#include "shared_types.h"
+#include "hashmap_nodep.h"
+
+
+namespace zorba { namespace simplestore {
+
+class XmlNode;
+class ElementNode;
+class InternalNode;
+
+
+/*******************************************************************************
+  A structural summary of an xml tree, which maps each element name to the
+  elements of the tree with that name, in document order. It lets the
+  descendant axis return the descendants of a node that have a given name
+  without walking the whole subtree of the node (see
+  InternalNode::getDescendantElements()).
+
+  Only the trees of collections get such an index (see XmlTree::getNameIndex()),
+  since they are queried repeatedly. The index is built on first use, and it is
+  dropped by the PULs that modify the tree (see CollectionPul::applyUpdates()).
+  It is reference counted, so that the iterators over it remain valid if it is
+  dropped while they are in use.
+
+  theNames:
+  ---------
+  Maps the normalized qname of each element name in the tree to the elements
+  with that name. The elements are not reference counted; they are kept alive
+  by the tree, which keeps the index.
+********************************************************************************/
+class ElementNameIndex : public SimpleRCObject
+{
+public:
+  typedef std::vector<ElementNode*> NodeList;
+
+  static const csize MIN_ELEMENTS;
+
+protected:
+  typedef ItemPointerHashMap<NodeList*> NameMap;
+
+protected:
+  NameMap   theNames;
+  csize     theNumElements;
+
+public:
+  ElementNameIndex();
+
+  ~ElementNameIndex();
+
+  static ElementNameIndex* build(const XmlNode* root);
+
+  csize numElements() const { return theNumElements; }
+
+  const NodeList* getElements(const store::Item* qname) const;
+
+protected:
+  bool addElements(const InternalNode* node);
+};
+
+
+typedef rchandle<ElementNameIndex> ElementNameIndex_t;
+
+
+/*******************************************************************************
+  Iterator over a range of the elements with a given name in an element name
+  index.
+********************************************************************************/
+class ElementNameIterator : public store::Iterator
+{
+protected:
+  ElementNameIndex_t                  theIndex;
+  const ElementNameIndex::NodeList  * theNodes;
+  csize                               theBegin;
+  csize                               theEnd;
+  csize                               thePos;
+
+public:
+  ElementNameIterator(
+      ElementNameIndex* index,
+      const ElementNameIndex::NodeList* nodes,
+      csize begin,
+      csize end)
+    :
+    theIndex(index),
+    theNodes(nodes),
+    theBegin(begin),
+    theEnd(end),
+    thePos(begin)
+  {
+  }
+
+  void open() { thePos = theBegin; }
+
+  bool next(store::Item_t& result);
+
+  void reset() { thePos = theBegin; }
+
+  void close() { }
+};
+
+
+} // namespace simplestore
+} // namespace zorba
+
+#endif
+/* vim:set et sw=2 ts=2: */
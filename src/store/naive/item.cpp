@@ -56,18 +56,17 @@ void Item::addReference() const
   {
   case NODE:
   {
-    SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->acquire());
-    ++(*theUnion.treeRCPtr);
-    ++theRefCount;
-    SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->release());
+    // No lock here: many threads may be copying handles to the nodes of the
+    // same (cached) tree at the same time. The tree counter is the one that
+    // decides when the nodes are freed, so it is incremented first.
+    rc_increment(theUnion.treeRCPtr);
+    rc_increment(&theRefCount);
     return;
   }
   case OBJECT:
   case ARRAY:
   {
-    SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->acquire());
-    ++theRefCount;
-    SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->release());
+    rc_increment(&theRefCount);
     return;
   }
   case ATOMIC:
@@ -129,35 +128,23 @@ void Item::removeReference()
   {
   case NODE:
   {
-    SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->acquire());
-
     assert(theRefCount > 0);
 
-    --theRefCount;
-    if (--(*theUnion.treeRCPtr) == 0)
-    {
-      SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->release());
+    rc_add(&theRefCount, -1);
+
+    if (rc_add(theUnion.treeRCPtr, -1) == 0)
       free();
-      return;
-    }
 
-    SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->release());
     return;
   }
   case OBJECT:
   case ARRAY:
   {
-    SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->acquire());
     assert(theRefCount > 0);
 
-    if (--theRefCount == 0)
-    {
-      SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->release());
+    if (rc_add(&theRefCount, -1) == 0)
       free();
-      return;
-    }
 
-    SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->release());
     return;
   }
   case ATOMIC:
@@ -228,18 +215,11 @@ long Item::getRefCount() const
   switch (getKind())
   {
     case NODE:
-    {
-      SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->acquire());
-      refCount = theRefCount;
-      SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->release());
-      break;
-    }
     case OBJECT:
     case ARRAY:
     {
-      SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->acquire());
+      // The counters of these items are updated without a lock.
       refCount = theRefCount;
-      SYNC_CODE(static_cast<const simplestore::json::JSONItem*>(this)->getRCLock()->release());
       break;
     }
     case ATOMIC:
@@ -959,6 +939,12 @@ bool Item::isRecursive() const
 }
 
 
+store::Iterator_t Item::getDescendantElements(const Item* qname) const
+{
+  return NULL;
+}
+
+
 void Item::getDocumentURI(zstring& uri) const
 {
   throw ZORBA_EXCEPTION(
@@ -1451,6 +1437,12 @@ Item::getObjectValue(const store::Item_t&) const
   );
 }
 
+store::Item_t
+Item::getObjectValue(const store::Item_t& key, ObjectLookupHint&) const
+{
+  return getObjectValue(key);
+}
+
 
 xs_integer
 Item::getNumObjectPairs() const
@@ -1527,11 +1519,11 @@ void Item::swap(Item* anotherItem)
     assert(anotherItem->theUnion.treeRCPtr);
     std::swap(theUnion.treeRCPtr, anotherItem->theUnion.treeRCPtr);
 
-    // Adjust counters.
-    *theUnion.treeRCPtr += theRefCount;
-    *theUnion.treeRCPtr -= anotherItem->theRefCount;
-    *anotherItem->theUnion.treeRCPtr -= theRefCount;
-    *anotherItem->theUnion.treeRCPtr += anotherItem->theRefCount;
+    // Adjust counters. Handles to the nodes are copied without taking the
+    // locks, so the tree counters must be updated atomically.
+    rc_add(theUnion.treeRCPtr, theRefCount - anotherItem->theRefCount);
+    rc_add(anotherItem->theUnion.treeRCPtr,
+           anotherItem->theRefCount - theRefCount);
     SYNC_CODE(static_cast<const simplestore::XmlNode*>(this)->getRCLock()->release());
     SYNC_CODE(static_cast<const simplestore::XmlNode*>(anotherItem)->getRCLock()->release());
     return;
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include <new>
+
+#include "item_pool.h"
+
+
+#if defined ZORBA_FOR_ONE_THREAD_ONLY
+#define ZORBA_ITEM_POOL
+#define ZORBA_ITEM_POOL_LOCAL static
+#elif defined ZORBA_CXX_THREAD_LOCAL
+#define ZORBA_ITEM_POOL
+#define ZORBA_ITEM_POOL_LOCAL static thread_local
+#endif
+
+
+namespace zorba { namespace simplestore {
+
+#ifdef ZORBA_ITEM_POOL
+
+namespace
+{
+
+struct FreeBlock
+{
+  FreeBlock  * theNext;
+};
+
+
+/*******************************************************************************
+  The free lists of a thread. The struct is trivially destructible, so it stays
+  usable while the other thread-local objects of the thread are destroyed; once
+  the releaser has returned the lists to the heap, theIsClosed is set and the
+  blocks that are dropped afterwards go straight back to the heap.
+********************************************************************************/
+struct FreeLists
+{
+  FreeBlock  * theHeads[ItemPool::NUM_CLASSES];
+  size_t       theSizes[ItemPool::NUM_CLASSES];
+  bool         theIsOpen;
+  bool         theIsClosed;
+};
+
+
+struct FreeListsReleaser
+{
+  FreeLists  * theLists;
+
+  ~FreeListsReleaser()
+  {
+    if (theLists == NULL)
+      return;
+
+    for (size_t c = 0; c < ItemPool::NUM_CLASSES; ++c)
+    {
+      while (theLists->theHeads[c] != NULL)
+      {
+        FreeBlock* block = theLists->theHeads[c];
+        theLists->theHeads[c] = block->theNext;
+        ::operator delete(block);
+      }
+
+      theLists->theSizes[c] = 0;
+    }
+
+    theLists->theIsClosed = true;
+  }
+};
+
+
+ZORBA_ITEM_POOL_LOCAL FreeLists theFreeLists;
+
+ZORBA_ITEM_POOL_LOCAL FreeListsReleaser theReleaser;
+
+
+inline FreeLists& getFreeLists()
+{
+  FreeLists& lists = theFreeLists;
+
+  // The first use of the releaser registers its destructor for this thread.
+  if (!lists.theIsOpen)
+  {
+    lists.theIsOpen = true;
+    theReleaser.theLists = &lists;
+  }
+
+  return lists;
+}
+
+}
+
+#endif // ZORBA_ITEM_POOL
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void* ItemPool::allocate(size_t size)
+{
+#ifdef ZORBA_ITEM_POOL
+  size_t c = (size - 1) / GRANULE;
+
+  if (c < NUM_CLASSES)
+  {
+    FreeLists& lists = getFreeLists();
+    FreeBlock* block = lists.theHeads[c];
+
+    if (block != NULL)
+    {
+      lists.theHeads[c] = block->theNext;
+      --lists.theSizes[c];
+      return block;
+    }
+
+    return ::operator new((c + 1) * GRANULE);
+  }
+#endif
+
+  return ::operator new(size);
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void ItemPool::deallocate(void* block, size_t size)
+{
+#ifdef ZORBA_ITEM_POOL
+  size_t c = (size - 1) / GRANULE;
+
+  if (c < NUM_CLASSES)
+  {
+    FreeLists& lists = getFreeLists();
+
+    if (!lists.theIsClosed && lists.theSizes[c] < MAX_FREE)
+    {
+      FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+      freeBlock->theNext = lists.theHeads[c];
+      lists.theHeads[c] = freeBlock;
+      ++lists.theSizes[c];
+      return;
+    }
+  }
+#endif
+
+  ::operator delete(block);
+}
+
+
+} // namespace simplestore
+} // namespace zorba
+/* vim:set et sw=2 ts=2: */
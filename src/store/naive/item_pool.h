@@ -0,0 +1,65 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_SIMPLE_STORE_ITEM_POOL
+#define ZORBA_SIMPLE_STORE_ITEM_POOL
+
+#include <cstddef>
+
+#include <zorba/config.h>
+
+
+namespace zorba { namespace simplestore {
+
+/*******************************************************************************
+  The allocator of the atomic items (see AtomicItem::operator new).
+
+  Queries create and drop atomic items at a very high rate, and most of them
+  are a few dozen bytes long. The pool keeps the memory blocks of the dropped
+  items in free lists, one per size class of GRANULE bytes, and hands them out
+  again to the next items of the same size class, so that most item allocations
+  and deallocations do not reach the heap allocator.
+
+  The free lists are per thread, so they need no locking. Since an item may be
+  dropped by a thread other than the one that created it, a block may move to
+  the free lists of another thread. Each free list holds at most MAX_FREE
+  blocks, and the lists of a thread are returned to the heap when the thread
+  exits. Blocks larger than the largest size class are not pooled.
+
+  If the compiler does not support thread-local variables and zorba is built
+  for several threads, the pool is disabled and just calls the heap allocator.
+********************************************************************************/
+class ItemPool
+{
+public:
+  enum
+  {
+    GRANULE = 16,
+    NUM_CLASSES = 8,
+    MAX_FREE = 1024
+  };
+
+public:
+  static void* allocate(size_t size);
+
+  static void deallocate(void* block, size_t size);
+};
+
+
+} // namespace simplestore
+} // namespace zorba
+
+#endif
+/* vim:set et sw=2 ts=2: */
@@ -191,30 +191,39 @@ store::Item* JSONObject::getType() const
 }
 
 
+/******************************************************************************
+
+*******************************************************************************/
+SimpleJSONObject::SimpleJSONObject()
+  :
+  JSONObject(),
+  theShape(GET_STORE().getObjectShapes().getEmpty())
+{
+}
+
+
 /******************************************************************************
 
 *******************************************************************************/
 SimpleJSONObject::~SimpleJSONObject()
 {
   ASSERT_INVARIANT();
-  for (Pairs::iterator lIter = thePairs.begin();
-       lIter != thePairs.end();
+  for (Values::iterator lIter = theValues.begin();
+       lIter != theValues.end();
        ++lIter)
   {
-    store::Item* lName = lIter->first;
-    store::Item* lChild = lIter->second;
+    store::Item* lChild = *lIter;
     if (getCollection() != NULL && lChild->isStructuredItem())
     {
       assert(dynamic_cast<StructuredItem*>(lChild));
       StructuredItem* lStructuredItem = static_cast<StructuredItem*>(lChild);
       lStructuredItem->setCollectionTreeInfo(NULL);
     }
-    lName->removeReference();
     lChild->removeReference();
   }
-  theKeys.clear();
-  thePairs.clear();
-  ASSERT_INVARIANT();
+  theValues.clear();
+  ObjectShape::release(theShape);
+  theShape = NULL;
 }
 
 
@@ -224,8 +233,9 @@ SimpleJSONObject::~SimpleJSONObject()
 
 size_t SimpleJSONObject::alloc_size() const
 {
-  return  ztd::alloc_sizeof( theKeys )
-        + ztd::alloc_sizeof( thePairs );
+  // A shared shape is accounted to the store rather than to its objects.
+  return  ztd::alloc_sizeof( theValues )
+        + ( theShape->isShared() ? 0 : theShape->alloc_size() );
 }
 
 size_t SimpleJSONObject::dynamic_size() const
@@ -247,22 +257,21 @@ store::Item* SimpleJSONObject::copy(
   {
     lNewObject = new SimpleJSONObject();
 
-    for (Pairs::const_iterator lIter = thePairs.begin();
-         lIter != thePairs.end();
+    // The copy has the same keys, so it can take the same shape.
+    lNewObject->theShape = (theShape->isShared() ? theShape : theShape->clone());
+    lNewObject->theValues.reserve(theValues.size());
+
+    for (Values::const_iterator lIter = theValues.begin();
+         lIter != theValues.end();
          ++lIter)
     {
-      store::Item_t lKey = lIter->first;
-      store::Item_t lValue = lIter->second;
-      
+      store::Item_t lValue = *lIter;
+
       if (lValue->isStructuredItem())
-      {
-        store::Item_t lCopiedValue = lValue->copy(NULL, copymode);
-        lNewObject->add(lKey, lCopiedValue, false);
-      }
-      else
-      {
-        lNewObject->add(lKey, lValue, false);
-      }
+        lValue = lValue->copy(NULL, copymode);
+
+      lValue->addReference();
+      lNewObject->theValues.push_back(lValue.getp());
     }
   }
 
@@ -292,9 +301,9 @@ bool SimpleJSONObject::add(
   aName->getStringValue2( zname );
   const char *const lName = zname.c_str();
 
-  Keys::iterator ite = theKeys.find(lName);
+  size_type lPosition;
 
-  if (ite == theKeys.end())
+  if (!theShape->find(lName, lPosition))
   {
     store::Item* lValue = aValue.getp();
 
@@ -305,9 +314,8 @@ bool SimpleJSONObject::add(
       lStructuredItem->setCollectionTreeInfo(theCollectionInfo);
     }
     
-    theKeys.insert( std::make_pair( lName, thePairs.size() ) );
-    thePairs.push_back(std::make_pair(aName.getp(), lValue));
-    aName->addReference();
+    theShape = theShape->add(aName.getp());
+    theValues.push_back(lValue);
     lValue->addReference();
 
     ASSERT_INVARIANT();
@@ -315,11 +323,9 @@ bool SimpleJSONObject::add(
   }
   else if (accumulate)
   {
-    size_type lPosition = ite->second;
-
-    assert(thePairs[lPosition].first->getStringValue() == lName);
+    assert(theShape->getKey(lPosition)->getStringValue() == lName);
 
-    store::Item* lValue = thePairs[lPosition].second;
+    store::Item* lValue = theValues[lPosition];
 
     if (lValue->isArray())
     {
@@ -338,7 +344,7 @@ bool SimpleJSONObject::add(
 
       lValue->removeReference();
       array->addReference();
-      thePairs[lPosition].second = array;
+      theValues[lPosition] = array;
     }
     ASSERT_INVARIANT();
     return true;
@@ -360,16 +366,14 @@ store::Item_t SimpleJSONObject::remove(const store::Item_t& aName)
   aName->getStringValue2( zname );
   const char *const lName = zname.c_str();
 
-  Keys::iterator lIter = theKeys.find(lName);
-  if (lIter == theKeys.end())
+  size_type lPosition;
+  if (!theShape->find(lName, lPosition))
   {
     ASSERT_INVARIANT();
     return NULL;
   }
-  size_type lPosition = lIter->second;
-  
-  store::Item *const lKey = thePairs[lPosition].first;
-  store::Item_t lValue( thePairs[lPosition].second );
+
+  store::Item_t lValue( theValues[lPosition] );
 
   if (getCollection() != NULL && (lValue->isStructuredItem()))
   {
@@ -378,25 +382,10 @@ store::Item_t SimpleJSONObject::remove(const store::Item_t& aName)
     lStructuredItem->setCollectionTreeInfo(NULL);
   }
 
-  lKey->removeReference();
   lValue->removeReference();
 
-  thePairs.erase(thePairs.begin() + lPosition);
-  theKeys.erase(lIter);
-
-  if (lPosition < thePairs.size())
-  {
-    Keys::iterator lKeysIte = theKeys.begin();
-    Keys::iterator lKeysEnd = theKeys.end();
-    for (; lKeysIte != lKeysEnd; ++lKeysIte)
-    {
-      size_type lPos = lKeysIte->second;
-      if (lPos > lPosition)
-      {
-        lKeysIte->second = lPos - 1;
-      }
-    }
-  }
+  theValues.erase(theValues.begin() + lPosition);
+  theShape = theShape->remove(lPosition);
 
   ASSERT_INVARIANT();
   return lValue;
@@ -415,17 +404,16 @@ store::Item_t SimpleJSONObject::setValue(
   aName->getStringValue2( zname );
   const char *const lName = zname.c_str();
 
-  Keys::const_iterator lIter = theKeys.find(lName);
-  if (lIter == theKeys.end())
+  size_type lPosition;
+  if (!theShape->find(lName, lPosition))
   {
     ASSERT_INVARIANT();
     return 0;
   }
-  size_type lPosition = lIter->second;
 
-  assert(thePairs[lPosition].first->getStringValue() == lName);
+  assert(theShape->getKey(lPosition)->getStringValue() == lName);
 
-  store::Item_t lOldValue = thePairs[lPosition].second;
+  store::Item_t lOldValue = theValues[lPosition];
 
   if (getCollection() != NULL)
   {
@@ -448,7 +436,7 @@ store::Item_t SimpleJSONObject::setValue(
 
   lOldValue->removeReference();
   aValue->addReference();
-  thePairs[lPosition].second = aValue.getp();
+  theValues[lPosition] = aValue.getp();
 
   ASSERT_INVARIANT();
   return lOldValue;
@@ -469,29 +457,22 @@ bool SimpleJSONObject::rename(
   const char *const lName = zname.c_str();
   const char *const lNewName = znewname.c_str();
 
-  Keys::const_iterator lIter = theKeys.find(lNewName);
-  if (lIter != theKeys.end())
+  size_type lPosition;
+  if (theShape->find(lNewName, lPosition))
   {
     ASSERT_INVARIANT();
     return false;
   }
 
-  Keys::iterator ite = theKeys.find(lName);
-
-  if (ite == theKeys.end())
+  if (!theShape->find(lName, lPosition))
   {
     ASSERT_INVARIANT();
     return false;
   }
 
-  size_type lPosition = ite->second;
-  assert(thePairs[lPosition].first->getStringValue() == lName);
-  
-  thePairs[lPosition].first->removeReference();
-  aNewName->addReference();
-  thePairs[lPosition].first = aNewName.getp();
-  theKeys.erase(ite);
-  theKeys.insert(std::make_pair(lNewName, lPosition));
+  assert(theShape->getKey(lPosition)->getStringValue() == lName);
+
+  theShape = theShape->rename(lPosition, aNewName.getp());
 
   ASSERT_INVARIANT();
   return true;
@@ -505,8 +486,8 @@ void SimpleJSONObject::swap(store::Item* anotherItem)
 {
   SimpleJSONObject* lOther = dynamic_cast<SimpleJSONObject*>(anotherItem);
   assert(lOther);
-  std::swap(theKeys, lOther->theKeys);
-  std::swap(thePairs, lOther->thePairs);
+  std::swap(theShape, lOther->theShape);
+  std::swap(theValues, lOther->theValues);
   setCollectionTreeInfo(theCollectionInfo);
   lOther->setCollectionTreeInfo(lOther->theCollectionInfo);
 }
@@ -519,11 +500,11 @@ void SimpleJSONObject::setCollectionTreeInfo(CollectionTreeInfo* collectionInfo)
 {
   theCollectionInfo = static_cast<CollectionTreeInfoWithTreeId*>(collectionInfo);
 
-  for (Pairs::iterator ite = thePairs.begin();
-       ite != thePairs.end();
+  for (Values::iterator ite = theValues.begin();
+       ite != theValues.end();
        ++ite)
   {
-    store::Item* value = ite->second;
+    store::Item* value = *ite;
 
     if (value->isStructuredItem())
     {
@@ -582,17 +563,54 @@ store::Item_t SimpleJSONObject::getObjectValue(const store::Item_t& aKey) const
   aKey->getStringValue2( zname );
   const char *const lName = zname.c_str();
 
-  Keys::const_iterator lIter = theKeys.find(lName);
+  size_type lPosition;
+
+  if (!theShape->find(lName, lPosition))
+  {
+    return NULL;
+  }
+
+  assert(theShape->getKey(lPosition)->getStringValue() == lName);
+
+  return theValues[lPosition];
+}
+
+
+/******************************************************************************
+  If the hint was filled by a lookup of the same key item in an object with the
+  same shared shape, the value is at the position that the hint remembers. The
+  hint is filled only for shared shapes, since a private shape may be deleted
+  and its address reused by another one.
+*******************************************************************************/
+store::Item_t SimpleJSONObject::getObjectValue(
+    const store::Item_t& aKey,
+    store::ObjectLookupHint& aHint) const
+{
+  ASSERT_INVARIANT();
+  if (aHint.theLayout == theShape && aHint.theKey.getp() == aKey.getp())
+  {
+    return theValues[aHint.thePosition];
+  }
+
+  zstring zname;
+  aKey->getStringValue2( zname );
+  const char *const lName = zname.c_str();
+
+  size_type lPosition;
 
-  if (lIter == theKeys.end())
+  if (!theShape->find(lName, lPosition))
   {
     return NULL;
   }
-  size_type lPosition = lIter->second;
 
-  assert(thePairs[lPosition].first->getStringValue() == lName);
+  if (theShape->isShared())
+  {
+    aHint.theKey = aKey;
+    aHint.theLayout = theShape;
+    aHint.thePosition = lPosition;
+  }
 
-  return thePairs[lPosition].second;
+  return theValues[lPosition];
 }
 
 
@@ -611,7 +629,7 @@ store::Iterator_t SimpleJSONObject::getObjectKeys() const
 *******************************************************************************/
 xs_integer SimpleJSONObject::getNumObjectPairs() const
 {
-  return xs_integer(thePairs.size());
+  return xs_integer(theValues.size());
 }
 
 
@@ -623,18 +641,18 @@ xs_integer SimpleJSONObject::getNumObjectPairs() const
 void SimpleJSONObject::assertInvariant() const
 {
   JSONItem::assertInvariant();
-  assert(theKeys.size() == thePairs.size());
+  assert(theShape != NULL);
+  assert(theShape->size() == theValues.size());
 
-  for(Keys::const_iterator lIter = theKeys.begin();
-      lIter != theKeys.end();
-      ++lIter)
+  for (size_type i = 0; i < theValues.size(); ++i)
   {
-    size_type lPosition = lIter->second;
-    assert(lPosition < thePairs.size());
-    assert(thePairs[lPosition].first != NULL);
-    assert(thePairs[lPosition].first->isAtomic());
-    assert(thePairs[lPosition].first->getStringValue() == lIter->first);
-    assert(thePairs[lPosition].second != NULL);
+    store::Item* lKey = theShape->getKey(i);
+    assert(lKey != NULL);
+    assert(lKey->isAtomic());
+    size_type lPosition;
+    assert(theShape->find(lKey->getStringValue().c_str(), lPosition));
+    assert(lPosition == i);
+    assert(theValues[i] != NULL);
   }
 }
 
@@ -650,11 +668,11 @@ bool SimpleJSONObject::isThisTreeOfAllDescendants(
     return false;
   }
 
-  for (Pairs::const_iterator lIter = thePairs.begin();
-       lIter != thePairs.end();
+  for (Values::const_iterator lIter = theValues.begin();
+       lIter != theValues.end();
        ++lIter)
   {
-    store::Item* lValue = lIter->second;
+    store::Item* lValue = *lIter;
     const JSONItem* lJSONItem = dynamic_cast<const JSONItem*>(lValue);
     if (lJSONItem != NULL && 
         !lJSONItem->isThisTreeOfAllDescendants(collectionInfo))
@@ -677,11 +695,11 @@ bool SimpleJSONObject::isInSubtree(const StructuredItem* anItem) const
     return true;
   }
 
-  for (Pairs::const_iterator lIter = thePairs.begin();
-       lIter != thePairs.end();
+  for (Values::const_iterator lIter = theValues.begin();
+       lIter != theValues.end();
        ++lIter)
   {
-    store::Item* lValue = lIter->second;
+    store::Item* lValue = *lIter;
     if (lValue->isStructuredItem())
     {
       const StructuredItem* lStructuredItem =
@@ -721,7 +739,7 @@ SimpleJSONObject::KeyIterator::~KeyIterator()
 *******************************************************************************/
 void SimpleJSONObject::KeyIterator::open()
 {
-  theIter = theObject->thePairs.begin();
+  thePosition = 0;
 }
 
 
@@ -730,10 +748,10 @@ void SimpleJSONObject::KeyIterator::open()
 *******************************************************************************/
 bool SimpleJSONObject::KeyIterator::next(store::Item_t& res)
 {
-  if (theIter != theObject->thePairs.end())
+  if (thePosition < theObject->theValues.size())
   {
-    res = theIter->first;
-    ++theIter;
+    res = theObject->theShape->getKey(thePosition);
+    ++thePosition;
     return true;
   }
   else
@@ -757,7 +775,7 @@ void SimpleJSONObject::KeyIterator::reset()
 *******************************************************************************/
 void SimpleJSONObject::KeyIterator::close()
 {
-  theIter = theObject->thePairs.end();
+  thePosition = theObject->theValues.size();
 }
 
 
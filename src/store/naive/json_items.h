@@ -31,6 +31,7 @@
 
 #include "atomic_items.h"
 #include "collection_tree_info.h"
+#include "object_shape.h"
 #include "simple_collection.h"
 #include "structured_item.h"
 
@@ -105,13 +106,9 @@ class JSONItem : public StructuredItem
   friend class zorba::simplestore::CollectionTreeInfoGetters;
 
 protected:
-  SYNC_CODE(mutable RCLock  theRCLock;)
-
   CollectionTreeInfoWithTreeId * theCollectionInfo;
 
 public:
-  SYNC_CODE(RCLock* getRCLock() const { return &theRCLock; })
-
   JSONItem(store::Item::ItemKind k) : StructuredItem(k), theCollectionInfo(NULL) {}
 
   virtual ~JSONItem();
@@ -203,26 +200,28 @@ public:
 
 
 /******************************************************************************
-
+  theShape:
+  ---------
+  The keys of the object, in insertion order (see ObjectShape). It is usually
+  shared with the other objects that have the same keys; if it is private, it
+  is owned by this object.
+
+  theValues:
+  ----------
+  The values of the object, in the order of the keys of its shape.
 *******************************************************************************/
 
 class SimpleJSONObject : public JSONObject
 {
 protected:
-  typedef std::vector<std::pair<store::Item*, store::Item*> > Pairs;
-  typedef Pairs::size_type size_type;
-
-  typedef std::unordered_map<
-    const char*,
-    size_type,
-    ztd::hash<char const*>,
-    ztd::equal_to<char const*> > Keys;
+  typedef std::vector<store::Item*> Values;
+  typedef Values::size_type size_type;
 
   class KeyIterator : public store::Iterator
   {
     protected:
       SimpleJSONObject_t  theObject;
-      Pairs::iterator     theIter;
+      size_type           thePosition;
 
     public:
       KeyIterator(const SimpleJSONObject_t& aObject) : theObject(aObject) {}
@@ -239,11 +238,11 @@ protected:
   };
 
 private:
-  Keys   theKeys;
-  Pairs  thePairs;
+  ObjectShape  * theShape;
+  Values         theValues;
 
 public:
-  SimpleJSONObject() : JSONObject() {}
+  SimpleJSONObject();
 
   virtual ~SimpleJSONObject();
 
@@ -256,6 +255,10 @@ public:
 
   store::Item_t getObjectValue(const store::Item_t& aKey) const;
 
+  store::Item_t getObjectValue(
+      const store::Item_t& aKey,
+      store::ObjectLookupHint& aHint) const;
+
   xs_integer getNumObjectPairs() const;
 
   store::Item* copy(
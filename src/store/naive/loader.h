@@ -24,6 +24,7 @@
 #include "store/api/load_properties.h"
 
 #include "ordpath.h"
+#include "qname_pool.h"
 
 #include "zorbautils/stack.h"
 #include "runtime/parsing_and_serializing/fragment_istream.h"
@@ -124,6 +125,10 @@ public:
                  and the endElement and endDocument methods will remove these
                  children from the stack and link them with N.
 
+  theQNameCache : A private cache of the element and attribute names, so that
+                  loaders running in parallel do not contend for the locks of
+                  the shared QNamePool for every name they see.
+
 ********************************************************************************/
 class FastXmlLoader : public XmlLoader
 {
@@ -151,6 +156,8 @@ protected:
   zorba::Stack<PathStepInfo>       thePathStack;
   std::stack<NsBindingsContext*>   theBindingsStack;
 
+  QNameCache                       theQNameCache;
+
 #ifdef DATAGUIDE
   zorba::Stack<ElementGuideNode*>  theGuideStack;
 #endif
@@ -349,6 +356,8 @@ protected:
   zorba::Stack<PathStepInfo>       thePathStack;
   std::stack<NsBindingsContext*>   theBindingsStack;
 
+  QNameCache                       theQNameCache;
+
 #ifdef DATAGUIDE
   zorba::Stack<ElementGuideNode*>  theGuideStack;
 #endif
@@ -584,7 +584,8 @@ DtdXmlLoader::DtdXmlLoader(
   XmlLoader(factory, xqueryDiagnostics, loadProperties, dataguide),
   theTree(NULL),
   theRootNode(NULL),
-  theNodeStack(2048)
+  theNodeStack(2048),
+  theQNameCache(GET_STORE().getQNamePool())
 {
   theOrdPath.init();
 
@@ -1201,7 +1202,7 @@ void DtdXmlLoader::startElement(
   NodeFactory& nfactory = store.getNodeFactory();
   DtdXmlLoader& loader = *(static_cast<DtdXmlLoader *>(ctx));
   ZORBA_LOADER_CHECK_ERROR(loader);
-  QNamePool& qnpool = store.getQNamePool();
+  QNameCache& qncache = loader.theQNameCache;
   zorba::Stack<XmlNode*>& nodeStack = loader.theNodeStack;
   zorba::Stack<PathStepInfo>& pathStack = loader.thePathStack;
   zstring baseUri;
@@ -1213,10 +1214,10 @@ void DtdXmlLoader::startElement(
 
     // Construct node name
     store::Item_t nodeName;
-    qnpool.insert(nodeName,
-                  reinterpret_cast<const char*>(uri),
-                  reinterpret_cast<const char*>(prefix),
-                  reinterpret_cast<const char*>(lname));
+    qncache.insert(nodeName,
+                   reinterpret_cast<const char*>(uri),
+                   reinterpret_cast<const char*>(prefix),
+                   reinterpret_cast<const char*>(lname));
 
     // Create the element node and push it to the node stack
     ElementNode* elemNode = nfactory.createElementNode(nodeName,
@@ -1340,7 +1341,7 @@ void DtdXmlLoader::startElement(
       const char* prefix = reinterpret_cast<const char*>(attr->ns != NULL ? attr->ns->prefix : NULL);
       const char* uri = reinterpret_cast<const char*>(attr->ns != NULL ? attr->ns->href : NULL);
       store::Item_t qname;
-      qnpool.insert(qname, uri, prefix, lname);
+      qncache.insert(qname, uri, prefix, lname);
 
       AttributeNode* attrNode = nfactory.createAttributeNode(qname);
 
@@ -199,7 +199,8 @@ FastXmlLoader::FastXmlLoader(
   XmlLoader(factory, xqueryDiagnostics, loadProperties, dataguide),
   theTree(NULL),
   theRootNode(NULL),
-  theNodeStack(2048)
+  theNodeStack(2048),
+  theQNameCache(GET_STORE().getQNamePool())
 {
   theBuffer = new char[INPUT_CHUNK_SIZE];
   theOrdPath.init();
@@ -665,7 +666,7 @@ void FastXmlLoader::startElement(
   NodeFactory& nfactory = store.getNodeFactory();
   FastXmlLoader& loader = *(static_cast<FastXmlLoader *>(ctx));
   ZORBA_LOADER_CHECK_ERROR(loader);
-  QNamePool& qnpool = store.getQNamePool();
+  QNameCache& qncache = loader.theQNameCache;
   zorba::Stack<XmlNode*>& nodeStack = loader.theNodeStack;
   zorba::Stack<PathStepInfo>& pathStack = loader.thePathStack;
   zstring baseUri;
@@ -677,10 +678,10 @@ void FastXmlLoader::startElement(
 
     // Construct node name
     store::Item_t nodeName;
-    qnpool.insert(nodeName,
-                  reinterpret_cast<const char*>(uri),
-                  reinterpret_cast<const char*>(prefix),
-                  reinterpret_cast<const char*>(lname));
+    qncache.insert(nodeName,
+                   reinterpret_cast<const char*>(uri),
+                   reinterpret_cast<const char*>(prefix),
+                   reinterpret_cast<const char*>(lname));
     
     // Create the element node and push it to the node stack
     ElementNode* elemNode = nfactory.createElementNode(nodeName,
@@ -806,7 +807,7 @@ void FastXmlLoader::startElement(
         const char* valueEnd = reinterpret_cast<const char*>(attributes[index+4]);
 
         store::Item_t qname;
-        qnpool.insert(qname, uri, prefix, lname);
+        qncache.insert(qname, uri, prefix, lname);
 
         zstring value(valueBegin, valueEnd);
         store::Item_t typedValue;
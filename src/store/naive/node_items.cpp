@@ -47,6 +47,7 @@
 #include "item_iterator.h"
 #include "dataguide.h"
 #include "node_factory.h"
+#include "zorbautils/mutex.h"
 
 #ifndef ZORBA_NO_FULL_TEXT
 using namespace zorba::locale;
@@ -73,11 +74,11 @@ XmlTree::XmlTree()
   theDataGuideRootNode(NULL),
 #endif
   theIsValidated(false),
-  theIsRecursive(false)
+  theIsRecursive(false),
 #ifndef EMBEDED_TYPE
-  ,
-  theTypesMap(NULL)
+  theTypesMap(NULL),
 #endif
+  theHasNoNameIndex(false)
 {
 }
 
@@ -95,11 +96,11 @@ XmlTree::XmlTree(XmlNode* root, const TreeId& id)
   theDataGuideRootNode(NULL),
 #endif
   theIsValidated(false),
-  theIsRecursive(false)
+  theIsRecursive(false),
 #ifndef EMBEDED_TYPE
-  ,
-  theTypesMap(NULL)
+  theTypesMap(NULL),
 #endif
+  theHasNoNameIndex(false)
 {
 }
 
@@ -298,6 +299,40 @@ void XmlTree::detachFromCollection()
 
   delete theCollectionInfo;
   theCollectionInfo = NULL;
+
+  invalidateNameIndex();
+}
+
+
+/*******************************************************************************
+  Return the element name index of this tree, building it if necessary, or NULL
+  if the tree does not belong to a collection or cannot have such an index.
+********************************************************************************/
+ElementNameIndex* XmlTree::getNameIndex()
+{
+  if (theNameIndex != NULL)
+    return theNameIndex.getp();
+
+  if (theHasNoNameIndex || getCollection() == NULL)
+    return NULL;
+
+#ifndef ZORBA_FOR_ONE_THREAD_ONLY
+  // Several queries may probe the same collection tree concurrently.
+  static Mutex mutex;
+  AutoMutex const lock(&mutex);
+
+  if (theNameIndex != NULL)
+    return theNameIndex.getp();
+#endif
+
+  ElementNameIndex_t index = ElementNameIndex::build(getRoot());
+
+  if (index == NULL)
+    theHasNoNameIndex = true;
+  else
+    theNameIndex = index;
+
+  return index.getp();
 }
 
 
@@ -1606,6 +1641,73 @@ size_t InternalNode::alloc_size() const
   return OrdPathNode::alloc_size() + ztd::alloc_sizeof( theNodes );
 }
 
+
+/*******************************************************************************
+  Return an iterator over the element descendants of this node that have the
+  given name, or NULL if the tree of this node has no element name index. The
+  descendants of a node are the elements of the index list that follow the node
+  in document order, up to the first one that is not a descendant of the node,
+  so the range is located by two binary searches on the ordpaths of the list.
+********************************************************************************/
+store::Iterator_t InternalNode::getDescendantElements(
+    const store::Item* qname) const
+{
+  ElementNameIndex* index = getTree()->getNameIndex();
+
+  if (index == NULL)
+    return NULL;
+
+  const ElementNameIndex::NodeList* nodes = index->getElements(qname);
+
+  if (nodes == NULL)
+    return new ElementNameIterator(index, NULL, 0, 0);
+
+  csize begin = 0;
+  csize end = nodes->size();
+
+  if (getTree()->getRoot() == this)
+  {
+    if (end > 0 && (*nodes)[0] == this)
+      begin = 1;
+
+    return new ElementNameIterator(index, nodes, begin, end);
+  }
+
+  const OrdPath& ordPath = getOrdPath();
+
+  // Find the first element that follows this node in document order.
+  csize low = 0;
+  csize high = end;
+
+  while (low < high)
+  {
+    csize mid = low + (high - low) / 2;
+
+    if (ordPath < (*nodes)[mid]->getOrdPath())
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  begin = low;
+
+  // Find the first element after it that is not a descendant of this node.
+  high = end;
+
+  while (low < high)
+  {
+    csize mid = low + (high - low) / 2;
+
+    if (ordPath.getRelativePosition((*nodes)[mid]->getOrdPath()) !=
+        OrdPath::DESCENDANT)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  return new ElementNameIterator(index, nodes, begin, low);
+}
+
 /*******************************************************************************
 
 ********************************************************************************/
@@ -53,6 +53,7 @@
 // Note: whether the EMBEDED_TYPE is defined or not is done in store_defs.h
 #ifndef EMBEDED_TYPE
 #include "hashmap_nodep.h"
+#include "element_name_index.h"
 #endif /* EMBEDED_TYPE */
 
 
@@ -135,7 +136,9 @@ class XmlNodeTokenizerCallback;
 
   theRCLock:
   ----------
-  Protects theRefCount
+  Serializes the structural updates (e.g. detaching a subtree) that move ref
+  counts between trees. Copying or dropping a reference to a node does not take
+  this lock; it updates theRefCount with atomic operations (see rc_add()).
 
   theTreeId:
   ----------
@@ -173,6 +176,17 @@ class XmlNodeTokenizerCallback;
 
   theTokens:
   ----------
+
+  theNameIndex:
+  -------------
+  The element name index of the tree, if the tree belongs to a collection and
+  the index has been built since the last update of the tree (see class
+  ElementNameIndex).
+
+  theHasNoNameIndex:
+  ------------------
+  True if an attempt to build the element name index found that the tree
+  cannot or need not have one. Reset when the tree is updated.
 ********************************************************************************/
 class XmlTree
 {
@@ -214,6 +228,9 @@ protected:
   FTTokenStore              theTokens;
 #endif
 
+  ElementNameIndex_t        theNameIndex;
+  bool                      theHasNoNameIndex;
+
 protected:
   XmlTree(XmlNode* root, const TreeId& id);
 
@@ -300,6 +317,14 @@ public:
 #ifndef ZORBA_NO_FULL_TEXT
   FTTokenStore& getTokenStore() { return theTokens; }
 #endif
+
+  ElementNameIndex* getNameIndex();
+
+  void invalidateNameIndex()
+  {
+    theNameIndex = NULL;
+    theHasNoNameIndex = false;
+  }
 };
 
 
@@ -797,6 +822,12 @@ protected:
   }
 
 public:
+  //
+  // Item methods
+  //
+
+  store::Iterator_t getDescendantElements(const store::Item* qname) const;
+
   //
   // SimpleStore Methods
   //
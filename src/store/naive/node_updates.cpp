@@ -316,7 +316,7 @@ void XmlNode::attach(InternalNode* parent, csize pos)
   oldTree->free();
 
   SYNC_CODE(newTree->getRCLock()->acquire());
-  newTree->getRefCount() += refcount;
+  rc_add(&newTree->getRefCount(), refcount);
   SYNC_CODE(newTree->getRCLock()->release());
 }
 
@@ -344,16 +344,15 @@ void XmlNode::detach()
 
     store::StoreConsts::NodeKind nodeKind = getNodeKind();
 
-    // ???? What we do here is not really thread-safe. For example, consider the
-    // following scenario: Let T1 be "this" thread and T2 be another thread that
-    // has an rchandle, rc2, on N. Right after T1 acquires the rclock on the old
-    // tree, T2 tries to make a copy of rc2; as a result, T2 will block on the
-    // old tree rclock. When T1 releases the old rclock, the old tree may be
-    // destroyed already, so T2 will be trying to acquire a deallocated lock. 
-    // Even if the old tree is there, T2 will increment the ref counter of the
-    // new tree while holding the lock of the old tree. In fact, the setTree()
-    // method istself is not safe (if T2 tries to copy rc2 after T1 has returned
-    // from setTree(), then things are ok).
+    // ???? What we do here is not really thread-safe. Copying or dropping an
+    // rchandle to a node does not take the rclock of its tree (see
+    // Item::addReference()); the rclocks only serialize structural changes
+    // like this one among themselves. For example, let T1 be "this" thread
+    // and T2 be another thread that has an rchandle, rc2, on N. If T2 makes
+    // a copy of rc2 while T1 is moving N to the new tree, T2 may increment the
+    // counter of the old tree after theRefCount of N has been added to
+    // refcount, and then the counters of both trees are off by one (if T2
+    // copies rc2 after T1 has returned from setTree(), then things are ok).
     SYNC_CODE(oldTree->getRCLock()->acquire());
     SYNC_CODE(newTree->getRCLock()->acquire());
 
@@ -498,8 +497,7 @@ void XmlNode::detach()
     }
     }
 
-    newTree->getRefCount() += refcount;
-    if (newTree->getRefCount() == 0)
+    if (rc_add(&newTree->getRefCount(), refcount) == 0)
     {
       SYNC_CODE(newTree->getRCLock()->release());
       newTree->free();
@@ -509,8 +507,7 @@ void XmlNode::detach()
       SYNC_CODE(newTree->getRCLock()->release());
     }
 
-    oldTree->getRefCount() -= refcount;
-    if (oldTree->getRefCount() == 0)
+    if (rc_add(&oldTree->getRefCount(), -(long)refcount) == 0)
     {
       SYNC_CODE(oldTree->getRCLock()->release());
       oldTree->free();
@@ -1246,7 +1243,7 @@ void ElementNode::replaceContent(UpdReplaceElemContent& upd)
     delete oldTree;
     
     SYNC_CODE(newTree->getRCLock()->acquire());
-    newTree->getRefCount() += 1;
+    rc_increment(&newTree->getRefCount());
     SYNC_CODE(newTree->getRCLock()->release());
     
     newChild->setTree(newTree);
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include "object_shape.h"
+
+
+namespace zorba { namespace simplestore { namespace json {
+
+
+/*******************************************************************************
+
+********************************************************************************/
+ObjectShape::ObjectShape(ObjectShapeTable* table, bool shared)
+  :
+  theTable(table),
+  theIsShared(shared)
+{
+}
+
+
+ObjectShape::~ObjectShape()
+{
+  for (Transitions::iterator ite = theTransitions.begin();
+       ite != theTransitions.end();
+       ++ite)
+  {
+    delete ite->second;
+  }
+
+  theTransitions.clear();
+  theKeys.clear();
+
+  for (size_type i = 0; i < theKeyItems.size(); ++i)
+    theKeyItems[i]->removeReference();
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+bool ObjectShape::find(const char* key, size_type& pos) const
+{
+  Keys::const_iterator ite = theKeys.find(key);
+
+  if (ite == theKeys.end())
+    return false;
+
+  pos = ite->second;
+  return true;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+size_t ObjectShape::alloc_size() const
+{
+  return sizeof(*this)
+       + ztd::alloc_sizeof(theKeyItems)
+       + ztd::alloc_sizeof(theKeys);
+}
+
+
+/*******************************************************************************
+  Appends the given key to this shape, in place.
+********************************************************************************/
+ObjectShape* ObjectShape::append(store::Item* key)
+{
+  // The string shares its buffer with the key item, which the shape keeps.
+  zstring name;
+  key->getStringValue2(name);
+
+  theKeys.insert(std::make_pair(name.c_str(), theKeyItems.size()));
+  theKeyItems.push_back(key);
+  key->addReference();
+
+  return this;
+}
+
+
+/*******************************************************************************
+  Returns a private copy of this shape.
+********************************************************************************/
+ObjectShape* ObjectShape::clone() const
+{
+  ObjectShape* shape = new ObjectShape(theTable, false);
+
+  shape->theKeyItems = theKeyItems;
+  shape->theKeys = theKeys;
+
+  for (size_type i = 0; i < theKeyItems.size(); ++i)
+    theKeyItems[i]->addReference();
+
+  return shape;
+}
+
+
+/*******************************************************************************
+  Returns the shape that follows from appending the given key to this shape.
+  A private shape is modified in place and returned; a shared shape is left
+  as is, and the result is either its shared child for the key or a private
+  copy of it with the key appended.
+********************************************************************************/
+ObjectShape* ObjectShape::add(store::Item* key)
+{
+  if (!theIsShared)
+    return append(key);
+
+  if (key->getTypeCode() == store::XS_STRING &&
+      size() < ObjectShapeTable::MAX_SHARED_KEYS)
+  {
+    zstring name;
+    key->getStringValue2(name);
+
+    SYNC_CODE(AutoMutex lock(&theTable->theMutex);)
+
+    Transitions::const_iterator ite = theTransitions.find(name.c_str());
+
+    if (ite != theTransitions.end())
+      return ite->second;
+
+    if (theTransitions.size() < ObjectShapeTable::MAX_TRANSITIONS &&
+        theTable->theNumShared < ObjectShapeTable::MAX_SHARED_SHAPES)
+    {
+      ObjectShape* shape = new ObjectShape(theTable, true);
+
+      shape->theKeyItems = theKeyItems;
+      shape->theKeys = theKeys;
+
+      for (size_type i = 0; i < theKeyItems.size(); ++i)
+        theKeyItems[i]->addReference();
+
+      shape->append(key);
+
+      theTransitions.insert(std::make_pair(name.c_str(), shape));
+      ++theTable->theNumShared;
+
+      return shape;
+    }
+  }
+
+  return clone()->append(key);
+}
+
+
+/*******************************************************************************
+  Returns the shape that follows from removing the key at the given position
+  from this shape. A private shape is modified in place and returned; for a
+  shared shape, the remaining keys are added again starting from the empty
+  shape.
+********************************************************************************/
+ObjectShape* ObjectShape::remove(size_type pos)
+{
+  if (theIsShared)
+  {
+    ObjectShape* shape = theTable->theEmpty;
+
+    for (size_type i = 0; i < theKeyItems.size(); ++i)
+    {
+      if (i != pos)
+        shape = shape->add(theKeyItems[i]);
+    }
+
+    return shape;
+  }
+
+  store::Item* key = theKeyItems[pos];
+
+  theKeyItems.erase(theKeyItems.begin() + pos);
+  theKeys.clear();
+
+  for (size_type i = 0; i < theKeyItems.size(); ++i)
+  {
+    zstring name;
+    theKeyItems[i]->getStringValue2(name);
+    theKeys.insert(std::make_pair(name.c_str(), i));
+  }
+
+  key->removeReference();
+
+  return this;
+}
+
+
+/*******************************************************************************
+  Returns the shape that follows from replacing the key at the given position
+  with the given key. Like remove(), a private shape is modified in place, and
+  for a shared shape the keys are added again starting from the empty shape.
+********************************************************************************/
+ObjectShape* ObjectShape::rename(size_type pos, store::Item* newKey)
+{
+  if (theIsShared)
+  {
+    ObjectShape* shape = theTable->theEmpty;
+
+    for (size_type i = 0; i < theKeyItems.size(); ++i)
+      shape = shape->add(i == pos ? newKey : theKeyItems[i]);
+
+    return shape;
+  }
+
+  store::Item* oldKey = theKeyItems[pos];
+
+  zstring oldName;
+  oldKey->getStringValue2(oldName);
+  theKeys.erase(oldName.c_str());
+
+  zstring newName;
+  newKey->getStringValue2(newName);
+  theKeys.insert(std::make_pair(newName.c_str(), pos));
+
+  theKeyItems[pos] = newKey;
+  newKey->addReference();
+  oldKey->removeReference();
+
+  return this;
+}
+
+
+/*******************************************************************************
+  Called by an object that no longer uses the given shape. Private shapes are
+  deleted; shared ones belong to the shape table.
+********************************************************************************/
+void ObjectShape::release(ObjectShape* shape)
+{
+  if (shape != NULL && !shape->theIsShared)
+    delete shape;
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+ObjectShapeTable::ObjectShapeTable()
+  :
+  theNumShared(1)
+{
+  theEmpty = new ObjectShape(this, true);
+}
+
+
+ObjectShapeTable::~ObjectShapeTable()
+{
+  delete theEmpty;
+}
+
+
+} // namespace json
+} // namespace simplestore
+} // namespace zorba
+/* vim:set et sw=2 ts=2: */
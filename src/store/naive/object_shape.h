@@ -0,0 +1,180 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_SIMPLE_STORE_OBJECT_SHAPE
+#define ZORBA_SIMPLE_STORE_OBJECT_SHAPE
+
+#include <vector>
+
+#include <zorba/config.h>
+#include "util/stl_util.h"
+#include "util/unordered_map.h"
+#include "util/hash/hash.h"
+
+#include "zorbautils/mutex.h"
+
+#include "store/api/item.h"
+
+
+namespace zorba { namespace simplestore { namespace json {
+
+class ObjectShapeTable;
+
+
+/*******************************************************************************
+  The shape of a SimpleJSONObject, i.e., the ordered list of its keys together
+  with a table that maps each key to its position in the list. An object keeps
+  only its values, in the order of the keys of its shape.
+
+  Shapes come in two kinds:
+
+  - Shared shapes, which are owned by the ObjectShapeTable of the store and are
+    never modified or deleted while the store is up. All the objects that have
+    the same keys in the same order (e.g., the objects of a collection that were
+    parsed from json with a fixed schema) point to the same shared shape, so the
+    key tables are not duplicated per object. The shared shapes form a tree
+    rooted at the shape with no keys; the child of a shape for a key k is the
+    shape that an object gets when k is appended to its keys. An object moves
+    along these transitions as keys are added, and back to the root and down
+    again when a key is removed or renamed.
+
+  - Private shapes, which are owned by a single object and are modified in
+    place. An object switches to a private shape when its keys are too many,
+    or when a key is not an xs:string item, or when the shape tree has grown
+    too large (see ObjectShapeTable), so that data-dependent keys cannot make
+    the tree grow without bounds.
+
+  theKeyItems:
+  ------------
+  The key items, in key order. The shape holds a reference to each of them.
+
+  theKeys:
+  --------
+  Maps the string value of each key to its position in theKeyItems. The strings
+  are those of the key items, which are kept alive by the shape.
+
+  theTransitions:
+  ---------------
+  For a shared shape, maps the string value of a key to the shared shape that
+  follows from appending that key. Guarded by the mutex of theTable.
+********************************************************************************/
+class ObjectShape
+{
+  friend class ObjectShapeTable;
+
+public:
+  typedef std::vector<store::Item*>::size_type size_type;
+
+protected:
+  typedef std::unordered_map<
+    const char*,
+    size_type,
+    ztd::hash<char const*>,
+    ztd::equal_to<char const*> > Keys;
+
+  typedef std::unordered_map<
+    const char*,
+    ObjectShape*,
+    ztd::hash<char const*>,
+    ztd::equal_to<char const*> > Transitions;
+
+protected:
+  ObjectShapeTable          * theTable;
+  std::vector<store::Item*>   theKeyItems;
+  Keys                        theKeys;
+  Transitions                 theTransitions;
+  bool                        theIsShared;
+
+protected:
+  ObjectShape(ObjectShapeTable* table, bool shared);
+
+  ObjectShape* append(store::Item* key);
+
+public:
+  ~ObjectShape();
+
+  bool isShared() const { return theIsShared; }
+
+  size_type size() const { return theKeyItems.size(); }
+
+  store::Item* getKey(size_type pos) const { return theKeyItems[pos]; }
+
+  bool find(const char* key, size_type& pos) const;
+
+  size_t alloc_size() const;
+
+  ObjectShape* clone() const;
+
+  ObjectShape* add(store::Item* key);
+
+  ObjectShape* remove(size_type pos);
+
+  ObjectShape* rename(size_type pos, store::Item* newKey);
+
+  static void release(ObjectShape* shape);
+
+private:
+  ObjectShape(const ObjectShape&);
+  ObjectShape& operator=(const ObjectShape&);
+};
+
+
+/*******************************************************************************
+  The shared object shapes of the store (see Store::getObjectShapes()).
+
+  theEmpty:
+  ---------
+  The shared shape with no keys, the root of the tree of shared shapes and the
+  shape of every new object.
+
+  theNumShared:
+  -------------
+  The number of shared shapes. Once it reaches MAX_SHARED_SHAPES, no more are
+  created and objects with new key lists get private shapes.
+********************************************************************************/
+class ObjectShapeTable
+{
+  friend class ObjectShape;
+
+public:
+  enum
+  {
+    MAX_SHARED_KEYS = 64,
+    MAX_TRANSITIONS = 256,
+    MAX_SHARED_SHAPES = 65536
+  };
+
+protected:
+  ObjectShape    * theEmpty;
+  csize            theNumShared;
+  SYNC_CODE(Mutex  theMutex;)
+
+public:
+  ObjectShapeTable();
+
+  ~ObjectShapeTable();
+
+  ObjectShape* getEmpty() const { return theEmpty; }
+
+  csize getNumShared() const { return theNumShared; }
+};
+
+
+} // namespace json
+} // namespace simplestore
+} // namespace zorba
+
+#endif
+/* vim:set et sw=2 ts=2: */
@@ -36,13 +36,55 @@ namespace zorba { namespace simplestore {
 
 ********************************************************************************/
 QNamePool::QNamePool(ulong size, StringPool* nspool) 
+  :
+  theNamespacePool(nspool)
+{
+  for (csize i = 0; i < NUM_SHARDS; ++i)
+    theShards[i] = new Shard(size / NUM_SHARDS);
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+QNamePool::~QNamePool() 
+{
+  for (csize i = 0; i < NUM_SHARDS; ++i)
+    delete theShards[i];
+}
+
+
+/*******************************************************************************
+  Return the shard that the given qname belongs to. This is the shard that owns
+  the cache slot of the qname, if the qname is in a cache slot.
+********************************************************************************/
+QNamePool::Shard& QNamePool::getShard(const QNameItem* qn) const
+{
+  if (qn->isInCache())
+  {
+    for (csize i = 0; i < NUM_SHARDS; ++i)
+    {
+      if (theShards[i]->ownsSlot(qn))
+        return *theShards[i];
+    }
+
+    ZORBA_ASSERT(false);
+  }
+
+  return getShard(CompareFunction::hash(qn));
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+QNamePool::Shard::Shard(ulong size) 
   :
   theCache(new QNameItem[size]),
   theCacheSize(size),
   theFirstFree(1),
   theNumFree(size - 1),
-  theHashSet(2 * size),
-  theNamespacePool(nspool)
+  theHashSet(2 * size)
 {
   // Put all the preallocated slots in the free list of the cahce.
   QNameItem* qn = &theCache[1];
@@ -64,7 +106,7 @@ QNamePool::QNamePool(ulong size, StringPool* nspool)
 /*******************************************************************************
 
 ********************************************************************************/
-QNamePool::~QNamePool() 
+QNamePool::Shard::~Shard() 
 {
   csize n = theHashSet.capacity();
 
@@ -106,7 +148,7 @@ QNamePool::~QNamePool()
 /*******************************************************************************
 
 ********************************************************************************/
-void QNamePool::addInFreeList(QNameItem* qn)
+void QNamePool::Shard::addInFreeList(QNameItem* qn)
 {
   assert(qn->getRefCount() == 0);
   assert(theCache[theFirstFree].thePrevFree == 0);
@@ -150,7 +192,7 @@ void QNamePool::addInFreeList(QNameItem* qn)
 /*******************************************************************************
 
 ********************************************************************************/
-void QNamePool::removeFromFreeList(QNameItem* qn)
+void QNamePool::Shard::removeFromFreeList(QNameItem* qn)
 {
   assert(qn->isInCache());
 
@@ -202,7 +244,7 @@ void QNamePool::removeFromFreeList(QNameItem* qn)
 /*******************************************************************************
 
 ********************************************************************************/
-QNameItem* QNamePool::popFreeList()
+QNameItem* QNamePool::Shard::popFreeList()
 {
   if (theFirstFree != 0)
   {
@@ -240,19 +282,21 @@ void QNamePool::remove(QNameItem* qn)
 {
   QNameItem* normVictim = NULL;
 
-  SYNC_CODE(theHashSet.theMutex.lock();)
+  Shard& shard = getShard(qn);
+
+  SYNC_CODE(shard.theHashSet.theMutex.lock();)
 
   try 
   {
     if (qn->getRefCount() > 0)
     {
-      SYNC_CODE(theHashSet.theMutex.unlock();)
+      SYNC_CODE(shard.theHashSet.theMutex.unlock();)
       return;
     }
 
     if (qn->isInCache())
     {
-      addInFreeList(qn);
+      shard.addInFreeList(qn);
     }
     else
     {
@@ -260,18 +304,18 @@ void QNamePool::remove(QNameItem* qn)
       // qn in the pool, and let the pool garbage-collect it later (if it still
       // unused). If however QNameItems may be referenced by regular pointers
       // as well, then qn must be removed from the pool and really deleted.
-      theHashSet.eraseNoSync(qn);
+      shard.theHashSet.eraseNoSync(qn);
       qn->invalidate(true, &normVictim);
       delete qn;
     }
 
     // Releasing the lock here to avoid deadlock, because decrementing the 
     // normVictim counter might reenter QNamePool::remove.
-    SYNC_CODE(theHashSet.theMutex.unlock();)
+    SYNC_CODE(shard.theHashSet.theMutex.unlock();)
   }
   catch(...)
   {
-    SYNC_CODE(theHashSet.theMutex.unlock();)
+    SYNC_CODE(shard.theHashSet.theMutex.unlock();)
               
     ZORBA_FATAL(0, "Unexpected exception");
   }
@@ -318,28 +362,30 @@ void QNamePool::insert(
 
   ulong hval = hashfun::h32(pre, hashfun::h32(ln, hashfun::h32(ns)));
 
+  Shard& shard = getShard(hval);
+
   try
   {
 retry:
-    SYNC_CODE(theHashSet.theMutex.lock();\
+    SYNC_CODE(shard.theHashSet.theMutex.lock();\
     haveLock = true;)
 
     QNHashEntry* entry = 
-    hashFind(ns, pre, ln, pooledNs.size(), strlen(pre), strlen(ln), hval);
+    shard.hashFind(ns, pre, ln, pooledNs.size(), strlen(pre), strlen(ln), hval);
 
     if (entry == 0)
     {
       if (normalized)
       {
         // Build a new QName (either new object or in cache).
-        qn = cacheInsert(normVictim);
+        qn = shard.cacheInsert(normVictim);
         qn->initializeAsNormalizedQName(pooledNs, ln);
       }
       else
       {
         if (normQName == NULL)
         {
-          SYNC_CODE(theHashSet.theMutex.unlock();\
+          SYNC_CODE(shard.theHashSet.theMutex.unlock();\
           haveLock = false;)
 
           insert(normItem, ns, NULL, ln);
@@ -347,31 +393,31 @@ retry:
           goto retry;
         }
         // Build a new QName (either new object or in cache).
-        qn = cacheInsert(normVictim);
+        qn = shard.cacheInsert(normVictim);
         qn->initializeAsUnnormalizedQName(normQName, pre);
       }
 
       bool found;
-      entry = theHashSet.hashInsert(qn, hval, found);
+      entry = shard.theHashSet.hashInsert(qn, hval, found);
       entry->key() = qn;
       ZORBA_FATAL(!found, "");
     }
     else
     {
       qn = entry->key();
-      cachePin(qn);
+      shard.cachePin(qn);
     }
 
     assert(qn->theNextFree == 0);
     res = qn;
 
-    SYNC_CODE(theHashSet.theMutex.unlock();\
+    SYNC_CODE(shard.theHashSet.theMutex.unlock();\
     haveLock = false;)
   }
   catch (...)
   {
     SYNC_CODE(if (haveLock) \
-      theHashSet.theMutex.unlock();)
+      shard.theHashSet.theMutex.unlock();)
 
     ZORBA_FATAL(0, "Unexpected exception");
   }
@@ -411,14 +457,17 @@ void QNamePool::insert(
   ulong hval = hashfun::h32(pre.c_str(),
                             hashfun::h32(ln.c_str(),
                                          hashfun::h32(ns.c_str())));
+
+  Shard& shard = getShard(hval);
+
   try
   {
 retry:
-    SYNC_CODE(theHashSet.theMutex.lock();\
+    SYNC_CODE(shard.theHashSet.theMutex.lock();\
     haveLock = true;)
 
     QNHashEntry* entry =
-    hashFind(ns.c_str(), pre.c_str(), ln.c_str(),
+    shard.hashFind(ns.c_str(), pre.c_str(), ln.c_str(),
              ns.size(), pre.size(), ln.size(),
              hval);
 
@@ -427,14 +476,14 @@ retry:
       if (normalized)
       {
         // Build a new QName (either new object or in cache).
-        qn = cacheInsert(normVictim);
+        qn = shard.cacheInsert(normVictim);
         qn->initializeAsNormalizedQName(pooledNs, ln);
       }
       else
       {
         if (normQName == NULL)
         {
-          SYNC_CODE(theHashSet.theMutex.unlock();\
+          SYNC_CODE(shard.theHashSet.theMutex.unlock();\
           haveLock = false;)
 
           // This call will need the lock.
@@ -444,30 +493,30 @@ retry:
           goto retry;
         }
         // Build a new QName (either new object or in cache).
-        qn = cacheInsert(normVictim);
+        qn = shard.cacheInsert(normVictim);
         qn->initializeAsUnnormalizedQName(normQName, pre);
       }
 
       bool found;
-      entry = theHashSet.hashInsert(qn, hval, found);
+      entry = shard.theHashSet.hashInsert(qn, hval, found);
       entry->key() = qn;
       ZORBA_FATAL(!found, "");
     }
     else
     {
       qn = entry->key();
-      cachePin(qn);
+      shard.cachePin(qn);
     }
 
     assert(qn->theNextFree == 0);
     res = qn;
 
-    SYNC_CODE(theHashSet.theMutex.unlock();\
+    SYNC_CODE(shard.theHashSet.theMutex.unlock();\
     haveLock = false;)
   }
   catch (...)
   {
-    SYNC_CODE(if (haveLock) theHashSet.theMutex.unlock();)
+    SYNC_CODE(if (haveLock) shard.theHashSet.theMutex.unlock();)
 
     ZORBA_FATAL(0, "Unexpected exception");
   }
@@ -486,7 +535,7 @@ retry:
   slot (if any) is removed from the pool. If the cache free list is empty a new
   QNameItem is allocated from the heap.
 ********************************************************************************/
-QNameItem* QNamePool::cacheInsert(QNameItem*& normVictim)
+QNameItem* QNamePool::Shard::cacheInsert(QNameItem*& normVictim)
 {
   assert(normVictim == NULL);
 
@@ -512,7 +561,7 @@ QNameItem* QNamePool::cacheInsert(QNameItem*& normVictim)
   If the given qname slot is in the free list of the cache, remove it from that
   list.
 ********************************************************************************/
-void QNamePool::cachePin(QNameItem* qn)
+void QNamePool::Shard::cachePin(QNameItem* qn)
 {
   if (qn->isInCache())
   {
@@ -524,7 +573,7 @@ void QNamePool::cachePin(QNameItem* qn)
 /*******************************************************************************
 
 ********************************************************************************/
-QNamePool::QNHashEntry* QNamePool::hashFind(
+QNamePool::QNHashEntry* QNamePool::Shard::hashFind(
     const char* ns,
     const char* pre,
     const char* ln,
@@ -554,6 +603,49 @@ QNamePool::QNHashEntry* QNamePool::hashFind(
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////
+//                                                                             //
+//  QNameCache                                                                 //
+//                                                                             //
+/////////////////////////////////////////////////////////////////////////////////
+
+
+/*******************************************************************************
+  Same as QNamePool::insert(), but look in the cache first.
+********************************************************************************/
+void QNameCache::insert(
+    store::Item_t& res,
+    const char* ns,
+    const char* pre,
+    const char* ln)
+{
+  if (ns == NULL) ns = "";
+  if (pre == NULL) pre = "";
+
+  uintptr_t key = (reinterpret_cast<uintptr_t>(ln) ^
+                   (reinterpret_cast<uintptr_t>(pre) << 1) ^
+                   (reinterpret_cast<uintptr_t>(ns) << 2));
+
+  store::Item_t& slot = theQNames[((key >> 3) ^ (key >> 11)) % CACHE_SIZE];
+
+  if (slot != NULL)
+  {
+    const QNameItem* qn = static_cast<const QNameItem*>(slot.getp());
+
+    if (qn->getLocalName2() == ln &&
+        qn->getPrefix2() == pre &&
+        qn->getNamespace2() == ns)
+    {
+      res = slot;
+      return;
+    }
+  }
+
+  thePool.insert(res, ns, pre, ln);
+  slot = res;
+}
+
+
 } // namespace store
 } // namespace zorba
 
@@ -32,17 +32,27 @@ class StringPool;
 
 /*******************************************************************************
 
+  The pool of QNameItems. It is partitioned into NUM_SHARDS shards, based on the
+  hash code of the qnames. Each shard is protected by its own mutex, so threads
+  that create qnames concurrently (e.g. threads that load documents in parallel)
+  rarely wait for each other.
+
+  Every shard has the following data members:
+
   theCache :
   ----------
   An array of QName slots that is managed as a cache. This means that slots that
   are not used are placed in a free list. When a new qname is inserted in the
   cache, a slot is taken from the free list and the qname currently in that slot
-  is replaced with the new slot.
+  is replaced with the new slot. A qname that is in a cache slot always belongs
+  to the shard that owns that slot, even if the slot is reused for a qname with
+  a different hash code (see getShard(QNameItem*)).
 
   theCacheSize :
   --------------
-  The size of theCache (number of slots). This size is given as a param to the
-  QNamePool constructor, and it never changes afterwards.
+  The size of theCache (number of slots). This size is the size given as a param
+  to the QNamePool constructor divided by NUM_SHARDS, and it never changes
+  afterwards.
  
   theFirstFree :
   --------------
@@ -97,16 +107,57 @@ protected:
 
  typedef HashEntry<QNameItem*, DummyHashValue> QNHashEntry;
 
+
+  class Shard
+  {
+    friend class QNamePool;
+
+  protected:
+    QNameItem         * theCache;
+    ulong               theCacheSize;
+    ulong               theFirstFree;
+    ulong               theNumFree;
+
+    QNamePoolHashSet    theHashSet;
+
+  public:
+    Shard(ulong size);
+
+    ~Shard();
+
+    bool ownsSlot(const QNameItem* qn) const
+    {
+      return theCache <= qn && qn < theCache + theCacheSize;
+    }
+
+  protected:
+    QNameItem* cacheInsert(QNameItem*& normVictim);
+
+    void cachePin(QNameItem* qn);
+
+    QNHashEntry* hashFind(
+        const char* ns,
+        const char* pre,
+        const char* ln,
+        csize       nslen,
+        csize       prelen,
+        csize       lnlen,
+        csize       hval);
+
+    void addInFreeList(QNameItem* qn);
+
+    void removeFromFreeList(QNameItem* qn);
+
+    QNameItem* popFreeList();
+  };
+
 public:
   static const ulong MAX_CACHE_SIZE = 32768;
 
-protected:
-  QNameItem         * theCache;
-  ulong               theCacheSize;
-	ulong               theFirstFree;
-  ulong               theNumFree;
+  static const csize NUM_SHARDS = 8;
 
-  QNamePoolHashSet    theHashSet;
+protected:
+  Shard             * theShards[NUM_SHARDS];
 
   StringPool        * theNamespacePool;
 
@@ -130,24 +181,48 @@ public:
   void remove(QNameItem* qn);
 
 protected:
-  QNameItem* cacheInsert(QNameItem*& normVictim);
+  Shard& getShard(ulong hval) const
+  {
+    // The low bits of the hash code select the bucket within the shard.
+    return *theShards[(hval >> 16) % NUM_SHARDS];
+  }
 
-  void cachePin(QNameItem* qn);
+  Shard& getShard(const QNameItem* qn) const;
+};
 
-  QNHashEntry* hashFind(
-      const char* ns,
-      const char* pre,
-      const char* ln,
-      csize       nslen,
-      csize       prelen,
-      csize       lnlen,
-      csize       hval);
 
-  void addInFreeList(QNameItem* qn);
+/*******************************************************************************
+  A small cache of qnames in front of the QNamePool, for use by a single thread
+  (e.g., by a document loader). A lookup in the cache takes no lock. The names
+  that the XML parser reports for elements and attributes are interned by the
+  parser, so the cache slot is chosen based on the addresses of the given
+  strings, and a hit is then verified by comparing the strings themselves.
+
+  The cache keeps a reference to the qnames in it, so it must be destroyed
+  before the store is shut down.
+********************************************************************************/
+class QNameCache
+{
+public:
+  static const csize CACHE_SIZE = 64;
+
+protected:
+  QNamePool      & thePool;
+
+  store::Item_t    theQNames[CACHE_SIZE];
+
+public:
+  QNameCache(QNamePool& pool) : thePool(pool) { }
 
-  void removeFromFreeList(QNameItem* qn);
+  void insert(
+      store::Item_t& res,
+      const char* ns,
+      const char* pre,
+      const char* ln);
 
-  QNameItem* popFreeList();
+private:
+  QNameCache(const QNameCache&);
+  void operator=(const QNameCache&);
 };
 
 
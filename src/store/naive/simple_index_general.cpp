@@ -2655,6 +2655,19 @@ void ProbeGeneralIndexIterator::count(store::Item_t& result)
 }
 
 
+/******************************************************************************
+  A node may have many keys in a general index, so there is no single key to
+  project a column of.
+********************************************************************************/
+bool ProbeGeneralIndexIterator::nextKeyColumn(
+    store::Item_t& result,
+    csize column)
+{
+  ZORBA_ASSERT(false);
+  return false;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////
 //                                                                             //
 //  ProbeHashGeneralIndexIterator                                              //
@@ -17,11 +17,12 @@
 #define ZORBA_SIMPLE_STORE_INDEX_HASH_GENERAL
 
 #include <cassert>
-#include <map>
 
 #include "simple_index.h"
 #include "store_defs.h"
 
+#include "zorbautils/btree_map.h"
+
 namespace zorba 
 { 
 
@@ -274,7 +275,9 @@ public:
 
 
 /******************************************************************************
-
+  Each of theMaps is a B+-tree (see BTreeMap), so the iterators into it that
+  the probe iterators hold are invalidated by any insertion or removal of an
+  entry.
 *******************************************************************************/
 class GeneralTreeIndex : public GeneralIndex
 {
@@ -282,7 +285,7 @@ class GeneralTreeIndex : public GeneralIndex
   friend class ProbeGeneralIndexIterator;
   friend class ProbeGeneralTreeIndexIterator;
 
-  typedef std::map<const store::Item*,
+  typedef BTreeMap<const store::Item*,
                    GeneralIndexValue*,
                    GeneralIndexCompareFunction> IndexMap;
 
@@ -472,6 +475,8 @@ public:
   bool next(store::Item_t& result);
 
   void count(store::Item_t& result);
+
+  bool nextKeyColumn(store::Item_t& result, csize column);
 };
 
 
@@ -16,6 +16,7 @@
 #include "stdafx.h"
 
 #include <algorithm>
+#include <memory>
 
 #include "simple_index_value.h"
 #include "store_defs.h"
@@ -26,9 +27,12 @@
 #include "diagnostics/util_macros.h"
 
 #include "zorbatypes/collation_manager.h"
+#include "zorbatypes/float.h"
 
 #include "zorbautils/hashfun.h"
 
+#include "runtime/util/work_stealing_pool.h"
+
 namespace zorba 
 { 
 
@@ -49,12 +53,14 @@ namespace simplestore
 ValueIndexCompareFunction::ValueIndexCompareFunction(
      csize numCols,
      long timezone,
-     const std::vector<std::string>& collations)
+     const std::vector<std::string>& collations,
+     const std::vector<store::Item_t>& keyTypes)
   :
   theNumColumns(numCols),
   theTimezone(timezone)
 {
   theCollators.resize(theNumColumns);
+  theEncodings.resize(theNumColumns, NO_ENCODING);
 
   for (csize i = 0; i < theNumColumns; ++i)
   {
@@ -66,6 +72,63 @@ ValueIndexCompareFunction::ValueIndexCompareFunction(
     {
       theCollators[i] = NULL;
     }
+
+    if (i >= keyTypes.size() || keyTypes[i] == NULL)
+      continue;
+
+    switch (GET_STORE().theSchemaTypeCodes[keyTypes[i].getp()])
+    {
+    case store::XS_STRING:
+    case store::XS_NORMALIZED_STRING:
+    case store::XS_TOKEN:
+    case store::XS_LANGUAGE:
+    case store::XS_NMTOKEN:
+    case store::XS_NAME:
+    case store::XS_NCNAME:
+    case store::XS_ID:
+    case store::XS_IDREF:
+    case store::XS_ENTITY:
+    case store::XS_UNTYPED_ATOMIC:
+      theEncodings[i] = STRING_ENCODING;
+      break;
+
+    case store::XS_DATETIME:
+    case store::XS_DATETIME_STAMP:
+    case store::XS_DATE:
+    case store::XS_TIME:
+    case store::XS_GYEAR_MONTH:
+    case store::XS_GYEAR:
+    case store::XS_GMONTH_DAY:
+    case store::XS_GDAY:
+    case store::XS_GMONTH:
+      theEncodings[i] = DATETIME_ENCODING;
+      break;
+
+    case store::XS_FLOAT:
+    case store::XS_DOUBLE:
+      theEncodings[i] = DOUBLE_ENCODING;
+      break;
+
+    case store::XS_DECIMAL:
+    case store::XS_INTEGER:
+    case store::XS_NON_POSITIVE_INTEGER:
+    case store::XS_NEGATIVE_INTEGER:
+    case store::XS_LONG:
+    case store::XS_INT:
+    case store::XS_SHORT:
+    case store::XS_BYTE:
+    case store::XS_NON_NEGATIVE_INTEGER:
+    case store::XS_UNSIGNED_LONG:
+    case store::XS_UNSIGNED_INT:
+    case store::XS_UNSIGNED_SHORT:
+    case store::XS_UNSIGNED_BYTE:
+    case store::XS_POSITIVE_INTEGER:
+      theEncodings[i] = INTEGER_ENCODING;
+      break;
+
+    default:
+      break;
+    }
   }
 }
 
@@ -145,17 +208,10 @@ long ValueIndexCompareFunction::compare(
     const store::Item_t& i1 = (*key1)[i];
     const store::Item_t& i2 = (*key2)[i];
 
-    if (i1 == NULL)
-    {
-      if (i2 != NULL)
-        return -1;
-    }
-    else if (i2 == NULL)
-    {
-      if (i1 != NULL)
-        return +1;
-    }
-    else if (i1 == IndexConditionImpl::theNegInf)
+    // The bounds of a probe are compared first, so that -INF and +INF, which
+    // stand for a column that the probe does not restrict, also take in the
+    // entries where that column is empty.
+    if (i1 == IndexConditionImpl::theNegInf)
     {
       return -1;
     }
@@ -171,6 +227,15 @@ long ValueIndexCompareFunction::compare(
     {
       return -1;
     }
+    else if (i1 == NULL)
+    {
+      if (i2 != NULL)
+        return -1;
+    }
+    else if (i2 == NULL)
+    {
+      return +1;
+    }
     else if ((result = i1->compare(i2, theTimezone, theCollators[i])))
     {
       return result;
@@ -181,6 +246,270 @@ long ValueIndexCompareFunction::compare(
 }
 
 
+/*******************************************************************************
+  Appends the given value to form as a big-endian number of the given size.
+********************************************************************************/
+static void append_bytes(std::string& form, uint64_t value, int size)
+{
+  for (int shift = (size - 1) * 8; shift >= 0; shift -= 8)
+    form += static_cast<char>((value >> shift) & 0xFF);
+}
+
+
+/*******************************************************************************
+  Computes the normalized form of the given key, if it has one. The form is
+  the concatenation of the forms of the key columns; each of them starts with
+  a tag byte, which puts the -INF bounds before empty columns, these before
+  all the values, and these before the +INF bounds, as compare() does. The
+  rest of the form of a non-empty column is an encoding of its value that
+  sorts under memcmp as compare() sorts the values themselves, and that no
+  other encoding of the column is a prefix of (see normalizeColumn()).
+********************************************************************************/
+void ValueIndexCompareFunction::normalize(
+    const store::IndexKey* key,
+    NormalizedIndexKey& result) const
+{
+  std::string form;
+
+  for (csize i = 0; i < theNumColumns && i < key->size(); ++i)
+  {
+    const store::Item* item = (*key)[i].getp();
+
+    if (item == IndexConditionImpl::theNegInf.getp())
+    {
+      form += '\x00';
+    }
+    else if (item == NULL)
+    {
+      form += '\x01';
+    }
+    else if (item == IndexConditionImpl::thePosInf.getp())
+    {
+      form += '\x03';
+    }
+    else
+    {
+      form += '\x02';
+
+      if (!normalizeColumn(i, item, form))
+      {
+        result.set(key);
+        return;
+      }
+    }
+  }
+
+  result.set(key, form);
+}
+
+
+/*******************************************************************************
+  Appends to form the encoding of the given value of the i-th column, or
+  returns false if the value cannot be encoded in the way the column is. Only
+  values of the types that the encoding of the column was chosen for are
+  encoded, because the encodings of different types (e.g. of integers and of
+  doubles) do not sort with respect to each other as the values do.
+********************************************************************************/
+bool ValueIndexCompareFunction::normalizeColumn(
+    csize i,
+    const store::Item* item,
+    std::string& form) const
+{
+  if (!item->isAtomic())
+    return false;
+
+  store::SchemaTypeCode type = item->getTypeCode();
+
+  switch (theEncodings[i])
+  {
+  case INTEGER_ENCODING:
+  {
+    if (type < store::XS_INTEGER || type > store::XS_POSITIVE_INTEGER)
+      return false;
+
+    xs_long value;
+
+    try
+    {
+      value = item->getLongValue();
+    }
+    catch (ZorbaException const&)
+    {
+      return false;
+    }
+
+    // Flipping the sign bit makes the two's complement order unsigned.
+    append_bytes(form, static_cast<uint64_t>(value) ^ (1ULL << 63), 8);
+    return true;
+  }
+
+  case DOUBLE_ENCODING:
+  {
+    if (type != store::XS_DOUBLE && type != store::XS_FLOAT)
+      return false;
+
+    double value = item->getDoubleValue().getNumber();
+
+    // NaN does not compare with anything, and -0 is equal to +0.
+    if (value != value)
+      return false;
+
+    if (value == 0)
+      value = 0;
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // Negative numbers sort in the reverse order of their bits, positive ones
+    // in the order of their bits, after all the negative ones.
+    bits = ((bits >> 63) ? ~bits : bits | (1ULL << 63));
+
+    append_bytes(form, bits, 8);
+    return true;
+  }
+
+  case STRING_ENCODING:
+  {
+    if (type < store::XS_STRING || type > store::XS_UNTYPED_ATOMIC ||
+        item->isStreamable())
+      return false;
+
+    const zstring& value = item->getString();
+    const XQPCollator* collator = theCollators[i];
+
+#ifndef ZORBA_NO_ICU
+    if (collator != NULL && !collator->doMemCmp())
+    {
+      // ICU sort keys compare as the collator compares the strings, and they
+      // contain no zero byte except the terminating one.
+      unicode::string uvalue;
+      unicode::to_string(value, &uvalue);
+
+      UErrorCode status = U_ZERO_ERROR;
+      CollationKey sortKey;
+      static_cast<Collator*>(collator->getCollator())->
+      getCollationKey(uvalue, sortKey, status);
+
+      if (U_FAILURE(status))
+        return false;
+
+      int32_t size;
+      const uint8_t* bytes = sortKey.getByteArray(size);
+
+      while (size > 0 && bytes[size - 1] == 0)
+        --size;
+
+      form.append(reinterpret_cast<const char*>(bytes), size);
+      form += '\x00';
+      return true;
+    }
+#endif /* ZORBA_NO_ICU */
+
+    // Byte order is the codepoint order of UTF-8 strings. Zero bytes are
+    // escaped, so that the "\x00\x00" terminator sorts before any content.
+    zstring::const_iterator ite = value.begin();
+    zstring::const_iterator end = value.end();
+
+    for (; ite != end; ++ite)
+    {
+      form += *ite;
+      if (*ite == '\x00')
+        form += '\xFF';
+    }
+
+    form += '\x00';
+    form += '\x00';
+    return true;
+  }
+
+  case DATETIME_ENCODING:
+  {
+    if (type != store::XS_DATETIME && type != store::XS_DATETIME_STAMP &&
+        (type < store::XS_DATE || type > store::XS_TIME) &&
+        (type < store::XS_GYEAR_MONTH || type > store::XS_GMONTH))
+      return false;
+
+    // DateTime::compare() compares the fields of the values, normalized to
+    // UTC, in order.
+    std::unique_ptr<DateTime> value;
+
+    try
+    {
+      value.reset(item->getDateTimeValue().normalizeTimeZone(theTimezone));
+    }
+    catch (InvalidTimezoneException const&)
+    {
+      return false;
+    }
+
+    int fields[] =
+    {
+      value->getMonth(),
+      value->getDay(),
+      value->getHours(),
+      value->getMinutes(),
+      value->getIntSeconds()
+    };
+
+    append_bytes(form, static_cast<uint32_t>(value->getYear()) ^ (1U << 31), 4);
+
+    for (csize f = 0; f < sizeof(fields) / sizeof(fields[0]); ++f)
+    {
+      if (fields[f] < 0 || fields[f] > 0xFF)
+        return false;
+
+      append_bytes(form, fields[f], 1);
+    }
+
+    append_bytes(form, value->getFractionalSeconds(), 4);
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+//                                                                             //
+//  NormalizedIndexKey                                                         //
+//                                                                             //
+/////////////////////////////////////////////////////////////////////////////////
+
+
+/******************************************************************************
+
+********************************************************************************/
+void NormalizedIndexKey::set(const store::IndexKey* key, const std::string& form)
+{
+  theKey = key;
+  theSize = static_cast<uint32_t>(form.size());
+
+  if (theSize <= INLINE_SIZE)
+  {
+    memcpy(theInline, form.data(), theSize);
+  }
+  else
+  {
+    theHeap = new char[theSize];
+    memcpy(theHeap, form.data(), theSize);
+  }
+}
+
+
+/******************************************************************************
+
+********************************************************************************/
+void NormalizedIndexKey::release()
+{
+  if (theSize != NO_FORM && theSize > INLINE_SIZE)
+    delete [] theHeap;
+
+  theSize = NO_FORM;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////
 //                                                                             //
 //  Value Index                                                                //
@@ -196,7 +525,10 @@ ValueIndex::ValueIndex(
     const store::IndexSpecification& spec)
   :
   IndexImpl(qname, spec),
-  theCompFunction(getNumColumns(), spec.theTimezone, spec.theCollations)
+  theCompFunction(getNumColumns(),
+                  spec.theTimezone,
+                  spec.theCollations,
+                  spec.theKeyTypes)
 {
 }
 
@@ -206,7 +538,7 @@ ValueIndex::ValueIndex(
 ********************************************************************************/
 ValueIndex::ValueIndex()
   :
-theCompFunction(0, 0, std::vector<std::string>())
+theCompFunction(0, 0, std::vector<std::string>(), std::vector<store::Item_t>())
 {
 }
 
@@ -296,7 +628,9 @@ ValueHashIndex::ValueHashIndex(
     const store::IndexSpecification& spec)
   :
   ValueIndex(qname, spec),
-  theMap(theCompFunction, 1024, spec.theIsThreadSafe)
+  theMap(theCompFunction, 1024, spec.theIsThreadSafe),
+  theFilterCapacity(BloomFilter::MIN_KEYS),
+  theFilterNumKeys(0)
 {
 }
   
@@ -307,7 +641,9 @@ ValueHashIndex::ValueHashIndex(
 ValueHashIndex::ValueHashIndex()
   :
   ValueIndex(),
-  theMap(theCompFunction, 0, false)
+  theMap(theCompFunction, 0, false),
+  theFilterCapacity(BloomFilter::MIN_KEYS),
+  theFilterNumKeys(0)
 {
 }
   
@@ -339,6 +675,10 @@ void ValueHashIndex::clear()
   }
 
   theMap.clear();
+
+  theFilter.clear();
+  theFilterCapacity = BloomFilter::MIN_KEYS;
+  theFilterNumKeys = 0;
 }
 
 
@@ -401,10 +741,46 @@ bool ValueHashIndex::insert(store::IndexKey*& key, store::Item_t& value)
   // Note: ownership of the key obj passes to the index.
   theMap.insert(key, valueSet);
 
+  insertInFilter(key);
+
   return false;
 } 
 
 
+/*******************************************************************************
+  Add the given key, which has just been inserted in the map, to the Bloom
+  filter, or rebuild the filter from the keys in the map if it is full.
+********************************************************************************/
+void ValueHashIndex::insertInFilter(const store::IndexKey* key)
+{
+  if (isThreadSafe())
+    return;
+
+  if (++theFilterNumKeys <= theFilterCapacity)
+  {
+    if (theFilter.isEnabled())
+      theFilter.insert(theCompFunction.hash(key));
+
+    return;
+  }
+
+  csize numKeys = theMap.size();
+
+  theFilter.init(2 * numKeys);
+  theFilterCapacity = std::max(2 * numKeys, BloomFilter::MIN_KEYS);
+  theFilterNumKeys = numKeys;
+
+  if (theFilter.isEnabled())
+  {
+    IndexMap::iterator ite = theMap.begin();
+    IndexMap::iterator end = theMap.end();
+
+    for (; ite != end; ++ite)
+      theFilter.insert(theCompFunction.hash((*ite).first));
+  }
+}
+
+
 /******************************************************************************
   Remove either (a) the given key and all of its associated values, or (b) only
   the given value from the value set of the given key. In (b) if the value set
@@ -485,7 +861,22 @@ void ProbeValueHashIndexIterator::init(const store::IndexCondition_t& cond,
 
   assert(key->size() == theIndex->getNumColumns());
 
-  theIndex->theMap.get(key, theResultSet);
+  ValueHashIndex::IndexMap::iterator entry = theIndex->theMap.end();
+
+  if (!theIndex->theFilter.isEnabled() ||
+      theIndex->theFilter.mayContain(theIndex->theCompFunction.hash(key)))
+    entry = theIndex->theMap.find(key);
+
+  if (entry != theIndex->theMap.end())
+  {
+    theResultKey = entry.getKey();
+    theResultSet = entry.getValue();
+  }
+  else
+  {
+    theResultKey = NULL;
+    theResultSet = NULL;
+  }
 
   if (theResultSet)
   {
@@ -531,6 +922,7 @@ void ProbeValueHashIndexIterator::reset()
 void ProbeValueHashIndexIterator::close()
 {
   theCondition = NULL;
+  theResultKey = NULL;
   theResultSet = NULL;
 }
 
@@ -572,6 +964,46 @@ void ProbeValueHashIndexIterator::count(store::Item_t& result)
 }
 
 
+/******************************************************************************
+  All the nodes returned by a point probe share the same key, so either all
+  of them or none of them has a non-empty item in the given column.
+********************************************************************************/
+bool ProbeValueHashIndexIterator::nextKeyColumn(
+    store::Item_t& result,
+    csize column)
+{
+  store::Item_t node;
+
+  if (theResultKey == NULL || (*theResultKey)[column] == NULL)
+    return false;
+
+  if (!next(node))
+    return false;
+
+  result = (*theResultKey)[column];
+  return true;
+}
+
+
+/******************************************************************************
+  Holds the normalized form of a key that theMap of a ValueTreeIndex is
+  searched with, and releases it, unless transfer() passes it to theMap.
+********************************************************************************/
+struct SearchKey
+{
+  NormalizedIndexKey theKey;
+
+  ~SearchKey() { theKey.release(); }
+
+  NormalizedIndexKey transfer()
+  {
+    NormalizedIndexKey key = theKey;
+    theKey.set(theKey.getKey());
+    return key;
+  }
+};
+
+
 /////////////////////////////////////////////////////////////////////////////////
 //                                                                             //
 //  Value Tree Index                                                           //
@@ -604,7 +1036,7 @@ bool ValueTreeIndex::KeyIterator::next(store::IndexKey& aKey)
 {
   if (theIterator != theMap.end())
   {
-    const store::IndexKey* lKey = (*theIterator).first;
+    const store::IndexKey* lKey = (*theIterator).first.getKey();
     aKey = *lKey;
 
     ++theIterator;
@@ -664,7 +1096,8 @@ void ValueTreeIndex::clear()
  
   for (; ite != end; ++ite)
   {
-    delete (*ite).first;
+    delete (*ite).first.getKey();
+    (*ite).first.release();
     delete (*ite).second;
   }
 
@@ -717,8 +1150,11 @@ bool ValueTreeIndex::insert(store::IndexKey*& key, store::Item_t& value)
   std::cout << "), " << value->getStringValue() << "]" << std::endl;
 #endif
 
+  SearchKey normKey;
+  theCompFunction.normalize(key, normKey.theKey);
+
   // TODO: optimize this using the lower_bound() method.
-  IndexMap::iterator pos = theMap.find(key);
+  IndexMap::iterator pos = theMap.find(normKey.theKey);
 
   if (pos != theMap.end())
   {
@@ -729,7 +1165,7 @@ bool ValueTreeIndex::insert(store::IndexKey*& key, store::Item_t& value)
     }
 
     pos->second->transfer_back(value);
-    key = const_cast<store::IndexKey*>(pos->first);
+    key = const_cast<store::IndexKey*>(pos->first.getKey());
 
     return true;
   }
@@ -737,13 +1173,262 @@ bool ValueTreeIndex::insert(store::IndexKey*& key, store::Item_t& value)
   ValueIndexValue* valueSet = new ValueIndexValue(1);
   (*valueSet)[0].transfer(value);
 
-  // Note: ownership of the key obj passes to the index.
-  theMap.insert(IndexMapPair(key, valueSet));
+  // Note: ownership of the key obj and of its normalized form passes to the
+  // index.
+  theMap.insert(IndexMapPair(normKey.transfer(), valueSet));
 
   return false;
 }
 
 
+/******************************************************************************
+  An entry of a bulk build: the normalized key and the position of the entry
+  in the input of bulkInsert(). Entries with equal keys are ordered by their
+  position, so they end up in the value sets in insertion order.
+********************************************************************************/
+typedef std::pair<NormalizedIndexKey, csize> BuildEntry;
+
+class BuildEntryLess
+{
+protected:
+  const ValueIndexCompareFunction & theCompare;
+
+public:
+  BuildEntryLess(const ValueIndexCompareFunction& compare) : theCompare(compare) {}
+
+  bool operator()(const BuildEntry& e1, const BuildEntry& e2) const
+  {
+    if (theCompare(e1.first, e2.first))
+      return true;
+
+    if (theCompare(e2.first, e1.first))
+      return false;
+
+    return e1.second < e2.second;
+  }
+};
+
+
+/******************************************************************************
+  Normalizes the keys of one run of a bulk build and sorts the run.
+********************************************************************************/
+class BuildRunTask : public WorkStealingPool::Task
+{
+protected:
+  const ValueIndexCompareFunction    & theCompare;
+  const std::vector<store::IndexKey*>& theKeys;
+  std::vector<BuildEntry>            & theEntries;
+  const std::vector<csize>           & theBounds;
+
+public:
+  BuildRunTask(
+      const ValueIndexCompareFunction& compare,
+      const std::vector<store::IndexKey*>& keys,
+      std::vector<BuildEntry>& entries,
+      const std::vector<csize>& bounds)
+    :
+    theCompare(compare),
+    theKeys(keys),
+    theEntries(entries),
+    theBounds(bounds)
+  {
+  }
+
+  void execute(csize run, csize /*workerId*/)
+  {
+    for (csize i = theBounds[run]; i < theBounds[run + 1]; ++i)
+    {
+      theCompare.normalize(theKeys[i], theEntries[i].first);
+      theEntries[i].second = i;
+    }
+
+    std::sort(theEntries.begin() + theBounds[run],
+              theEntries.begin() + theBounds[run + 1],
+              BuildEntryLess(theCompare));
+  }
+};
+
+
+/******************************************************************************
+  Merges pairs of adjacent sorted runs of a bulk build.
+********************************************************************************/
+class MergeRunsTask : public WorkStealingPool::Task
+{
+protected:
+  const ValueIndexCompareFunction & theCompare;
+  std::vector<BuildEntry>         & theEntries;
+  const std::vector<csize>        & theBounds;
+
+public:
+  MergeRunsTask(
+      const ValueIndexCompareFunction& compare,
+      std::vector<BuildEntry>& entries,
+      const std::vector<csize>& bounds)
+    :
+    theCompare(compare),
+    theEntries(entries),
+    theBounds(bounds)
+  {
+  }
+
+  void execute(csize pair, csize /*workerId*/)
+  {
+    std::inplace_merge(theEntries.begin() + theBounds[2 * pair],
+                       theEntries.begin() + theBounds[2 * pair + 1],
+                       theEntries.begin() + theBounds[2 * pair + 2],
+                       BuildEntryLess(theCompare));
+  }
+};
+
+
+static void runBuildTasks(
+    WorkStealingPool* pool,
+    WorkStealingPool::Task& task,
+    csize numTasks)
+{
+  if (pool != NULL && numTasks > 1)
+  {
+    pool->run(task, numTasks);
+    return;
+  }
+
+  for (csize i = 0; i < numTasks; ++i)
+    task.execute(i, 0);
+}
+
+
+/******************************************************************************
+  Inserts the given entries into the index, which must be empty, with the same
+  result as inserting them one by one. The keys are normalized and sorted in
+  runs, one per thread, the runs are merged pairwise, and theMap is then built
+  bottom-up out of the sorted entries.
+
+  Ownership of the keys passes to the index, even if an error is raised, and
+  keys is cleared.
+********************************************************************************/
+void ValueTreeIndex::bulkInsert(
+    std::vector<store::IndexKey*>& keys,
+    std::vector<store::Item_t>& values,
+    csize numThreads)
+{
+  assert(keys.size() == values.size());
+  assert(theMap.empty());
+
+  SYNC_CODE(AutoMutex lock((isThreadSafe() ? &theMapMutex : NULL));)
+
+  csize numEntries = keys.size();
+
+  if (numThreads == 0)
+    numThreads = 1;
+
+  std::vector<BuildEntry> entries;
+  std::vector<IndexMapPair> mapEntries;
+  csize numConsumed = 0;
+
+  try
+  {
+    for (csize i = 0; i < numEntries; ++i)
+    {
+      if (keys[i]->size() != getNumColumns())
+      {
+        RAISE_ERROR_NO_LOC(zerr::ZSTR0003_INDEX_PARTIAL_KEY_INSERT,
+        ERROR_PARAMS(keys[i]->toString(), theQname->getStringValue()));
+      }
+    }
+
+    entries.resize(numEntries);
+
+    // Small builds are not worth the threads.
+    csize numRuns = std::min(numThreads, numEntries / 1024 + 1);
+
+    std::vector<csize> bounds(numRuns + 1);
+
+    for (csize run = 0; run <= numRuns; ++run)
+      bounds[run] = numEntries * run / numRuns;
+
+    std::unique_ptr<WorkStealingPool> pool;
+
+#ifndef ZORBA_FOR_ONE_THREAD_ONLY
+    if (numRuns > 1)
+      pool.reset(new WorkStealingPool(numRuns));
+#endif
+
+    BuildRunTask runTask(theCompFunction, keys, entries, bounds);
+    runBuildTasks(pool.get(), runTask, numRuns);
+
+    while (bounds.size() > 2)
+    {
+      MergeRunsTask mergeTask(theCompFunction, entries, bounds);
+      runBuildTasks(pool.get(), mergeTask, (bounds.size() - 1) / 2);
+
+      std::vector<csize> merged;
+
+      for (csize i = 0; i < bounds.size(); i += 2)
+        merged.push_back(bounds[i]);
+
+      if (merged.back() != numEntries)
+        merged.push_back(numEntries);
+
+      bounds.swap(merged);
+    }
+
+    // Group the entries with equal keys into value sets.
+    mapEntries.reserve(numEntries);
+
+    for (; numConsumed < numEntries; ++numConsumed)
+    {
+      BuildEntry& entry = entries[numConsumed];
+      csize pos = entry.second;
+
+      if (!mapEntries.empty() &&
+          !theCompFunction(mapEntries.back().first, entry.first))
+      {
+        if (isUnique())
+        {
+          RAISE_ERROR_NO_LOC(zerr::ZDDY0024_INDEX_UNIQUE_VIOLATION,
+          ERROR_PARAMS(theQname->getStringValue()));
+        }
+
+        mapEntries.back().second->transfer_back(values[pos]);
+
+        entry.first.release();
+        delete keys[pos];
+        keys[pos] = NULL;
+        continue;
+      }
+
+      ValueIndexValue* valueSet = new ValueIndexValue(1);
+      (*valueSet)[0].transfer(values[pos]);
+
+      mapEntries.push_back(IndexMapPair(entry.first, valueSet));
+      keys[pos] = NULL;
+    }
+  }
+  catch (...)
+  {
+    for (csize i = 0; i < mapEntries.size(); ++i)
+    {
+      delete mapEntries[i].first.getKey();
+      mapEntries[i].first.release();
+      delete mapEntries[i].second;
+    }
+
+    for (csize i = numConsumed; i < entries.size(); ++i)
+      entries[i].first.release();
+
+    for (csize i = 0; i < numEntries; ++i)
+      delete keys[i];
+
+    keys.clear();
+    throw;
+  }
+
+  theMap.assign_sorted(mapEntries.empty() ? NULL : &mapEntries[0],
+                       mapEntries.size());
+  keys.clear();
+}
+
+
 /******************************************************************************
 
 ********************************************************************************/
@@ -760,11 +1445,14 @@ bool ValueTreeIndex::remove(
 
   SYNC_CODE(AutoMutex lock((isThreadSafe() ? &theMapMutex : NULL));)
 
-  IndexMap::iterator pos = theMap.find(key);
+  SearchKey normKey;
+  theCompFunction.normalize(key, normKey.theKey);
+
+  IndexMap::iterator pos = theMap.find(normKey.theKey);
 
   if (pos != theMap.end())
   {
-    const store::IndexKey* keyp = pos->first;
+    NormalizedIndexKey keyp = pos->first;
     ValueIndexValue* valueSet = (*pos).second;
 
     ValueIndexValue::iterator valIte = 
@@ -777,7 +1465,8 @@ bool ValueTreeIndex::remove(
       if (valueSet->empty())
       {
         theMap.erase(pos);
-        delete keyp;
+        delete keyp.getKey();
+        keyp.release();
         delete valueSet;
       }
 
@@ -789,6 +1478,305 @@ bool ValueTreeIndex::remove(
 }
 
 
+/******************************************************************************
+
+********************************************************************************/
+ValueIndexBatch::~ValueIndexBatch()
+{
+  for (csize i = 0; i < theRemovals.size(); ++i)
+    theRemovals[i].theKey.release();
+
+  for (csize i = 0; i < theInsertions.size(); ++i)
+    theInsertions[i].theKey.release();
+}
+
+
+csize ValueIndexBatch::size() const
+{
+  csize size = 0;
+
+  for (csize i = 0; i < theRemoveDeltas.size(); ++i)
+    size += theRemoveDeltas[i]->size();
+
+  for (csize i = 0; i < theInsertDeltas.size(); ++i)
+    size += theInsertDeltas[i]->size();
+
+  return size;
+}
+
+
+/******************************************************************************
+  Orders the entries of a batch by key, and entries with equal keys by their
+  position in the deltas.
+********************************************************************************/
+class BatchEntryLess
+{
+protected:
+  const ValueIndexCompareFunction & theCompare;
+
+public:
+  BatchEntryLess(const ValueIndexCompareFunction& compare) : theCompare(compare) {}
+
+  bool operator()(
+      const ValueIndexBatch::Entry& e1,
+      const ValueIndexBatch::Entry& e2) const
+  {
+    if (theCompare(e1.theKey, e2.theKey))
+      return true;
+
+    if (theCompare(e2.theKey, e1.theKey))
+      return false;
+
+    return e1.thePos < e2.thePos;
+  }
+};
+
+
+class BatchKeyLess
+{
+protected:
+  const ValueIndexCompareFunction & theCompare;
+
+public:
+  BatchKeyLess(const ValueIndexCompareFunction& compare) : theCompare(compare) {}
+
+  bool operator()(
+      const ValueIndexBatch::Entry& e,
+      const NormalizedIndexKey& key) const
+  {
+    return theCompare(e.theKey, key);
+  }
+
+  bool operator()(
+      const NormalizedIndexKey& key,
+      const ValueIndexBatch::Entry& e) const
+  {
+    return theCompare(key, e.theKey);
+  }
+};
+
+
+static void collect_batch_entries(
+    const ValueIndexCompareFunction& compare,
+    const std::vector<store::IndexDelta::ValueDelta*>& deltas,
+    std::vector<ValueIndexBatch::Entry>& entries)
+{
+  csize pos = 0;
+
+  for (csize i = 0; i < deltas.size(); ++i)
+    pos += deltas[i]->size();
+
+  entries.resize(pos);
+  pos = 0;
+
+  for (csize i = 0; i < deltas.size(); ++i)
+  {
+    store::IndexDelta::ValueDelta& delta = *deltas[i];
+
+    for (csize j = 0; j < delta.size(); ++j, ++pos)
+    {
+      compare.normalize(delta[j].second, entries[pos].theKey);
+      entries[pos].thePair = &delta[j];
+      entries[pos].thePos = pos;
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(), BatchEntryLess(compare));
+}
+
+
+/******************************************************************************
+  Normalizes and sorts the entries of the given batch. The index itself is not
+  accessed, so the batches of different indexes may be prepared concurrently.
+********************************************************************************/
+void ValueTreeIndex::prepareBatch(ValueIndexBatch& batch) const
+{
+  csize numColumns = getNumColumns();
+
+  for (csize i = 0; i < batch.theRemoveDeltas.size(); ++i)
+  {
+    store::IndexDelta::ValueDelta& delta = *batch.theRemoveDeltas[i];
+
+    for (csize j = 0; j < delta.size(); ++j)
+    {
+      if (delta[j].second->size() != numColumns)
+      {
+        RAISE_ERROR_NO_LOC(zerr::ZSTR0004_INDEX_PARTIAL_KEY_REMOVE,
+        ERROR_PARAMS(delta[j].second->toString(), theQname->getStringValue()));
+      }
+    }
+  }
+
+  for (csize i = 0; i < batch.theInsertDeltas.size(); ++i)
+  {
+    store::IndexDelta::ValueDelta& delta = *batch.theInsertDeltas[i];
+
+    for (csize j = 0; j < delta.size(); ++j)
+    {
+      if (delta[j].second->size() != numColumns)
+      {
+        RAISE_ERROR_NO_LOC(zerr::ZSTR0003_INDEX_PARTIAL_KEY_INSERT,
+        ERROR_PARAMS(delta[j].second->toString(), theQname->getStringValue()));
+      }
+    }
+  }
+
+  collect_batch_entries(theCompFunction, batch.theRemoveDeltas, batch.theRemovals);
+  collect_batch_entries(theCompFunction, batch.theInsertDeltas, batch.theInsertions);
+}
+
+
+/******************************************************************************
+  Raises ZDDY0024 if applying the given batch would violate the uniqueness of
+  the index, i.e., if it inserts two entries with equal keys, or an entry with
+  the key of an index entry whose values are not all removed by the batch.
+********************************************************************************/
+void ValueTreeIndex::checkUniqueBatch(ValueIndexBatch& batch)
+{
+  std::vector<ValueIndexBatch::Entry>& removals = batch.theRemovals;
+  std::vector<ValueIndexBatch::Entry>& insertions = batch.theInsertions;
+
+  for (csize i = 0; i < insertions.size(); ++i)
+  {
+    const NormalizedIndexKey& key = insertions[i].theKey;
+
+    bool violation = (i + 1 < insertions.size() &&
+                      !theCompFunction(key, insertions[i + 1].theKey));
+
+    IndexMap::iterator pos = theMap.find(key);
+
+    if (!violation && pos != theMap.end())
+    {
+      std::pair<std::vector<ValueIndexBatch::Entry>::iterator,
+                std::vector<ValueIndexBatch::Entry>::iterator> removed =
+      std::equal_range(removals.begin(), removals.end(), key,
+                       BatchKeyLess(theCompFunction));
+
+      ValueIndexValue::const_iterator valIte = pos->second->begin();
+      ValueIndexValue::const_iterator valEnd = pos->second->end();
+
+      for (; valIte != valEnd && !violation; ++valIte)
+      {
+        violation = true;
+
+        for (std::vector<ValueIndexBatch::Entry>::iterator ite = removed.first;
+             ite != removed.second;
+             ++ite)
+        {
+          if (ite->thePair->first == *valIte)
+          {
+            violation = false;
+            break;
+          }
+        }
+      }
+    }
+
+    if (violation)
+    {
+      RAISE_ERROR_NO_LOC(zerr::ZDDY0024_INDEX_UNIQUE_VIOLATION,
+      ERROR_PARAMS(theQname->getStringValue()));
+    }
+  }
+}
+
+
+/******************************************************************************
+  Removes the entries of the removal deltas of the given batch from the index,
+  and then inserts the entries of its insertion deltas, with the same result
+  as calling remove(key, node, false) and insert(key, node) for each entry in
+  turn. prepareBatch() must have been called on the batch.
+
+  Instead of searching theMap for each entry, the sorted entries are merged
+  with theMap in one pass, and theMap is rebuilt bottom-up out of the result.
+  This pays off when the batch is not much smaller than the index.
+
+  As with insert(), the key obj of an inserted entry either passes to the
+  index or is deleted, and the key pointer of the entry is then set to the
+  key obj of the index. If an error is raised, the index is left unchanged.
+********************************************************************************/
+void ValueTreeIndex::applyBatch(ValueIndexBatch& batch)
+{
+  SYNC_CODE(AutoMutex lock((isThreadSafe() ? &theMapMutex : NULL));)
+
+  std::vector<ValueIndexBatch::Entry>& removals = batch.theRemovals;
+  std::vector<ValueIndexBatch::Entry>& insertions = batch.theInsertions;
+
+  if (isUnique())
+    checkUniqueBatch(batch);
+
+  std::vector<IndexMapPair> mapEntries;
+  mapEntries.reserve(theMap.size() + insertions.size());
+
+  IndexMap::iterator mapIte = theMap.begin();
+  IndexMap::iterator mapEnd = theMap.end();
+
+  csize numRemovals = removals.size();
+  csize numInsertions = insertions.size();
+  csize r = 0;
+  csize i = 0;
+
+  while (mapIte != mapEnd || i < numInsertions)
+  {
+    IndexMapPair entry;
+
+    if (i == numInsertions ||
+        (mapIte != mapEnd && !theCompFunction(insertions[i].theKey, mapIte->first)))
+    {
+      entry = *mapIte;
+      ++mapIte;
+
+      while (r < numRemovals && theCompFunction(removals[r].theKey, entry.first))
+        ++r;
+
+      for (; r < numRemovals && !theCompFunction(entry.first, removals[r].theKey); ++r)
+      {
+        ValueIndexValue::iterator valIte =
+        std::find(entry.second->begin(), entry.second->end(),
+                  removals[r].thePair->first);
+
+        if (valIte != entry.second->end())
+          entry.second->theItems.erase(valIte);
+      }
+    }
+    else
+    {
+      // Ownership of the key obj of the entry and of its normalized form
+      // passes to the index.
+      entry = IndexMapPair(insertions[i].theKey, new ValueIndexValue(0));
+      insertions[i].theKey.set(insertions[i].theKey.getKey());
+    }
+
+    for (; i < numInsertions && !theCompFunction(entry.first, insertions[i].theKey); ++i)
+    {
+      store::IndexDelta::ValuePair* pair = insertions[i].thePair;
+
+      if (pair->second != entry.first.getKey())
+      {
+        delete pair->second;
+        pair->second = const_cast<store::IndexKey*>(entry.first.getKey());
+      }
+
+      store::Item_t node = pair->first;
+      entry.second->transfer_back(node);
+    }
+
+    if (entry.second->empty())
+    {
+      delete entry.first.getKey();
+      entry.first.release();
+      delete entry.second;
+      continue;
+    }
+
+    mapEntries.push_back(entry);
+  }
+
+  theMap.assign_sorted(mapEntries.empty() ? NULL : &mapEntries[0],
+                       mapEntries.size());
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////
 //                                                                             //
 //  ProbeValueTreeIndexIterator                                                //
@@ -836,7 +1824,10 @@ void ProbeValueTreeIndexIterator::initExact()
 
   assert(key.size() == theIndex->getNumColumns());
 
-  theMapBegin = theIndex->theMap.find(&key);
+  SearchKey normKey;
+  theIndex->theCompFunction.normalize(&key, normKey.theKey);
+
+  theMapBegin = theIndex->theMap.find(normKey.theKey);
 
   if (theMapBegin != theIndex->theMap.end())
   {
@@ -950,9 +1941,18 @@ void ProbeValueTreeIndexIterator::initBox()
   //
   // Do the probing
   //
+  SearchKey normLowerBounds;
+  SearchKey normUpperBounds;
+
+  if (haveLowerBound)
+    theIndex->theCompFunction.normalize(&lowerBounds, normLowerBounds.theKey);
+
+  if (haveUpperBound)
+    theIndex->theCompFunction.normalize(&upperBounds, normUpperBounds.theKey);
+
   if (haveLowerBound && lowIncl)
   {
-    theMapBegin = theIndex->theMap.lower_bound(&lowerBounds);
+    theMapBegin = theIndex->theMap.lower_bound(normLowerBounds.theKey);
 
     if (theMapBegin == theIndex->theMap.end())
     {
@@ -962,7 +1962,7 @@ void ProbeValueTreeIndexIterator::initBox()
   }
   else if (haveLowerBound)
   {
-    theMapBegin = theIndex->theMap.upper_bound(&lowerBounds);
+    theMapBegin = theIndex->theMap.upper_bound(normLowerBounds.theKey);
 
     if (theMapBegin == theIndex->theMap.end())
     {
@@ -973,11 +1973,11 @@ void ProbeValueTreeIndexIterator::initBox()
 
   if (haveUpperBound && highIncl)
   {
-    theMapEnd = theIndex->theMap.upper_bound(&upperBounds);
+    theMapEnd = theIndex->theMap.upper_bound(normUpperBounds.theKey);
   }
   else if (haveUpperBound)
   {
-    theMapEnd = theIndex->theMap.lower_bound(&upperBounds);
+    theMapEnd = theIndex->theMap.lower_bound(normUpperBounds.theKey);
   }
 
   if (theMapEnd == theMapBegin)
@@ -1012,7 +2012,7 @@ void ProbeValueTreeIndexIterator::reset()
     {
       if (!theDoExtraFiltering ||
           theBoxCond == NULL ||
-          theBoxCond->test(*(theMapIte->first)))
+          theBoxCond->test(*(theMapIte->first.getKey())))
         break;
 
       ++theMapIte;
@@ -1069,7 +2069,7 @@ bool ProbeValueTreeIndexIterator::next(store::Item_t& result)
 
     while (theMapIte != theMapEnd)
     {
-      if (!theDoExtraFiltering || theBoxCond->test(*(theMapIte->first)))
+      if (!theDoExtraFiltering || theBoxCond->test(*(theMapIte->first.getKey())))
       {
         theResultSet = theMapIte->second;
         theIte = theResultSet->begin();
@@ -1106,6 +2106,32 @@ void ProbeValueTreeIndexIterator::count(store::Item_t& result)
 }
 
 
+/******************************************************************************
+  next() moves theMapIte to the following entry only when it is called after
+  the last node of the current entry has been returned, so theMapIte is the
+  entry of the node that next() has just returned.
+********************************************************************************/
+bool ProbeValueTreeIndexIterator::nextKeyColumn(
+    store::Item_t& result,
+    csize column)
+{
+  store::Item_t node;
+
+  while (next(node))
+  {
+    const store::Item_t& item = (*theMapIte->first.getKey())[column];
+
+    if (item != NULL)
+    {
+      result = item;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
 } // namespace simplestore
 } // namespace zorba
 /* vim:set et sw=2 ts=2: */
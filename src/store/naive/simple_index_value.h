@@ -16,9 +16,13 @@
 #ifndef ZORBA_SIMPLE_STORE_INDEX_HASH_VALUE
 #define ZORBA_SIMPLE_STORE_INDEX_HASH_VALUE
 
+#include <cstring>
+#include <string>
+
 #include "simple_index.h"
 #include "zorbatypes/integer.h"
-#include <map>
+#include "zorbautils/bloom_filter.h"
+#include "zorbautils/btree_map.h"
 
 namespace zorba
 {
@@ -27,20 +31,98 @@ namespace simplestore
 {
 
 /******************************************************************************
+  An IndexKey together with its normalized form, i.e., an order-preserving
+  byte encoding of the key (see ValueIndexCompareFunction::normalize()), if
+  the key has one. Two keys that both have normalized forms compare the same
+  way as their normalized forms do under memcmp. This is the key type of the
+  B+-tree of a ValueTreeIndex.
+
+  Normalized forms of up to INLINE_SIZE bytes are stored in the object itself,
+  so that the B+-tree can compare them without following any pointer; longer
+  ones are allocated on the heap. Since the B+-tree copies its keys around
+  freely, the object does not own its heap buffer: release() must be called
+  explicitly when the key is no longer needed.
+*******************************************************************************/
+class NormalizedIndexKey
+{
+public:
+  enum { INLINE_SIZE = 20 };
+
+  static const uint32_t NO_FORM = ~static_cast<uint32_t>(0);
+
+protected:
+  const store::IndexKey * theKey;
+  uint32_t                theSize;
+
+  union
+  {
+    char                  theInline[INLINE_SIZE];
+    char                * theHeap;
+  };
 
+public:
+  NormalizedIndexKey() : theKey(NULL), theSize(NO_FORM) {}
+
+  void set(const store::IndexKey* key) { theKey = key; theSize = NO_FORM; }
+
+  void set(const store::IndexKey* key, const std::string& form);
+
+  void release();
+
+  const store::IndexKey* getKey() const { return theKey; }
+
+  bool isNormalized() const { return theSize != NO_FORM; }
+
+  const char* getBytes() const
+  {
+    return (theSize <= INLINE_SIZE ? theInline : theHeap);
+  }
+
+  /**
+   * Like ValueIndexCompareFunction::compare(), this compares only as many
+   * columns as the shorter key has: no column form is a prefix of another
+   * one, so if one form is a prefix of the other, it is so column-wise.
+   */
+  long compareForms(const NormalizedIndexKey& other) const
+  {
+    uint32_t size = (theSize < other.theSize ? theSize : other.theSize);
+
+    return memcmp(getBytes(), other.getBytes(), size);
+  }
+};
+
+
+/******************************************************************************
+  theEncodings:
+  -------------
+  For each key column, how the values of that column are normalized (see
+  normalize()). It is derived from the declared type of the column, so all
+  the normalized keys of an index encode each column the same way.
 ********************************************************************************/
 class ValueIndexCompareFunction
 {
+public:
+  enum ColumnEncoding
+  {
+    NO_ENCODING,
+    INTEGER_ENCODING,
+    DOUBLE_ENCODING,
+    STRING_ENCODING,
+    DATETIME_ENCODING
+  };
+
 private:
-  csize                       theNumColumns;
-  long                        theTimezone;
-  std::vector<XQPCollator*>   theCollators;
+  csize                        theNumColumns;
+  long                         theTimezone;
+  std::vector<XQPCollator*>    theCollators;
+  std::vector<ColumnEncoding>  theEncodings;
 
 public:
   ValueIndexCompareFunction(
        csize numCols,
        long timezone,
-       const std::vector<std::string>& collation);
+       const std::vector<std::string>& collation,
+       const std::vector<store::Item_t>& keyTypes);
 
   ~ValueIndexCompareFunction();
 
@@ -56,6 +138,24 @@ public:
   {
     return compare(key1, key2) < 0;
   }
+
+  bool operator()(
+      const NormalizedIndexKey& key1,
+      const NormalizedIndexKey& key2) const
+  {
+    if (key1.isNormalized() && key2.isNormalized())
+      return key1.compareForms(key2) < 0;
+
+    return compare(key1.getKey(), key2.getKey()) < 0;
+  }
+
+  void normalize(const store::IndexKey* key, NormalizedIndexKey& result) const;
+
+protected:
+  bool normalizeColumn(
+      csize i,
+      const store::Item* item,
+      std::string& form) const;
 };
 
 
@@ -101,7 +201,15 @@ public:
 
 
 /******************************************************************************
-
+  theFilter:
+  ----------
+  A Bloom filter over the hashes of the keys of the index, so that most of the
+  probes with keys that are not in the index do not search the hash map. It is
+  enabled once the index has BloomFilter::MIN_KEYS keys, and it is rebuilt,
+  for twice as many keys as the index then has, every time the number of keys
+  inserted since the last rebuild exceeds theFilterCapacity. Removed keys stay
+  in the filter until the next rebuild. Thread-safe indexes have no filter,
+  because they may be probed while they are updated.
 *******************************************************************************/
 class ValueHashIndex : public ValueIndex
 {
@@ -133,7 +241,11 @@ protected:
   typedef rchandle<KeyIterator> KeyIterator_t;
 
 private:
-  IndexMap  theMap;
+  IndexMap     theMap;
+
+  BloomFilter  theFilter;
+  csize        theFilterCapacity;
+  csize        theFilterNumKeys;
 
 protected:
   ValueHashIndex(
@@ -156,6 +268,9 @@ public:
   bool insert(store::IndexKey*& key, store::Item_t& item);
 
   bool remove(const store::IndexKey* key, const store::Item_t& item, bool all);
+
+protected:
+  void insertInFilter(const store::IndexKey* key);
 };
 
 
@@ -169,13 +284,17 @@ protected:
 
   rchandle<IndexPointCondition>          theCondition;
 
+  const store::IndexKey                * theResultKey;
   ValueIndexValue                      * theResultSet;
   ValueIndexValue::const_iterator        theIte;
   ValueIndexValue::const_iterator        theEnd;
   xs_integer                             theSkip;
 
 public:
-  ProbeValueHashIndexIterator(const store::Index_t& index) : theResultSet(NULL)
+  ProbeValueHashIndexIterator(const store::Index_t& index)
+    :
+    theResultKey(NULL),
+    theResultSet(NULL)
   {
     theIndex = static_cast<ValueHashIndex*>(index.getp());
   }
@@ -191,20 +310,71 @@ public:
   void close();
 
   void count(store::Item_t& result);
+
+  bool nextKeyColumn(store::Item_t& result, csize column);
 };
 
 
 /******************************************************************************
+  The deltas of a ValueTreeIndex that a pul applies to it in one merged pass
+  (see ValueTreeIndex::applyBatch()) rather than entry by entry.
+
+  theRemovals and theInsertions are built by ValueTreeIndex::prepareBatch():
+  they point to the entries of the removal and insertion deltas, in the order
+  in which the deltas were added, and are sorted by their normalized keys.
+  Entries with equal keys stay in delta order, so the inserted values end up
+  in the value sets in the same order as with one-by-one insertions.
+*******************************************************************************/
+class ValueIndexBatch
+{
+  friend class ValueTreeIndex;
+
+public:
+  struct Entry
+  {
+    NormalizedIndexKey              theKey;
+    store::IndexDelta::ValuePair  * thePair;
+    csize                           thePos;
+  };
+
+protected:
+  std::vector<store::IndexDelta::ValueDelta*>  theRemoveDeltas;
+  std::vector<store::IndexDelta::ValueDelta*>  theInsertDeltas;
+
+  std::vector<Entry>                           theRemovals;
+  std::vector<Entry>                           theInsertions;
+
+public:
+  ~ValueIndexBatch();
+
+  void addRemovals(store::IndexDelta::ValueDelta& delta)
+  {
+    theRemoveDeltas.push_back(&delta);
+  }
+
+  void addInsertions(store::IndexDelta::ValueDelta& delta)
+  {
+    theInsertDeltas.push_back(&delta);
+  }
+
+  csize size() const;
+};
+
 
+/******************************************************************************
+  The entries are kept in a B+-tree (see BTreeMap), keyed by the normalized
+  forms of their keys where possible (see NormalizedIndexKey). The iterators
+  into theMap that the probe iterators hold are invalidated by any insertion
+  or removal of an entry.
 ********************************************************************************/
 class ValueTreeIndex : public ValueIndex
 {
   friend class Store;
   friend class ProbeValueTreeIndexIterator;
 
-  typedef std::pair<const store::IndexKey*, ValueIndexValue*> IndexMapPair;
+  typedef std::pair<NormalizedIndexKey, ValueIndexValue*> IndexMapPair;
 
-  typedef std::map<const store::IndexKey*,
+  typedef BTreeMap<NormalizedIndexKey,
                    ValueIndexValue*,
                    ValueIndexCompareFunction> IndexMap;
 
@@ -250,7 +420,19 @@ public:
 
   bool insert(store::IndexKey*& key, store::Item_t& item);
 
+  void bulkInsert(
+      std::vector<store::IndexKey*>& keys,
+      std::vector<store::Item_t>& values,
+      csize numThreads);
+
   bool remove(const store::IndexKey* key, const store::Item_t& item, bool all);
+
+  void prepareBatch(ValueIndexBatch& batch) const;
+
+  void applyBatch(ValueIndexBatch& batch);
+
+protected:
+  void checkUniqueBatch(ValueIndexBatch& batch);
 };
 
 
@@ -302,6 +484,8 @@ public:
   void close();
 
   void count(store::Item_t& result);
+
+  bool nextKeyColumn(store::Item_t& result, csize column);
 };
 
 
@@ -54,11 +54,23 @@ BasicItemFactory::BasicItemFactory(UriPool* uriPool, QNamePool* qnPool)
   theFalseItem(new BooleanItem(store::XS_BOOLEAN, false)),
   theNullItem(new json::JSONNull())
 {
+  theSmallIntegerItems.resize(SMALL_INTEGER_MAX - SMALL_INTEGER_MIN + 1);
+
+  for (long i = SMALL_INTEGER_MIN; i <= SMALL_INTEGER_MAX; ++i)
+  {
+    theSmallIntegerItems[i - SMALL_INTEGER_MIN] =
+    new IntegerItem(store::XS_INTEGER, xs_integer(i));
+  }
+
+  zstring empty;
+  theEmptyStringItem = new StringItem(store::XS_STRING, empty);
 }
 
 
 BasicItemFactory::~BasicItemFactory()
 {
+  theEmptyStringItem = NULL;
+  theSmallIntegerItems.clear();
   theFalseItem = NULL;
   theTrueItem  = NULL;
   theQNamePool = NULL;
@@ -143,7 +155,11 @@ bool BasicItemFactory::createStructuralAnyURI(
 
 bool BasicItemFactory::createString(store::Item_t& result, zstring& value)
 {
-  result = new StringItem(store::XS_STRING, value);
+  if (value.empty())
+    result = theEmptyStringItem;
+  else
+    result = new StringItem(store::XS_STRING, value);
+
   return true;
 }
 
@@ -340,7 +356,12 @@ bool BasicItemFactory::createDecimal(store::Item_t& result, const xs_decimal& va
 
 bool BasicItemFactory::createInteger(store::Item_t& result, const xs_integer& value)
 {
-  result = new IntegerItem(store::XS_INTEGER, value);
+  if (value >= static_cast<long>(SMALL_INTEGER_MIN) &&
+      value <= static_cast<long>(SMALL_INTEGER_MAX))
+    result = theSmallIntegerItems[to_xs_long(value) - SMALL_INTEGER_MIN];
+  else
+    result = new IntegerItem(store::XS_INTEGER, value);
+
   return true;
 }
 
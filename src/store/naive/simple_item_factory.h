@@ -17,6 +17,7 @@
 #define ZORBA_SIMPLE_STORE_ITEM_FACTORY
 
 #include <iostream>
+#include <vector>
 
 #include "shared_types.h"
 
@@ -59,6 +60,18 @@ protected:
   store::Item_t theFalseItem;
   store::Item_t theNullItem;
 
+  // Atomic items are immutable, so the xs:integer items with small values and
+  // the empty xs:string item, which queries create all the time, are shared
+  // too. createInteger and createString return them.
+  enum
+  {
+    SMALL_INTEGER_MIN = -128,
+    SMALL_INTEGER_MAX = 1023
+  };
+
+  std::vector<store::Item_t> theSmallIntegerItems;
+  store::Item_t              theEmptyStringItem;
+
 public:
   BasicItemFactory(UriPool* uriPool, QNamePool* qnPool);
 
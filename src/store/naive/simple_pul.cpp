@@ -17,6 +17,8 @@
 
 #include <algorithm>
 
+#include <zorba/properties.h>
+
 #include "diagnostics/xquery_diagnostics.h"
 #include "diagnostics/util_macros.h"
 
@@ -38,6 +40,8 @@
 #include "store/api/validator.h"
 #include "store/api/ic.h"
 
+#include "runtime/util/work_stealing_pool.h"
+
 
 namespace zorba {
 namespace simplestore {
@@ -2722,6 +2726,36 @@ void CollectionPul::switchPulInPrimitivesList(std::vector<UpdatePrimitive*>& lis
 }
 
 
+/*******************************************************************************
+  Drop the element name indexes (see class ElementNameIndex) of the trees that
+  are modified by the XQUF primitives of this pul. Called both before the
+  primitives are applied and after they are undone, since the node lists of an
+  index built in between would be stale.
+********************************************************************************/
+void CollectionPul::invalidateNameIndexes()
+{
+  invalidateNameIndexes(theDoFirstList);
+  invalidateNameIndexes(theInsertList);
+  invalidateNameIndexes(theReplaceNodeList);
+  invalidateNameIndexes(theReplaceContentList);
+  invalidateNameIndexes(theDeleteList);
+}
+
+
+void CollectionPul::invalidateNameIndexes(std::vector<UpdatePrimitive*>& list)
+{
+  std::vector<UpdatePrimitive*>::iterator ite = list.begin();
+  std::vector<UpdatePrimitive*>::iterator end = list.end();
+  for (; ite != end; ++ite)
+  {
+    store::Item* target = (*ite)->theTarget.getp();
+
+    if (target != NULL && target->isNode())
+      static_cast<XmlNode*>(target)->getTree()->invalidateNameIndex();
+  }
+}
+
+
 /*******************************************************************************
   For each incrementally-maintained index associated with this collection,
   compute the index contents on the modified and deleted docs, before any 
@@ -2878,10 +2912,16 @@ void CollectionPul::refreshIndexes()
     STORE_TRACE1("Refreshing indexes for collection "
                  << theCollection->getName()->getStringValue().c_str()); 
 
+    std::vector<std::unique_ptr<ValueIndexBatch> > batches(numIncrementalIndices);
+
+    prepareIndexBatches(batches);
+
     for (csize idx = 0; idx < numIncrementalIndices; ++idx)
     {
       if (theIncrementalIndices[idx]->isGeneral())
         refreshGeneralIndex(idx);
+      else if (batches[idx])
+        refreshValueIndexBatch(idx, *batches[idx]);
       else
         refreshValueIndex(idx);
     }
@@ -2894,6 +2934,110 @@ void CollectionPul::refreshIndexes()
 
 
 
+/*******************************************************************************
+  The deltas of a sorted value index are applied in one merged pass (see
+  ValueTreeIndex::applyBatch()) if they have at least BATCH_MIN_ENTRIES
+  entries in total, and at least 1/BATCH_MAX_RATIO as many as the index has
+  keys. Smaller deltas are cheaper to apply entry by entry.
+********************************************************************************/
+static const csize BATCH_MIN_ENTRIES = 1024;
+static const csize BATCH_MAX_RATIO = 8;
+
+
+/*******************************************************************************
+  Normalizes and sorts the entries of the batch of one index.
+********************************************************************************/
+class PrepareBatchTask : public WorkStealingPool::Task
+{
+protected:
+  const std::vector<IndexImpl*>                       & theIndexes;
+  const std::vector<std::unique_ptr<ValueIndexBatch> >& theBatches;
+  const std::vector<csize>                            & theBatchIndexes;
+
+public:
+  PrepareBatchTask(
+      const std::vector<IndexImpl*>& indexes,
+      const std::vector<std::unique_ptr<ValueIndexBatch> >& batches,
+      const std::vector<csize>& batchIndexes)
+    :
+    theIndexes(indexes),
+    theBatches(batches),
+    theBatchIndexes(batchIndexes)
+  {
+  }
+
+  void execute(csize pos, csize /*workerId*/)
+  {
+    csize idx = theBatchIndexes[pos];
+
+    static_cast<ValueTreeIndex*>(theIndexes[idx])->
+    prepareBatch(*theBatches[idx]);
+  }
+};
+
+
+/*******************************************************************************
+  Creates a batch for each incrementally maintained index whose deltas are
+  large enough to be applied in one merged pass, and prepares the batches.
+  The indexes are independent of each other, so their batches are prepared
+  in parallel, on up to Properties::getIndexBuildThreads() threads.
+********************************************************************************/
+void CollectionPul::prepareIndexBatches(
+    std::vector<std::unique_ptr<ValueIndexBatch> >& batches)
+{
+  csize numIncrementalIndices = theIncrementalIndices.size();
+  std::vector<csize> batchIndexes;
+
+  for (csize idx = 0; idx < numIncrementalIndices; ++idx)
+  {
+    IndexImpl* index = theIncrementalIndices[idx];
+
+    if (index->isGeneral() || !static_cast<ValueIndex*>(index)->isTreeIndex())
+      continue;
+
+    std::unique_ptr<ValueIndexBatch> batch(new ValueIndexBatch);
+
+    batch->addRemovals(theBeforeIndexDeltas[idx].getValueDelta());
+    batch->addRemovals(theDeletedDocsIndexDeltas[idx].getValueDelta());
+    batch->addInsertions(theAfterIndexDeltas[idx].getValueDelta());
+    batch->addInsertions(theInsertedDocsIndexDeltas[idx].getValueDelta());
+
+    csize numEntries = batch->size();
+
+    if (numEntries < BATCH_MIN_ENTRIES ||
+        numEntries * BATCH_MAX_RATIO < index->size())
+      continue;
+
+    batches[idx].swap(batch);
+    batchIndexes.push_back(idx);
+  }
+
+  PrepareBatchTask task(theIncrementalIndices, batches, batchIndexes);
+
+  std::unique_ptr<WorkStealingPool> pool;
+
+#ifndef ZORBA_FOR_ONE_THREAD_ONLY
+  csize numThreads = Properties::instance().getIndexBuildThreads();
+
+  if (numThreads > batchIndexes.size())
+    numThreads = batchIndexes.size();
+
+  if (numThreads > 1)
+    pool.reset(new WorkStealingPool(numThreads));
+#endif
+
+  if (pool.get() != NULL)
+  {
+    pool->run(task, batchIndexes.size());
+  }
+  else
+  {
+    for (csize i = 0; i < batchIndexes.size(); ++i)
+      task.execute(i, 0);
+  }
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
@@ -2975,6 +3119,36 @@ void CollectionPul::refreshValueIndex(csize idx)
 }
 
 
+/*******************************************************************************
+  Applies all the deltas of a sorted value index at once. applyBatch() leaves
+  the index unchanged if it raises an error, and otherwise has the effect of
+  refreshValueIndex(), so undoValueIndexRefresh() works the same either way.
+********************************************************************************/
+void CollectionPul::refreshValueIndexBatch(csize idx, ValueIndexBatch& batch)
+{
+  ValueTreeIndex* index = static_cast<ValueTreeIndex*>(theIncrementalIndices[idx]);
+
+  STORE_TRACE2("Index size before do = " << index->size()
+               << ", batch size = " << batch.size());
+
+  index->applyBatch(batch);
+
+  theNumBeforeIndexDeltasApplied[idx] =
+  theBeforeIndexDeltas[idx].getValueDelta().size();
+
+  theNumAfterIndexDeltasApplied[idx] =
+  theAfterIndexDeltas[idx].getValueDelta().size();
+
+  theNumDeletedDocsIndexDeltasApplied[idx] =
+  theDeletedDocsIndexDeltas[idx].getValueDelta().size();
+
+  theNumInsertedDocsIndexDeltasApplied[idx] =
+  theInsertedDocsIndexDeltas[idx].getValueDelta().size();
+
+  STORE_TRACE2("Index size after do = " << index->size());
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
@@ -3447,6 +3621,8 @@ void CollectionPul::applyUpdates()
 
     theIsApplied = true;
 
+    invalidateNameIndexes();
+
     // Apply all the XQUF update primitives
     applyList(theDoFirstList);
     applyList(theInsertList);
@@ -3659,6 +3835,8 @@ void CollectionPul::undoUpdates()
     undoList(theInsertList);
     undoList(theDoFirstList);
 
+    invalidateNameIndexes();
+
     undoRefreshIndexes();
   }
   catch (...)
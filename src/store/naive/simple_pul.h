@@ -16,6 +16,7 @@
 #ifndef ZORBA_SIMPLE_STORE_PUL
 #define ZORBA_SIMPLE_STORE_PUL
 
+#include <memory>
 #include <vector>
 
 #include "shared_types.h"
@@ -41,6 +42,7 @@ namespace simplestore
 
 class UpdatePrimitive;
 class IndexKey;
+class ValueIndexBatch;
 class PULImpl;
 class QNameItem;
 class Collection;
@@ -250,12 +252,21 @@ public:
 protected:
   void switchPulInPrimitivesList(std::vector<UpdatePrimitive*>& list);
 
+  void invalidateNameIndexes(std::vector<UpdatePrimitive*>& list);
+
+  void invalidateNameIndexes();
+
   void computeIndexDeltas(std::vector<IndexDeltaImpl>& deltas);
 
   void cleanIndexDeltas();
 
+  void prepareIndexBatches(
+      std::vector<std::unique_ptr<ValueIndexBatch> >& batches);
+
   void refreshValueIndex(csize idx);
 
+  void refreshValueIndexBatch(csize idx, ValueIndexBatch& batch);
+
   void refreshGeneralIndex(csize idx);
 
   void undoValueIndexRefresh(csize idx);
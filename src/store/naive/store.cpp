@@ -22,6 +22,7 @@
 
 #include <zorba/internal/cxx_util.h>
 #include <zorba/internal/unique_ptr.h>
+#include <zorba/properties.h>
 
 #include "zorbautils/hashfun.h"
 #include "zorbautils/fatal.h"
@@ -32,6 +33,8 @@
 
 #include "store/api/pul.h"
 
+#include "runtime/util/work_stealing_pool.h"
+
 #include "string_pool.h"
 #include "simple_store.h"
 #include "simple_temp_seq.h"
@@ -57,6 +60,7 @@
 #include "document_name_iterator.h"
 #include "pul_primitive_factory.h"
 #include "tree_id_generator.h"
+#include "object_shape.h"
 
 #include "zorbautils/string_util.h"
 
@@ -106,6 +110,7 @@ Store::Store()
   theNodeFactory(NULL),
   thePULFactory(NULL),
   theTreeIdGeneratorFactory(NULL),
+  theObjectShapes(NULL),
   theDocuments(DEFAULT_DOCUMENT_SET_SIZE, true),
   theCollections(0),
   theIndices(HashMapItemPointerCmp(0, NULL), DEFAULT_INDICES_SET_SIZE, true),
@@ -127,6 +132,7 @@ Store::~Store()
 {
   delete theEmptyNs;
   delete theXmlSchemaNs;
+  delete theObjectShapes;
 }
 
 
@@ -170,6 +176,11 @@ void Store::init()
     
     theTreeIdGeneratorFactory = createTreeIdGeneratorFactory();
 
+    // The shapes outlive shutdown(), since objects that are released late
+    // (e.g. by cached plans) still point to them.
+    if (theObjectShapes == NULL)
+      theObjectShapes = new json::ObjectShapeTable();
+
     theCollections = createCollectionSet();
 
     StoreManagerImpl::theStore = this;
@@ -536,6 +547,17 @@ void Store::populateValueIndex(
 
   ValueIndex* index = static_cast<ValueIndex*>(idx.getp());
 
+  // A sorted index can be built in bulk, on several threads, once all its
+  // entries have been computed (see ValueTreeIndex::bulkInsert()).
+  csize numThreads = Properties::instance().getIndexBuildThreads();
+  bool bulk = false;
+  std::vector<store::IndexKey*> bulkKeys;
+  std::vector<store::Item_t> bulkValues;
+
+#ifndef ZORBA_FOR_ONE_THREAD_ONLY
+  bulk = (numThreads > 1 && index->isTreeIndex() && index->size() == 0);
+#endif
+
   sourceIter->open();
 
   try
@@ -566,18 +588,37 @@ void Store::populateValueIndex(
         }
       }
 
+      if (bulk)
+      {
+        bulkKeys.push_back(key);
+        bulkValues.push_back(domainItem);
+        key = key2 = NULL;
+        continue;
+      }
+
       key2 = key;
       index->insert(key2, domainItem);
     }
 
     if (key != key2)
       delete key;
+
+    key = NULL;
+
+    if (bulk)
+    {
+      static_cast<ValueTreeIndex*>(index)->
+      bulkInsert(bulkKeys, bulkValues, numThreads);
+    }
   }
   catch(...)
   {
     if (key != NULL)
       delete key;
 
+    for (csize i = 0; i < bulkKeys.size(); ++i)
+      delete bulkKeys[i];
+
     sourceIter->close();
     throw;
   }
@@ -1009,6 +1050,120 @@ store::Item_t Store::loadDocument(
 }
 
 
+/*******************************************************************************
+  Loads the documents of a loadDocuments() call. Every document gets its own
+  loader, and thus its own tree and qname cache, so the documents share nothing
+  but the (thread-safe) pools and factories of the store. The errors are kept
+  per document, so that loadDocuments() raises the same error no matter which
+  thread finished first.
+********************************************************************************/
+class DocumentLoadTask : public WorkStealingPool::Task
+{
+protected:
+  const std::vector<zstring>           & theDocUris;
+  const std::vector<std::istream*>     & theStreams;
+  const store::LoadProperties          & theLoadProperties;
+  std::vector<store::Item_t>           & theDocs;
+  std::vector<ZorbaException*>           theErrors;
+
+public:
+  DocumentLoadTask(
+      const std::vector<zstring>& docUris,
+      const std::vector<std::istream*>& streams,
+      const store::LoadProperties& loadProperties,
+      std::vector<store::Item_t>& docs)
+    :
+    theDocUris(docUris),
+    theStreams(streams),
+    theLoadProperties(loadProperties),
+    theDocs(docs),
+    theErrors(docUris.size(), NULL)
+  {
+  }
+
+  ~DocumentLoadTask()
+  {
+    for (csize i = 0; i < theErrors.size(); ++i)
+      delete theErrors[i];
+  }
+
+  void execute(csize pos, csize /*workerId*/)
+  {
+    XQueryDiagnostics diagnostics;
+
+    try
+    {
+      std::unique_ptr<XmlLoader> loader(
+        GET_STORE().getXmlLoader(&diagnostics, theLoadProperties));
+
+      theDocs[pos] = loader->loadXml(theDocUris[pos],
+                                     theDocUris[pos],
+                                     *theStreams[pos]);
+
+      if (!diagnostics.errors().empty())
+        theErrors[pos] = clone(*diagnostics.errors().front()).release();
+    }
+    catch (ZorbaException const& e)
+    {
+      theErrors[pos] = clone(e).release();
+    }
+  }
+
+  void raiseFirstError() const
+  {
+    for (csize i = 0; i < theErrors.size(); ++i)
+    {
+      if (theErrors[i] != NULL)
+        theErrors[i]->polymorphic_throw();
+    }
+  }
+};
+
+
+void Store::loadDocuments(
+    const std::vector<zstring>& docUris,
+    const std::vector<std::istream*>& streams,
+    const store::LoadProperties& loadProperties,
+    csize numThreads,
+    std::vector<store::Item_t>& docs)
+{
+  ZORBA_ASSERT(docUris.size() == streams.size());
+
+  csize numDocs = docUris.size();
+
+  docs.clear();
+  docs.resize(numDocs);
+
+  DocumentLoadTask task(docUris, streams, loadProperties, docs);
+
+#ifndef ZORBA_FOR_ONE_THREAD_ONLY
+  if (numThreads > 1 && numDocs > 1)
+  {
+    WorkStealingPool pool(numThreads);
+    pool.run(task, numDocs);
+  }
+  else
+#endif
+  {
+    for (csize i = 0; i < numDocs; ++i)
+      task.execute(i, 0);
+  }
+
+  task.raiseFirstError();
+
+  if (loadProperties.getStoreDocument())
+  {
+    for (csize i = 0; i < numDocs; ++i)
+    {
+      XmlNode_t root = static_cast<XmlNode*>(docs[i].getp());
+
+      if (root != NULL)
+        theDocuments.insert(docUris[i], root);
+    }
+  }
+}
+
+
 /*******************************************************************************
   For lazy loading...
   Param stream is a heap pointer to an input stream. This is to be deallocated
@@ -64,6 +64,11 @@ class PULPrimitiveFactory;
 class TreeIdGeneratorFactory;
 class TreeIdGenerator;
 
+namespace json
+{
+class ObjectShapeTable;
+}
+
 ZSTRING_HASH_MAP(XmlNode_t, DocumentSet);
 ITEM_PTR_HASH_MAP(store::Index_t, IndexSet);
 ITEM_PTR_HASH_MAP(store::IC_t, ICSet);
@@ -109,6 +114,10 @@ ITEM_PTR_HASH_MAP(store::IC_t, ICSet);
   -------------------
   The tree-id generator used by the store for trees that are not in collections.
 
+  theObjectShapes:
+  ----------------
+  The shapes (key lists) shared by the json objects of the store.
+
   theDocuments:
   -------------
   A hashmap that for each xml tree that does not belong to any collection, maps
@@ -176,6 +185,8 @@ protected:
   
   TreeIdGenerator             * theTreeIdGenerator;
 
+  json::ObjectShapeTable      * theObjectShapes;
+
   DocumentSet                   theDocuments;
   CollectionSet*                theCollections;
   IndexSet                      theIndices;
@@ -234,6 +245,8 @@ public:
 
   QNamePool& getQNamePool() const { return *theQNamePool; }
 
+  json::ObjectShapeTable& getObjectShapes() const { return *theObjectShapes; }
+
 protected:
   // Functions to create/destory the node and item factories. These functions
   // are called from init and shutdown, respectively. Having this functionality
@@ -367,6 +380,13 @@ public:
       std::istream* stream,
       const store::LoadProperties& loadProperties);
 
+  virtual void loadDocuments(
+      const std::vector<zstring>& docUris,
+      const std::vector<std::istream*>& streams,
+      const store::LoadProperties& loadProperties,
+      csize numThreads,
+      std::vector<store::Item_t>& docs);
+
   virtual void addNode(const zstring& uri, const store::Item_t& node);
 
   virtual store::Iterator_t getDocumentNames() const;
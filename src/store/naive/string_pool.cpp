@@ -22,10 +22,46 @@
 
 namespace zorba { namespace simplestore {
 
+/*******************************************************************************
+
+********************************************************************************/
+StringPool::StringPool(ulong size)
+{
+  ulong shardSize = size / NUM_SHARDS;
+
+  if (shardSize < 16)
+    shardSize = 16;
+
+  for (csize i = 0; i < NUM_SHARDS; ++i)
+    theShards[i] = new Shard(shardSize);
+}
+
+
 /*******************************************************************************
 
 ********************************************************************************/
 StringPool::~StringPool() 
+{
+  csize count = 0;
+
+  for (csize i = 0; i < NUM_SHARDS; ++i)
+  {
+    count += theShards[i]->numSharedStrings();
+    delete theShards[i];
+  }
+
+  if (count > 0)
+  {
+    throw ZORBA_EXCEPTION(zerr::ZSTR0065_STRINGS_IN_POOL, ERROR_PARAMS(count));
+  }
+}
+
+
+/*******************************************************************************
+  Return the number of strings in the shard that are still used outside the
+  pool (and print them).
+********************************************************************************/
+csize StringPool::Shard::numSharedStrings() const
 {
   csize count = 0;
   csize n = capacity();
@@ -36,15 +72,11 @@ StringPool::~StringPool()
     {
       std::cerr << "ID: " << i << " Referenced URI: "
                 << theHashTab[i].key() << std::endl;
-      //delete theHashTab[i].theString.getp();
       count++;
     }
   }
 
-  if (count > 0)
-  {
-    throw ZORBA_EXCEPTION(zerr::ZSTR0065_STRINGS_IN_POOL, ERROR_PARAMS(count));
-  }
+  return count;
 }
 
 
@@ -59,12 +91,16 @@ bool StringPool::insertc(const char* str, zstring& outStr)
 
   zstring::size_type len = strlen(str);
 
-  ulong hval = hashfun::h32(str, len, FNV_32_INIT) % bucket_count();
+  uint32_t hcode = hashfun::h32(str, len, FNV_32_INIT);
+
+  Shard& shard = getShard(hcode);
+
+  ulong hval = hcode % shard.bucket_count();
 
   {
-    SYNC_CODE(AutoMutex lock(&theMutex);)
+    SYNC_CODE(AutoMutex lock(&shard.theMutex);)
 
-    HashEntry<zstring, DummyHashValue>* entry = &theHashTab[hval];
+    HashEntry<zstring, DummyHashValue>* entry = &shard.theHashTab[hval];
 
     if (!entry->isFree())
     {
@@ -87,17 +123,38 @@ bool StringPool::insertc(const char* str, zstring& outStr)
   }
 
   zstring tmp(str, len);
-  insert(tmp, outStr);
+  shard.insert(tmp, outStr);
 
   return true;
 }
 
 
+/*******************************************************************************
+  If the pool does not contain a string equal to str, insert str in the pool
+  and return true. Otherwise, return false. In both cases, return in outStr
+  the string in the pool.
+********************************************************************************/
+bool StringPool::insert(const zstring& str, zstring& outStr)
+{
+  return getShard(StringPoolCompareFunction::hash(str)).insert(str, outStr);
+}
+
+
+/*******************************************************************************
+  If the pool does not contain a string equal to str, insert str in the pool
+  and return true. Otherwise, return false.
+********************************************************************************/
+bool StringPool::insert(zstring& str)
+{
+  return getShard(StringPoolCompareFunction::hash(str)).insert(str);
+}
+
+
 /*******************************************************************************
   Look for strings that are not used by anybody outside the pool. Delete each
   such string and place its entry in the free list.
 ********************************************************************************/
-void StringPool::garbageCollect()
+void StringPool::Shard::garbageCollect()
 {
   HashEntry<zstring, DummyHashValue>* currEntry;
 
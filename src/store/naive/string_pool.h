@@ -44,21 +44,56 @@ public:
 /*******************************************************************************
   A hash-based set container of zstrings.
 
-  It is used to implement a pool of URI strings.
+  It is used to implement a pool of URI strings. The strings are partitioned
+  into NUM_SHARDS shards, based on their hash code, and each shard is a separate
+  hash set with its own mutex. So, threads that intern different strings (e.g.
+  threads that load documents in parallel) rarely wait for each other.
 ********************************************************************************/
-class StringPool : public HashSet<zstring, StringPoolCompareFunction>
+class StringPool
 {
 public:
- StringPool(ulong size) 
-    :
-    HashSet<zstring, StringPoolCompareFunction>(size, true) {}
+  static const csize NUM_SHARDS = 8;
+
+protected:
+  class Shard : public HashSet<zstring, StringPoolCompareFunction>
+  {
+    friend class StringPool;
+
+  public:
+    Shard(ulong size)
+      :
+      HashSet<zstring, StringPoolCompareFunction>(size, true) {}
+
+    csize numSharedStrings() const;
+
+  protected:
+    void garbageCollect();
+  };
+
+protected:
+  Shard  * theShards[NUM_SHARDS];
+
+public:
+  StringPool(ulong size);
 
   ~StringPool();
 
   bool insertc(const char* str, zstring& outStr);
 
+  bool insert(const zstring& str, zstring& outStr);
+
+  bool insert(zstring& str);
+
 protected:
-  void garbageCollect();
+  Shard& getShard(uint32_t hval) const
+  {
+    // The low bits of the hash code select the bucket within the shard.
+    return *theShards[(hval >> 16) % NUM_SHARDS];
+  }
+
+private:
+  StringPool(const StringPool&);
+  void operator=(const StringPool&);
 };
 
 
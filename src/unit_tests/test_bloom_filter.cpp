@@ -0,0 +1,99 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stdafx.h"
+#include <iostream>
+
+#include "zorbautils/bloom_filter.h"
+
+using namespace std;
+using namespace zorba;
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int failures;
+
+static bool assert_true( int no, char const *expr, int line, bool result ) {
+  if ( !result ) {
+    cout << '#' << no << " FAILED, line " << line << ": " << expr << endl;
+    ++failures;
+  }
+  return result;
+}
+
+#define ASSERT_TRUE( NO, EXPR ) assert_true( NO, #EXPR, __LINE__, !!(EXPR) )
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Counts the values in [begin, end) that the filter may contain. The values
+ * are spaced like the addresses of nodes, i.e., their low bits are constant.
+ */
+static csize count_hits( BloomFilter const &f, uint32_t begin, uint32_t end ) {
+  csize hits = 0;
+  for ( uint32_t v = begin; v < end; ++v )
+    hits += f.mayContain( v * 64 );
+  return hits;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace zorba {
+namespace UnitTests {
+
+int test_bloom_filter( int, char*[] ) {
+  uint32_t const num_keys = 100000;
+  BloomFilter f;
+
+  ASSERT_TRUE( 1, !f.isEnabled() && f.mayContain( 0 ) );
+
+  // Small key sets get no filter: every probe goes to the table.
+  f.init( BloomFilter::MIN_KEYS - 1 );
+  ASSERT_TRUE( 2, !f.isEnabled() );
+  ASSERT_TRUE( 3, count_hits( f, 0, 1000 ) == 1000 );
+
+  f.init( num_keys );
+  ASSERT_TRUE( 4, f.isEnabled() );
+  ASSERT_TRUE( 5, count_hits( f, 0, num_keys ) == 0 );
+
+  for ( uint32_t v = 0; v < num_keys; ++v )
+    f.insert( v * 64 );
+
+  // No false negatives, and few false positives.
+  ASSERT_TRUE( 6, count_hits( f, 0, num_keys ) == num_keys );
+  csize const false_hits = count_hits( f, num_keys, 11 * num_keys );
+  ASSERT_TRUE( 7, false_hits < num_keys * 10 / 100 );
+
+  // A filter that holds twice its number of keys is less selective, but
+  // still has no false negatives.
+  for ( uint32_t v = num_keys; v < 2 * num_keys; ++v )
+    f.insert( v * 64 );
+  ASSERT_TRUE( 8, count_hits( f, 0, 2 * num_keys ) == 2 * num_keys );
+
+  f.init( num_keys );
+  ASSERT_TRUE( 9, count_hits( f, 0, 2 * num_keys ) == 0 );
+
+  f.clear();
+  ASSERT_TRUE( 10, !f.isEnabled() && f.mayContain( 64 ) );
+
+  cout << failures << " test(s) failed\n";
+  return failures ? 1 : 0;
+}
+
+} // namespace UnitTests
+} // namespace zorba
+
+/* vim:set et sw=2 ts=2: */
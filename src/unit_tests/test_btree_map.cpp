@@ -0,0 +1,196 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stdafx.h"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "zorbautils/btree_map.h"
+
+using namespace std;
+using namespace zorba;
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int failures;
+
+static bool assert_true( int no, char const *expr, int line, bool result ) {
+  if ( !result ) {
+    cout << '#' << no << " FAILED, line " << line << ": " << expr << endl;
+    ++failures;
+  }
+  return result;
+}
+
+#define ASSERT_TRUE( NO, EXPR ) assert_true( NO, #EXPR, __LINE__, !!(EXPR) )
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct long_less {
+  bool operator()( long a, long b ) const {
+    return a < b;
+  }
+};
+
+/**
+ * Orders keys by their hundreds first, like index keys by their first column.
+ * A negative key -(h+1) stands for the prefix h: it is equivalent to all the
+ * keys in [100h, 100h+99], like a key with fewer columns.
+ */
+struct prefix_less {
+  static long prefix( long a ) {
+    return a < 0 ? -a - 1 : a / 100;
+  }
+  bool operator()( long a, long b ) const {
+    if ( prefix( a ) != prefix( b ) )
+      return prefix( a ) < prefix( b );
+    return a >= 0 && b >= 0 && a < b;
+  }
+};
+
+typedef BTreeMap<long,long,long_less> btree_type;
+typedef map<long,long> map_type;
+
+static bool same_entries( btree_type const &bt, map_type const &m ) {
+  if ( bt.size() != m.size() )
+    return false;
+  btree_type::const_iterator i = bt.begin();
+  map_type::const_iterator j = m.begin();
+  for ( ; j != m.end(); ++i, ++j ) {
+    if ( i == bt.end() || i->first != j->first || i->second != j->second )
+      return false;
+  }
+  return i == bt.end();
+}
+
+static bool same_bounds( btree_type const &bt, map_type const &m, long key ) {
+  btree_type::const_iterator i = bt.lower_bound( key );
+  map_type::const_iterator j = m.lower_bound( key );
+  if ( (i == bt.end()) != (j == m.end()) ||
+       (j != m.end() && i->first != j->first) )
+    return false;
+
+  i = bt.upper_bound( key );
+  j = m.upper_bound( key );
+  if ( (i == bt.end()) != (j == m.end()) ||
+       (j != m.end() && i->first != j->first) )
+    return false;
+
+  i = bt.find( key );
+  j = m.find( key );
+  return (i == bt.end()) == (j == m.end());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace zorba {
+namespace UnitTests {
+
+int test_btree_map( int, char*[] ) {
+  int const num_keys = 20000;
+  long_less const less;
+  btree_type bt( less );
+  map_type m;
+
+  ASSERT_TRUE( 1, bt.empty() && bt.begin() == bt.end() );
+  ASSERT_TRUE( 2, bt.lower_bound( 0 ) == bt.end() );
+
+  srand( 1 );
+
+  // Random inserts and erases, enough to split inner nodes.
+  for ( int i = 0; i < 10 * num_keys; ++i ) {
+    long const key = rand() % num_keys;
+    if ( rand() % 3 ) {
+      bool const inserted = bt.insert( make_pair( key, key * 2 ) ).second;
+      ASSERT_TRUE( 3, inserted == m.insert( make_pair( key, key * 2 ) ).second );
+    } else {
+      btree_type::iterator const pos = bt.find( key );
+      map_type::iterator const mpos = m.find( key );
+      if ( ASSERT_TRUE( 4, (pos == bt.end()) == (mpos == m.end()) ) &&
+           pos != bt.end() ) {
+        bt.erase( pos );
+        m.erase( mpos );
+      }
+    }
+    if ( i % 10000 == 0 ) {
+      ASSERT_TRUE( 5, same_entries( bt, m ) );
+      for ( long key = -1; key <= num_keys; key += 97 )
+        ASSERT_TRUE( 6, same_bounds( bt, m, key ) );
+    }
+  }
+
+  ASSERT_TRUE( 7, same_entries( bt, m ) );
+
+  // Erase everything, which frees all the leaves but the root.
+  while ( !m.empty() ) {
+    bt.erase( bt.find( m.begin()->first ) );
+    m.erase( m.begin() );
+  }
+  ASSERT_TRUE( 8, bt.empty() && bt.begin() == bt.end() );
+
+  for ( long key = 0; key < num_keys; ++key )
+    bt.insert( make_pair( key, key ) );
+  ASSERT_TRUE( 9, bt.size() == static_cast<csize>( num_keys ) );
+
+  bt.clear();
+  ASSERT_TRUE( 10, bt.empty() && bt.find( 0 ) == bt.end() );
+
+  // Bulk loads of various sizes, followed by random updates.
+  for ( int count = 0; count < num_keys; count = count * 3 + 1 ) {
+    vector<btree_type::value_type> entries;
+    m.clear();
+    for ( long key = 0; key < count; ++key ) {
+      entries.push_back( make_pair( key * 2, key ) );
+      m.insert( make_pair( key * 2, key ) );
+    }
+    bt.assign_sorted( entries.empty() ? NULL : &entries[0], entries.size() );
+    ASSERT_TRUE( 11, same_entries( bt, m ) );
+    for ( long key = -1; key <= 2 * count; key += 7 )
+      ASSERT_TRUE( 12, same_bounds( bt, m, key ) );
+
+    for ( int i = 0; i < count; ++i ) {
+      long const key = rand() % (2 * count + 2);
+      if ( rand() % 2 ) {
+        bt.insert( make_pair( key, key ) );
+        m.insert( make_pair( key, key ) );
+      } else if ( m.find( key ) != m.end() ) {
+        bt.erase( bt.find( key ) );
+        m.erase( key );
+      }
+    }
+    ASSERT_TRUE( 13, same_entries( bt, m ) );
+  }
+
+  // Probes with prefixes, each equivalent to the entries of many leaves.
+  prefix_less const pless;
+  BTreeMap<long,long,prefix_less> pbt( pless );
+  for ( long key = 0; key < num_keys; ++key )
+    pbt.insert( make_pair( key, key ) );
+  for ( long p = 0; p < num_keys / 100; p += 13 ) {
+    ASSERT_TRUE( 14, pbt.lower_bound( -p - 1 )->first == p * 100 );
+    ASSERT_TRUE( 15, pbt.upper_bound( -p - 1 ) == pbt.find( p * 100 + 100 ) );
+  }
+
+  cout << failures << " test(s) failed\n";
+  return failures ? 1 : 0;
+}
+
+} // namespace UnitTests
+} // namespace zorba
+
+/* vim:set et sw=2 ts=2: */
@@ -31,6 +31,8 @@ namespace UnitTests {
   int test_ato_( int, char*[] );
   int test_base64( int, char*[] );
   int test_base64_streambuf( int, char*[] );
+  int test_bloom_filter( int, char*[] );
+  int test_btree_map( int, char*[] );
   int test_fs_util( int, char*[] );
   int test_hashmaps( int argc, char* argv[] );
   int test_hexbinary( int argc, char* argv[] );
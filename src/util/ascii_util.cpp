@@ -20,6 +20,11 @@
 #include <cstring>
 #include <iomanip>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ZORBA_ASCII_SSE2 1
+#endif /* __SSE2__ */
+
 // local
 #include "ascii_util.h"
 
@@ -38,6 +43,69 @@ bool is_space( char const *s ) {
   return true;
 }
 
+/**
+ * Finds the first character in [begin,end) that is one of the (up to 4) given
+ * characters or, if \a NonPrint is \c true, that is not printable ASCII.
+ */
+template<bool NonPrint>
+static char const* find_impl( char const *begin, char const *end,
+                              char const *chars ) {
+  // Unused slots repeat the first character.
+  char sc[4];
+  sc[0] = sc[1] = sc[2] = sc[3] = chars[0];
+  for ( int i = 1; i < 4 && chars[i]; ++i )
+    sc[i] = chars[i];
+
+  char const *s = begin;
+#ifdef ZORBA_ASCII_SSE2
+  //
+  // Since the bytes are compared as signed, those of non-ASCII characters
+  // (>= 0x80) are less than 0x20 just like the control characters.
+  //
+  __m128i const space = _mm_set1_epi8( 0x20 );
+  __m128i const del = _mm_set1_epi8( 0x7F );
+  __m128i const sc0 = _mm_set1_epi8( sc[0] );
+  __m128i const sc1 = _mm_set1_epi8( sc[1] );
+  __m128i const sc2 = _mm_set1_epi8( sc[2] );
+  __m128i const sc3 = _mm_set1_epi8( sc[3] );
+
+  for ( ; end - s >= 16; s += 16 ) {
+    __m128i const x = _mm_loadu_si128( reinterpret_cast<__m128i const*>( s ) );
+    __m128i m = _mm_or_si128(
+      _mm_or_si128( _mm_cmpeq_epi8( x, sc0 ), _mm_cmpeq_epi8( x, sc1 ) ),
+      _mm_or_si128( _mm_cmpeq_epi8( x, sc2 ), _mm_cmpeq_epi8( x, sc3 ) )
+    );
+    if ( NonPrint )
+      m = _mm_or_si128( m, _mm_or_si128(
+        _mm_cmplt_epi8( x, space ), _mm_cmpeq_epi8( x, del )
+      ) );
+    if ( unsigned mask = _mm_movemask_epi8( m ) ) {
+      for ( ; !(mask & 1); mask >>= 1 )
+        ++s;
+      return s;
+    }
+  }
+#endif /* ZORBA_ASCII_SSE2 */
+
+  for ( ; s < end; ++s ) {
+    unsigned char const c = static_cast<unsigned char>( *s );
+    if ( NonPrint && (c < 0x20 || c >= 0x7F) )
+      break;
+    if ( c == sc[0] || c == sc[1] || c == sc[2] || c == sc[3] )
+      break;
+  }
+  return s;
+}
+
+char const* find_any( char const *begin, char const *end, char const *chars ) {
+  return find_impl<false>( begin, end, chars );
+}
+
+char const* find_escapable( char const *begin, char const *end,
+                            char const *specials ) {
+  return find_impl<true>( begin, end, specials );
+}
+
 char* itoa( long long n, char *buf ) {
   //
   // This implementation is much faster than using sprintf(3).
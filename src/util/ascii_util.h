@@ -252,6 +252,37 @@ is_xdigit( CharType c ) {
   return is_ascii( c ) && isxdigit( c );
 }
 
+////////// Scanning ///////////////////////////////////////////////////////////
+
+/**
+ * Finds the first character in the given range that is one of the given
+ * characters.  On processors that have SSE2, the range is scanned 16 bytes at
+ * a time.
+ *
+ * @param begin A pointer to the first character of the range.
+ * @param end A pointer to one past the last character of the range.
+ * @param chars The NULL-terminated characters to find.  There must be at least
+ * 1 and at most 4 of them.
+ * @return Returns a pointer to the first such character or \a end if none.
+ */
+char const* find_any( char const *begin, char const *end, char const *chars );
+
+/**
+ * Finds the first character in the given range that either is not a printable
+ * ASCII character (i.e., is a control character, DEL, or a byte of a non-ASCII
+ * UTF-8 character) or is one of the given special characters.  This is used by
+ * the serializers to copy the runs of characters that need no escaping in one
+ * go; on processors that have SSE2, the range is scanned 16 bytes at a time.
+ *
+ * @param begin A pointer to the first character of the range.
+ * @param end A pointer to one past the last character of the range.
+ * @param specials The NULL-terminated special characters.  There must be at
+ * least 1 and at most 4 of them.
+ * @return Returns a pointer to the first such character or \a end if none.
+ */
+char const* find_escapable( char const *begin, char const *end,
+                            char const *specials );
+
 ////////// begins/ends_with ///////////////////////////////////////////////////
 
 /**
@@ -335,8 +335,8 @@ string curdir() {
 
 zstring get_temp_file() {
 #ifndef WIN32
-  static char const mkdtemp_template[] = "zorba_tmp.XXXXXXXX";
-  static size_t const mkdtemp_template_len = ::strlen( mkdtemp_template );
+  static char const mkstemp_template[] = "zorba_tmp.XXXXXXXX";
+  static size_t const mkstemp_template_len = ::strlen( mkstemp_template );
 
   char const *tmp_dir = ::getenv( "TMPDIR" );
   if ( !tmp_dir )
@@ -345,16 +345,19 @@ zstring get_temp_file() {
     new char[
       ::strlen( tmp_dir )
       + 1 // dir_separator
-      + mkdtemp_template_len
+      + mkstemp_template_len
       + 1 // null
     ]
   );
   ::strcpy( buf.get(), tmp_dir );
-  append( buf.get(), mkdtemp_template );
-  char const *const path = ::mkdtemp( buf.get() );
-  if ( !path )
-    throw fs::exception( "mkdtemp()", path );
-  return path;
+  append( buf.get(), mkstemp_template );
+  // Like GetTempFileName() below, create the (empty) file so that its name
+  // can't be taken by someone else.
+  int const fd = ::mkstemp( buf.get() );
+  if ( fd == -1 )
+    throw fs::exception( "mkstemp()", buf.get() );
+  ::close( fd );
+  return buf.get();
 #else
   WCHAR wtemp[ MAX_PATH ];
   // GetTempFileName() needs a 14-character cushion.
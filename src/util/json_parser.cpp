@@ -194,8 +194,10 @@ ostream& operator<<( ostream &o, token const &t ) {
 ///////////////////////////////////////////////////////////////////////////////
 
 inline bool lexer::peek_char( char *c ) {
-  *c = in_->peek();
-  return in_->good();
+  if ( buf_cur_ == buf_end_ && !fill_buf() )
+    return false;
+  *c = *buf_cur_;
+  return true;
 }
 
 inline void lexer::set_cur_loc() {
@@ -214,24 +216,56 @@ inline void lexer::set_loc_range( location *loc ) {
   );
 }
 
-lexer::lexer( istream &in ) : in_( &in ) {
+lexer::lexer( istream &in ) : in_( &in ), buf_cur_( buf_ ), buf_end_( buf_ ) {
   line_ = prev_line_ = 1;
   col_ = prev_col_ = 1;
 }
 
-bool lexer::get_char( char *c ) {
-  char const temp = in_->get();
-  if ( in_->good() ) {
-    prev_line_ = line_;
-    prev_col_ = col_;
-    if ( temp == '\n' )
-      ++line_, col_ = 1;
-    else
-      ++col_;
-    *c = temp;
+bool lexer::fill_buf() {
+  streambuf *const sb = in_->rdbuf();
+  if ( !sb || !in_->good() )
+    return false;
+  try {
+    //
+    // Read only what the streambuf already has buffered (or a single character
+    // if nothing is) so that we never block waiting for more input than the
+    // next token needs.
+    //
+    streamsize const avail = sb->in_avail();
+    streamsize n = 0;
+    if ( avail >= 0 )
+      n = sb->sgetn(
+        buf_, avail > 0 ? min( avail, static_cast<streamsize>( BUF_SIZE ) ) : 1
+      );
+    if ( n <= 0 ) {
+      in_->setstate( ios::eofbit | ios::failbit );
+      return false;
+    }
+    buf_cur_ = buf_;
+    buf_end_ = buf_ + n;
     return true;
   }
-  return false;
+  catch ( ... ) {
+    // Behave like istream::get() does when its streambuf throws.
+    in_->setstate( ios::badbit );
+    if ( in_->exceptions() & ios::badbit )
+      throw;
+    return false;
+  }
+}
+
+bool lexer::get_char( char *c ) {
+  if ( buf_cur_ == buf_end_ && !fill_buf() )
+    return false;
+  char const temp = *buf_cur_++;
+  prev_line_ = line_;
+  prev_col_ = col_;
+  if ( temp == '\n' )
+    ++line_, col_ = 1;
+  else
+    ++col_;
+  *c = temp;
+  return true;
 }
 
 bool lexer::next( token *t, bool throw_exceptions ) {
@@ -521,6 +555,25 @@ bool lexer::parse_string( bool throw_exceptions ) {
   value_.clear();
 
   while ( true ) {
+    if ( !got_backslash ) {
+      //
+      // Copy the run of characters up to the next quote, backslash, or newline
+      // (which must go through get_char() to be counted) in one go.
+      //
+      char const *const run_end =
+        ascii::find_any( buf_cur_, buf_end_, "\"\\\n" );
+      if ( run_end != buf_cur_ ) {
+        column_type const n = static_cast<column_type>( run_end - buf_cur_ );
+        value.flush();
+        value_.append( buf_cur_, n );
+        buf_cur_ = run_end;
+        prev_line_ = line_;
+        prev_col_ = col_ + n - 1;
+        col_ += n;
+        continue;
+      }
+    }
+
     //
     // We need to call set_cur_loc() here since strings can have invalid
     // code-points or escapes and we need to report the exact error location of
@@ -466,13 +466,18 @@ public:
 ///////////////////////////////////////////////////////////////////////////////
 
 /**
- * A %lexer extracts JSON tokens from an istream.
+ * A %lexer extracts JSON tokens from an istream.  It reads the istream's
+ * characters in chunks into a buffer of its own (rather than one by one) and
+ * copies the characters of strings to their tokens a whole run at a time.
+ * Hence a %lexer may read past the last token it returns.
  */
 class lexer {
 public:
   typedef location::line_type line_type;
   typedef location::column_type column_type;
 
+  enum { BUF_SIZE = 16384 };
+
   /**
    * Constructs a %lexer on the given istream.
    *
@@ -501,6 +506,7 @@ public:
   void set_loc( char const *file, line_type line, column_type col );
 
 private:
+  bool fill_buf();
   bool get_char( char* );
   bool peek_char( char* );
   bool parse_codepoint( unicode::code_point *cp, bool throw_exceptions );
@@ -512,6 +518,8 @@ private:
   void set_loc_range( location* );
 
   std::istream *in_;
+  char buf_[ BUF_SIZE ];
+  char const *buf_cur_, *buf_end_;
   std::string file_;
   line_type line_, prev_line_;
   column_type col_, prev_col_;
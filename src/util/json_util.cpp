@@ -15,11 +15,14 @@
  */
 
 #include "stdafx.h"
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
 //#define ZORBA_JSON_EMIT_SURROGATES
 
+#include "util/ascii_util.h"
 #include "util/stl_util.h"
 #ifdef ZORBA_JSON_EMIT_SURROGATES
 #include "util/unicode_util.h"
@@ -40,8 +43,26 @@ ostream& serialize( ostream &os, char const *s ) {
   const unsigned int length = 8192;
   char buffer[length];
   unsigned int i = 0;
+  char const *const end = s + std::strlen( s );
 
   while ( true ) {
+    // copy the run of printable ASCII characters that need no escaping
+    char const *const run_end = ascii::find_escapable( s, end, "\"\\" );
+    for ( ; s < run_end; ) {
+      unsigned const n = static_cast<unsigned>(
+        std::min<ptrdiff_t>( run_end - s, length - i )
+      );
+      std::memcpy( buffer + i, s, n );
+      i += n;
+      s += n;
+      if ( i == length ) {
+        os.rdbuf()->sputn(buffer, i);
+        i = 0;
+      }
+    }
+    if ( s == end )
+      break;
+
     unicode::code_point const cp = utf8::next_char( s );
     if ( !cp )
       break;
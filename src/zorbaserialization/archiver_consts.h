@@ -286,12 +286,16 @@ enum TypeCode
   TYPE_ProbeIndexPointGeneralIterator,
   TYPE_ProbeIndexRangeValueIterator,
   TYPE_ProbeIndexRangeGeneralIterator,
+  TYPE_ProbeIndexFullTextIterator,
+  TYPE_FullTextIndexTokensIterator,
   TYPE_ValueIndexEntryBuilderIterator,
   TYPE_GeneralIndexEntryBuilderIterator,
   TYPE_RefreshIndexIterator,
   TYPE_DeleteIndexIterator,
   TYPE_CreateIndexIterator,
   TYPE_CreateInternalIndexIterator,
+  TYPE_CreateHashJoinIterator,
+  TYPE_ProbeHashJoinIterator,
 
   TYPE_PrecedingAxisIterator,
   TYPE_PrecedingReverseAxisIterator,
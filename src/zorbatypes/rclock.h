@@ -173,8 +173,59 @@ public:
 
 #endif // ZORBA_HAVE_PTHREAD or WIN32
 
+
 #endif // ZORBA_FOR_ONE_THREAD_ONLY
 
+
+/*******************************************************************************
+  Lock-free updates of a reference counter that is a plain long (for example,
+  Item::theRefCount or the counter of an xml tree in the simple store). Both
+  functions return the new value of the counter.
+
+  rc_increment() does not order any other memory access: a thread can only
+  create a new reference from a reference that it already has, so there is
+  nothing to synchronize with. rc_add() is used to drop references; it has
+  acquire-release semantics, so the thread that drops the last reference sees
+  all the writes made by the other threads before it destroys the object.
+********************************************************************************/
+#if defined ZORBA_FOR_ONE_THREAD_ONLY
+
+inline long rc_increment(long* counter)
+{
+  return ++(*counter);
+}
+
+inline long rc_add(long* counter, long delta)
+{
+  return (*counter += delta);
+}
+
+#elif defined WIN32 && !defined CYGWIN
+
+inline long rc_increment(long* counter)
+{
+  return InterlockedIncrement(counter);
+}
+
+inline long rc_add(long* counter, long delta)
+{
+  return InterlockedExchangeAdd(counter, delta) + delta;
+}
+
+#else
+
+inline long rc_increment(long* counter)
+{
+  return __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+
+inline long rc_add(long* counter, long delta)
+{
+  return __atomic_add_fetch(counter, delta, __ATOMIC_ACQ_REL);
+}
+
+#endif
+
 } // namespace zorba
 
 #endif // ZORBA_RCLOCK
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stdafx.h"
+
+#include "zorbautils/bloom_filter.h"
+
+namespace zorba
+{
+
+const csize BloomFilter::MIN_KEYS = 4096;
+const csize BloomFilter::BITS_PER_KEY = 16;
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void BloomFilter::init(csize numKeys)
+{
+  theBlocks.clear();
+
+  if (numKeys < MIN_KEYS)
+    return;
+
+  csize blockBits = BLOCK_WORDS * 32;
+  csize numBlocks = (numKeys * BITS_PER_KEY + blockBits - 1) / blockBits;
+
+  // The blocks are value-initialized, i.e., all their bits are cleared.
+  theBlocks.resize(numBlocks);
+}
+
+
+/*******************************************************************************
+
+********************************************************************************/
+void BloomFilter::clear()
+{
+  std::vector<Block>().swap(theBlocks);
+}
+
+
+}
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_UTILS_BLOOM_FILTER_H
+#define ZORBA_UTILS_BLOOM_FILTER_H
+
+#include <vector>
+
+#include "zorbamisc/config/platform.h"
+
+#include "store/api/shared_types.h"
+
+
+namespace zorba
+{
+
+/*******************************************************************************
+  A blocked Bloom filter over 32-bit hash values, used in front of a hash table
+  to reject, without touching the table, most of the probes that miss it.
+
+  The filter is an array of blocks of BLOCK_WORDS 32-bit words (32 bytes, half
+  a cache line). A hash value selects one block and sets one bit in each word
+  of it, so a test reads a single block, and the per-word bit tests have no
+  dependencies on each other and no branches, which lets the compiler evaluate
+  them with vector instructions.
+
+  The filter is sized for a given number of keys with BITS_PER_KEY bits per
+  key, which gives about 0.2% false positives at that number of keys. Tables
+  with fewer than MIN_KEYS keys fit in the caches, where a Bloom filter saves
+  nothing, so init() leaves the filter disabled for them. A disabled filter
+  may contain every hash value.
+
+  A filter never has false negatives, so it remains correct when keys are
+  removed from the table it is built for; it just becomes less selective.
+********************************************************************************/
+class BloomFilter
+{
+public:
+  static const csize MIN_KEYS;
+  static const csize BITS_PER_KEY;
+
+protected:
+  enum { BLOCK_WORDS = 8 };
+
+  struct Block
+  {
+    uint32_t  theWords[BLOCK_WORDS];
+  };
+
+protected:
+  std::vector<Block>  theBlocks;
+
+public:
+  BloomFilter() { }
+
+  /**
+   * Clears the filter and sizes it for the given number of keys, or disables
+   * it if the number is less than MIN_KEYS.
+   */
+  void init(csize numKeys);
+
+  void clear();
+
+  bool isEnabled() const { return !theBlocks.empty(); }
+
+  void insert(uint32_t hash)
+  {
+    uint32_t key;
+    Block& block = theBlocks[getBlock(hash, key)];
+
+    for (csize i = 0; i < BLOCK_WORDS; ++i)
+      block.theWords[i] |= getMask(key, i);
+  }
+
+  /**
+   * Returns false if no hash value equal to the given one has been inserted
+   * in the filter since its last init(), true if one may have been.
+   */
+  bool mayContain(uint32_t hash) const
+  {
+    if (theBlocks.empty())
+      return true;
+
+    uint32_t key;
+    const Block& block = theBlocks[getBlock(hash, key)];
+
+    uint32_t missing = 0;
+
+    for (csize i = 0; i < BLOCK_WORDS; ++i)
+      missing |= getMask(key, i) & ~block.theWords[i];
+
+    return missing == 0;
+  }
+
+protected:
+  /**
+   * Mixes the hash value, since the hash functions of the tables may leave
+   * many of its bits constant (e.g. the alignment bits of pointers). The high
+   * half of the result selects the block and the low half is returned in
+   * "key", to select the bits within the block.
+   */
+  csize getBlock(uint32_t hash, uint32_t& key) const
+  {
+    uint64_t h = hash + 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= (h >> 31);
+
+    key = static_cast<uint32_t>(h);
+
+    return static_cast<csize>(((h >> 32) * theBlocks.size()) >> 32);
+  }
+
+  static uint32_t getMask(uint32_t key, csize word)
+  {
+    static const uint32_t salts[BLOCK_WORDS] =
+    {
+      0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+      0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+
+    return 1U << ((key * salts[word]) >> 27);
+  }
+};
+
+
+}
+
+#endif
+/* vim:set et sw=2 ts=2: */
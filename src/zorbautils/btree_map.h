@@ -0,0 +1,740 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZORBA_UTILS_BTREE_MAP_H
+#define ZORBA_UTILS_BTREE_MAP_H
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "store/api/shared_types.h"
+
+
+namespace zorba
+{
+
+/*******************************************************************************
+  An in-memory B+-tree that maps keys of type K to values of type V, ordered by
+  the "less than" function C. It provides the subset of the std::map interface
+  that the sorted indexes of the store use, but keeps the entries in wide nodes
+  instead of one heap node per entry:
+
+  - A leaf node holds up to LEAF_CAPACITY entries in a sorted array, and is
+    linked to the next leaf, so a range scan walks contiguous arrays rather than
+    the parent pointers of a red-black tree.
+  - An inner node holds up to INNER_CAPACITY separator keys in a sorted array,
+    and one more child pointer. All the keys in child i are >= keys[i-1] and
+    < keys[i].
+
+  Both K and V are meant to be small, cheaply copyable types (typically
+  pointers); the map does not own the objects they may point to.
+
+  Leaves that become empty are removed from the tree, but nodes are otherwise
+  not merged or rebalanced on erase. Every leaf, except an empty root, has at
+  least one entry, so iterators never have to skip empty leaves.
+
+  Unlike std::map, any modification of the map invalidates all its iterators.
+
+  The comparison function is held by reference; it must outlive the map.
+********************************************************************************/
+template <class K, class V, class C>
+class BTreeMap
+{
+public:
+  typedef K                  key_type;
+  typedef V                  mapped_type;
+  typedef std::pair<K, V>    value_type;
+
+protected:
+  enum
+  {
+    NODE_BYTES     = 1024,
+    LEAF_CAPACITY  = (NODE_BYTES / sizeof(value_type) < 4 ?
+                      4 : NODE_BYTES / sizeof(value_type)),
+    INNER_CAPACITY = (NODE_BYTES / (sizeof(K) + sizeof(void*)) < 4 ?
+                      4 : NODE_BYTES / (sizeof(K) + sizeof(void*))),
+    MAX_HEIGHT     = 32
+  };
+
+  struct Node
+  {
+    bool       theIsLeaf;
+    csize      theCount;
+
+    Node(bool isLeaf) : theIsLeaf(isLeaf), theCount(0) {}
+  };
+
+  struct Leaf : public Node
+  {
+    Leaf       * thePrev;
+    Leaf       * theNext;
+    value_type   theEntries[LEAF_CAPACITY];
+
+    Leaf() : Node(true), thePrev(NULL), theNext(NULL) {}
+  };
+
+  // theCount is the number of keys; there are theCount + 1 children.
+  struct Inner : public Node
+  {
+    K          theKeys[INNER_CAPACITY];
+    Node     * theChildren[INNER_CAPACITY + 1];
+
+    Inner() : Node(false) {}
+  };
+
+  // The inner nodes visited on the way from the root to a leaf, and the child
+  // taken in each of them.
+  struct Path
+  {
+    Inner  * theNodes[MAX_HEIGHT];
+    csize    thePositions[MAX_HEIGHT];
+    csize    theDepth;
+
+    Path() : theDepth(0) {}
+  };
+
+public:
+  class const_iterator;
+
+  class iterator
+  {
+    friend class BTreeMap;
+    friend class const_iterator;
+
+  protected:
+    Leaf  * theLeaf;
+    csize   thePos;
+
+    iterator(Leaf* leaf, csize pos) : theLeaf(leaf), thePos(pos) {}
+
+  public:
+    iterator() : theLeaf(NULL), thePos(0) {}
+
+    value_type& operator*() const { return theLeaf->theEntries[thePos]; }
+
+    value_type* operator->() const { return &theLeaf->theEntries[thePos]; }
+
+    iterator& operator++()
+    {
+      if (++thePos == theLeaf->theCount)
+      {
+        theLeaf = theLeaf->theNext;
+        thePos = 0;
+      }
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const
+    {
+      return theLeaf == other.theLeaf && thePos == other.thePos;
+    }
+
+    bool operator!=(const iterator& other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  class const_iterator
+  {
+    friend class BTreeMap;
+
+  protected:
+    const Leaf  * theLeaf;
+    csize         thePos;
+
+    const_iterator(const Leaf* leaf, csize pos) : theLeaf(leaf), thePos(pos) {}
+
+  public:
+    const_iterator() : theLeaf(NULL), thePos(0) {}
+
+    const_iterator(const iterator& ite) : theLeaf(ite.theLeaf), thePos(ite.thePos) {}
+
+    const value_type& operator*() const { return theLeaf->theEntries[thePos]; }
+
+    const value_type* operator->() const { return &theLeaf->theEntries[thePos]; }
+
+    const_iterator& operator++()
+    {
+      if (++thePos == theLeaf->theCount)
+      {
+        theLeaf = theLeaf->theNext;
+        thePos = 0;
+      }
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const
+    {
+      return theLeaf == other.theLeaf && thePos == other.thePos;
+    }
+
+    bool operator!=(const const_iterator& other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+protected:
+  const C  & theCompare;
+  Node     * theRoot;
+  Leaf     * theFirstLeaf;
+  csize      theHeight;
+  csize      theSize;
+
+public:
+  BTreeMap(const C& compare)
+    :
+    theCompare(compare),
+    theRoot(NULL),
+    theFirstLeaf(NULL),
+    theHeight(0),
+    theSize(0)
+  {
+    theFirstLeaf = new Leaf();
+    theRoot = theFirstLeaf;
+  }
+
+  ~BTreeMap()
+  {
+    destroy(theRoot);
+  }
+
+  csize size() const { return theSize; }
+
+  bool empty() const { return theSize == 0; }
+
+  iterator begin()
+  {
+    return (theSize == 0 ? end() : iterator(theFirstLeaf, 0));
+  }
+
+  const_iterator begin() const
+  {
+    return (theSize == 0 ? end() : const_iterator(theFirstLeaf, 0));
+  }
+
+  iterator end() { return iterator(); }
+
+  const_iterator end() const { return const_iterator(); }
+
+  /**
+   * Returns an iterator to the first entry whose key is not less than key.
+   */
+  iterator lower_bound(const K& key)
+  {
+    Leaf* leaf = findLeaf(key, NULL, true);
+    return makeIterator(leaf, leafLowerBound(leaf, key));
+  }
+
+  const_iterator lower_bound(const K& key) const
+  {
+    return const_cast<BTreeMap*>(this)->lower_bound(key);
+  }
+
+  /**
+   * Returns an iterator to the first entry whose key is greater than key.
+   */
+  iterator upper_bound(const K& key)
+  {
+    Leaf* leaf = findLeaf(key, NULL);
+    return makeIterator(leaf, leafUpperBound(leaf, key));
+  }
+
+  const_iterator upper_bound(const K& key) const
+  {
+    return const_cast<BTreeMap*>(this)->upper_bound(key);
+  }
+
+  iterator find(const K& key)
+  {
+    Leaf* leaf = findLeaf(key, NULL);
+    csize pos = leafLowerBound(leaf, key);
+
+    if (pos < leaf->theCount && !theCompare(key, leaf->theEntries[pos].first))
+      return iterator(leaf, pos);
+
+    return end();
+  }
+
+  const_iterator find(const K& key) const
+  {
+    return const_cast<BTreeMap*>(this)->find(key);
+  }
+
+  /**
+   * Inserts the given entry, unless there is already an entry with the same
+   * key. Returns an iterator to the entry with that key, and whether the
+   * insertion took place.
+   */
+  std::pair<iterator, bool> insert(const value_type& entry)
+  {
+    Path path;
+    Leaf* leaf = findLeaf(entry.first, &path);
+    csize pos = leafLowerBound(leaf, entry.first);
+
+    if (pos < leaf->theCount && !theCompare(entry.first, leaf->theEntries[pos].first))
+      return std::pair<iterator, bool>(iterator(leaf, pos), false);
+
+    if (leaf->theCount == LEAF_CAPACITY)
+    {
+      Leaf* right = splitLeaf(leaf, path);
+
+      if (pos > leaf->theCount)
+      {
+        pos -= leaf->theCount;
+        leaf = right;
+      }
+    }
+
+    for (csize i = leaf->theCount; i > pos; --i)
+      leaf->theEntries[i] = leaf->theEntries[i - 1];
+
+    leaf->theEntries[pos] = entry;
+    ++leaf->theCount;
+    ++theSize;
+
+    return std::pair<iterator, bool>(iterator(leaf, pos), true);
+  }
+
+  /**
+   * Removes the entry that the given iterator points to.
+   */
+  void erase(iterator ite)
+  {
+    assert(ite.theLeaf != NULL);
+
+    Leaf* leaf = ite.theLeaf;
+    csize pos = ite.thePos;
+
+    Path path;
+#ifndef NDEBUG
+    Leaf* found =
+#endif
+    findLeaf(leaf->theEntries[pos].first, &path);
+    assert(found == leaf);
+
+    --leaf->theCount;
+    --theSize;
+
+    for (csize i = pos; i < leaf->theCount; ++i)
+      leaf->theEntries[i] = leaf->theEntries[i + 1];
+
+    if (leaf->theCount == 0 && leaf != theRoot)
+      removeLeaf(leaf, path);
+  }
+
+  void clear()
+  {
+    destroy(theRoot);
+
+    theFirstLeaf = new Leaf();
+    theRoot = theFirstLeaf;
+    theHeight = 0;
+    theSize = 0;
+  }
+
+  /**
+   * Replaces the contents of the map with the given entries, which must be
+   * sorted by strictly increasing key. The tree is built bottom-up out of
+   * full leaves, which is much cheaper than inserting the entries one by one.
+   */
+  void assign_sorted(const value_type* entries, csize count)
+  {
+    clear();
+
+    if (count == 0)
+      return;
+
+    // The nodes of the level being built, and the smallest key under each.
+    std::vector<Node*> level;
+    std::vector<K> firstKeys;
+
+    Leaf* prev = NULL;
+
+    for (csize i = 0; i < count; i += LEAF_CAPACITY)
+    {
+      Leaf* leaf = (prev == NULL ? theFirstLeaf : new Leaf());
+      csize num = (count - i < LEAF_CAPACITY ? count - i : LEAF_CAPACITY);
+
+      for (csize j = 0; j < num; ++j)
+        leaf->theEntries[j] = entries[i + j];
+
+      leaf->theCount = num;
+
+      if (prev != NULL)
+      {
+        prev->theNext = leaf;
+        leaf->thePrev = prev;
+      }
+
+      prev = leaf;
+      level.push_back(leaf);
+      firstKeys.push_back(entries[i].first);
+    }
+
+    while (level.size() > 1)
+    {
+      csize numChildren = level.size();
+      csize numNodes = (numChildren + INNER_CAPACITY) / (INNER_CAPACITY + 1);
+
+      std::vector<Node*> parents;
+      std::vector<K> parentKeys;
+      csize child = 0;
+
+      for (csize i = 0; i < numNodes; ++i)
+      {
+        // Deal the children out evenly, so that every node gets at least two.
+        csize num = numChildren / numNodes + (i < numChildren % numNodes ? 1 : 0);
+
+        Inner* inner = new Inner();
+        inner->theChildren[0] = level[child];
+
+        for (csize j = 1; j < num; ++j)
+        {
+          inner->theKeys[j - 1] = firstKeys[child + j];
+          inner->theChildren[j] = level[child + j];
+        }
+
+        inner->theCount = num - 1;
+
+        parents.push_back(inner);
+        parentKeys.push_back(firstKeys[child]);
+        child += num;
+      }
+
+      level.swap(parents);
+      firstKeys.swap(parentKeys);
+      ++theHeight;
+      assert(theHeight < MAX_HEIGHT);
+    }
+
+    theRoot = level[0];
+    theSize = count;
+  }
+
+protected:
+  iterator makeIterator(Leaf* leaf, csize pos)
+  {
+    if (pos < leaf->theCount)
+      return iterator(leaf, pos);
+
+    return iterator(leaf->theNext, 0);
+  }
+
+  /**
+   * Returns the leaf that contains the given key, if the key is in the map, or
+   * the leaf where the key would be inserted otherwise. If path is not NULL,
+   * the inner nodes on the way to the leaf are recorded in it.
+   *
+   * A probe key may be equivalent to several entries (e.g. a key prefix). The
+   * leaf returned is then the one of the last such entry, or the one of the
+   * first such entry if first is true.
+   */
+  Leaf* findLeaf(const K& key, Path* path, bool first = false) const
+  {
+    Node* node = theRoot;
+
+    while (!node->theIsLeaf)
+    {
+      Inner* inner = static_cast<Inner*>(node);
+
+      // The child to descend to is the number of keys that are <= key (or
+      // < key, if first is true).
+      csize low = 0;
+      csize high = inner->theCount;
+
+      while (low < high)
+      {
+        csize mid = (low + high) / 2;
+
+        if (first ?
+            !theCompare(inner->theKeys[mid], key) :
+            theCompare(key, inner->theKeys[mid]))
+          high = mid;
+        else
+          low = mid + 1;
+      }
+
+      if (path != NULL)
+      {
+        path->theNodes[path->theDepth] = inner;
+        path->thePositions[path->theDepth] = low;
+        ++path->theDepth;
+      }
+
+      node = inner->theChildren[low];
+    }
+
+    return static_cast<Leaf*>(node);
+  }
+
+  /**
+   * Returns the position of the first entry of the leaf whose key is not less
+   * than the given key.
+   */
+  csize leafLowerBound(const Leaf* leaf, const K& key) const
+  {
+    csize low = 0;
+    csize high = leaf->theCount;
+
+    while (low < high)
+    {
+      csize mid = (low + high) / 2;
+
+      if (theCompare(leaf->theEntries[mid].first, key))
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+    return low;
+  }
+
+  /**
+   * Returns the position of the first entry of the leaf whose key is greater
+   * than the given key.
+   */
+  csize leafUpperBound(const Leaf* leaf, const K& key) const
+  {
+    csize low = 0;
+    csize high = leaf->theCount;
+
+    while (low < high)
+    {
+      csize mid = (low + high) / 2;
+
+      if (theCompare(key, leaf->theEntries[mid].first))
+        high = mid;
+      else
+        low = mid + 1;
+    }
+
+    return low;
+  }
+
+  /**
+   * Moves the upper half of the given full leaf to a new leaf, which is linked
+   * after it and added to its parent. Returns the new leaf.
+   */
+  Leaf* splitLeaf(Leaf* leaf, Path& path)
+  {
+    Leaf* right = new Leaf();
+
+    csize half = leaf->theCount / 2;
+
+    for (csize i = half; i < leaf->theCount; ++i)
+      right->theEntries[i - half] = leaf->theEntries[i];
+
+    right->theCount = leaf->theCount - half;
+    leaf->theCount = half;
+
+    right->thePrev = leaf;
+    right->theNext = leaf->theNext;
+    if (leaf->theNext != NULL)
+      leaf->theNext->thePrev = right;
+    leaf->theNext = right;
+
+    insertInParent(leaf, right->theEntries[0].first, right, path);
+
+    return right;
+  }
+
+  /**
+   * Adds the given key and right child to the parent of the given left child,
+   * right after that child, splitting the parent (and its ancestors) if it is
+   * full.
+   */
+  void insertInParent(Node* left, const K& key, Node* right, Path& path)
+  {
+    if (path.theDepth == 0)
+    {
+      assert(left == theRoot);
+
+      Inner* root = new Inner();
+      root->theKeys[0] = key;
+      root->theChildren[0] = left;
+      root->theChildren[1] = right;
+      root->theCount = 1;
+
+      theRoot = root;
+      ++theHeight;
+      assert(theHeight < MAX_HEIGHT);
+      return;
+    }
+
+    --path.theDepth;
+    Inner* parent = path.theNodes[path.theDepth];
+    csize pos = path.thePositions[path.theDepth];
+
+    assert(parent->theChildren[pos] == left);
+
+    if (parent->theCount < INNER_CAPACITY)
+    {
+      insertInInner(parent, pos, key, right);
+      return;
+    }
+
+    // Split the parent: the left half stays in it, the middle key moves up,
+    // and the right half moves to a new node.
+    K keys[INNER_CAPACITY + 1];
+    Node* children[INNER_CAPACITY + 2];
+
+    for (csize i = 0; i < pos; ++i)
+      keys[i] = parent->theKeys[i];
+    keys[pos] = key;
+    for (csize i = pos; i < INNER_CAPACITY; ++i)
+      keys[i + 1] = parent->theKeys[i];
+
+    for (csize i = 0; i <= pos; ++i)
+      children[i] = parent->theChildren[i];
+    children[pos + 1] = right;
+    for (csize i = pos + 1; i <= INNER_CAPACITY; ++i)
+      children[i + 1] = parent->theChildren[i];
+
+    csize half = (INNER_CAPACITY + 1) / 2;
+
+    parent->theCount = half;
+
+    for (csize i = 0; i < half; ++i)
+    {
+      parent->theKeys[i] = keys[i];
+      parent->theChildren[i] = children[i];
+    }
+    parent->theChildren[half] = children[half];
+
+    Inner* sibling = new Inner();
+    sibling->theCount = INNER_CAPACITY - half;
+
+    for (csize i = 0; i < sibling->theCount; ++i)
+    {
+      sibling->theKeys[i] = keys[half + 1 + i];
+      sibling->theChildren[i] = children[half + 1 + i];
+    }
+    sibling->theChildren[sibling->theCount] = children[INNER_CAPACITY + 1];
+
+    insertInParent(parent, keys[half], sibling, path);
+  }
+
+  static void insertInInner(Inner* node, csize pos, const K& key, Node* right)
+  {
+    for (csize i = node->theCount; i > pos; --i)
+    {
+      node->theKeys[i] = node->theKeys[i - 1];
+      node->theChildren[i + 1] = node->theChildren[i];
+    }
+
+    node->theKeys[pos] = key;
+    node->theChildren[pos + 1] = right;
+    ++node->theCount;
+  }
+
+  /**
+   * Unlinks and frees the given empty leaf, and removes it from its parent,
+   * freeing the ancestors that are left without children.
+   */
+  void removeLeaf(Leaf* leaf, Path& path)
+  {
+    if (leaf->thePrev != NULL)
+      leaf->thePrev->theNext = leaf->theNext;
+    else
+      theFirstLeaf = leaf->theNext;
+
+    if (leaf->theNext != NULL)
+      leaf->theNext->thePrev = leaf->thePrev;
+
+    Node* child = leaf;
+
+    while (path.theDepth > 0)
+    {
+      --path.theDepth;
+      Inner* parent = path.theNodes[path.theDepth];
+      csize pos = path.thePositions[path.theDepth];
+
+      freeNode(child);
+
+      if (parent->theCount > 0)
+      {
+        // Drop the child and one of the keys around it.
+        csize keyPos = (pos > 0 ? pos - 1 : 0);
+
+        for (csize i = keyPos; i + 1 < parent->theCount; ++i)
+          parent->theKeys[i] = parent->theKeys[i + 1];
+
+        for (csize i = pos; i < parent->theCount; ++i)
+          parent->theChildren[i] = parent->theChildren[i + 1];
+
+        --parent->theCount;
+
+        // A root with a single child is replaced by that child.
+        while (!theRoot->theIsLeaf && theRoot->theCount == 0)
+        {
+          Inner* root = static_cast<Inner*>(theRoot);
+          theRoot = root->theChildren[0];
+          delete root;
+          --theHeight;
+        }
+
+        return;
+      }
+
+      child = parent;
+    }
+
+    assert(false);
+  }
+
+  static void freeNode(Node* node)
+  {
+    if (node->theIsLeaf)
+      delete static_cast<Leaf*>(node);
+    else
+      delete static_cast<Inner*>(node);
+  }
+
+  void destroy(Node* node)
+  {
+    if (node->theIsLeaf)
+    {
+      delete static_cast<Leaf*>(node);
+      return;
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+
+    for (csize i = 0; i <= inner->theCount; ++i)
+      destroy(inner->theChildren[i]);
+
+    delete inner;
+  }
+
+private:
+  BTreeMap(const BTreeMap&);
+  void operator=(const BTreeMap&);
+};
+
+
+} // namespace zorba
+
+#endif /* ZORBA_UTILS_BTREE_MAP_H */
+
+/*
+ * Local variables:
+ * mode: c++
+ * End:
+ */
+/* vim:set et sw=2 ts=2: */
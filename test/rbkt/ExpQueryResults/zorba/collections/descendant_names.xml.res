@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<result equal="true"><all>343</all><section>new new.1 3.1 3.2 3.3 3.4 3.5 3.5.1 3.6 3.7 3.8 3.9 3.10 3.10.1 3.11 3.12 3.13 3.14 3.15 3.15.1</section><nested>8.10.1</nested><leaf>0</leaf><positional>1.2 2.2 3.1 5.2 6.3 7.2 8.2 9.2 10.2 11.2 12.2 13.2 14.2 15.2 16.2 17.2 18.2 19.2 20.2</positional><names>285</names><missing>0</missing></result>
\ No newline at end of file
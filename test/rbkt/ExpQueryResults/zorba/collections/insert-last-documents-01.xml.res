@@ -0,0 +1 @@
+1 false ddl:docs  true 2 true ddl:docs Zorba the greek false 3 true ddl:docs Zorba the greek false
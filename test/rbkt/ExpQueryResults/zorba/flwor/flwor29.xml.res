@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+714 7 4998 11790
\ No newline at end of file
@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+6 13 20 27 34 | 20 -20 30 -30 | 991 | 1 0 2 | 44 33 22
\ No newline at end of file
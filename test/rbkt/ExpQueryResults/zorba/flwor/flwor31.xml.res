@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+0:3:18:6:3:9 1:3:18:6:1:10 2:2:7:3.5:2:5 | ac4 | 0 0 15 1
\ No newline at end of file
@@ -0,0 +1 @@
+<result count="19998"><pair c="1" o="1"/><pair c="1" o="7002"/><pair c="1" o="14003"/><pair c="2" o="2"/><pair c="7000" o="14001"/></result>
@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<check tag="small insert" count="500">true true true true true</check><check tag="bulk insert" count="5500">true true true true true</check><check tag="bulk delete" count="3650">true true true true true</check><violation/><check tag="rolled back insert" count="3650">true true true true true</check>
@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<result><prices>true</prices><sum>true</sum><notes>true</notes><count>true</count><nodes>true</nodes></result>
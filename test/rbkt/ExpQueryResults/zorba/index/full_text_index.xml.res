@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<result><word>true</word><all>true</all><any>true</any><phrase>true</phrase><stem>true</stem><probe>true</probe></result>
@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<result><hits>10000</hits><hits>15000</hits><hits>2</hits></result>
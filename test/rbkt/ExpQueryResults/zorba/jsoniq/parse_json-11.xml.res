@@ -0,0 +1 @@
+147 abcdefghijklmnopqrstuvwxyz0123456789"abcdefghijklmnopqrstuvwxyz0123456789\abcdefghijklmnopqrstuvwxyz0123456789éabcdefghijklmnopqrstuvwxyz0123456789 10
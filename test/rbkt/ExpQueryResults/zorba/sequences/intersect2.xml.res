@@ -0,0 +1,2 @@
+<?xml version="1.0" encoding="UTF-8"?>
+5000 5000 2 9999
@@ -0,0 +1 @@
+<a b="abcdefghijklmnopqrstuvwxyz0123456789&quot;&lt;&amp;abcdefghijklmnopqrstuvwxyz0123456789&#x9;&#xA;abcdefghijklmnopqrstuvwxyz0123456789">abcdefghijklmnopqrstuvwxyz0123456789&lt;&amp;&gt;"abcdefghijklmnopqrstuvwxyz0123456789éabcdefghijklmnopqrstuvwxyz0123456789&#x7F;&#119070;abcdefghijklmnopqrstuvwxyz0123456789</a>
\ No newline at end of file
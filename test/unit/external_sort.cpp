@@ -0,0 +1,130 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <zorba/zorba.h>
+#include <zorba/properties.h>
+#include <zorba/store_manager.h>
+#include <zorba/xquery_exception.h>
+
+
+using namespace zorba;
+
+namespace zorba { namespace external_sort {
+
+static char const *const queries[] = {
+  // flwor with orderby (FLWORIterator)
+  "for $i in 1 to 20000 "
+  "let $k := ($i * 7919) mod 1000 "
+  "order by $k descending, $i "
+  "return concat($k, ':', $i)",
+
+  // stable orderby with many ties
+  "for $i in 1 to 5000 "
+  "stable order by $i mod 10 "
+  "return $i",
+
+  // let var with a sequence value and empty keys
+  "for $i in 1 to 5000 "
+  "let $s := ($i, string($i), xs:double($i) div 3) "
+  "order by (if ($i mod 13 eq 0) then () else $i mod 97) empty greatest, "
+  "         $i descending "
+  "return $s",
+
+  // nodes in the result: spilling must be switched off
+  "for $i in 1 to 3000 "
+  "order by -$i "
+  "return <a>{$i}</a>",
+
+  0
+};
+
+
+static std::string run_query(Zorba* zorba, char const *query)
+{
+  std::ostringstream os;
+  XQuery_t q = zorba->compileQuery(query);
+  os << q;
+  return os.str();
+}
+
+
+static bool run_queries(Zorba* zorba)
+{
+  Properties& props = Properties::instance();
+
+  for (char const *const *query = queries; *query; ++query)
+  {
+    props.setSortMemoryLimit(0);
+    std::string const expected(run_query(zorba, *query));
+
+    // small enough to spill many runs of a few tuples each
+    props.setSortMemoryLimit(2048);
+    std::string const actual(run_query(zorba, *query));
+
+    props.setSortMemoryLimit(0);
+
+    if (actual != expected)
+    {
+      std::cerr << "unexpected result for query: " << *query << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} /* namespace external_sort */ } /* namespace zorba */
+
+
+int
+external_sort(int argc, char* argv[])
+{
+  void* lStore = zorba::StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+  int lResult = 0;
+
+  try
+  {
+    if (!external_sort::run_queries(lZorba))
+      lResult = 1;
+
+    // the same queries with generalized flwors (OrderByIterator)
+    Properties::instance().setForceGFLWOR(true);
+
+    if (lResult == 0 && !external_sort::run_queries(lZorba))
+      lResult = 2;
+
+    Properties::instance().setForceGFLWOR(false);
+  }
+  catch (XQueryException& qe)
+  {
+    std::cerr << qe << std::endl;
+    lResult = 3;
+  }
+  catch (ZorbaException& e)
+  {
+    std::cerr << e << std::endl;
+    lResult = 4;
+  }
+
+  lZorba->shutdown();
+  zorba::StoreManager::shutdownStore(lStore);
+  return lResult;
+}
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <zorba/zorba.h>
+#include <zorba/properties.h>
+#include <zorba/store_manager.h>
+#include <zorba/xquery_exception.h>
+
+
+using namespace zorba;
+
+namespace zorba { namespace groupby_spill {
+
+// The order of the groups may change when the group-by spills, so every
+// query orders its groups.
+static char const *const queries[] = {
+  // aggregates only (computed incrementally in FLWORIterator)
+  "for $i in 1 to 20000 "
+  "let $k := ($i * 7919) mod 3000 "
+  "group by $k "
+  "order by $k "
+  "return concat($k, ':', count($i), ':', sum($i), ':', avg($i), ':', "
+  "              min($i), ':', max($i))",
+
+  // full values of the non-grouping vars
+  "for $i in 1 to 10000 "
+  "let $k := $i mod 1000 "
+  "let $s := ($i, string($i)) "
+  "group by $k "
+  "order by $k "
+  "return <g k=\"{$k}\">{$s}</g>",
+
+  // empty and multiple keys, mixed aggregates and values
+  "for $i in 1 to 10000 "
+  "let $k1 := if ($i mod 7 eq 0) then () else $i mod 13 "
+  "let $k2 := string($i mod 11) "
+  "group by $k1, $k2 "
+  "order by $k1 empty least, $k2 "
+  "return ($k1, $k2, count($i), $i[1])",
+
+  // nodes in the non-grouping values: partitions keep them in memory
+  "for $i in 1 to 3000 "
+  "let $a := <a>{$i}</a> "
+  "group by $k := $i mod 500 "
+  "order by $k "
+  "return <g>{$a}</g>",
+
+  // errors are raised only for the groups that use the failing aggregate
+  "for $i in (1 to 2000, 'x') "
+  "let $k := if ($i instance of xs:string) then 0 else $i mod 100 "
+  "group by $k "
+  "order by $k "
+  "return if ($k eq 0) then 'skip' else sum($i)",
+
+  0
+};
+
+
+static std::string run_query(Zorba* zorba, char const *query)
+{
+  std::ostringstream os;
+  XQuery_t q = zorba->compileQuery(query);
+  os << q;
+  return os.str();
+}
+
+
+static bool run_queries(Zorba* zorba)
+{
+  Properties& props = Properties::instance();
+
+  for (char const *const *query = queries; *query; ++query)
+  {
+    props.setGroupByMemoryLimit(0);
+    std::string const expected(run_query(zorba, *query));
+
+    // small enough to spill most of the groups
+    props.setGroupByMemoryLimit(4096);
+    std::string const actual(run_query(zorba, *query));
+
+    props.setGroupByMemoryLimit(0);
+
+    if (actual != expected)
+    {
+      std::cerr << "unexpected result for query: " << *query << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} /* namespace groupby_spill */ } /* namespace zorba */
+
+
+int
+groupby_spill(int argc, char* argv[])
+{
+  void* lStore = zorba::StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+  int lResult = 0;
+
+  try
+  {
+    if (!groupby_spill::run_queries(lZorba))
+      lResult = 1;
+
+    // the same queries with generalized flwors (GroupByIterator)
+    Properties::instance().setForceGFLWOR(true);
+
+    if (lResult == 0 && !groupby_spill::run_queries(lZorba))
+      lResult = 2;
+
+    Properties::instance().setForceGFLWOR(false);
+  }
+  catch (XQueryException& qe)
+  {
+    std::cerr << qe << std::endl;
+    lResult = 3;
+  }
+  catch (ZorbaException& e)
+  {
+    std::cerr << e << std::endl;
+    lResult = 4;
+  }
+
+  lZorba->shutdown();
+  zorba::StoreManager::shutdownStore(lStore);
+  return lResult;
+}
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// standard
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#ifdef WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+// Zorba
+#include <zorba/properties.h>
+#include <zorba/store_manager.h>
+#include <zorba/util/fs_util.h>
+#include <zorba/zorba.h>
+
+using namespace zorba;
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+
+static std::string snapshot_dir;
+static std::string module_path;
+
+
+static void write_module()
+{
+  std::ofstream os(module_path.c_str());
+  os << "module namespace m = 'http://zorba.io/unit/index-snapshot';\n"
+     << "import module namespace dml ="
+     << " 'http://zorba.io/modules/store/static/collections/dml';\n"
+     << "declare namespace an = 'http://zorba.io/annotations';\n"
+     << "declare collection m:c as node()*;\n"
+     << "declare %an:value-range index m:i\n"
+     << "  on nodes dml:collection(xs:QName('m:c'))\n"
+     << "  by xs:integer(@i) as xs:integer;\n";
+}
+
+
+/**
+ * Returns the path of the only entry in the snapshot directory, or an empty
+ * string if there is not exactly one entry.
+ */
+static std::string snapshot_entry()
+{
+  std::string path;
+  int numEntries = 0;
+
+  fs::iterator dir(snapshot_dir);
+  while (dir.next())
+  {
+    path = snapshot_dir;
+    fs::append(path, dir->name);
+    ++numEntries;
+  }
+
+  return numEntries == 1 ? path : std::string();
+}
+
+
+static std::string read_file(std::string const& path)
+{
+  std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(is)),
+                     std::istreambuf_iterator<char>());
+}
+
+
+static time_t mtime(std::string const& path)
+{
+  fs::info info;
+  fs::get_type(path, &info);
+  return info.mtime;
+}
+
+
+/**
+ * Fills the collection with the given number of nodes, builds the index on
+ * it, probes the index, and drops the index.
+ */
+static bool run_query(Zorba* aZorba, int numNodes, std::string const& expected)
+{
+  std::ostringstream query;
+  query << "import module namespace m = 'http://zorba.io/unit/index-snapshot'"
+        << " at 'file://" << module_path << "';\n"
+        << "import module namespace ddl ="
+        << " 'http://zorba.io/modules/store/static/collections/ddl';\n"
+        << "import module namespace dml ="
+        << " 'http://zorba.io/modules/store/static/collections/dml';\n"
+        << "import module namespace iddl ="
+        << " 'http://zorba.io/modules/store/static/indexes/ddl';\n"
+        << "import module namespace idml ="
+        << " 'http://zorba.io/modules/store/static/indexes/dml';\n"
+        << "if (ddl:is-available-collection(xs:QName('m:c')))\n"
+        << "then { dml:truncate(xs:QName('m:c')); }\n"
+        << "else { ddl:create(xs:QName('m:c')); }\n"
+        << "dml:insert(xs:QName('m:c'), for $n in 1 to " << numNodes
+        << " return <e i='{$n mod 100}'/>);\n"
+        << "iddl:create(xs:QName('m:i'));\n"
+        << "variable $r := count(idml:probe-index-range-value(xs:QName('m:i'),"
+        << " 10, 19, true(), true(), true(), true()));\n"
+        << "iddl:delete(xs:QName('m:i'));\n"
+        << "$r";
+
+  std::ostringstream result;
+  result << aZorba->compileQuery(query.str());
+
+  if (result.str().find(expected) == std::string::npos)
+  {
+    std::cerr << "unexpected result: " << result.str() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+static bool index_snapshot_test(Zorba* aZorba)
+{
+  write_module();
+
+  // Building the index records the snapshot.
+  if (!run_query(aZorba, 1000, "100"))
+    return false;
+
+  std::string const entry = snapshot_entry();
+  if (entry.empty())
+  {
+    std::cerr << "no snapshot created" << std::endl;
+    return false;
+  }
+
+  std::string const snapshot = read_file(entry);
+
+  // Backdate the snapshot so that rewriting it shows up in its mtime.
+  struct utimbuf times;
+  times.actime = times.modtime = 1;
+  utime(entry.c_str(), &times);
+
+  // Building it again over the same nodes replays the snapshot.
+  if (!run_query(aZorba, 1000, "100"))
+    return false;
+
+  if (snapshot_entry() != entry || mtime(entry) != 1)
+  {
+    std::cerr << "snapshot rewritten on a replay" << std::endl;
+    return false;
+  }
+
+  // Changing the collection invalidates the snapshot.
+  if (!run_query(aZorba, 500, "50"))
+    return false;
+
+  if (snapshot_entry() != entry || read_file(entry) == snapshot)
+  {
+    std::cerr << "snapshot not replaced" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+#endif /* ZORBA_WITH_FILE_ACCESS */
+
+
+int index_snapshot(int argc, char* argv[])
+{
+  int result = 0;
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+  void* lStore = zorba::StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+
+  snapshot_dir = fs::curdir();
+  fs::append(snapshot_dir, "index_snapshot.d");
+  module_path = fs::curdir();
+  fs::append(module_path, "index_snapshot_module.xq");
+
+  if (fs::get_type(snapshot_dir) == fs::directory)
+  {
+    fs::iterator dir(snapshot_dir);
+    while (dir.next())
+    {
+      std::string path(snapshot_dir);
+      fs::append(path, dir->name);
+      fs::remove(path);
+    }
+  }
+
+  Properties::instance().setIndexSnapshotDir(snapshot_dir);
+
+  try
+  {
+    if (!index_snapshot_test(lZorba))
+      result = 1;
+  }
+  catch (ZorbaException const& e)
+  {
+    std::cerr << e << std::endl;
+    result = 2;
+  }
+
+  Properties::instance().setIndexSnapshotDir("");
+
+  lZorba->shutdown();
+  zorba::StoreManager::shutdownStore(lStore);
+#endif /* ZORBA_WITH_FILE_ACCESS */
+
+  return result;
+}
+/* vim:set et sw=2 ts=2: */
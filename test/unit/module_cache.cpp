@@ -0,0 +1,139 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// standard
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Zorba
+#include <zorba/store_manager.h>
+#include <zorba/util/fs_util.h>
+#include <zorba/zorba.h>
+
+using namespace zorba;
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+
+static std::string module_path;
+
+
+/**
+ * Writes a module whose translation depends on more than the bare parse tree:
+ * boundary whitespace stripping, a FLWOR expr, and a UDF body.
+ */
+static void write_module(int value)
+{
+  std::ofstream os(module_path.c_str());
+  os << "module namespace m = 'http://zorba.io/unit/module-cache';\n"
+     << "declare function m:f() {\n"
+     << "  <r>  { for $i in 1 to " << value << " return $i }  </r>\n"
+     << "};\n";
+}
+
+
+static bool run_query(
+    Zorba* aZorba,
+    std::string const& body,
+    std::string const& expected)
+{
+  std::ostringstream query;
+  query << "import module namespace m = 'http://zorba.io/unit/module-cache'"
+        << " at 'file://" << module_path << "';\n"
+        << body;
+
+  std::ostringstream result;
+  result << aZorba->compileQuery(query.str());
+
+  if (result.str().find(expected) == std::string::npos)
+  {
+    std::cerr << "unexpected result: " << result.str()
+              << " (expected " << expected << ")" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+static bool module_cache_test(Zorba* aZorba)
+{
+  write_module(2);
+
+  // The first query parses the module; the others reuse its tree, and must
+  // translate it the same way.
+  for (int i = 0; i < 3; ++i)
+  {
+    if (!run_query(aZorba, "m:f()", "<r>1 2</r>"))
+      return false;
+  }
+
+  if (!run_query(aZorba, "count(m:f()/text())", "1"))
+    return false;
+
+  // While one query is open, another one importing the same module gets a
+  // private tree.
+  {
+    XQuery_t held = aZorba->compileQuery(
+      "import module namespace m = 'http://zorba.io/unit/module-cache'"
+      " at 'file://" + module_path + "';\n"
+      "m:f()");
+
+    if (!run_query(aZorba, "m:f()", "<r>1 2</r>"))
+      return false;
+  }
+
+  // Changing the module text replaces the cached tree.
+  write_module(3);
+
+  if (!run_query(aZorba, "m:f()", "<r>1 2 3</r>"))
+    return false;
+
+  return true;
+}
+
+#endif /* ZORBA_WITH_FILE_ACCESS */
+
+
+int module_cache(int argc, char* argv[])
+{
+  int result = 0;
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+  void* lStore = zorba::StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+
+  module_path = fs::curdir();
+  fs::append(module_path, "module_cache_module.xq");
+
+  try
+  {
+    if (!module_cache_test(lZorba))
+      result = 1;
+  }
+  catch (ZorbaException const& e)
+  {
+    std::cerr << e << std::endl;
+    result = 2;
+  }
+
+  lZorba->shutdown();
+  zorba::StoreManager::shutdownStore(lStore);
+#endif /* ZORBA_WITH_FILE_ACCESS */
+
+  return result;
+}
+/* vim:set et sw=2 ts=2: */
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zorba/config.h>
+#include <zorba/iterator.h>
+#include <zorba/zorba.h>
+#include <zorba/store_manager.h>
+#include <zorba/xquery_exception.h>
+
+#if defined ZORBA_HAVE_PTHREAD_H && !defined ZORBA_FOR_ONE_THREAD_ONLY
+#include <pthread.h>
+#define NODE_REFCOUNT_THREADS
+#endif
+
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+
+using namespace zorba;
+
+namespace zorba { namespace node_refcount {
+
+/*
+ * Micro-benchmark for the reference counting of nodes: several threads copy
+ * and drop handles to the nodes of one shared document, as the queries of a
+ * server do with a cached document. Every copy updates the counter of the
+ * node and the counter of its tree.
+ */
+
+static unsigned const NUM_THREADS = 4;
+static unsigned const NUM_ROUNDS = 200;
+
+struct worker_data
+{
+  std::vector<Item> const * theNodes;
+  unsigned long             theCopies;
+};
+
+
+static void* copy_handles(void* param)
+{
+  worker_data* data = static_cast<worker_data*>(param);
+  std::vector<Item> const& nodes = *data->theNodes;
+
+  std::vector<Item> copies;
+  copies.reserve(nodes.size());
+
+  for (unsigned round = 0; round < NUM_ROUNDS; ++round)
+  {
+    for (size_t i = 0; i < nodes.size(); ++i)
+      copies.push_back(nodes[i]);
+
+    data->theCopies += copies.size();
+    copies.clear();
+  }
+
+  return 0;
+}
+
+
+static double now()
+{
+#ifndef WIN32
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+#else
+  return 0;
+#endif
+}
+
+
+static bool run_workers(std::vector<Item> const& nodes)
+{
+  std::vector<worker_data> data(NUM_THREADS);
+
+  for (unsigned i = 0; i < NUM_THREADS; ++i)
+  {
+    data[i].theNodes = &nodes;
+    data[i].theCopies = 0;
+  }
+
+  double const start = now();
+
+#ifdef NODE_REFCOUNT_THREADS
+  pthread_t threads[NUM_THREADS];
+
+  for (unsigned i = 0; i < NUM_THREADS; ++i)
+    pthread_create(&threads[i], NULL, copy_handles, &data[i]);
+
+  for (unsigned i = 0; i < NUM_THREADS; ++i)
+    pthread_join(threads[i], NULL);
+#else
+  for (unsigned i = 0; i < NUM_THREADS; ++i)
+    copy_handles(&data[i]);
+#endif
+
+  double const elapsed = now() - start;
+
+  unsigned long copies = 0;
+  for (unsigned i = 0; i < NUM_THREADS; ++i)
+  {
+    if (data[i].theCopies != nodes.size() * NUM_ROUNDS)
+    {
+      std::cerr << "worker " << i << " made " << data[i].theCopies
+                << " copies" << std::endl;
+      return false;
+    }
+    copies += data[i].theCopies;
+  }
+
+  std::cout << NUM_THREADS << " workers, " << copies << " handle copies: "
+            << (copies ? elapsed * 1e9 / copies : 0) << " ns/copy" << std::endl;
+
+  return true;
+}
+
+
+static bool check_document(Zorba* zorba, Item const& doc)
+{
+  // The handles must not have been lost: the document must still be usable,
+  // and its nodes must still be there.
+  XQuery_t query = zorba->compileQuery("count(.//b), sum(.//b)");
+  query->getDynamicContext()->setContextItem(doc);
+
+  std::ostringstream os;
+  os << query;
+
+  std::string const result(os.str());
+  std::string const expected("1000 500500");
+
+  if (result.find(expected) == std::string::npos)
+  {
+    std::cerr << "unexpected result: " << result << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+static bool run_test(Zorba* zorba)
+{
+  try
+  {
+    XQuery_t build = zorba->compileQuery(
+      "document { <r>{ for $i in 1 to 1000 "
+      "return <a n=\"{ $i }\"><b>{ $i }</b></a> }</r> }");
+
+    Item doc;
+    Iterator_t docIt = build->iterator();
+    docIt->open();
+    docIt->next(doc);
+    docIt->close();
+
+    // Handles to the element, attribute, and text nodes of the document.
+    XQuery_t query = zorba->compileQuery(".//node(), .//@*");
+    query->getDynamicContext()->setContextItem(doc);
+
+    std::vector<Item> nodes;
+    Iterator_t it = query->iterator();
+    it->open();
+    Item node;
+    while (it->next(node))
+      nodes.push_back(node);
+    it->close();
+
+    if (nodes.size() != 4001)
+    {
+      std::cerr << "unexpected number of nodes: " << nodes.size() << std::endl;
+      return false;
+    }
+
+    if (!run_workers(nodes))
+      return false;
+
+    nodes.clear();
+    return check_document(zorba, doc);
+  }
+  catch (XQueryException const& e)
+  {
+    std::cerr << e << std::endl;
+    return false;
+  }
+}
+
+} // namespace node_refcount
+} // namespace zorba
+
+
+int node_refcount(int argc, char* argv[])
+{
+  void* store = StoreManager::getStore();
+  Zorba* zorba = Zorba::getInstance(store);
+
+  bool const ok = zorba::node_refcount::run_test(zorba);
+
+  zorba->shutdown();
+  StoreManager::shutdownStore(store);
+
+  return ok ? 0 : 1;
+}
+/* vim:set et sw=2 ts=2: */
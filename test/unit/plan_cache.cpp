@@ -0,0 +1,184 @@
+/*
+ * Copyright 2006-2016 zorba.io
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// standard
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+// Zorba
+#include <zorba/properties.h>
+#include <zorba/store_manager.h>
+#include <zorba/util/fs_util.h>
+#include <zorba/zorba.h>
+
+using namespace zorba;
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+
+static std::string cache_dir;
+static std::string module_path;
+
+
+static void write_module(int value)
+{
+  std::ofstream os(module_path.c_str());
+  os << "module namespace m = 'http://zorba.io/unit/plan-cache';\n"
+     << "declare function m:f() { " << value << " };\n";
+}
+
+
+/**
+ * Returns the path of the only entry in the cache directory, or an empty
+ * string if there is not exactly one entry.
+ */
+static std::string cache_entry()
+{
+  std::string path;
+  int numEntries = 0;
+
+  fs::iterator dir(cache_dir);
+  while (dir.next())
+  {
+    path = cache_dir;
+    fs::append(path, dir->name);
+    ++numEntries;
+  }
+
+  return numEntries == 1 ? path : std::string();
+}
+
+
+static std::string read_file(std::string const& path)
+{
+  std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(is)),
+                     std::istreambuf_iterator<char>());
+}
+
+
+static bool run_query(Zorba* aZorba, std::string const& expected)
+{
+  std::ostringstream query;
+  query << "import module namespace m = 'http://zorba.io/unit/plan-cache'"
+        << " at 'file://" << module_path << "';\n"
+        << "m:f()";
+
+  std::ostringstream result;
+  result << aZorba->compileQuery(query.str());
+
+  if (result.str().find(expected) == std::string::npos)
+  {
+    std::cerr << "unexpected result: " << result.str() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+static bool plan_cache_test(Zorba* aZorba)
+{
+  write_module(1);
+
+  // Compiling the query creates the cache entry.
+  if (!run_query(aZorba, "1"))
+    return false;
+
+  std::string const entry = cache_entry();
+  if (entry.empty())
+  {
+    std::cerr << "no cache entry created" << std::endl;
+    return false;
+  }
+
+  std::string const plan = read_file(entry);
+
+  // Compiling it again uses the entry, and leaves it alone.
+  if (!run_query(aZorba, "1"))
+    return false;
+
+  if (cache_entry() != entry || read_file(entry) != plan)
+  {
+    std::cerr << "cache entry rewritten on a hit" << std::endl;
+    return false;
+  }
+
+  // Changing the imported module invalidates the entry.
+  write_module(2);
+
+  if (!run_query(aZorba, "2"))
+    return false;
+
+  if (cache_entry() != entry || read_file(entry) == plan)
+  {
+    std::cerr << "cache entry not replaced" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+#endif /* ZORBA_WITH_FILE_ACCESS */
+
+
+int plan_cache(int argc, char* argv[])
+{
+  int result = 0;
+
+#ifdef ZORBA_WITH_FILE_ACCESS
+  void* lStore = zorba::StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+
+  cache_dir = fs::curdir();
+  fs::append(cache_dir, "plan_cache.d");
+  module_path = fs::curdir();
+  fs::append(module_path, "plan_cache_module.xq");
+
+  if (fs::get_type(cache_dir) == fs::directory)
+  {
+    fs::iterator dir(cache_dir);
+    while (dir.next())
+    {
+      std::string path(cache_dir);
+      fs::append(path, dir->name);
+      fs::remove(path);
+    }
+  }
+
+  Properties::instance().setPlanCacheDir(cache_dir);
+
+  try
+  {
+    if (!plan_cache_test(lZorba))
+      result = 1;
+  }
+  catch (ZorbaException const& e)
+  {
+    std::cerr << e << std::endl;
+    result = 2;
+  }
+
+  Properties::instance().setPlanCacheDir("");
+
+  lZorba->shutdown();
+  zorba::StoreManager::shutdownStore(lStore);
+#endif /* ZORBA_WITH_FILE_ACCESS */
+
+  return result;
+}
+/* vim:set et sw=2 ts=2: */